@@ -16,7 +16,6 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 
-#include <tr1/unordered_map>
 
 using namespace wali::domains::binrel;
 using std::endl;
@@ -65,16 +64,6 @@ namespace wali
       std::map<bdd, sem_elem_t, BddLessThan> star_cache;
       */
 
-      typedef std::pair< bdd, bool> StarCacheKey;
-      struct StarCacheHash
-      {
-        size_t operator() (StarCacheKey k) const
-        {
-          return k.first.id() << 1 & (int) k.second;
-        }
-      };
-      std::tr1::unordered_map< StarCacheKey, sem_elem_t, StarCacheHash> star_cache;
-
 
       namespace details {
 
@@ -196,6 +185,45 @@ namespace wali
         // BinRel* br = static_cast<BinRel*>(se)
         return br;
       }
+
+      // The layout and detensor method picked by the macros in BinRel.hpp
+      static BddContext::TensorLayout defaultTensorLayout()
+      {
+#if (TENSOR_MAX_AFFINITY == 1)
+        return BddContext::MaxAffinityLayout;
+#elif (TENSOR_MIN_AFFINITY == 1)
+        return BddContext::MinAffinityLayout;
+#elif (TENSOR_MATCHED_PAREN == 1)
+        return BddContext::MatchedParenLayout;
+#else
+        return BddContext::BaseMaxAffinityTensorMixedLayout;
+#endif
+      }
+
+      static BddContext::DetensorMethod defaultDetensorMethod()
+      {
+#if (DETENSOR_TOGETHER == 1)
+        return BddContext::DetensorTogether;
+#else
+        return BddContext::DetensorBitByBit;
+#endif
+      }
+
+      // Appends the bdd variables of 'domains' to 'order' the way
+      // fdd_extdomain allocates the domains of one call: interleaved bit
+      // by bit.
+      static void appendInterleaved(std::vector<int> const & domains, std::vector<int> & order)
+      {
+        int mostBits = 0;
+        for(size_t d = 0; d < domains.size(); ++d)
+          mostBits = std::max(mostBits, fdd_varnum(domains[d]));
+        for(int bit = 0; bit < mostBits; ++bit){
+          for(size_t d = 0; d < domains.size(); ++d){
+            if(bit < fdd_varnum(domains[d]))
+              order.push_back(fdd_vars(domains[d])[bit]);
+          }
+        }
+      }
     } // namespace binrel
   } // namespace domains
 } // namespace wali
@@ -203,7 +231,8 @@ namespace wali
 
 BddContext::BddContext(int bddMemSize, int cacheSize) :
   std::map< const std::string, bddinfo_t>(),
-  count(0)
+  count(0),
+  memo(BINREL_MEMO_CAPACITY)
 {
   //If buddy has not been initialized, initialize it.
   //We handle this by keeping track of the number of BddContext objects
@@ -263,6 +292,10 @@ BddContext::BddContext(int bddMemSize, int cacheSize) :
   cachedTensorOne = NULL;
   cachedTensorZero = NULL;
 
+  tensorLayout = defaultTensorLayout();
+  tensorLayoutSet = false;
+  detensorMethod = defaultDetensorMethod();
+
 #ifdef BINREL_STATS
   numCompose = 0;
   numUnion = 0;
@@ -273,6 +306,8 @@ BddContext::BddContext(int bddMemSize, int cacheSize) :
   numTranspose = 0;
   numDetensor = 0;
   numDetensorTranspose = 0;
+  numMemoLookups = 0;
+  numMemoHits = 0;
 #endif
   populateCache();
 }
@@ -296,6 +331,11 @@ BddContext::BddContext(const BddContext& other) :
   commonBddContextSet23(other.commonBddContextSet23),
   commonBddContextSet13(other.commonBddContextSet13),
   commonBddContextId13(other.commonBddContextId13),
+  varGroups(other.varGroups),
+  tensorLayout(other.tensorLayout),
+  tensorLayoutSet(other.tensorLayoutSet),
+  detensorMethod(other.detensorMethod),
+  memo(other.memo.getCapacity()),
   cachedBaseOne(other.cachedBaseOne),
   cachedBaseZero(other.cachedBaseZero),
   cachedTensorOne(other.cachedTensorOne),
@@ -314,6 +354,8 @@ BddContext::BddContext(const BddContext& other) :
   numTranspose = 0;
   numDetensor = 0;
   numDetensorTranspose = 0;
+  numMemoLookups = 0;
+  numMemoHits = 0;
 #endif
   populateCache();
 }
@@ -337,6 +379,12 @@ BddContext& BddContext::operator = (const BddContext& other)
     commonBddContextSet23=other.commonBddContextSet23;
     commonBddContextSet13=other.commonBddContextSet13;
     commonBddContextId13=other.commonBddContextId13;
+    varGroups=other.varGroups;
+    tensorLayout=other.tensorLayout;
+    tensorLayoutSet=other.tensorLayoutSet;
+    detensorMethod=other.detensorMethod;
+    memo.clear();
+    memo.setCapacity(other.memo.getCapacity());
     cachedBaseOne=other.cachedBaseOne;
     cachedBaseZero=other.cachedBaseZero;
     cachedTensorOne=other.cachedTensorOne;
@@ -371,6 +419,9 @@ BddContext::~BddContext()
   commonBddContextSet13 = bddtrue;
   commonBddContextId13 = bddtrue;
 
+  //Let go of the memoized bdds before buddy goes away.
+  memo.clear();
+
   //Delete cached BinRel objects.
   cachedBaseOne = NULL;
   cachedBaseZero = NULL;
@@ -384,7 +435,6 @@ BddContext::~BddContext()
   numBddContexts--;
   if(numBddContexts == 0){
     //All BddContexts are now dead. So we must shutdown buddy.
-    star_cache.clear();
     if(bdd_isrunning() != 0)
       bdd_done();
     //Now clear the reverse map.
@@ -413,6 +463,7 @@ void BddContext::createIntVars(const std::vector<std::map<std::string, int> >& v
   // First work through the variable list and create the vocabulary structure
   // This will collect information about the fdds to be created in buddy
   for(std::vector<std::map<std::string, int> >::const_iterator cvi = vars.begin(); cvi != vars.end(); ++cvi){
+    std::vector<bddinfo_t> group;
     for(std::map<std::string, int>::const_iterator cmi = (*cvi).begin(); cmi != (*cvi).end(); ++cmi){
       if(cmi->second < 2){
         *waliErr << "I haven't tested the library for int size less than 2";
@@ -421,7 +472,9 @@ void BddContext::createIntVars(const std::vector<std::map<std::string, int> >& v
       bddinfo_t varInfo = new BddInfo;
       varInfo->maxVal = cmi->second;
       (*this)[cmi->first] = varInfo;
+      group.push_back(varInfo);
     }
+    varGroups.push_back(group);
   }
 
 #if (TENSOR_MAX_AFFINITY == 1)
@@ -735,6 +788,9 @@ void BddContext::createIntVars(const std::vector<std::map<std::string, int> >& v
     idx2Name[varInfo->tensor2Extra] = ci->first + "_t2''";
   } 
 
+  if(tensorLayoutSet)
+    applyTensorLayout();
+
 #if (NWA_DETENSOR == 1)
   setupLevelArray();
 #endif
@@ -750,6 +806,9 @@ void BddContext::setupCachedBdds()
 {
   int vari;
 
+  // The vocabulary changed, and with it one and star.
+  memo.clear();
+
   // Update bddPairs
   // We will first create arrays for each of columns
   int * baseLhs = new int[this->size()];
@@ -849,16 +908,8 @@ void BddContext::setupCachedBdds()
   commonBddContextSet13 &= fdd_makeset(tensor2Lhs, this->size());
   assert(this->size() == 0 || (baseSecBddContextSet != bddfalse && tensorSecBddContextSet != bddfalse
         && tensorSecBddContextSet != bddfalse && commonBddContextSet23 != bddfalse && commonBddContextSet13 != bddfalse));
-#if (DETENSOR_TOGETHER == 1)
-  // Somehow make this efficient
-  for(std::map<const std::string, bddinfo_t>::const_iterator ci = this->begin(); ci != this->end(); ++ci){
-    bddinfo_t varInfo = ci->second;
-    commonBddContextId23 = commonBddContextId23 &
-      fdd_equals(varInfo->tensor1Rhs, varInfo->tensor2Lhs);
-    commonBddContextId13 = commonBddContextId13 & 
-      fdd_equals(varInfo->tensor1Lhs, varInfo->tensor2Lhs);
-  }
-#endif
+  if(detensorMethod == DetensorTogether)
+    setupDetensorIds();
 
   // Create cached BinRel objects
   // Somehow make this efficient
@@ -945,7 +996,12 @@ void BddContext::addIntVar(std::string name, unsigned size)
   varInfo->tensor2Extra = base + 2;
   //release mutex
 
+  varGroups.push_back(std::vector<bddinfo_t>(1, varInfo));
+  if(tensorLayoutSet)
+    applyTensorLayout();
+
   //We will now update all the cached bdds and bddpairs 
+  memo.clear();
   //update bddPairs
   fdd_setpair(baseSwap.get(), varInfo->baseLhs, varInfo->baseRhs);
   fdd_setpair(baseSwap.get(), varInfo->baseRhs, varInfo->baseLhs);
@@ -997,6 +1053,245 @@ void BddContext::addIntVar(std::string name, unsigned size)
   //release mutex
 }
 
+void BddContext::setupDetensorIds()
+{
+  // Somehow make this efficient
+  commonBddContextId23 = bddtrue;
+  commonBddContextId13 = bddtrue;
+  for(std::map<const std::string, bddinfo_t>::const_iterator ci = this->begin(); ci != this->end(); ++ci){
+    bddinfo_t varInfo = ci->second;
+    commonBddContextId23 = commonBddContextId23 &
+      fdd_equals(varInfo->tensor1Rhs, varInfo->tensor2Lhs);
+    commonBddContextId13 = commonBddContextId13 & 
+      fdd_equals(varInfo->tensor1Lhs, varInfo->tensor2Lhs);
+  }
+}
+
+void BddContext::setTensorLayout(TensorLayout layout)
+{
+#if (NWA_DETENSOR == 1)
+  // The Nwa based detensor caches bdd levels, and needs this one.
+  if(layout != MatchedParenLayout){
+    *waliErr << "[WARNING] NWA_DETENSOR only works with MatchedParenLayout." << endl;
+    assert(false);
+  }
+  return;
+#else
+  tensorLayout = layout;
+  tensorLayoutSet = true;
+  applyTensorLayout();
+#endif
+}
+
+BddContext::TensorLayout BddContext::getTensorLayout() const
+{
+  return tensorLayout;
+}
+
+void BddContext::setDetensorMethod(DetensorMethod method)
+{
+  detensorMethod = method;
+  if(detensorMethod == DetensorTogether)
+    setupDetensorIds();
+}
+
+BddContext::DetensorMethod BddContext::getDetensorMethod() const
+{
+  return detensorMethod;
+}
+
+void BddContext::applyTensorLayout()
+{
+  // The levels this context wants, top to bottom, built the same way
+  // createIntVars would have allocated them under each layout macro.
+  std::vector<int> wanted;
+  std::vector<int> domains;
+  typedef std::vector<std::vector<bddinfo_t> >::const_iterator GroupIter;
+  typedef std::vector<bddinfo_t>::const_iterator VarIter;
+
+  switch(tensorLayout){
+    case MaxAffinityLayout:
+      for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+        domains.clear();
+        for(VarIter n = g->begin(); n != g->end(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->baseLhs);
+          domains.push_back(varInfo->baseRhs);
+          domains.push_back(varInfo->baseExtra);
+          domains.push_back(varInfo->tensor1Lhs);
+          domains.push_back(varInfo->tensor1Rhs);
+          domains.push_back(varInfo->tensor1Extra);
+          domains.push_back(varInfo->tensor2Lhs);
+          domains.push_back(varInfo->tensor2Rhs);
+          domains.push_back(varInfo->tensor2Extra);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      break;
+    case MinAffinityLayout:
+      for(int vocab = 0; vocab < 3; ++vocab){
+        for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+          domains.clear();
+          for(VarIter n = g->begin(); n != g->end(); ++n){
+            bddinfo_t varInfo = *n;
+            if(vocab == 0){
+              domains.push_back(varInfo->baseLhs);
+              domains.push_back(varInfo->baseRhs);
+              domains.push_back(varInfo->baseExtra);
+            }else if(vocab == 1){
+              domains.push_back(varInfo->tensor1Lhs);
+              domains.push_back(varInfo->tensor1Rhs);
+              domains.push_back(varInfo->tensor1Extra);
+            }else{
+              domains.push_back(varInfo->tensor2Lhs);
+              domains.push_back(varInfo->tensor2Rhs);
+              domains.push_back(varInfo->tensor2Extra);
+            }
+          }
+          appendInterleaved(domains, wanted);
+        }
+      }
+      break;
+    case BaseMaxAffinityTensorMixedLayout:
+      for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+        domains.clear();
+        for(VarIter n = g->begin(); n != g->end(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->baseLhs);
+          domains.push_back(varInfo->baseRhs);
+          domains.push_back(varInfo->baseExtra);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+        domains.clear();
+        for(VarIter n = g->begin(); n != g->end(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->tensor1Lhs);
+          domains.push_back(varInfo->tensor1Rhs);
+          domains.push_back(varInfo->tensor1Extra);
+          domains.push_back(varInfo->tensor2Lhs);
+          domains.push_back(varInfo->tensor2Rhs);
+          domains.push_back(varInfo->tensor2Extra);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      break;
+    case MatchedParenLayout:
+      for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+        domains.clear();
+        for(VarIter n = g->begin(); n != g->end(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->baseExtra);
+          domains.push_back(varInfo->baseRhs);
+          domains.push_back(varInfo->baseLhs);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      for(GroupIter g = varGroups.begin(); g != varGroups.end(); ++g){
+        domains.clear();
+        for(VarIter n = g->begin(); n != g->end(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->tensor1Extra);
+          domains.push_back(varInfo->tensor1Rhs);
+          domains.push_back(varInfo->tensor1Lhs);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      for(std::vector<std::vector<bddinfo_t> >::const_reverse_iterator g = varGroups.rbegin(); g != varGroups.rend(); ++g){
+        domains.clear();
+        for(std::vector<bddinfo_t>::const_reverse_iterator n = g->rbegin(); n != g->rend(); ++n){
+          bddinfo_t varInfo = *n;
+          domains.push_back(varInfo->tensor2Lhs);
+          domains.push_back(varInfo->tensor2Rhs);
+          domains.push_back(varInfo->tensor2Extra);
+        }
+        appendInterleaved(domains, wanted);
+      }
+      break;
+  }
+
+  // Put the wanted order into the levels this context's variables occupy
+  // now, leaving every other variable (including ProgramBddContext's
+  // scratch registers) where it is.
+  int numVars = bdd_varnum();
+  std::vector<bool> ours(numVars, false);
+  for(size_t i = 0; i < wanted.size(); ++i)
+    ours[wanted[i]] = true;
+
+  std::vector<int> order(numVars);
+  size_t next = 0;
+  for(int level = 0; level < numVars; ++level){
+    int var = bdd_level2var(level);
+    order[level] = ours[var] ? wanted[next++] : var;
+  }
+  assert(next == wanted.size());
+  if(numVars > 0)
+    bdd_setvarorder(&order[0]);
+}
+
+BddContext::TensorLayout BddContext::autoTune(std::vector<binrel_t> const & samples)
+{
+#if (NWA_DETENSOR == 1)
+  return tensorLayout;
+#else
+  TensorLayout candidates[] = {
+    MaxAffinityLayout,
+    MinAffinityLayout,
+    BaseMaxAffinityTensorMixedLayout,
+    MatchedParenLayout
+  };
+
+  TensorLayout best = tensorLayout;
+  long bestNodes = -1;
+  for(size_t c = 0; c < sizeof(candidates)/sizeof(candidates[0]); ++c){
+    setTensorLayout(candidates[c]);
+
+    long nodes = 0;
+    for(size_t i = 0; i < samples.size(); ++i){
+      binrel_t tensored = samples[i]->Kronecker(samples[(i + 1) % samples.size()]);
+      binrel_t squared = tensored->Compose(tensored);
+      nodes += bdd_nodecount(tensored->getBdd());
+      nodes += bdd_nodecount(squared->getBdd());
+      nodes += bdd_nodecount(squared->Eq23Project()->getBdd());
+      nodes += bdd_nodecount(tensored->Eq13Project()->getBdd());
+    }
+    if(bestNodes < 0 || nodes < bestNodes){
+      bestNodes = nodes;
+      best = candidates[c];
+    }
+  }
+
+  setTensorLayout(best);
+  return best;
+#endif
+}
+
+void BddContext::reorderNow()
+{
+#if (NWA_DETENSOR == 1)
+  *waliErr << "[WARNING] Reordering is not supported with NWA_DETENSOR." << endl;
+  assert(false);
+#else
+  // BuDDy only sifts variable blocks, and bdd_setvarorder (which
+  // applyTensorLayout uses) refuses to run while any exist, so each
+  // variable gets its own block just for this reorder
+  bdd_varblockall();
+  bdd_reorder(BDD_REORDER_SIFT);
+  bdd_clrvarblocks();
+#endif
+}
+
+void BddContext::setMemoCapacity(size_t capacity)
+{
+  memo.setCapacity(capacity);
+}
+
+size_t BddContext::getMemoCapacity() const
+{
+  return memo.getCapacity();
+}
+
 void BddContext::populateCache()
 {
   bdd baseId = bddtrue;
@@ -1092,14 +1387,17 @@ binrel_t BinRel::Compose( binrel_t that ) const
     return new BinRel(*this);
 
   bdd c;
-  if(!isTensored){
-    bdd temp1 = bdd_replace(that->rel, con->baseRightShift.get());
-    bdd temp2 = bdd_relprod(rel, temp1, con->baseSecBddContextSet);
-    c = bdd_replace(temp2, con->baseRestore.get());
-  }else{
-    bdd temp1 = bdd_replace(that->rel, con->tensorRightShift.get());
-    bdd temp2 = bdd_relprod(rel, temp1, con->tensorSecBddContextSet);
-    c = bdd_replace(temp2, con->tensorRestore.get());
+  if(!lookupMemo(BinRelMemo::ComposeOp, that->rel, c)){
+    if(!isTensored){
+      bdd temp1 = bdd_replace(that->rel, con->baseRightShift.get());
+      bdd temp2 = bdd_relprod(rel, temp1, con->baseSecBddContextSet);
+      c = bdd_replace(temp2, con->baseRestore.get());
+    }else{
+      bdd temp1 = bdd_replace(that->rel, con->tensorRightShift.get());
+      bdd temp2 = bdd_relprod(rel, temp1, con->tensorSecBddContextSet);
+      c = bdd_replace(temp2, con->tensorRestore.get());
+    }
+    con->memo.insert(BinRelMemo::ComposeOp, rel, that->rel, isTensored, c);
   }
 
   binrel_t ret = new BinRel(con,c,isTensored);
@@ -1130,8 +1428,14 @@ binrel_t BinRel::Union( binrel_t that ) const
   if (that->isZero())
     return new BinRel(*this);
 
+  bdd c;
+  if(!lookupMemo(BinRelMemo::UnionOp, that->rel, c)){
+    c = rel | that->rel;
+    con->memo.insert(BinRelMemo::UnionOp, rel, that->rel, isTensored, c);
+  }
+
   // Keep zero/one unique
-  binrel_t ret = new BinRel(con,rel | that->rel, isTensored);
+  binrel_t ret = new BinRel(con, c, isTensored);
   if(ret->isOne())
     return static_cast<BinRel*>(ret->one().get_ptr());
   //can't be zero.
@@ -1270,11 +1574,12 @@ binrel_t BinRel::Eq23Project() const
     return new BinRel(con,bddfalse, false);
   }
 #endif
-#if (DETENSOR_TOGETHER == 1)
-  bdd rel1 = rel & con->commonBddContextId23; 
-  bdd rel2 = bdd_exist(rel1, con->commonBddContextSet23);
-  bdd c = bdd_replace(rel2, con->move2Base.get());
-#else
+  bdd c;
+  if(con->detensorMethod == BddContext::DetensorTogether){
+    bdd rel1 = rel & con->commonBddContextId23; 
+    bdd rel2 = bdd_exist(rel1, con->commonBddContextSet23);
+    c = bdd_replace(rel2, con->move2Base.get());
+  }else{
   bdd rel1 = rel;
   for(std::map<const std::string, bddinfo_t>::const_iterator citer = con->begin(); citer != con->end(); ++citer){
     bddinfo_t varInfo = (*citer).second;
@@ -1282,8 +1587,8 @@ binrel_t BinRel::Eq23Project() const
     rel1 = rel1 & id;
     rel1 = bdd_exist(rel1, fdd_ithset(varInfo->tensor1Rhs) & fdd_ithset(varInfo->tensor2Lhs));
   }
-  bdd c = bdd_replace(rel1, con->move2Base.get());
-#endif
+  c = bdd_replace(rel1, con->move2Base.get());
+  }
   binrel_t ret = new BinRel(con,c,false);
   if(ret->isZero())
     return static_cast<BinRel*>(ret->zero().get_ptr());
@@ -1303,11 +1608,12 @@ binrel_t BinRel::Eq13Project() const
     return new BinRel(con,bddfalse, false);
   }
 #endif
-#if (DETENSOR_TOGETHER == 1)
-  bdd rel1 = rel & con->commonBddContextId13; 
-  bdd rel2 = bdd_exist(rel1, con->commonBddContextSet13);
-  bdd c = bdd_replace(rel2, con->move2BaseTwisted.get());
-#else
+  bdd c;
+  if(con->detensorMethod == BddContext::DetensorTogether){
+    bdd rel1 = rel & con->commonBddContextId13; 
+    bdd rel2 = bdd_exist(rel1, con->commonBddContextSet13);
+    c = bdd_replace(rel2, con->move2BaseTwisted.get());
+  }else{
   bdd rel1 = rel;
   for(std::map<const std::string, bddinfo_t>::const_iterator citer = con->begin(); citer != con->end(); ++citer){
     bddinfo_t varInfo = (*citer).second;
@@ -1315,8 +1621,8 @@ binrel_t BinRel::Eq13Project() const
     rel1 = rel1 & id;
     rel1 = bdd_exist(rel1, fdd_ithset(varInfo->tensor1Lhs) & fdd_ithset(varInfo->tensor2Lhs));
   }
-  bdd c = bdd_replace(rel1, con->move2BaseTwisted.get());
-#endif
+  c = bdd_replace(rel1, con->move2BaseTwisted.get());
+  }
   binrel_t ret = new BinRel(con,c,false);
   if(ret->isZero())
     return static_cast<BinRel*>(ret->zero().get_ptr());
@@ -1326,24 +1632,231 @@ binrel_t BinRel::Eq13Project() const
 }
 
 
+// ////////////////////////////
+// Moving relations between contexts
+
+namespace
+{
+  // The nine fdd domains of a variable, in the order BddInfo lists them
+  const unsigned NUM_DOMAINS = 9;
+
+  int domainOf(BddInfo const & info, unsigned d)
+  {
+    switch(d){
+      case 0: return info.baseLhs;
+      case 1: return info.baseRhs;
+      case 2: return info.baseExtra;
+      case 3: return info.tensor1Lhs;
+      case 4: return info.tensor1Rhs;
+      case 5: return info.tensor1Extra;
+      case 6: return info.tensor2Lhs;
+      case 7: return info.tensor2Rhs;
+      default: return info.tensor2Extra;
+    }
+  }
+
+  // A BDD node in terms of the vocabulary rather than BDD levels. Nodes
+  // 0 and 1 are bddfalse and bddtrue; the rest are numbered from 2, and
+  // only refer to nodes numbered before them.
+  struct PortableNode
+  {
+    unsigned var;     // index into PortableBdd::vars
+    unsigned domain;  // which of the variable's domains (see domainOf)
+    unsigned bit;     // which bit of that domain
+    unsigned low;
+    unsigned high;
+  };
+
+  struct PortableBdd
+  {
+    std::vector<std::pair<std::string, unsigned> > vars; // name, maxVal
+    std::vector<PortableNode> nodes;
+    unsigned root;
+  };
+
+  unsigned flatten(bdd const & b,
+                   std::map<int, PortableNode> const & levels,
+                   std::map<int, unsigned> & seen,
+                   std::vector<PortableNode> & nodes)
+  {
+    if(b == bddfalse)
+      return 0;
+    if(b == bddtrue)
+      return 1;
+    std::map<int, unsigned>::const_iterator found = seen.find(b.id());
+    if(found != seen.end())
+      return found->second;
+
+    std::map<int, PortableNode>::const_iterator level = levels.find(bdd_var(b));
+    if(level == levels.end()){
+      *waliErr << "[ERROR] BinRel::save: BDD variable " << bdd_var(b)
+        << " is not in the relation's vocabulary" << endl;
+      assert(false);
+    }
+    PortableNode node = level->second;
+    node.low = flatten(bdd_low(b), levels, seen, nodes);
+    node.high = flatten(bdd_high(b), levels, seen, nodes);
+    nodes.push_back(node);
+    unsigned id = static_cast<unsigned>(nodes.size() + 1);
+    seen[b.id()] = id;
+    return id;
+  }
+
+  PortableBdd makePortable(BddContext const & con, bdd const & rel)
+  {
+    PortableBdd ret;
+    std::map<int, PortableNode> levels;
+    for(BddContext::const_iterator it = con.begin(); it != con.end(); ++it){
+      PortableNode where = PortableNode();
+      where.var = static_cast<unsigned>(ret.vars.size());
+      ret.vars.push_back(std::make_pair(it->first, it->second->maxVal));
+      for(where.domain = 0; where.domain < NUM_DOMAINS; ++where.domain){
+        int domain = domainOf(*it->second, where.domain);
+        int * vars = fdd_vars(domain);
+        for(where.bit = 0; where.bit < unsigned(fdd_varnum(domain)); ++where.bit)
+          levels[vars[where.bit]] = where;
+      }
+    }
+    std::map<int, unsigned> seen;
+    ret.root = flatten(rel, levels, seen, ret.nodes);
+    return ret;
+  }
+
+  // Rebuilds 'p' in 'target'. Returns false if 'target' does not have
+  // the vocabulary 'p' was saved with, or 'p' is not well formed.
+  bool rebuild(BddContext const & target, PortableBdd const & p, bdd & out)
+  {
+    std::vector<bddinfo_t> infos;
+    for(size_t v = 0; v < p.vars.size(); ++v){
+      BddContext::const_iterator it = target.find(p.vars[v].first);
+      if(it == target.end() || it->second->maxVal != p.vars[v].second)
+        return false;
+      infos.push_back(it->second);
+    }
+    if(infos.size() != target.size())
+      return false;
+
+    std::vector<bdd> built;
+    built.push_back(bddfalse);
+    built.push_back(bddtrue);
+    for(size_t n = 0; n < p.nodes.size(); ++n){
+      PortableNode const & node = p.nodes[n];
+      if(node.var >= infos.size() || node.domain >= NUM_DOMAINS
+          || node.low >= built.size() || node.high >= built.size())
+        return false;
+      int domain = domainOf(*infos[node.var], node.domain);
+      if(node.bit >= unsigned(fdd_varnum(domain)))
+        return false;
+      bdd test = bdd_ithvar(fdd_vars(domain)[node.bit]);
+      built.push_back(bdd_ite(test, built[node.high], built[node.low]));
+    }
+    if(p.root >= built.size())
+      return false;
+    out = built[p.root];
+    return true;
+  }
+}
+
+binrel_t BinRel::transferTo(BddContext const * target) const
+{
+  if(target == con)
+    return new BinRel(*this);
+  bdd moved;
+  if(!rebuild(*target, makePortable(*con, rel), moved)){
+    *waliErr << "[ERROR] BinRel::transferTo: the target context has a "
+      << "different vocabulary" << endl;
+    assert(false);
+    return new BinRel(target, bddfalse, isTensored);
+  }
+  return new BinRel(target, moved, isTensored);
+}
+
+void BinRel::save(std::ostream& o) const
+{
+  PortableBdd p = makePortable(*con, rel);
+  o << "binrel " << (isTensored ? 1 : 0) << " " << p.vars.size() << " "
+    << p.nodes.size() << " " << p.root << "\n";
+  for(size_t v = 0; v < p.vars.size(); ++v)
+    o << p.vars[v].first.size() << " " << p.vars[v].first << " "
+      << p.vars[v].second << "\n";
+  for(size_t n = 0; n < p.nodes.size(); ++n){
+    PortableNode const & node = p.nodes[n];
+    o << node.var << " " << node.domain << " " << node.bit << " "
+      << node.low << " " << node.high << "\n";
+  }
+}
+
+binrel_t BinRel::load(BddContext const * target, std::istream& in)
+{
+  PortableBdd p;
+  std::string magic;
+  int tensored = 0;
+  size_t numVars = 0, numNodes = 0;
+  bool ok = (in >> magic >> tensored >> numVars >> numNodes >> p.root)
+    && magic == "binrel" && (tensored == 0 || tensored == 1)
+    && numVars == target->size();
+  for(size_t v = 0; ok && v < numVars; ++v){
+    size_t length = 0;
+    unsigned maxVal = 0;
+    ok = static_cast<bool>(in >> length) && in.get() == ' ';
+    std::string name(length, '\0');
+    ok = ok && in.read(&name[0], static_cast<std::streamsize>(length))
+      && (in >> maxVal);
+    p.vars.push_back(std::make_pair(name, maxVal));
+  }
+  for(size_t n = 0; ok && n < numNodes; ++n){
+    PortableNode node;
+    ok = static_cast<bool>(in >> node.var >> node.domain >> node.bit
+                           >> node.low >> node.high);
+    p.nodes.push_back(node);
+  }
+  bdd loaded;
+  if(!ok || !rebuild(*target, p, loaded)){
+    *waliErr << "[ERROR] BinRel::load: malformed relation, or the target "
+      << "context has a different vocabulary" << endl;
+    assert(false);
+    return new BinRel(target, bddfalse, tensored == 1);
+  }
+  return new BinRel(target, loaded, tensored == 1);
+}
+
+
 
 // ////////////////////////////
 // SemElem Interface functions
 
 wali::sem_elem_t BinRel::star()
 {
-  StarCacheKey k(getBdd(), isTensored);
-  if (star_cache.find(k) == star_cache.end()) {
+  bdd c;
+  if(!lookupMemo(BinRelMemo::StarOp, bddtrue, c)){
     sem_elem_t w = combine(one().get_ptr());
     sem_elem_t wn = w->extend(w);
     while(!w->equal(wn)) {
       w = wn;
       wn = wn->extend(wn);
     }
-    star_cache[k] = wn;
+    c = convert(wn.get_ptr())->getBdd();
+    con->memo.insert(BinRelMemo::StarOp, rel, bddtrue, isTensored, c);
   }
 
-  return star_cache[k];
+  // Star contains one, so it's never zero
+  binrel_t ret = new BinRel(con, c, isTensored);
+  if(ret->isOne())
+    return ret->one();
+  return ret;
+}
+
+bool BinRel::lookupMemo(BinRelMemo::Op op, bdd const & other, bdd & result) const
+{
+#ifdef BINREL_STATS
+  con->numMemoLookups++;
+#endif
+  if(!con->memo.lookup(op, rel, other, isTensored, result))
+    return false;
+#ifdef BINREL_STATS
+  con->numMemoHits++;
+#endif
+  return true;
 }
 
 
@@ -1451,6 +1964,10 @@ std::ostream& BddContext::printStats( std::ostream& o) const
   o << "#Transpose: " << numTranspose << endl;
   o << "#Eq23Project: " << numDetensor << endl;
   o << "#Eq13Project: " << numDetensorTranspose << endl;
+  o << "#MemoHits: " << numMemoHits << " / " << numMemoLookups;
+  if(numMemoLookups > 0)
+    o << " (" << (100.0 * numMemoHits / numMemoLookups) << "%)";
+  o << endl;
   return o;
 }
 
@@ -1465,9 +1982,92 @@ void BddContext::resetStats()
   numTranspose = 0;
   numDetensor = 0;
   numDetensorTranspose = 0;
+  numMemoLookups = 0;
+  numMemoHits = 0;
 }
 #endif //BINREL_STATS
 
+///////////////////////////////
+// BinRelMemo
+
+BinRelMemo::BinRelMemo(size_t capacity)
+  : capacity(capacity)
+{}
+
+BinRelMemo::Key BinRelMemo::makeKey(Op op, bdd const & lhs, bdd const & rhs, bool tensored)
+{
+  Key k;
+  k.op = op;
+  k.lhs = lhs.id();
+  k.rhs = rhs.id();
+  k.tensored = tensored;
+  // Union commutes, so both orders share an entry
+  if(op == UnionOp && k.rhs < k.lhs)
+    std::swap(k.lhs, k.rhs);
+  return k;
+}
+
+size_t BinRelMemo::KeyHash::operator()(Key const & k) const
+{
+  size_t seed = 0;
+  boost::hash_combine(seed, (int) k.op);
+  boost::hash_combine(seed, k.lhs);
+  boost::hash_combine(seed, k.rhs);
+  boost::hash_combine(seed, k.tensored);
+  return seed;
+}
+
+bool BinRelMemo::lookup(Op op, bdd const & lhs, bdd const & rhs, bool tensored, bdd & result)
+{
+  if(capacity == 0)
+    return false;
+  boost::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator it =
+    index.find(makeKey(op, lhs, rhs, tensored));
+  if(it == index.end())
+    return false;
+  // Mark as most recently used
+  entries.splice(entries.begin(), entries, it->second);
+  result = it->second->result;
+  return true;
+}
+
+void BinRelMemo::insert(Op op, bdd const & lhs, bdd const & rhs, bool tensored, bdd const & result)
+{
+  if(capacity == 0)
+    return;
+  Key k = makeKey(op, lhs, rhs, tensored);
+  if(index.find(k) != index.end())
+    return;
+
+  Entry e;
+  e.key = k;
+  e.lhs = lhs;
+  e.rhs = rhs;
+  e.result = result;
+  entries.push_front(e);
+  index[k] = entries.begin();
+
+  while(entries.size() > capacity){
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+void BinRelMemo::clear()
+{
+  index.clear();
+  entries.clear();
+}
+
+void BinRelMemo::setCapacity(size_t c)
+{
+  capacity = c;
+  while(entries.size() > capacity){
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
 ///////////////////////////////
 
 namespace wali {
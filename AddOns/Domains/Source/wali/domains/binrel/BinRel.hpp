@@ -19,6 +19,7 @@
         for more general tensor products.
  */
 
+#include <list>
 #include <map>
 #include <vector>
 #include <utility>
@@ -28,6 +29,7 @@
 #include <boost/shared_ptr.hpp> // It'd be nice to include the standard version but there are too many ways to get it.
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/function.hpp>
 
 #include "wali/wfa/WeightMaker.hpp"
@@ -85,6 +87,9 @@
  * x1t2 x1t2' x1t2'' y1t2 y1t2' y1t2'' x2t2 x2t2' x2t2'' y2t2 y2t2' y2t2'' z1t2 z1t2' z1t2'' w1t2 w1t2' w1t2'' z2t2 z2t2' z2t2'' w2t2 w2t2' w2t2''
  *
  * The tensor choice is determined by setting **exactly one** macro to 1.
+ * This only picks how the bdd variables are first allocated; a BddContext
+ * can be switched to another of these orders at runtime with
+ * BddContext::setTensorLayout, or pick one itself with BddContext::autoTune.
  **/
 #define TENSOR_MAX_AFFINITY 1
 #define TENSOR_MIN_AFFINITY 0
@@ -110,6 +115,8 @@
  * the detensored bdd.
  *
  * The detensor choice is made by setting **exactly one** macro to 1
+ * The choice between (1) and (2) is only the default for new BddContexts;
+ * see BddContext::setDetensorMethod.
  **/
 #define DETENSOR_TOGETHER 0
 #define DETENSOR_BIT_BY_BIT 1
@@ -130,6 +137,12 @@
 **/
 #define BINREL_STATS
 
+/**
+  The number of Compose/Union/star results each BddContext remembers by
+  default (see BddContext::setMemoCapacity). 0 switches the memo off.
+**/
+#define BINREL_MEMO_CAPACITY 4096
+
 
 /// This checks two implementations of the 'subsumes' operation (subset) off
 /// each other (one faster, one simpler)
@@ -182,6 +195,67 @@ namespace wali
         */
       typedef long long int StatCount;
 
+      /**
+       * A bounded table of results of BinRel operations, keyed on the ids of
+       * the operand bdds, that forgets the least recently used entry when
+       * full.
+       *
+       * Every entry holds on to its operand and result bdds. That keeps
+       * their nodes from being garbage collected, so an id in the table
+       * always still names the bdd it was computed for.
+       */
+      class BinRelMemo
+      {
+        public:
+          enum Op { ComposeOp, UnionOp, StarOp };
+
+          explicit BinRelMemo(size_t capacity);
+
+          /// If the result of 'op' on (lhs, rhs) is known, puts it in
+          /// 'result' and returns true.
+          bool lookup(Op op, bdd const & lhs, bdd const & rhs, bool tensored, bdd & result);
+          void insert(Op op, bdd const & lhs, bdd const & rhs, bool tensored, bdd const & result);
+
+          void clear();
+          size_t size() const { return entries.size(); }
+          size_t getCapacity() const { return capacity; }
+          void setCapacity(size_t capacity);
+
+        private:
+          struct Key
+          {
+            Op op;
+            int lhs;
+            int rhs;
+            bool tensored;
+
+            bool operator==(Key const & other) const {
+              return op == other.op && lhs == other.lhs && rhs == other.rhs
+                && tensored == other.tensored;
+            }
+          };
+
+          struct KeyHash
+          {
+            size_t operator()(Key const & k) const;
+          };
+
+          struct Entry
+          {
+            Key key;
+            bdd lhs;
+            bdd rhs;
+            bdd result;
+          };
+
+          static Key makeKey(Op op, bdd const & lhs, bdd const & rhs, bool tensored);
+
+          size_t capacity;
+          // Most recently used at the front
+          std::list<Entry> entries;
+          boost::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+      };
+
       /**
        * Variable name, maximum value and the different base indices.
        */
@@ -260,6 +334,63 @@ namespace wali
           virtual void setIntVars(const std::map<std::string, int>& vars);
           virtual void setIntVars(const std::vector<std::map<std::string, int> >& vars);
 
+          /**
+           * The bdd variable orders described at the top of this file.
+           * Groups of variables (as passed to setIntVars) are kept together
+           * in every layout.
+           **/
+          enum TensorLayout {
+            MaxAffinityLayout,
+            MinAffinityLayout,
+            BaseMaxAffinityTensorMixedLayout,
+            MatchedParenLayout
+          };
+
+          /** The two bdd-based ways of enforcing the detensor constraints **/
+          enum DetensorMethod {
+            DetensorTogether,
+            DetensorBitByBit
+          };
+
+          /**
+           * Reorders the bdd levels of this context's vocabulary into
+           * 'layout'. This can be done at any time: existing BinRel objects
+           * remain valid, and variables added later are moved into the
+           * layout as well. Levels of other BddContexts are not touched.
+           * Under NWA_DETENSOR, only MatchedParenLayout is supported.
+           **/
+          void setTensorLayout(TensorLayout layout);
+          TensorLayout getTensorLayout() const;
+
+          void setDetensorMethod(DetensorMethod method);
+          DetensorMethod getDetensorMethod() const;
+
+          /**
+           * Tries each layout on a few tensor and detensor operations over
+           * 'samples' (base relations in this context), and switches to the
+           * one that produces the fewest bdd nodes. Returns the layout
+           * chosen.
+           **/
+          TensorLayout autoTune(std::vector<binrel_t> const & samples);
+
+          /**
+           * Sifts the bdd variable order once, now. Reordering is done by
+           * BuDDy for all live bdds, so this affects every BddContext.
+           * There is no automatic reordering: BuDDy only sifts variable
+           * blocks, and while blocks exist setTensorLayout cannot set an
+           * order. Not supported under NWA_DETENSOR, which caches bdd
+           * levels.
+           **/
+          static void reorderNow();
+
+          /**
+           * How many Compose/Union/star results this context remembers.
+           * Setting a smaller capacity drops the least recently used
+           * results; 0 switches the memo off.
+           **/
+          void setMemoCapacity(size_t capacity);
+          size_t getMemoCapacity() const;
+
 #if (NWA_DETENSOR == 1)
           /**
            * These functions are used by an NWA based implementation of detensor.
@@ -278,6 +409,10 @@ namespace wali
            **/
           void createIntVars(const std::vector<std::map<std::string, int> >& vars);
           virtual void setupCachedBdds();
+          /** Computes commonBddContextId23/13 for DetensorTogether **/
+          void setupDetensorIds();
+          /** Puts the levels of this context in the order given by tensorLayout **/
+          void applyTensorLayout();
         public:
           //using wali::Countable::count;
           int count;
@@ -324,6 +459,17 @@ namespace wali
           //Id: TL2 = TR2
           bdd commonBddContextId13;
 
+          // The groups of variables as they were added, for applyTensorLayout
+          std::vector<std::vector<bddinfo_t> > varGroups;
+          TensorLayout tensorLayout;
+          // Whether tensorLayout was asked for, rather than being how the
+          // variables happened to be allocated
+          bool tensorLayoutSet;
+          DetensorMethod detensorMethod;
+
+          // Results of BinRel operations in this context
+          mutable BinRelMemo memo;
+
           //We cache zero and one BinRel objects, since they are used so much
           binrel_t cachedBaseOne;
           binrel_t cachedBaseZero;
@@ -349,6 +495,8 @@ namespace wali
           mutable StatCount numTranspose;
           mutable StatCount numDetensor;
           mutable StatCount numDetensorTranspose;
+          mutable StatCount numMemoLookups;
+          mutable StatCount numMemoHits;
 
           // Related functions
         public:
@@ -419,7 +567,24 @@ namespace wali
           binrel_t Kronecker( binrel_t that) const;
           binrel_t Eq23Project() const;
           binrel_t Eq13Project() const;
-        public: 
+
+          /**
+           * This relation rebuilt in 'target', which must have the same
+           * variables with the same sizes as this relation's context, but
+           * may order and interleave them differently.
+           **/
+          binrel_t transferTo(BddContext const * target) const;
+
+          /**
+           * Writes this relation in terms of variable names and bit
+           * positions rather than BDD levels. load() rebuilds it in any
+           * context with the same vocabulary, including one in another
+           * process, so sub-analyses can run in separate processes (each
+           * with its own BuDDy kernel) and merge their results.
+           **/
+          void save(std::ostream& o) const;
+          static binrel_t load(BddContext const * target, std::istream& in);
+        public:
           // ////////////////////////////////
           // SemElem methods
           sem_elem_t one() const;
@@ -497,6 +662,9 @@ namespace wali
           BddContext const * con;
           bdd rel;
           bool isTensored;
+        private:
+          /// Looks up 'op' on (rel, other) in con's memo, and counts it
+          bool lookupMemo(BinRelMemo::Op op, bdd const & other, bdd & result) const;
 #if(NWA_DETENSOR == 1)
         private:
           //TODO: Cleanup in the destructor for all these
@@ -0,0 +1,1052 @@
+/**
+ * @see BitRel.hpp
+ */
+
+#include "wali/domains/bitrel/BitRel.hpp"
+#include "wali/Common.hpp"
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+
+#include <boost/functional/hash.hpp>
+
+using namespace wali::domains::bitrel;
+using wali::domains::bitrel::details::Word;
+using wali::domains::bitrel::details::BitMatrix;
+using wali::waliErr;
+using std::endl;
+
+namespace wali
+{
+  namespace domains
+  {
+    namespace bitrel
+    {
+      namespace details
+      {
+        static const size_t WORD_BITS = 64;
+
+        static size_t wordsFor(size_t bits)
+        {
+          return (bits + WORD_BITS - 1) / WORD_BITS;
+        }
+
+        /// Index of the lowest set bit of a nonzero word
+        static unsigned lowestBit(Word w)
+        {
+          assert(w != 0);
+#if defined(__GNUC__)
+          return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+          unsigned i = 0;
+          while ((w & 1) == 0) {
+            w >>= 1;
+            ++i;
+          }
+          return i;
+#endif
+        }
+
+        static void orRow(Word * dst, Word const * src, size_t words)
+        {
+          for (size_t i = 0; i < words; ++i) {
+            dst[i] |= src[i];
+          }
+        }
+
+        /// Reads 'count' (at most WORD_BITS) bits starting at bit 'pos'
+        static Word readBits(Word const * src, size_t pos, size_t count)
+        {
+          size_t w = pos / WORD_BITS;
+          size_t off = pos % WORD_BITS;
+          Word v = src[w] >> off;
+          if (off != 0 && off + count > WORD_BITS) {
+            v |= src[w + 1] << (WORD_BITS - off);
+          }
+          if (count < WORD_BITS) {
+            v &= (Word(1) << count) - 1;
+          }
+          return v;
+        }
+
+        /// ORs the low 'count' (at most WORD_BITS) bits of 'v' in at bit 'pos'
+        static void orInBits(Word * dst, size_t pos, Word v, size_t count)
+        {
+          size_t w = pos / WORD_BITS;
+          size_t off = pos % WORD_BITS;
+          dst[w] |= v << off;
+          if (off != 0 && off + count > WORD_BITS) {
+            dst[w + 1] |= v >> (WORD_BITS - off);
+          }
+        }
+
+
+        BitMatrix::BitMatrix(size_t dim)
+          : dimension(dim)
+          , rowWords(wordsFor(dim))
+          , bits(dim * wordsFor(dim), 0)
+        {}
+
+        bool BitMatrix::get(size_t r, size_t col) const
+        {
+          assert(r < dimension && col < dimension);
+          return (row(r)[col / WORD_BITS] >> (col % WORD_BITS)) & 1;
+        }
+
+        void BitMatrix::set(size_t r, size_t col)
+        {
+          assert(r < dimension && col < dimension);
+          row(r)[col / WORD_BITS] |= Word(1) << (col % WORD_BITS);
+        }
+
+        bool BitMatrix::isEmptyRow(size_t r) const
+        {
+          Word const * words = row(r);
+          for (size_t i = 0; i < rowWords; ++i) {
+            if (words[i] != 0) {
+              return false;
+            }
+          }
+          return true;
+        }
+
+        void BitMatrix::orWith(BitMatrix const & that)
+        {
+          assert(dimension == that.dimension);
+          for (size_t i = 0; i < bits.size(); ++i) {
+            bits[i] |= that.bits[i];
+          }
+        }
+
+        void BitMatrix::andWith(BitMatrix const & that)
+        {
+          assert(dimension == that.dimension);
+          for (size_t i = 0; i < bits.size(); ++i) {
+            bits[i] &= that.bits[i];
+          }
+        }
+
+        BitMatrix BitMatrix::product(BitMatrix const & that) const
+        {
+          assert(dimension == that.dimension);
+          BitMatrix result(dimension);
+          // Row i of the product is the union of the rows of 'that' picked
+          // out by the bits of row i of 'this'.
+          for (size_t i = 0; i < dimension; ++i) {
+            Word const * lhs = row(i);
+            Word * out = result.row(i);
+            for (size_t w = 0; w < rowWords; ++w) {
+              Word bitsLeft = lhs[w];
+              while (bitsLeft != 0) {
+                size_t k = w * WORD_BITS + lowestBit(bitsLeft);
+                bitsLeft &= bitsLeft - 1;
+                orRow(out, that.row(k), rowWords);
+              }
+            }
+          }
+          return result;
+        }
+
+        BitMatrix BitMatrix::transpose() const
+        {
+          BitMatrix result(dimension);
+          for (size_t i = 0; i < dimension; ++i) {
+            Word const * words = row(i);
+            for (size_t w = 0; w < rowWords; ++w) {
+              Word bitsLeft = words[w];
+              while (bitsLeft != 0) {
+                result.set(w * WORD_BITS + lowestBit(bitsLeft), i);
+                bitsLeft &= bitsLeft - 1;
+              }
+            }
+          }
+          return result;
+        }
+
+        BitMatrix BitMatrix::closure() const
+        {
+          // Warshall's algorithm, a row at a time
+          BitMatrix result(*this);
+          result.setIdentity();
+          for (size_t k = 0; k < dimension; ++k) {
+            Word const * through = result.row(k);
+            for (size_t i = 0; i < dimension; ++i) {
+              if (i != k && result.get(i, k)) {
+                orRow(result.row(i), through, rowWords);
+              }
+            }
+          }
+          return result;
+        }
+
+        void BitMatrix::setIdentity()
+        {
+          for (size_t i = 0; i < dimension; ++i) {
+            set(i, i);
+          }
+        }
+
+        void BitMatrix::orBits(Word * dst, size_t to, Word const * src, size_t from, size_t count)
+        {
+          for (size_t done = 0; done < count; done += WORD_BITS) {
+            size_t chunk = count - done < WORD_BITS ? count - done : WORD_BITS;
+            Word v = readBits(src, from + done, chunk);
+            if (v != 0) {
+              orInBits(dst, to + done, v, chunk);
+            }
+          }
+        }
+
+        bool BitMatrix::operator<(BitMatrix const & that) const
+        {
+          if (dimension != that.dimension) {
+            return dimension < that.dimension;
+          }
+          return bits < that.bits;
+        }
+
+        bool BitMatrix::isSubsetOf(BitMatrix const & that) const
+        {
+          assert(dimension == that.dimension);
+          for (size_t i = 0; i < bits.size(); ++i) {
+            if ((bits[i] & ~that.bits[i]) != 0) {
+              return false;
+            }
+          }
+          return true;
+        }
+
+        size_t BitMatrix::hash() const
+        {
+          size_t seed = dimension;
+          boost::hash_range(seed, bits.begin(), bits.end());
+          return seed;
+        }
+      } // namespace details
+
+
+      static BitRel* convert(wali::SemElem* se)
+      {
+        BitRel* br = dynamic_cast<BitRel*>(se);
+        if (br == NULL) {
+          *waliErr << "[ERROR] Cannot cast to class wali::domains::bitrel::BitRel.\n";
+          se->print( *waliErr << "    " ) << endl;
+          assert(false);
+        }
+        return br;
+      }
+
+      bitrel_t operator*(bitrel_t a, bitrel_t b)
+      {
+        return a->Compose(b);
+      }
+
+      bitrel_t operator|(bitrel_t a, bitrel_t b)
+      {
+        return a->Union(b);
+      }
+
+      bitrel_t operator&(bitrel_t a, bitrel_t b)
+      {
+        return a->Intersect(b);
+      }
+    } // namespace bitrel
+  } // namespace domains
+} // namespace wali
+
+
+// ////////////////////////////
+// BitExpr
+
+BitExpr::BitExpr(size_t numStates, unsigned size)
+  : regSize(size)
+  , words(details::wordsFor(size))
+  , bits(numStates * details::wordsFor(size), 0)
+{}
+
+bool BitExpr::mayBe(size_t state, unsigned value) const
+{
+  if (value >= regSize) {
+    return false;
+  }
+  return (values(state)[value / details::WORD_BITS] >> (value % details::WORD_BITS)) & 1;
+}
+
+void BitExpr::add(size_t state, unsigned value)
+{
+  assert(value < regSize);
+  values(state)[value / details::WORD_BITS] |= Word(1) << (value % details::WORD_BITS);
+}
+
+
+// ////////////////////////////
+// BitRelContext
+
+BitRelContext::BitRelContext()
+  : states(1)
+  , maxSize(2)
+{}
+
+BitRelContext::BitRelContext(const std::map<std::string, int>& vars)
+  : states(1)
+  , maxSize(2)
+{
+  setIntVars(vars);
+}
+
+BitRelContext::BitRelContext(const std::vector<std::map<std::string, int> >& vars)
+  : states(1)
+  , maxSize(2)
+{
+  setIntVars(vars);
+}
+
+BitRelContext::~BitRelContext()
+{}
+
+void BitRelContext::addBoolVar(std::string name)
+{
+  addIntVar(name, 2);
+}
+
+void BitRelContext::addIntVar(std::string name, unsigned size)
+{
+  if (size < 2) {
+    *waliErr << "[ERROR] BitRelContext::addIntVar: variable " << name
+             << " must have at least two values.\n";
+    assert(false);
+    return;
+  }
+  if (varIndex.find(name) != varIndex.end()) {
+    *waliErr << "[ERROR] BitRelContext::addIntVar: variable " << name
+             << " is already in the vocabulary.\n";
+    assert(false);
+    return;
+  }
+
+  VarInfo info;
+  info.name = name;
+  info.size = size;
+  info.stride = states;
+
+  varIndex[name] = vars.size();
+  vars.push_back(info);
+  states *= size;
+  if (size > maxSize) {
+    maxSize = size;
+  }
+  invalidateCache();
+}
+
+void BitRelContext::setIntVars(const std::map<std::string, int>& vars)
+{
+  for (std::map<std::string, int>::const_iterator var = vars.begin();
+       var != vars.end(); ++var)
+  {
+    addIntVar(var->first, static_cast<unsigned>(var->second));
+  }
+}
+
+void BitRelContext::setIntVars(const std::vector<std::map<std::string, int> >& vars)
+{
+  for (size_t i = 0; i < vars.size(); ++i) {
+    setIntVars(vars[i]);
+  }
+}
+
+bool BitRelContext::sameVocabulary(BitRelContext const & other) const
+{
+  if (vars.size() != other.vars.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < vars.size(); ++i) {
+    std::map<std::string, size_t>::const_iterator iter = other.varIndex.find(vars[i].name);
+    if (iter == other.varIndex.end() || other.vars[iter->second].size != vars[i].size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<size_t> BitRelContext::translateStates(BitRelContext const & target) const
+{
+  assert(sameVocabulary(target));
+
+  std::vector<size_t> targetStrides(vars.size());
+  for (size_t i = 0; i < vars.size(); ++i) {
+    targetStrides[i] = target.vars[target.varIndex.find(vars[i].name)->second].stride;
+  }
+
+  std::vector<size_t> translation(states);
+  for (size_t s = 0; s < states; ++s) {
+    size_t t = 0;
+    for (size_t i = 0; i < vars.size(); ++i) {
+      t += ((s / vars[i].stride) % vars[i].size) * targetStrides[i];
+    }
+    translation[s] = t;
+  }
+  return translation;
+}
+
+bool BitRelContext::hasVar(std::string const & var) const
+{
+  return varIndex.find(var) != varIndex.end();
+}
+
+BitRelContext::VarInfo const & BitRelContext::lookup(std::string const & var, char const * caller) const
+{
+  std::map<std::string, size_t>::const_iterator iter = varIndex.find(var);
+  if (iter == varIndex.end()) {
+    *waliErr << "[ERROR] " << caller << " on \"" << var
+             << "\". I don't recognize this name.\n";
+    std::abort();
+  }
+  return vars[iter->second];
+}
+
+unsigned BitRelContext::getVarSize(std::string const & var) const
+{
+  return lookup(var, "getVarSize").size;
+}
+
+unsigned BitRelContext::getValue(size_t state, std::string const & var) const
+{
+  VarInfo const & info = lookup(var, "getValue");
+  return static_cast<unsigned>((state / info.stride) % info.size);
+}
+
+size_t BitRelContext::getState(std::map<std::string, unsigned> const & values) const
+{
+  size_t state = 0;
+  for (std::map<std::string, unsigned>::const_iterator val = values.begin();
+       val != values.end(); ++val)
+  {
+    VarInfo const & info = lookup(val->first, "getState");
+    assert(val->second < info.size);
+    state += val->second * info.stride;
+  }
+  return state;
+}
+
+std::ostream& BitRelContext::print(std::ostream& o) const
+{
+  o << "BitRelContext (" << states << " states):";
+  for (size_t i = 0; i < vars.size(); ++i) {
+    o << " " << vars[i].name << "[" << vars[i].size << "]";
+  }
+  return o;
+}
+
+std::ostream& BitRelContext::printState(std::ostream& o, size_t state) const
+{
+  o << "{";
+  for (size_t i = 0; i < vars.size(); ++i) {
+    if (i != 0) {
+      o << ", ";
+    }
+    o << vars[i].name << "=" << (state / vars[i].stride) % vars[i].size;
+  }
+  return o << "}";
+}
+
+BitExpr BitRelContext::From(std::string var) const
+{
+  VarInfo const & info = lookup(var, "From");
+  BitExpr ret(states, info.size);
+  for (size_t s = 0; s < states; ++s) {
+    ret.add(s, static_cast<unsigned>((s / info.stride) % info.size));
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::NonDet() const
+{
+  BitExpr ret(states, maxSize);
+  for (size_t s = 0; s < states; ++s) {
+    for (unsigned v = 0; v < maxSize; ++v) {
+      ret.add(s, v);
+    }
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::True() const
+{
+  BitExpr ret(states, 2);
+  for (size_t s = 0; s < states; ++s) {
+    ret.add(s, 1);
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::False() const
+{
+  BitExpr ret(states, 2);
+  for (size_t s = 0; s < states; ++s) {
+    ret.add(s, 0);
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::Const(unsigned val) const
+{
+  if (val >= maxSize) {
+    *waliErr << "[ERROR] [Const] Attempted to create a constant value larger "
+             << "than maxVal\n";
+    assert(false);
+  }
+  BitExpr ret(states, maxSize);
+  for (size_t s = 0; s < states; ++s) {
+    ret.add(s, val % maxSize);
+  }
+  return ret;
+}
+
+namespace
+{
+  unsigned bitAnd(unsigned a, unsigned b, unsigned) { return (a != 0 && b != 0) ? 1 : 0; }
+  unsigned bitOr(unsigned a, unsigned b, unsigned) { return (a != 0 || b != 0) ? 1 : 0; }
+  unsigned plus(unsigned a, unsigned b, unsigned size) { return (a + b) % size; }
+  unsigned minus(unsigned a, unsigned b, unsigned size) { return (a + size - b) % size; }
+  unsigned times(unsigned a, unsigned b, unsigned size) { return (a * b) % size; }
+  // Division by zero is arbitrary; ProgramBddContext picks 0 as well
+  unsigned div(unsigned a, unsigned b, unsigned) { return b == 0 ? 0 : a / b; }
+}
+
+BitExpr BitRelContext::binOp(BitExpr const & lexpr, BitExpr const & rexpr,
+                             unsigned (*op)(unsigned, unsigned, unsigned)) const
+{
+  // Like ProgramBddContext, the longer register is clipped
+  unsigned outSize = lexpr.size() < rexpr.size() ? lexpr.size() : rexpr.size();
+  bool boolean = (op == bitAnd || op == bitOr);
+  BitExpr ret(states, boolean ? 2 : outSize);
+
+  for (size_t s = 0; s < states; ++s) {
+    for (unsigned i = 0; i < outSize; ++i) {
+      if (!lexpr.mayBe(s, i)) {
+        continue;
+      }
+      for (unsigned j = 0; j < outSize; ++j) {
+        if (rexpr.mayBe(s, j)) {
+          ret.add(s, op(i, j, outSize));
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::And(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, bitAnd);
+}
+
+BitExpr BitRelContext::Or(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, bitOr);
+}
+
+BitExpr BitRelContext::Not(BitExpr const & expr) const
+{
+  BitExpr ret(states, 2);
+  for (size_t s = 0; s < states; ++s) {
+    if (expr.mayBe(s, 0)) {
+      ret.add(s, 1);
+    }
+    for (unsigned v = 1; v < expr.size(); ++v) {
+      if (expr.mayBe(s, v)) {
+        ret.add(s, 0);
+        break;
+      }
+    }
+  }
+  return ret;
+}
+
+BitExpr BitRelContext::Plus(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, plus);
+}
+
+BitExpr BitRelContext::Minus(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, minus);
+}
+
+BitExpr BitRelContext::Times(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, times);
+}
+
+BitExpr BitRelContext::Div(BitExpr const & lexpr, BitExpr const & rexpr) const
+{
+  return binOp(lexpr, rexpr, div);
+}
+
+bitrel_t BitRelContext::Assign(std::string var, BitExpr const & expr) const
+{
+  BitMatrix rel(states);
+
+  if (!hasVar(var)) {
+    *waliErr << "[WARNING] [BitRelContext::Assign] Unknown Variable: " << var << "\n";
+    // This is a safe result. We assume that anything can be assigned to anything!
+    for (size_t s = 0; s < states; ++s) {
+      for (size_t t = 0; t < states; ++t) {
+        rel.set(s, t);
+      }
+    }
+    return new BitRel(this, rel);
+  }
+
+  VarInfo const & info = lookup(var, "Assign");
+  for (size_t s = 0; s < states; ++s) {
+    size_t others = s - ((s / info.stride) % info.size) * info.stride;
+    for (unsigned v = 0; v < expr.size(); ++v) {
+      if (expr.mayBe(s, v)) {
+        rel.set(s, others + (v % info.size) * info.stride);
+      }
+    }
+  }
+  return new BitRel(this, rel);
+}
+
+bitrel_t BitRelContext::Assume(BitExpr const & expr1, BitExpr const & expr2) const
+{
+  BitMatrix rel(states);
+  for (size_t s = 0; s < states; ++s) {
+    for (unsigned v = 0; v < expr1.size(); ++v) {
+      if (expr1.mayBe(s, v) && expr2.mayBe(s, v)) {
+        rel.set(s, s);
+        break;
+      }
+    }
+  }
+  return new BitRel(this, rel);
+}
+
+bitrel_t BitRelContext::constrain(std::string const & var, unsigned val, bool pre) const
+{
+  VarInfo const & info = lookup(var, pre ? "setPre" : "setPost");
+  if (val >= info.size) {
+    *waliErr << "[ERROR] " << (pre ? "setPre" : "setPost") << ": val too large\n";
+    std::abort();
+  }
+
+  BitMatrix rel(states);
+  for (size_t s = 0; s < states; ++s) {
+    if ((s / info.stride) % info.size != val) {
+      continue;
+    }
+    for (size_t t = 0; t < states; ++t) {
+      if (pre) {
+        rel.set(s, t);
+      }
+      else {
+        rel.set(t, s);
+      }
+    }
+  }
+  return new BitRel(this, rel);
+}
+
+bitrel_t BitRelContext::setPre(std::string var) const
+{
+  assert(getVarSize(var) == 2);
+  return constrain(var, 1, true);
+}
+
+bitrel_t BitRelContext::unsetPre(std::string var) const
+{
+  assert(getVarSize(var) == 2);
+  return constrain(var, 0, true);
+}
+
+bitrel_t BitRelContext::setPre(std::string var, unsigned val) const
+{
+  return constrain(var, val, true);
+}
+
+bitrel_t BitRelContext::setPost(std::string var) const
+{
+  assert(getVarSize(var) == 2);
+  return constrain(var, 1, false);
+}
+
+bitrel_t BitRelContext::unsetPost(std::string var) const
+{
+  assert(getVarSize(var) == 2);
+  return constrain(var, 0, false);
+}
+
+bitrel_t BitRelContext::setPost(std::string var, unsigned val) const
+{
+  return constrain(var, val, false);
+}
+
+bitrel_t BitRelContext::baseOne() const
+{
+  if (cachedBaseOne == NULL) {
+    BitMatrix id(states);
+    id.setIdentity();
+    cachedBaseOne = new BitRel(this, id, false);
+  }
+  return cachedBaseOne;
+}
+
+bitrel_t BitRelContext::baseZero() const
+{
+  if (cachedBaseZero == NULL) {
+    cachedBaseZero = new BitRel(this, false);
+  }
+  return cachedBaseZero;
+}
+
+bitrel_t BitRelContext::tensorOne() const
+{
+  if (cachedTensorOne == NULL) {
+    BitMatrix id(states * states);
+    id.setIdentity();
+    cachedTensorOne = new BitRel(this, id, true);
+  }
+  return cachedTensorOne;
+}
+
+bitrel_t BitRelContext::tensorZero() const
+{
+  if (cachedTensorZero == NULL) {
+    cachedTensorZero = new BitRel(this, true);
+  }
+  return cachedTensorZero;
+}
+
+void BitRelContext::invalidateCache()
+{
+  cachedBaseOne = NULL;
+  cachedBaseZero = NULL;
+  cachedTensorOne = NULL;
+  cachedTensorZero = NULL;
+}
+
+
+// ////////////////////////////
+// BitRel
+
+BitRel::BitRel(BitRelContext const * con, bool is_tensored)
+  : con(con)
+  , rel(is_tensored ? con->numStates() * con->numStates() : con->numStates())
+  , isTensored(is_tensored)
+{}
+
+BitRel::BitRel(BitRelContext const * con, BitMatrix const & rel, bool is_tensored)
+  : con(con)
+  , rel(rel)
+  , isTensored(is_tensored)
+{
+  assert(rel.dim() == (is_tensored ? con->numStates() * con->numStates() : con->numStates()));
+}
+
+BitRel::~BitRel()
+{}
+
+bitrel_t BitRel::Compose( bitrel_t that ) const
+{
+  assert(isTensored == that->isTensored);
+  if (this->isZero() || that->isOne()) {
+    return const_cast<BitRel*>(this);
+  }
+  if (that->isZero() || this->isOne()) {
+    return that;
+  }
+  return new BitRel(con, rel.product(that->rel), isTensored);
+}
+
+bitrel_t BitRel::Union( bitrel_t that ) const
+{
+  assert(isTensored == that->isTensored);
+  if (that->isZero()) {
+    return const_cast<BitRel*>(this);
+  }
+  if (this->isZero()) {
+    return that;
+  }
+  BitMatrix result(rel);
+  result.orWith(that->rel);
+  return new BitRel(con, result, isTensored);
+}
+
+bitrel_t BitRel::Intersect( bitrel_t that ) const
+{
+  assert(isTensored == that->isTensored);
+  BitMatrix result(rel);
+  result.andWith(that->rel);
+  return new BitRel(con, result, isTensored);
+}
+
+bool BitRel::Equal( bitrel_t that ) const
+{
+  if (isTensored != that->isTensored) {
+    return false;
+  }
+  return rel == that->rel;
+}
+
+bitrel_t BitRel::Transpose() const
+{
+  if (isTensored) {
+    *waliErr << "[WARNING] " << "Attempted to transpose tensored weight."
+             << endl << "Not supported" << endl;
+    print(*waliErr) << endl;
+    assert(false);
+    return con->tensorZero();
+  }
+  return new BitRel(con, rel.transpose(), false);
+}
+
+bitrel_t BitRel::Kronecker( bitrel_t that ) const
+{
+  if (isTensored || that->isTensored) {
+    *waliErr << "[WARNING] " << "Attempted to tensor two tensored weights."
+             << endl << "Not supported" << endl;
+    assert(false);
+    return con->tensorZero();
+  }
+
+  size_t n = rel.dim();
+  assert(n == that->rel.dim());
+  BitMatrix result(n * n);
+
+  // Row (a, b) of the result has R2's row b copied into each block c for
+  // which a R1 c
+  for (size_t a = 0; a < n; ++a) {
+    if (rel.isEmptyRow(a)) {
+      continue;
+    }
+    for (size_t b = 0; b < n; ++b) {
+      if (that->rel.isEmptyRow(b)) {
+        continue;
+      }
+      Word * out = result.row(a * n + b);
+      for (size_t c = 0; c < n; ++c) {
+        if (rel.get(a, c)) {
+          BitMatrix::orBits(out, c * n, that->rel.row(b), 0, n);
+        }
+      }
+    }
+  }
+  return new BitRel(con, result, true);
+}
+
+bitrel_t BitRel::Eq23Project() const
+{
+  assert(isTensored);
+  size_t n = con->numStates();
+  BitMatrix result(n);
+
+  // a D d  iff  (a, b) T (b, d) for some b
+  for (size_t a = 0; a < n; ++a) {
+    for (size_t b = 0; b < n; ++b) {
+      BitMatrix::orBits(result.row(a), 0, rel.row(a * n + b), b * n, n);
+    }
+  }
+  return new BitRel(con, result, false);
+}
+
+bitrel_t BitRel::Eq13Project() const
+{
+  assert(isTensored);
+  size_t n = con->numStates();
+  BitMatrix result(n);
+
+  // c D d  iff  (a, a) T (c, d) for some a
+  for (size_t a = 0; a < n; ++a) {
+    size_t r = a * n + a;
+    if (rel.isEmptyRow(r)) {
+      continue;
+    }
+    for (size_t c = 0; c < n; ++c) {
+      BitMatrix::orBits(result.row(c), 0, rel.row(r), c * n, n);
+    }
+  }
+  return new BitRel(con, result, false);
+}
+
+bitrel_t BitRel::transferTo(BitRelContext const * target) const
+{
+  if (target == con) {
+    return const_cast<BitRel*>(this);
+  }
+  if (!con->sameVocabulary(*target)) {
+    *waliErr << "[ERROR] Attempted to transfer a relation between contexts "
+             << "with different vocabularies." << endl;
+    con->print(*waliErr << "    from: ") << endl;
+    target->print(*waliErr << "    to:   ") << endl;
+    assert(false);
+    return isTensored ? target->tensorZero() : target->baseZero();
+  }
+
+  std::vector<size_t> translation = con->translateStates(*target);
+  size_t n = translation.size();
+
+  bool sameLayout = true;
+  for (size_t s = 0; s < n && sameLayout; ++s) {
+    sameLayout = (translation[s] == s);
+  }
+  if (sameLayout) {
+    return new BitRel(target, rel, isTensored);
+  }
+
+  if (isTensored) {
+    // Pair (a, b) goes to (translation[a], translation[b])
+    std::vector<size_t> pairs(n * n);
+    for (size_t a = 0; a < n; ++a) {
+      for (size_t b = 0; b < n; ++b) {
+        pairs[a * n + b] = translation[a] * n + translation[b];
+      }
+    }
+    translation.swap(pairs);
+  }
+
+  BitMatrix result(rel.dim());
+  for (size_t from = 0; from < rel.dim(); ++from) {
+    Word const * words = rel.row(from);
+    for (size_t w = 0; w < rel.wordsPerRow(); ++w) {
+      Word bitsLeft = words[w];
+      while (bitsLeft != 0) {
+        size_t to = w * details::WORD_BITS + details::lowestBit(bitsLeft);
+        bitsLeft &= bitsLeft - 1;
+        result.set(translation[from], translation[to]);
+      }
+    }
+  }
+  return new BitRel(target, result, isTensored);
+}
+
+
+// ////////////////////////////
+// SemElem Interface functions
+
+wali::sem_elem_t BitRel::one() const
+{
+  if (!isTensored)
+    return con->baseOne();
+  else
+    return con->tensorOne();
+}
+
+wali::sem_elem_t BitRel::zero() const
+{
+  if (!isTensored)
+    return con->baseZero();
+  else
+    return con->tensorZero();
+}
+
+bool BitRel::isOne() const
+{
+  bitrel_t one = isTensored ? con->tensorOne() : con->baseOne();
+  return one.get_ptr() == this || rel == one->rel;
+}
+
+bool BitRel::isZero() const
+{
+  bitrel_t zero = isTensored ? con->tensorZero() : con->baseZero();
+  return zero.get_ptr() == this || rel == zero->rel;
+}
+
+wali::sem_elem_t BitRel::combine(wali::SemElem* se)
+{
+  bitrel_t that( convert(se) );
+  return Union(that);
+}
+
+wali::sem_elem_t BitRel::extend(wali::SemElem* se)
+{
+  bitrel_t that( convert(se) );
+  return Compose(that);
+}
+
+wali::sem_elem_t BitRel::star()
+{
+  return new BitRel(con, rel.closure(), isTensored);
+}
+
+bool BitRel::underApproximates(wali::SemElem * se)
+{
+  bitrel_t that( convert(se) );
+  assert(isTensored == that->isTensored);
+  return rel.isSubsetOf(that->rel);
+}
+
+bool BitRel::equal(wali::SemElem* se) const
+{
+  bitrel_t that( convert(se) );
+  return Equal(that);
+}
+
+bool BitRel::containerLessThan(wali::SemElem const * se) const
+{
+  BitRel const * other = dynamic_cast<BitRel const *>(se);
+  return this->rel < other->rel;
+}
+
+std::ostream& BitRel::print( std::ostream& o ) const
+{
+  size_t n = con->numStates();
+  if (!isTensored)
+    o << "Base relation: ";
+  else
+    o << "Tensored relation: ";
+
+  bool first = true;
+  for (size_t from = 0; from < rel.dim(); ++from) {
+    for (size_t to = 0; to < rel.dim(); ++to) {
+      if (!rel.get(from, to)) {
+        continue;
+      }
+      if (!first) {
+        o << ", ";
+      }
+      first = false;
+      if (!isTensored) {
+        con->printState(o, from) << " -> ";
+        con->printState(o, to);
+      }
+      else {
+        con->printState(con->printState(o << "(", from / n) << ", ", from % n) << ") -> ";
+        con->printState(con->printState(o << "(", to / n) << ", ", to % n) << ")";
+      }
+    }
+  }
+  if (first) {
+    o << "empty";
+  }
+  return o;
+}
+
+wali::sem_elem_tensor_t BitRel::transpose()
+{
+  return Transpose();
+}
+
+wali::sem_elem_tensor_t BitRel::tensor(wali::SemElemTensor* se)
+{
+  bitrel_t that( convert(se) );
+  return Kronecker(that);
+}
+
+wali::sem_elem_tensor_t BitRel::detensor()
+{
+  return Eq23Project();
+}
+
+wali::sem_elem_tensor_t BitRel::detensorTranspose()
+{
+  return Eq13Project();
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
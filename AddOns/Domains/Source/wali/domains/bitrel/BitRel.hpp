@@ -0,0 +1,393 @@
+#ifndef wali_domains_bitrel_BITREL_GUARD
+#define wali_domains_bitrel_BITREL_GUARD 1
+
+/**
+ * BitRel models the same relations as binrel::BinRel -- binary relations
+ * over the states of a small finite vocabulary -- but stores them as
+ * dense bit matrices instead of BDDs.
+ *
+ * A vocabulary of V variables with sizes s_1, ..., s_V has
+ * n = s_1 * ... * s_V states. A base relation is an n x n bit matrix
+ * (row = pre-state, column = post-state). A tensored relation is an
+ * n^2 x n^2 bit matrix over pairs of states, laid out the same way BinRel
+ * lays out its tensored vocabularies: the pair (a, b) is state a*n + b,
+ * and Kronecker(R1, R2) relates (a, b) to (c, d) iff R1 relates a to c and
+ * R2 relates b to d.
+ *
+ * Rows are stored as 64-bit words, so extend is a Boolean matrix product
+ * that ORs whole rows together, combine is a word-wise OR, and
+ * tensor/detensor move blocks of n bits between rows.
+ *
+ * For a handful of Boolean variables this avoids the BDD unique table and
+ * node management altogether. The price is memory that is quadratic in
+ * the number of states (and quartic for tensored relations), so BitRel is
+ * meant for vocabularies of a few thousand states at most, and tensored
+ * weights only for vocabularies of a couple hundred.
+ *
+ * BitRelContext provides the same vocabulary and transformer-building
+ * functions as binrel::ProgramBddContext (addBoolVar/addIntVar/setIntVars,
+ * From/Const/Plus/..., Assign/Assume, setPre/setPost), so an analysis can
+ * switch between the two domains without restructuring.
+ *
+ * BinRel's BDDs all live in BuDDy's single, process-wide kernel, so two
+ * BinRel operations can never run at the same time. BitRelContexts share
+ * no state with each other: independent sub-analyses can each build their
+ * own context and run on their own thread, then move their results into
+ * a common context with BitRel::transferTo. (A single context and the
+ * relations built in it are still only safe to use from one thread at a
+ * time; reference counts are not atomic.)
+ */
+
+// ::wali
+#include "wali/SemElemTensor.hpp"
+#include "wali/ref_ptr.hpp"
+#include "wali/Countable.hpp"
+
+// ::std
+#include <map>
+#include <vector>
+#include <string>
+#include <iosfwd>
+
+#include <boost/cstdint.hpp>
+
+namespace wali
+{
+  namespace domains
+  {
+    namespace bitrel
+    {
+      class BitRel;
+      typedef ref_ptr<BitRel> bitrel_t;
+
+      class BitRelContext;
+      typedef ref_ptr<BitRelContext> bitrel_context_t;
+
+      namespace details
+      {
+        typedef boost::uint64_t Word;
+
+        /**
+         * A square matrix of bits, stored row-major with each row padded
+         * out to a whole number of Words. Padding bits are always zero, so
+         * rows and whole matrices can be compared and hashed word-wise.
+         */
+        class BitMatrix
+        {
+          public:
+            explicit BitMatrix(size_t dim = 0);
+
+            size_t dim() const { return dimension; }
+            size_t wordsPerRow() const { return rowWords; }
+
+            bool get(size_t row, size_t col) const;
+            void set(size_t row, size_t col);
+
+            Word * row(size_t r) { return &bits[0] + r * rowWords; }
+            Word const * row(size_t r) const { return &bits[0] + r * rowWords; }
+
+            bool isEmptyRow(size_t r) const;
+
+            /// this := this | that
+            void orWith(BitMatrix const & that);
+            /// this := this & that
+            void andWith(BitMatrix const & that);
+
+            /// Boolean matrix product
+            BitMatrix product(BitMatrix const & that) const;
+            BitMatrix transpose() const;
+            /// Reflexive-transitive closure
+            BitMatrix closure() const;
+
+            /// Sets the diagonal
+            void setIdentity();
+
+            /// OR 'count' bits starting at bit 'from' of 'src' into the
+            /// bits starting at 'to' of 'dst'
+            static void orBits(Word * dst, size_t to, Word const * src, size_t from, size_t count);
+
+            bool operator==(BitMatrix const & that) const { return bits == that.bits; }
+            bool operator<(BitMatrix const & that) const;
+            bool isSubsetOf(BitMatrix const & that) const;
+            size_t hash() const;
+
+          private:
+            size_t dimension;
+            size_t rowWords;
+            std::vector<Word> bits;
+        };
+      }
+
+
+      /**
+       * An expression over the pre-state vocabulary, as built by
+       * BitRelContext::From, Const, Plus, etc.
+       *
+       * Like ProgramBddContext's expression bdds, an expression has a
+       * register size (values are in 0..size()-1, and arithmetic wraps
+       * around at that size), and can be nondeterministic: it maps each
+       * state to the set of values it may evaluate to there.
+       */
+      class BitExpr
+      {
+        public:
+          unsigned size() const { return regSize; }
+
+          /// Whether 'value' is one of the values of this in 'state'
+          bool mayBe(size_t state, unsigned value) const;
+
+        private:
+          friend class BitRelContext;
+
+          BitExpr(size_t numStates, unsigned size);
+
+          details::Word * values(size_t state) { return &bits[0] + state * words; }
+          details::Word const * values(size_t state) const { return &bits[0] + state * words; }
+          void add(size_t state, unsigned value);
+
+          unsigned regSize;
+          size_t words;
+          std::vector<details::Word> bits;
+      };
+
+
+      /**
+       * The vocabulary a BitRel is over. See ProgramBddContext, whose
+       * interface this follows.
+       *
+       * Every relation is built over the vocabulary as it was when the
+       * relation was created, so set up all variables before creating
+       * relations. Like BddContext, a BitRelContext must outlive the
+       * relations built in it.
+       */
+      class BitRelContext : public wali::Countable
+      {
+        public:
+          BitRelContext();
+          BitRelContext(const std::map<std::string, int>& vars);
+          BitRelContext(const std::vector<std::map<std::string, int> >& vars);
+          virtual ~BitRelContext();
+
+          /** Add a boolean variable to the vocabulary with the name 'name' **/
+          virtual void addBoolVar(std::string name);
+          /** Add a int variable to the vocabulary with the name 'name'. The integer can take values
+           * between 0...size-1. **/
+          virtual void addIntVar(std::string name, unsigned size);
+
+          /**
+           * Add multiple int variables with the given sizes. The grouping
+           * that ProgramBddContext uses for variable ordering has no effect
+           * on a bit matrix; the groups are just added in order.
+           **/
+          virtual void setIntVars(const std::map<std::string, int>& vars);
+          virtual void setIntVars(const std::vector<std::map<std::string, int> >& vars);
+
+          /// The number of states, i.e. the product of the variable sizes
+          size_t numStates() const { return states; }
+
+          /// Whether 'other' has the same variables with the same sizes,
+          /// possibly added in a different order
+          bool sameVocabulary(BitRelContext const & other) const;
+
+          /// For each state of this context, the state of 'target' with the
+          /// same variable values. Requires sameVocabulary(target).
+          std::vector<size_t> translateStates(BitRelContext const & target) const;
+
+          bool hasVar(std::string const & var) const;
+          unsigned getVarSize(std::string const & var) const;
+
+          /// The value of 'var' in 'state'
+          unsigned getValue(size_t state, std::string const & var) const;
+          /// The state with each variable set as in 'values' (unmentioned
+          /// variables are 0)
+          size_t getState(std::map<std::string, unsigned> const & values) const;
+
+          std::ostream& print(std::ostream& o) const;
+          std::ostream& printState(std::ostream& o, size_t state) const;
+
+          // ////////////////Create a expression for the variable var///////////////////////
+          BitExpr From(std::string var) const;
+          // ////////////////Non deterministic expression///////////////////////////////////
+          BitExpr NonDet() const;
+          // ////////////////Boolen Expression Generators///////////////////////////////////
+          BitExpr True() const;
+          BitExpr False() const;
+
+          BitExpr And(BitExpr const & lexpr, BitExpr const & rexpr) const;
+          BitExpr Or(BitExpr const & lexpr, BitExpr const & rexpr) const;
+          BitExpr Not(BitExpr const & expr) const;
+
+          // //////////////Integer Expression Generators///////////////////////////////////
+          BitExpr Const(unsigned val) const;
+
+          BitExpr Plus(BitExpr const & lexpr, BitExpr const & rexpr) const;
+          BitExpr Minus(BitExpr const & lexpr, BitExpr const & rexpr) const;
+          BitExpr Times(BitExpr const & lexpr, BitExpr const & rexpr) const;
+          BitExpr Div(BitExpr const & lexpr, BitExpr const & rexpr) const;
+
+          // //////////////Statement Generators/////////////////////////////////////////////
+          /// var := expr; other variables are unchanged. Values too large
+          /// for 'var' wrap around.
+          bitrel_t Assign(std::string var, BitExpr const & expr) const;
+          /// assume(expr1 == expr2)
+          bitrel_t Assume(BitExpr const & expr1, BitExpr const & expr2) const;
+
+          // Constrain one variable in the pre- or post-state, leaving
+          // everything else unconstrained. Very useful for testing.
+          bitrel_t setPre(std::string var) const;
+          bitrel_t unsetPre(std::string var) const;
+          bitrel_t setPre(std::string var, unsigned val) const;
+          bitrel_t setPost(std::string var) const;
+          bitrel_t unsetPost(std::string var) const;
+          bitrel_t setPost(std::string var, unsigned val) const;
+
+          // Cached relations
+          bitrel_t baseOne() const;
+          bitrel_t baseZero() const;
+          bitrel_t tensorOne() const;
+          bitrel_t tensorZero() const;
+
+        private:
+          struct VarInfo
+          {
+            std::string name;
+            unsigned size;
+            size_t stride;
+          };
+
+          VarInfo const & lookup(std::string const & var, char const * caller) const;
+          BitExpr binOp(BitExpr const & lexpr, BitExpr const & rexpr, unsigned (*op)(unsigned, unsigned, unsigned)) const;
+          bitrel_t constrain(std::string const & var, unsigned val, bool pre) const;
+          void invalidateCache();
+
+          std::vector<VarInfo> vars;
+          std::map<std::string, size_t> varIndex;
+          size_t states;
+          // The largest variable size; NonDet and Const produce expressions of this size
+          unsigned maxSize;
+
+          mutable bitrel_t cachedBaseOne;
+          mutable bitrel_t cachedBaseZero;
+          mutable bitrel_t cachedTensorOne;
+          mutable bitrel_t cachedTensorZero;
+
+          BitRelContext(BitRelContext const &);
+          BitRelContext & operator=(BitRelContext const &);
+      };
+
+
+      class BitRel : public wali::SemElemTensor
+      {
+        public:
+          /** @see BitRel::Compose */
+          friend bitrel_t operator*(bitrel_t a, bitrel_t b);
+          /** @see BitRel::Union */
+          friend bitrel_t operator|(bitrel_t a, bitrel_t b);
+          /** @see BitRel::Intersect */
+          friend bitrel_t operator&(bitrel_t a, bitrel_t b);
+
+        public:
+          /// The empty relation over 'con' (or over pairs of its states if
+          /// 'is_tensored')
+          BitRel(BitRelContext const * con, bool is_tensored=false);
+          BitRel(BitRelContext const * con, details::BitMatrix const & rel, bool is_tensored=false);
+          virtual ~BitRel();
+
+        public:
+          bitrel_t Compose( bitrel_t that ) const;
+          bitrel_t Union( bitrel_t that ) const;
+          bitrel_t Intersect( bitrel_t that ) const;
+          bool Equal( bitrel_t that ) const;
+          bitrel_t Transpose() const;
+          bitrel_t Kronecker( bitrel_t that ) const;
+          bitrel_t Eq23Project() const;
+          bitrel_t Eq13Project() const;
+
+          /// This relation rebuilt in 'target', which must have the same
+          /// vocabulary as this relation's context. This is how results
+          /// computed in separate contexts (for instance, on separate
+          /// threads) are brought together.
+          bitrel_t transferTo(BitRelContext const * target) const;
+
+          /// Whether 'from' is related to 'to'. For tensored relations these
+          /// are pair-states a*n + b.
+          bool contains(size_t from, size_t to) const { return rel.get(from, to); }
+
+        public:
+          // ////////////////////////////////
+          // SemElem methods
+          sem_elem_t one() const;
+          sem_elem_t zero() const;
+
+          bool isOne() const;
+          bool isZero() const;
+
+          /** @return [this]->Union( cast<BitRel*>(se) ) */
+          sem_elem_t combine(SemElem* se);
+
+          /** @return [this]->Compose( cast<BitRel*>(se) ) */
+          sem_elem_t extend(SemElem* se);
+
+          sem_elem_t star();
+
+          bool underApproximates(SemElem * other);
+
+          /** @return [this]->Equal( cast<BitRel*>(se) ) */
+          bool equal(SemElem* se) const;
+
+          std::ostream& print( std::ostream& o ) const;
+
+          // ////////////////////////////////
+          // SemElemTensor methods
+
+          /** @return [this]->Transpose() */
+          sem_elem_tensor_t transpose();
+
+          /** @return [this]->Kronecker( cast<BitRel*>(se) ) */
+          sem_elem_tensor_t tensor(SemElemTensor* se);
+
+          /** @return [this]->Eq23Project() */
+          sem_elem_tensor_t detensor();
+
+          /** @return [this]->Eq13Project() */
+          sem_elem_tensor_t detensorTranspose();
+
+          /** @return The backing matrix */
+          details::BitMatrix const & getMatrix() const {
+            return rel;
+          }
+
+          /** @return Get the vocabulary the relation is over */
+          BitRelContext const & getVocabulary() const {
+            return *con;
+          }
+
+          bool isTensoredRel() const {
+            return isTensored;
+          }
+
+          virtual bool containerLessThan(SemElem const * other) const;
+
+          virtual size_t hash() const {
+            return rel.hash();
+          }
+
+        protected:
+          //This has to be a raw/weak pointer; BitRelContext caches some
+          //BitRel objects.
+          BitRelContext const * con;
+          details::BitMatrix rel;
+          bool isTensored;
+      };
+
+    } // namespace bitrel
+  } // namespace domains
+} // namespace wali
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif // wali_domains_bitrel_BITREL_GUARD
@@ -0,0 +1,586 @@
+#include "wali/domains/genkill/BitVectorGenKill.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace wali {
+  namespace domains {
+    namespace genkill {
+
+      namespace {
+        const size_t word_bits = 64;
+
+        enum WordOp { OrOp, AndOp, AndNotOp };
+
+        /// Combines a and b (missing words are zero) a word at a time
+        std::vector<BitVectorSet::Word>
+        combineWords(std::vector<BitVectorSet::Word> const & a,
+                     std::vector<BitVectorSet::Word> const & b,
+                     WordOp op)
+        {
+          size_t length = std::max(a.size(), b.size());
+          std::vector<BitVectorSet::Word> out(length, 0);
+          for (size_t w = 0; w < length; ++w) {
+            BitVectorSet::Word x = w < a.size() ? a[w] : 0;
+            BitVectorSet::Word y = w < b.size() ? b[w] : 0;
+            switch (op) {
+              case OrOp:     out[w] = x | y;  break;
+              case AndOp:    out[w] = x & y;  break;
+              case AndNotOp: out[w] = x & ~y; break;
+            }
+          }
+          return out;
+        }
+      }
+
+
+      ///////////////////////////////////////
+      // BitVectorSet
+
+      BitVectorSet::BitVectorSet()
+        : m_complemented(false)
+      {}
+
+
+      BitVectorSet const &
+      BitVectorSet::EmptySet()
+      {
+        static BitVectorSet empty;
+        return empty;
+      }
+
+
+      BitVectorSet const &
+      BitVectorSet::UniverseSet()
+      {
+        static BitVectorSet universe = BitVectorSet().complement();
+        return universe;
+      }
+
+
+      BitVectorSet
+      BitVectorSet::singleton(size_t element)
+      {
+        BitVectorSet s;
+        s.insert(element);
+        return s;
+      }
+
+
+      void
+      BitVectorSet::insert(size_t element)
+      {
+        if (contains(element)) {
+          return;
+        }
+        // Flip the bit
+        size_t w = element / word_bits;
+        if (w >= m_words.size()) {
+          m_words.resize(w + 1, 0);
+        }
+        m_words[w] ^= Word(1) << (element % word_bits);
+        trim();
+      }
+
+
+      void
+      BitVectorSet::erase(size_t element)
+      {
+        if (!contains(element)) {
+          return;
+        }
+        size_t w = element / word_bits;
+        if (w >= m_words.size()) {
+          m_words.resize(w + 1, 0);
+        }
+        m_words[w] ^= Word(1) << (element % word_bits);
+        trim();
+      }
+
+
+      bool
+      BitVectorSet::contains(size_t element) const
+      {
+        size_t w = element / word_bits;
+        bool bit = w < m_words.size()
+                   && ((m_words[w] >> (element % word_bits)) & 1);
+        return bit != m_complemented;
+      }
+
+
+      bool
+      BitVectorSet::isEmpty() const
+      {
+        return !m_complemented && m_words.empty();
+      }
+
+
+      bool
+      BitVectorSet::isUniverse() const
+      {
+        return m_complemented && m_words.empty();
+      }
+
+
+      BitVectorSet
+      BitVectorSet::complement() const
+      {
+        BitVectorSet c(*this);
+        c.m_complemented = !m_complemented;
+        return c;
+      }
+
+
+      bool
+      BitVectorSet::Eq(BitVectorSet const & x, BitVectorSet const & y)
+      {
+        return x == y;
+      }
+
+
+      BitVectorSet
+      BitVectorSet::Union(BitVectorSet const & x, BitVectorSet const & y)
+      {
+        // With a and b the stored words:
+        //     a  U  b = a | b
+        //    ~a  U ~b = ~(a & b)
+        //    ~a  U  b = ~(a & ~b)
+        BitVectorSet result;
+        if (!x.m_complemented && !y.m_complemented) {
+          result.m_words = combineWords(x.m_words, y.m_words, OrOp);
+        }
+        else if (x.m_complemented && y.m_complemented) {
+          result.m_words = combineWords(x.m_words, y.m_words, AndOp);
+          result.m_complemented = true;
+        }
+        else if (x.m_complemented) {
+          result.m_words = combineWords(x.m_words, y.m_words, AndNotOp);
+          result.m_complemented = true;
+        }
+        else {
+          result.m_words = combineWords(y.m_words, x.m_words, AndNotOp);
+          result.m_complemented = true;
+        }
+        result.trim();
+        return result;
+      }
+
+
+      BitVectorSet
+      BitVectorSet::Intersect(BitVectorSet const & x, BitVectorSet const & y)
+      {
+        return Union(x.complement(), y.complement()).complement();
+      }
+
+
+      BitVectorSet
+      BitVectorSet::Diff(BitVectorSet const & x, BitVectorSet const & y,
+                         bool normalizing ATTR_UNUSED)
+      {
+        // Complements make x - y exact even when x is the universe, so
+        // there's no need to treat normalization specially.
+        return Intersect(x, y.complement());
+      }
+
+
+      bool
+      BitVectorSet::operator==(BitVectorSet const & other) const
+      {
+        return m_complemented == other.m_complemented
+          && m_words == other.m_words;
+      }
+
+
+      bool
+      BitVectorSet::operator!=(BitVectorSet const & other) const
+      {
+        return !(*this == other);
+      }
+
+
+      size_t
+      BitVectorSet::hash() const
+      {
+        size_t seed = boost::hash_range(m_words.begin(), m_words.end());
+        boost::hash_combine(seed, m_complemented);
+        return seed;
+      }
+
+
+      std::ostream &
+      BitVectorSet::print(std::ostream & os) const
+      {
+        if (m_complemented) {
+          os << "~";
+        }
+        os << "{";
+        bool first = true;
+        for (size_t w = 0; w < m_words.size(); ++w) {
+          for (size_t b = 0; b < word_bits; ++b) {
+            if ((m_words[w] >> b) & 1) {
+              os << (first ? "" : ", ") << w * word_bits + b;
+              first = false;
+            }
+          }
+        }
+        return os << "}";
+      }
+
+
+      void
+      BitVectorSet::trim()
+      {
+        while (!m_words.empty() && m_words.back() == 0) {
+          m_words.pop_back();
+        }
+      }
+
+
+      ///////////////////////////////////////
+      // BitVectorGenKill
+
+      namespace {
+        size_t
+        hashPair(BitVectorSet const & kill, BitVectorSet const & gen)
+        {
+          size_t seed = kill.hash();
+          boost::hash_combine(seed, gen.hash());
+          return seed;
+        }
+
+        typedef std::pair<BitVectorSet const *, BitVectorSet const *> KillGen;
+      }
+
+
+      struct BitVectorGenKill::Hash
+      {
+        size_t operator()(BitVectorGenKill const * t) const {
+          return t->m_hash;
+        }
+      };
+
+      struct BitVectorGenKill::Equal
+      {
+        bool operator()(BitVectorGenKill const * a, BitVectorGenKill const * b) const {
+          return a->m_kill == b->m_kill && a->m_gen == b->m_gen;
+        }
+      };
+
+      struct BitVectorGenKill::ContentsHash
+      {
+        size_t operator()(KillGen const & k) const {
+          return hashPair(*k.first, *k.second);
+        }
+      };
+
+      struct BitVectorGenKill::ContentsEqual
+      {
+        bool operator()(KillGen const & k, BitVectorGenKill const * t) const {
+          return *k.first == t->m_kill && *k.second == t->m_gen;
+        }
+      };
+
+
+      struct BitVectorGenKill::InternTable
+        : boost::unordered_set<BitVectorGenKill *, Hash, Equal>
+      {};
+
+
+      BitVectorGenKill::InternTable &
+      BitVectorGenKill::internTable()
+      {
+        // Never freed, so transformers that outlive static destruction
+        // can still remove themselves.
+        static InternTable * table = new InternTable();
+        return *table;
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::make(BitVectorSet const & kill, BitVectorSet const & gen)
+      {
+        BitVectorSet kill_normalized = BitVectorSet::Diff(kill, gen);
+        if (kill_normalized.isEmpty() && gen.isUniverse()) {
+          return MkBottom();
+        }
+        if (kill_normalized.isEmpty() && gen.isEmpty()) {
+          return MkOne();
+        }
+
+        KillGen key(&kill_normalized, &gen);
+        InternTable::iterator it =
+          internTable().find(key, ContentsHash(), ContentsEqual());
+        if (it != internTable().end()) {
+          return *it;
+        }
+
+        BitVectorGenKill * t = new BitVectorGenKill(kill_normalized, gen);
+        internTable().insert(t);
+        return t;
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::MkOne()
+      {
+        static BitVectorGenKill * ONE = NULL;
+        if (ONE == NULL) {
+          ONE = new BitVectorGenKill(BitVectorSet::EmptySet(), BitVectorSet::EmptySet());
+          ONE->count = 1;
+          internTable().insert(ONE);
+        }
+        return ONE;
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::MkZero()
+      {
+        static BitVectorGenKill * ZERO = NULL;
+        if (ZERO == NULL) {
+          ZERO = new BitVectorGenKill();
+          ZERO->count = 1;
+        }
+        return ZERO;
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::MkBottom()
+      {
+        static BitVectorGenKill * BOTTOM = NULL;
+        if (BOTTOM == NULL) {
+          BOTTOM = new BitVectorGenKill(BitVectorSet::EmptySet(), BitVectorSet::UniverseSet());
+          BOTTOM->count = 1;
+          internTable().insert(BOTTOM);
+        }
+        return BOTTOM;
+      }
+
+
+      size_t
+      BitVectorGenKill::numInterned()
+      {
+        return internTable().size();
+      }
+
+
+      BitVectorGenKill::BitVectorGenKill(BitVectorSet const & kill, BitVectorSet const & gen)
+        : m_kill(kill)
+        , m_gen(gen)
+        , m_hash(hashPair(kill, gen))
+        , m_is_zero(false)
+      {}
+
+
+      BitVectorGenKill::BitVectorGenKill()
+        : m_hash(0)
+        , m_is_zero(true)
+      {}
+
+
+      BitVectorGenKill::~BitVectorGenKill()
+      {
+        if (!m_is_zero) {
+          InternTable::iterator it =
+            internTable().find(this);
+          if (it != internTable().end() && *it == this) {
+            internTable().erase(it);
+          }
+        }
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::one() const
+      {
+        return MkOne();
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::zero() const
+      {
+        return MkZero();
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::bottom() const
+      {
+        return MkBottom();
+      }
+
+
+      bool
+      BitVectorGenKill::isOne() const
+      {
+        return this == MkOne().get_ptr();
+      }
+
+
+      bool
+      BitVectorGenKill::isZero() const
+      {
+        return m_is_zero;
+      }
+
+
+      bool
+      BitVectorGenKill::isBottom() const
+      {
+        return this == MkBottom().get_ptr();
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::extend(SemElem * se)
+      {
+        BitVectorGenKill * y = dynamic_cast<BitVectorGenKill *>(se);
+        fast_assert(y != NULL);
+
+        if (this->isZero() || y->isZero()) {
+          return zero();
+        }
+        if (this->isOne()) {
+          return y;
+        }
+        if (y->isOne()) {
+          return this;
+        }
+        if (y->isBottom()) {
+          return bottom();
+        }
+
+        return make(BitVectorSet::Union(m_kill, y->m_kill),
+                    BitVectorSet::Union(BitVectorSet::Diff(m_gen, y->m_kill), y->m_gen));
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::combine(SemElem * se)
+      {
+        BitVectorGenKill * y = dynamic_cast<BitVectorGenKill *>(se);
+        fast_assert(y != NULL);
+
+        if (this->isZero() || this == y) {
+          return y;
+        }
+        if (y->isZero()) {
+          return this;
+        }
+        if (this->isBottom() || y->isBottom()) {
+          return bottom();
+        }
+
+        return make(BitVectorSet::Intersect(m_kill, y->m_kill),
+                    BitVectorSet::Union(m_gen, y->m_gen));
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::diff(SemElem * se)
+      {
+        BitVectorGenKill * y = dynamic_cast<BitVectorGenKill *>(se);
+        fast_assert(y != NULL);
+
+        if (this->isZero()) {
+          return zero();
+        }
+        if (y->isZero()) {
+          return this;
+        }
+        if (y->isBottom()) {
+          return zero();
+        }
+
+        return make(BitVectorSet::Diff(y->m_kill, m_kill).complement(),
+                    BitVectorSet::Diff(m_gen, y->m_gen));
+      }
+
+
+      sem_elem_t
+      BitVectorGenKill::quasi_one() const
+      {
+        return one();
+      }
+
+
+      bool
+      BitVectorGenKill::equal(SemElem * se) const
+      {
+        return this == se;
+      }
+
+
+      bool
+      BitVectorGenKill::containerLessThan(SemElem const * other) const
+      {
+        return std::less<SemElem const *>()(this, other);
+      }
+
+
+      size_t
+      BitVectorGenKill::hash() const
+      {
+        return m_hash;
+      }
+
+
+      std::ostream &
+      BitVectorGenKill::print(std::ostream & os) const
+      {
+        if (isZero()) {
+          return os << "<zero>";
+        }
+        if (isOne()) {
+          return os << "<one>";
+        }
+        if (isBottom()) {
+          return os << "<bottom>";
+        }
+        os << "<\\S.(S - ";
+        m_kill.print(os);
+        os << ") U ";
+        m_gen.print(os);
+        return os << ">";
+      }
+
+
+      BitVectorSet
+      BitVectorGenKill::apply(BitVectorSet const & input) const
+      {
+        fast_assert(!isZero());
+        return BitVectorSet::Union(BitVectorSet::Diff(input, m_kill), m_gen);
+      }
+
+
+      BitVectorSet const &
+      BitVectorGenKill::getKill() const
+      {
+        fast_assert(!isZero());
+        return m_kill;
+      }
+
+
+      BitVectorSet const &
+      BitVectorGenKill::getGen() const
+      {
+        fast_assert(!isZero());
+        return m_gen;
+      }
+
+    }
+  }
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
@@ -0,0 +1,149 @@
+#ifndef WALI_DOMAINS_GENKILL_BIT_VECTOR_GEN_KILL_HPP
+#define WALI_DOMAINS_GENKILL_BIT_VECTOR_GEN_KILL_HPP
+
+#include <iosfwd>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "wali/SemElem.hpp"
+
+namespace wali {
+  namespace domains {
+    namespace genkill {
+
+      /// A set of small non-negative integers (e.g., variable numbers),
+      /// stored as a dense bit vector.
+      ///
+      /// The set may also be a complement, so that the universe and sets
+      /// like "everything but x" are as cheap as the empty set and {x}.
+      /// Trailing zero words are trimmed, so equal sets have identical
+      /// representations and hash the same.
+      ///
+      /// BitVectorSet also provides the static interface required of the
+      /// Set parameter of GenKillTransformer_T (see
+      /// GenKillXformerTemplate.hpp).
+      class BitVectorSet
+      {
+      public:
+        typedef boost::uint64_t Word;
+
+        /// The empty set
+        BitVectorSet();
+
+        static BitVectorSet const & EmptySet();
+        static BitVectorSet const & UniverseSet();
+        static BitVectorSet singleton(size_t element);
+
+        void insert(size_t element);
+        void erase(size_t element);
+        bool contains(size_t element) const;
+
+        bool isEmpty() const;
+        bool isUniverse() const;
+
+        BitVectorSet complement() const;
+
+        static bool Eq(BitVectorSet const & x, BitVectorSet const & y);
+        static BitVectorSet Union(BitVectorSet const & x, BitVectorSet const & y);
+        static BitVectorSet Intersect(BitVectorSet const & x, BitVectorSet const & y);
+        static BitVectorSet Diff(BitVectorSet const & x, BitVectorSet const & y,
+                                 bool normalizing = false);
+
+        bool operator==(BitVectorSet const & other) const;
+        bool operator!=(BitVectorSet const & other) const;
+
+        size_t hash() const;
+
+        std::ostream & print(std::ostream & os) const;
+
+      private:
+        /// Membership of i is (bit i of m_words) != m_complemented
+        std::vector<Word> m_words;
+        bool m_complemented;
+
+        void trim();
+      };
+
+
+      /// The gen/kill transformer \S.(S - kill) U gen over BitVectorSets.
+      ///
+      /// This has the same semantics as
+      /// GenKillTransformer_T<BitVectorSet>, but transformers are
+      /// hash-consed: make() returns the existing instance when one with
+      /// the same (normalized) kill and gen sets is alive. So equal() and
+      /// containerLessThan() only compare addresses, hash() is computed
+      /// once, and repeated results of extend and combine share storage.
+      /// one, zero, and bottom are created once and never freed.
+      class BitVectorGenKill
+        : public wali::SemElem
+      {
+      public:
+        /// Returns the transformer \S.(S - kill) U gen
+        static sem_elem_t make(BitVectorSet const & kill, BitVectorSet const & gen);
+
+        static sem_elem_t MkOne();
+        static sem_elem_t MkZero();
+        static sem_elem_t MkBottom();
+
+        /// The number of distinct non-zero transformers alive
+        static size_t numInterned();
+
+        ~BitVectorGenKill();
+
+        virtual sem_elem_t one() const;
+        virtual sem_elem_t zero() const;
+        sem_elem_t bottom() const;
+
+        bool isOne() const;
+        bool isZero() const;
+        bool isBottom() const;
+
+        /// x extend y = y o x (first apply x, then y)
+        virtual sem_elem_t extend(SemElem * se);
+        virtual sem_elem_t combine(SemElem * se);
+        virtual sem_elem_t diff(SemElem * se);
+        virtual sem_elem_t quasi_one() const;
+
+        virtual bool equal(SemElem * se) const;
+        virtual bool containerLessThan(SemElem const * other) const;
+        virtual size_t hash() const;
+
+        virtual std::ostream & print(std::ostream & os) const;
+
+        BitVectorSet apply(BitVectorSet const & input) const;
+        BitVectorSet const & getKill() const;
+        BitVectorSet const & getGen() const;
+
+      private:
+        struct Hash;
+        struct Equal;
+        struct ContentsHash;
+        struct ContentsEqual;
+        struct InternTable;
+
+        /// All live non-zero transformers
+        static InternTable & internTable();
+
+        /// Non-zero transformers; kill must not intersect gen
+        BitVectorGenKill(BitVectorSet const & kill, BitVectorSet const & gen);
+        /// Zero
+        BitVectorGenKill();
+
+        BitVectorSet m_kill;
+        BitVectorSet m_gen;
+        size_t m_hash;
+        bool m_is_zero;
+      };
+
+    }
+  }
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif /* WALI_DOMAINS_GENKILL_BIT_VECTOR_GEN_KILL_HPP */
@@ -0,0 +1,294 @@
+#ifndef WALI_DOMAINS_MATRIX_MATRIX_KERNELS_HPP
+#define WALI_DOMAINS_MATRIX_MATRIX_KERNELS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "wali/Common.hpp"
+#include "wali/domains/matrix/MinPlus.hpp"
+
+namespace wali {
+  namespace domains {
+    namespace details {
+
+      /// The dense kernels behind Matrix<T>. Each works on row-major arrays
+      /// of value_type (as stored by Matrix::BackingMatrix):
+      ///
+      ///   multiply_add(a, b, c, n, m, p):  c += a * b, where a is n x m,
+      ///                                    b is m x p, and c is n x p
+      ///   add(a, c, count):                c += a, elementwise
+      ///   star(a, n):                      a := a*, if this kernel knows
+      ///                                    how; returns false otherwise
+      ///
+      /// The generic version just performs the semiring operations in a
+      /// cache-blocked loop, keeping the order in which each element's
+      /// products are combined the same as ublas's prod(). There are
+      /// specializations for bool and MinPlus<int> that work on packed
+      /// words and plain ints so the compiler can vectorize the inner loops.
+      template<typename T>
+      struct MatrixKernels
+      {
+        // Columns of c (and b) handled per block, and rows of b per block
+        static const size_t col_block = 256;
+        static const size_t inner_block = 64;
+
+        static void
+        multiply_add(T const * a, T const * b, T * c, size_t n, size_t m, size_t p)
+        {
+          for (size_t jj = 0; jj < p; jj += col_block) {
+            size_t j_end = std::min(p, jj + col_block);
+            for (size_t kk = 0; kk < m; kk += inner_block) {
+              size_t k_end = std::min(m, kk + inner_block);
+              for (size_t i = 0; i < n; ++i) {
+                T * c_row = c + i*p;
+                for (size_t k = kk; k < k_end; ++k) {
+                  T const & a_ik = a[i*m + k];
+                  T const * b_row = b + k*p;
+                  for (size_t j = jj; j < j_end; ++j) {
+                    c_row[j] += a_ik * b_row[j];
+                  }
+                }
+              }
+            }
+          }
+        }
+
+        static void
+        add(T const * a, T * c, size_t count)
+        {
+          for (size_t i = 0; i < count; ++i) {
+            c[i] += a[i];
+          }
+        }
+
+        static bool
+        star(T * a ATTR_UNUSED, size_t n ATTR_UNUSED)
+        {
+          return false;
+        }
+      };
+
+
+      /// Boolean matrices are packed 64 entries to a word, and products and
+      /// closures become ORs of whole rows.
+      template<>
+      struct MatrixKernels<bool>
+      {
+        typedef boost::uint64_t Word;
+        static const size_t word_bits = 64;
+
+        static size_t
+        words_for(size_t bits)
+        {
+          return (bits + word_bits - 1) / word_bits;
+        }
+
+        static void
+        pack(bool const * a, size_t rows, size_t cols, std::vector<Word> & out)
+        {
+          size_t words = words_for(cols);
+          out.assign(rows * words, 0);
+          for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+              if (a[i*cols + j]) {
+                out[i*words + j/word_bits] |= Word(1) << (j % word_bits);
+              }
+            }
+          }
+        }
+
+        static void
+        unpack(std::vector<Word> const & in, size_t rows, size_t cols, bool * a)
+        {
+          size_t words = words_for(cols);
+          for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+              a[i*cols + j] = (in[i*words + j/word_bits] >> (j % word_bits)) & 1;
+            }
+          }
+        }
+
+        static void
+        or_row(Word const * from, Word * to, size_t words)
+        {
+          for (size_t w = 0; w < words; ++w) {
+            to[w] |= from[w];
+          }
+        }
+
+        static void
+        multiply_add(bool const * a, bool const * b, bool * c, size_t n, size_t m, size_t p)
+        {
+          std::vector<Word> b_bits, c_bits;
+          pack(b, m, p, b_bits);
+          pack(c, n, p, c_bits);
+          size_t words = words_for(p);
+          for (size_t i = 0; i < n; ++i) {
+            for (size_t k = 0; k < m; ++k) {
+              if (a[i*m + k]) {
+                or_row(&b_bits[k*words], &c_bits[i*words], words);
+              }
+            }
+          }
+          unpack(c_bits, n, p, c);
+        }
+
+        static void
+        add(bool const * a, bool * c, size_t count)
+        {
+          for (size_t i = 0; i < count; ++i) {
+            c[i] = c[i] || a[i];
+          }
+        }
+
+        /// Warshall's algorithm on the reflexive closure
+        static bool
+        star(bool * a, size_t n)
+        {
+          std::vector<Word> bits;
+          pack(a, n, n, bits);
+          size_t words = words_for(n);
+          for (size_t i = 0; i < n; ++i) {
+            bits[i*words + i/word_bits] |= Word(1) << (i % word_bits);
+          }
+          for (size_t k = 0; k < n; ++k) {
+            Word const * k_row = &bits[k*words];
+            for (size_t i = 0; i < n; ++i) {
+              if ((bits[i*words + k/word_bits] >> (k % word_bits)) & 1) {
+                or_row(k_row, &bits[i*words], words);
+              }
+            }
+          }
+          unpack(bits, n, n, a);
+          return true;
+        }
+      };
+
+
+      /// Min-plus matrices are unpacked into plain ints, with the
+      /// semiring zero (infinity) kept as INT_MAX and never added to.
+      template<>
+      struct MatrixKernels<MinPlus<int> >
+      {
+        typedef MinPlus<int> T;
+
+        static const size_t col_block = 256;
+        static const size_t inner_block = 64;
+
+        static int
+        infinity()
+        {
+          return T().infinity();
+        }
+
+        static void
+        unwrap(T const * a, size_t count, std::vector<int> & out)
+        {
+          out.resize(count);
+          for (size_t i = 0; i < count; ++i) {
+            out[i] = a[i].get_value();
+          }
+        }
+
+        static void
+        wrap(std::vector<int> const & in, T * a)
+        {
+          for (size_t i = 0; i < in.size(); ++i) {
+            a[i].set_value(in[i]);
+          }
+        }
+
+        /// to[j] = min(to[j], from[j] + d), for a finite d
+        static void
+        relax_row(int const * from, int d, int * to, size_t begin, size_t end)
+        {
+          int const inf = infinity();
+          for (size_t j = begin; j < end; ++j) {
+            int through = from[j] == inf ? inf : from[j] + d;
+            to[j] = through < to[j] ? through : to[j];
+          }
+        }
+
+        static void
+        multiply_add(T const * a, T const * b, T * c, size_t n, size_t m, size_t p)
+        {
+          int const inf = infinity();
+          std::vector<int> a_raw, b_raw, c_raw;
+          unwrap(a, n*m, a_raw);
+          unwrap(b, m*p, b_raw);
+          unwrap(c, n*p, c_raw);
+
+          for (size_t jj = 0; jj < p; jj += col_block) {
+            size_t j_end = std::min(p, jj + col_block);
+            for (size_t kk = 0; kk < m; kk += inner_block) {
+              size_t k_end = std::min(m, kk + inner_block);
+              for (size_t i = 0; i < n; ++i) {
+                for (size_t k = kk; k < k_end; ++k) {
+                  int a_ik = a_raw[i*m + k];
+                  if (a_ik != inf) {
+                    relax_row(&b_raw[k*p], a_ik, &c_raw[i*p], jj, j_end);
+                  }
+                }
+              }
+            }
+          }
+
+          wrap(c_raw, c);
+        }
+
+        static void
+        add(T const * a, T * c, size_t count)
+        {
+          for (size_t i = 0; i < count; ++i) {
+            c[i] += a[i];
+          }
+        }
+
+        /// Floyd-Warshall on the reflexive closure. This gives up (and
+        /// returns false) if there is a negative cycle, which has no star
+        /// in MinPlus<int>.
+        static bool
+        star(T * a, size_t n)
+        {
+          int const inf = infinity();
+          std::vector<int> raw;
+          unwrap(a, n*n, raw);
+          for (size_t i = 0; i < n; ++i) {
+            raw[i*n + i] = std::min(raw[i*n + i], 0);
+          }
+          for (size_t k = 0; k < n; ++k) {
+            if (raw[k*n + k] < 0) {
+              return false;
+            }
+            int const * k_row = &raw[k*n];
+            for (size_t i = 0; i < n; ++i) {
+              int a_ik = raw[i*n + k];
+              if (a_ik != inf && i != k) {
+                relax_row(k_row, a_ik, &raw[i*n], 0, n);
+              }
+            }
+          }
+          for (size_t i = 0; i < n; ++i) {
+            if (raw[i*n + i] < 0) {
+              return false;
+            }
+          }
+          wrap(raw, a);
+          return true;
+        }
+      };
+
+    }
+  }
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif /* WALI_DOMAINS_MATRIX_MATRIX_KERNELS_HPP */
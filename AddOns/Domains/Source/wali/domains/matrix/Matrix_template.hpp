@@ -42,6 +42,16 @@ namespace wali {
       Matrix *
       combine_raw(Matrix * rhs) const;
 
+      /// (this * rhs) + addend, without building the intermediate product
+      Matrix *
+      extend_and_combine_raw(Matrix * rhs, Matrix * addend) const;
+
+      /// The reflexive, transitive closure, for square matrices. Returns
+      /// NULL if the element type has no closure algorithm (or, for
+      /// MinPlus, if there is a negative cycle).
+      Matrix *
+      star_raw() const;
+
       bool
       equal(Matrix * rhs) const;
 
@@ -55,6 +65,14 @@ namespace wali {
       virtual sem_elem_t extend(SemElem * se);
       virtual sem_elem_t combine(SemElem * se);
       virtual bool equal(SemElem * se) const;
+      virtual sem_elem_t star();
+
+      /// When every rhs[i] is the same matrix (as when a path summary
+      /// extends a batch of transition weights by one delta), stacks the
+      /// lhs matrices and does a single product. Otherwise, extends each
+      /// pair separately.
+      virtual void extend_many(size_t n, sem_elem_t const * lhs,
+                               sem_elem_t const * rhs, sem_elem_t * out);
 
     private:
       Matrix* down(SemElem* se) const;
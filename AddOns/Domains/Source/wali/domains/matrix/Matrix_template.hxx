@@ -2,7 +2,9 @@
 #define MATRIX_TEMPLATE_HXX
 
 #include <wali/Common.hpp>
+#include <wali/domains/matrix/MatrixKernels.hpp>
 #include <boost/numeric/ublas/io.hpp>
+#include <algorithm>
 #include <ostream>
 
 using namespace boost::numeric::ublas;
@@ -46,7 +48,14 @@ namespace wali {
     Matrix<ElementType>*
     Matrix<ElementType>::extend_raw(Matrix * that) const
     {
-      return new Matrix(prod(this->matrix(), that->matrix()));
+      fast_assert(this->matrix().size2() == that->matrix().size1());
+      Matrix * result = new Matrix(BackingMatrix(this->matrix().size1(),
+                                                 that->matrix().size2()));
+      details::MatrixKernels<value_type>::multiply_add(
+        this->matrix().data().data(), that->matrix().data().data(),
+        result->m_matrix.data().data(),
+        this->matrix().size1(), this->matrix().size2(), that->matrix().size2());
+      return result;
     }
 
 
@@ -54,7 +63,45 @@ namespace wali {
     Matrix<ElementType>*
     Matrix<ElementType>::combine_raw(Matrix * that) const
     {
-      return new Matrix(this->matrix() + that->matrix());
+      fast_assert(this->matrix().size1() == that->matrix().size1());
+      fast_assert(this->matrix().size2() == that->matrix().size2());
+      Matrix * result = new Matrix(this->matrix());
+      details::MatrixKernels<value_type>::add(
+        that->matrix().data().data(), result->m_matrix.data().data(),
+        result->matrix().data().size());
+      return result;
+    }
+
+
+    template<typename ElementType>
+    Matrix<ElementType>*
+    Matrix<ElementType>::extend_and_combine_raw(Matrix * that, Matrix * addend) const
+    {
+      fast_assert(this->matrix().size2() == that->matrix().size1());
+      fast_assert(this->matrix().size1() == addend->matrix().size1());
+      fast_assert(that->matrix().size2() == addend->matrix().size2());
+      Matrix * result = new Matrix(addend->matrix());
+      details::MatrixKernels<value_type>::multiply_add(
+        this->matrix().data().data(), that->matrix().data().data(),
+        result->m_matrix.data().data(),
+        this->matrix().size1(), this->matrix().size2(), that->matrix().size2());
+      return result;
+    }
+
+
+    template<typename ElementType>
+    Matrix<ElementType>*
+    Matrix<ElementType>::star_raw() const
+    {
+      fast_assert(this->matrix().size1() == this->matrix().size2());
+      Matrix * result = new Matrix(this->matrix());
+      if (!details::MatrixKernels<value_type>::star(result->m_matrix.data().data(),
+                                                    result->matrix().size1()))
+      {
+        delete result;
+        return NULL;
+      }
+      return result;
     }
 
 
@@ -131,6 +178,69 @@ namespace wali {
       return equal(down(se));
     }
 
+
+    template<typename ElementType>
+    sem_elem_t
+    Matrix<ElementType>::star()
+    {
+      Matrix * result = star_raw();
+      if (result == NULL) {
+        return SemElem::star();
+      }
+      return result;
+    }
+
+
+    template<typename ElementType>
+    void
+    Matrix<ElementType>::extend_many(size_t n, sem_elem_t const * lhs,
+                                     sem_elem_t const * rhs, sem_elem_t * out)
+    {
+      if (n < 2) {
+        SemElem::extend_many(n, lhs, rhs, out);
+        return;
+      }
+
+      // Holds on to the common operand in case out is the same array as rhs
+      sem_elem_t common_se = rhs[0];
+      Matrix * common = down(common_se.get_ptr());
+      size_t rows = down(lhs[0].get_ptr())->matrix().size1();
+      size_t inner = common->matrix().size1();
+      size_t cols = common->matrix().size2();
+
+      for (size_t i = 0; i < n; ++i) {
+        if (rhs[i].get_ptr() != common
+            || down(lhs[i].get_ptr())->matrix().size1() != rows)
+        {
+          SemElem::extend_many(n, lhs, rhs, out);
+          return;
+        }
+        fast_assert(down(lhs[i].get_ptr())->matrix().size2() == inner);
+      }
+
+      boost::container::vector<value_type> stacked;
+      stacked.reserve(n * rows * inner);
+      for (size_t i = 0; i < n; ++i) {
+        typename BackingMatrix::array_type const & data =
+          down(lhs[i].get_ptr())->matrix().data();
+        stacked.insert(stacked.end(), data.begin(), data.end());
+      }
+
+      BackingMatrix product(n * rows, cols);
+      details::MatrixKernels<value_type>::multiply_add(
+        stacked.data(), common->matrix().data().data(),
+        product.data().data(), n * rows, inner, cols);
+
+      for (size_t i = 0; i < n; ++i) {
+        BackingMatrix part(rows, cols);
+        std::copy(product.data().begin() + i * rows * cols,
+                  product.data().begin() + (i + 1) * rows * cols,
+                  part.data().begin());
+        out[i] = new Matrix(part);
+      }
+    }
+
+
     template<typename ElementType>
     Matrix<ElementType>*
     Matrix<ElementType>::down(SemElem* se) const
@@ -1,3 +1,6 @@
+#ifndef WALI_DOMAINS_MATRIX_MIN_PLUS_HPP
+#define WALI_DOMAINS_MATRIX_MIN_PLUS_HPP
+
 #include <algorithm>
 #include <limits>
 #include <ostream>
@@ -173,3 +176,5 @@ namespace wali {
 //   c-file-style: "ellemtel"
 //   c-basic-offset: 2
 // End:
+
+#endif /* WALI_DOMAINS_MATRIX_MIN_PLUS_HPP */
@@ -0,0 +1,1147 @@
+#include "wali/wpds/FastWpdsReader.hpp"
+
+#include "wali/Key.hpp"
+#include "wali/SemElem.hpp"
+#include "wali/MergeFn.hpp"
+#include "wali/WeightFactory.hpp"
+#include "wali/MergeFnFactory.hpp"
+#include "wali/util/unordered_map.hpp"
+
+#include "wali/wpds/Rule.hpp"
+#include "wali/wpds/RuleFunctor.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/DebugWPDS.hpp"
+#include "wali/wpds/ewpds/ERule.hpp"
+#include "wali/wpds/ewpds/EWPDS.hpp"
+#include "wali/wfa/ITrans.hpp"
+#include "wali/wfa/State.hpp"
+#include "wali/wfa/WFA.hpp"
+
+#include "opennwa/Nwa.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace wali
+{
+  namespace wpds
+  {
+    namespace
+    {
+      typedef unsigned int u32;
+
+      const u32 NONE = 0xFFFFFFFF;
+
+      const char BinaryMagic[] = "WALIWPDS";
+      const u32 BinaryVersion = 1;
+
+      /// The root element of Nwa::marshall; Nwa::XMLTag is private
+      const std::string NwaXMLTag("XML");
+
+      std::string trim( std::string const & s )
+      {
+        std::string::size_type b = s.find_first_not_of(" \t\r\n");
+        if( b == std::string::npos ) {
+          return "";
+        }
+        std::string::size_type e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+      }
+
+      /**
+       * The rules of a block, as indices into a table of the distinct
+       * strings they use. flush() turns each string that is used as a
+       * name into a Key, and each one used as a weight or merge function
+       * into a sem_elem_t or merge_fn_t, once, then adds the rules.
+       */
+      class RuleBlock
+      {
+        public:
+          RuleBlock( WeightFactory* wf, MergeFnFactory* mf )
+            : fWeightFactory(wf), fMergeFactory(mf)
+          {}
+
+          u32 intern( std::string const & s )
+          {
+            index_t::iterator it = index.find(s);
+            if( it != index.end() ) {
+              return it->second;
+            }
+            u32 i = static_cast<u32>(strings.size());
+            index.insert(std::make_pair(s, i));
+            strings.push_back(s);
+            return i;
+          }
+
+          /// For a binary dump, whose strings are already distinct
+          void setStrings( std::vector<std::string> & ss )
+          {
+            strings.swap(ss);
+          }
+
+          size_t numStrings() const { return strings.size(); }
+
+          void addRule( u32 const r[7] )
+          {
+            rules.insert(rules.end(), r, r + 7);
+          }
+
+          size_t numRules() const { return rules.size() / 7; }
+
+          /**
+           * Adds the rules to pds. Strings and what was built from them
+           * are forgotten if clear_strings.
+           * @return 0 on success
+           */
+          int flush( WPDS & pds, bool clear_strings )
+          {
+            keys.resize(strings.size(), WALI_EPSILON);
+            has_key.resize(strings.size(), false);
+            weights.resize(strings.size());
+            merges.resize(strings.size());
+            has_merge.resize(strings.size(), false);
+
+            ewpds::EWPDS * epds = dynamic_cast<ewpds::EWPDS*>(&pds);
+            for( size_t i = 0; i < rules.size(); i += 7 ) {
+              u32 const * r = &rules[i];
+              for( size_t j = 0; j < 7; j++ ) {
+                if( r[j] != NONE && r[j] >= strings.size() ) {
+                  *waliErr << "[ERROR] FastWpdsReader - string index out of range.\n";
+                  return 1;
+                }
+              }
+              if( r[5] == NONE ) {
+                *waliErr << "[ERROR] FastWpdsReader - rule without a weight.\n";
+                return 1;
+              }
+              Key from      = key(r[0]);
+              Key fromStack = key(r[1]);
+              Key to        = key(r[2]);
+              Key toStack1  = key(r[3]);
+              Key toStack2  = key(r[4]);
+              sem_elem_t se = weight(r[5]);
+              merge_fn_t mf;
+              if( r[6] != NONE && toStack2 != WALI_EPSILON ) {
+                if( !merge(r[6], mf) ) {
+                  return 1;
+                }
+              }
+              if( epds != NULL && mf.is_valid() ) {
+                epds->add_rule(from, fromStack, to, toStack1, toStack2, se, mf);
+              }
+              else {
+                pds.add_rule(from, fromStack, to, toStack1, toStack2, se);
+              }
+            }
+            rules.clear();
+            if( clear_strings ) {
+              strings.clear();
+              index.clear();
+              keys.clear();
+              has_key.clear();
+              weights.clear();
+              merges.clear();
+              has_merge.clear();
+            }
+            return 0;
+          }
+
+        private:
+          typedef util::unordered_map<std::string, u32> index_t;
+
+          WeightFactory* fWeightFactory;
+          MergeFnFactory* fMergeFactory;
+          std::vector<std::string> strings;
+          index_t index;
+          std::vector<u32> rules;         //!< Seven indices per rule
+          std::vector<Key> keys;
+          std::vector<bool> has_key;
+          std::vector<sem_elem_t> weights;
+          std::vector<merge_fn_t> merges;
+          std::vector<bool> has_merge;
+
+          Key key( u32 i )
+          {
+            if( i == NONE ) {
+              return WALI_EPSILON;
+            }
+            if( !has_key[i] ) {
+              keys[i] = getKey(strings[i]);
+              has_key[i] = true;
+            }
+            return keys[i];
+          }
+
+          sem_elem_t weight( u32 i )
+          {
+            if( !weights[i].is_valid() ) {
+              weights[i] = fWeightFactory->getWeight(strings[i]);
+            }
+            return weights[i];
+          }
+
+          /// Sets mf to merge function i, invalid for "NONE"
+          bool merge( u32 i, merge_fn_t & mf )
+          {
+            if( !has_merge[i] ) {
+              if( trim(strings[i]) != "NONE" ) {
+                if( fMergeFactory == NULL ) {
+                  *waliErr << "[ERROR] FastWpdsReader - no MergeFactory given.\n";
+                  return false;
+                }
+                merges[i] = fMergeFactory->getMergeFn(strings[i]);
+              }
+              has_merge[i] = true;
+            }
+            mf = merges[i];
+            return true;
+          }
+      };
+
+
+      /// Reads an istream a chunk at a time
+      class Scanner
+      {
+        public:
+          Scanner( std::istream & i ) : in(i), buf(1 << 20), pos(0), end(0), line(1) {}
+
+          int peek()
+          {
+            if( pos == end && !fill() ) {
+              return EOF;
+            }
+            return static_cast<unsigned char>(buf[pos]);
+          }
+
+          int get()
+          {
+            int c = peek();
+            if( c != EOF ) {
+              pos++;
+              if( c == '\n' ) {
+                line++;
+              }
+            }
+            return c;
+          }
+
+          void skipSpace()
+          {
+            int c;
+            while( (c = peek()) == ' ' || c == '\t' || c == '\r' || c == '\n' ) {
+              get();
+            }
+          }
+
+          /// Consumes input up to and including [s]; false at EOF
+          bool skipPast( const char * s )
+          {
+            size_t n = std::strlen(s);
+            size_t matched = 0;
+            int c;
+            while( (c = get()) != EOF ) {
+              if( c == s[matched] ) {
+                if( ++matched == n ) {
+                  return true;
+                }
+                continue;
+              }
+              // Fall back to the longest prefix of s that ends here; the
+              // patterns are a few characters long
+              std::string seen(s, matched);
+              seen += static_cast<char>(c);
+              matched = 0;
+              for( size_t k = seen.size(); k > 0; k-- ) {
+                if( seen.compare(seen.size() - k, k, s, k) == 0 ) {
+                  matched = k;
+                  break;
+                }
+              }
+            }
+            return false;
+          }
+
+          /// Reads an XML name into [name]
+          void readName( std::string & name )
+          {
+            name.clear();
+            int c;
+            while( (c = peek()) != EOF && c != ' ' && c != '\t' && c != '\r'
+                   && c != '\n' && c != '>' && c != '/' && c != '=' )
+            {
+              name += static_cast<char>(c);
+              get();
+            }
+          }
+
+          /// Appends the character of the entity whose '&' was just
+          /// read; false if it is not one
+          bool readEntity( std::string & out )
+          {
+            std::string ent;
+            int c;
+            while( (c = get()) != EOF && c != ';' ) {
+              ent += static_cast<char>(c);
+              if( ent.size() > 10 ) {
+                return false;
+              }
+            }
+            if( ent == "amp" ) out += '&';
+            else if( ent == "lt" ) out += '<';
+            else if( ent == "gt" ) out += '>';
+            else if( ent == "quot" ) out += '"';
+            else if( ent == "apos" ) out += '\'';
+            else if( ent.size() > 1 && ent[0] == '#' ) {
+              long v = (ent[1] == 'x')
+                ? std::strtol(ent.c_str() + 2, NULL, 16)
+                : std::strtol(ent.c_str() + 1, NULL, 10);
+              if( v <= 0 || v > 0x7F ) {
+                // Only ASCII; Xerces would produce UTF-8 here
+                return false;
+              }
+              out += static_cast<char>(v);
+            }
+            else {
+              return false;
+            }
+            return true;
+          }
+
+          int lineNumber() const { return line; }
+
+        private:
+          std::istream & in;
+          std::vector<char> buf;
+          size_t pos, end;
+          int line;
+
+          bool fill()
+          {
+            if( !in ) {
+              return false;
+            }
+            in.read(&buf[0], buf.size());
+            end = static_cast<size_t>(in.gcount());
+            pos = 0;
+            return end > 0;
+          }
+      };
+
+      /**
+       * Tokenizes the XML on a Scanner and hands each element to
+       * startElement and endElement, with its name and attributes. The
+       * text of an element is collected in chars while in_text is set;
+       * anywhere else, text other than white space is an error.
+       */
+      class XmlReader
+      {
+        public:
+          XmlReader( Scanner & s ) : scan(s), in_text(false) {}
+
+          virtual ~XmlReader() {}
+
+          int parse()
+          {
+            std::string text;
+            while( true ) {
+              text.clear();
+              int c;
+              while( (c = scan.peek()) != EOF && c != '<' ) {
+                scan.get();
+                if( c == '&' ) {
+                  if( !scan.readEntity(text) ) {
+                    return error("bad character entity");
+                  }
+                }
+                else {
+                  text += static_cast<char>(c);
+                }
+              }
+              if( in_text ) {
+                chars += text;
+              }
+              else if( !trim(text).empty() ) {
+                return error("unexpected text '" + trim(text) + "'");
+              }
+              if( c == EOF ) {
+                break;
+              }
+              scan.get();  // '<'
+              c = scan.peek();
+              if( c == '?' ) {
+                if( !scan.skipPast("?>") ) {
+                  return error("unterminated processing instruction");
+                }
+              }
+              else if( c == '!' ) {
+                scan.get();
+                if( scan.peek() == '-' ) {
+                  if( !scan.skipPast("-->") ) {
+                    return error("unterminated comment");
+                  }
+                }
+                else if( !scan.skipPast(">") ) {
+                  return error("unterminated declaration");
+                }
+              }
+              else if( c == '/' ) {
+                scan.get();
+                scan.readName(name);
+                scan.skipSpace();
+                if( scan.get() != '>' ) {
+                  return error("malformed end tag '" + name + "'");
+                }
+                int rc = endElement();
+                if( rc != 0 ) {
+                  return rc;
+                }
+              }
+              else {
+                int rc = startTag();
+                if( rc != 0 ) {
+                  return rc;
+                }
+              }
+            }
+            return finish();
+          }
+
+        protected:
+          typedef std::map<std::string, std::string> attrs_t;
+
+          Scanner & scan;
+          std::string name;
+          attrs_t attrs;
+          bool in_text;
+          std::string chars;
+
+          virtual int startElement() = 0;
+
+          virtual int endElement() = 0;
+
+          //! Called at the end of the input
+          virtual int finish() = 0;
+
+          int error( std::string const & msg )
+          {
+            *waliErr << "[ERROR] FastWpdsReader - " << msg
+              << " on line " << scan.lineNumber() << ".\n";
+            return 1;
+          }
+
+          //! @return the value of attribute key, or NULL if there is none
+          std::string const * value( std::string const & key ) const
+          {
+            attrs_t::const_iterator it = attrs.find(key);
+            return (it == attrs.end()) ? NULL : &it->second;
+          }
+
+        private:
+          /// Reads a start tag whose '<' was just read
+          int startTag()
+          {
+            scan.readName(name);
+            attrs.clear();
+            bool empty = false;
+            while( true ) {
+              scan.skipSpace();
+              int c = scan.peek();
+              if( c == '>' ) {
+                scan.get();
+                break;
+              }
+              if( c == '/' ) {
+                scan.get();
+                if( scan.get() != '>' ) {
+                  return error("malformed tag '" + name + "'");
+                }
+                empty = true;
+                break;
+              }
+              if( c == EOF ) {
+                return error("unterminated tag '" + name + "'");
+              }
+              std::string attr;
+              scan.readName(attr);
+              scan.skipSpace();
+              if( scan.get() != '=' ) {
+                return error("malformed attribute '" + attr + "'");
+              }
+              scan.skipSpace();
+              int quote = scan.get();
+              if( quote != '\'' && quote != '"' ) {
+                return error("unquoted attribute '" + attr + "'");
+              }
+              std::string & value = attrs[attr];
+              while( (c = scan.get()) != quote ) {
+                if( c == EOF ) {
+                  return error("unterminated attribute '" + attr + "'");
+                }
+                if( c == '&' ) {
+                  if( !scan.readEntity(value) ) {
+                    return error("bad character entity");
+                  }
+                }
+                else {
+                  value += static_cast<char>(c);
+                }
+              }
+            }
+            int rc = startElement();
+            if( rc == 0 && empty ) {
+              rc = endElement();
+            }
+            return rc;
+          }
+      };
+
+      /// Parses the XML of a (E)WPDS into RuleBlocks
+      class XmlRuleParser : public XmlReader
+      {
+        public:
+          XmlRuleParser( Scanner & s, RuleBlock & b, WPDS & p, size_t bs,
+                         FastWpdsReader::SSMap & entry,
+                         FastWpdsReader::SSMap & exit )
+            : XmlReader(s), block(b), pds(p), block_size(bs)
+            , metaEntry(entry), metaExit(exit), num_rules(0)
+            , in_rule(false)
+          {}
+
+          size_t numRules() const { return num_rules; }
+
+        private:
+          RuleBlock & block;
+          WPDS & pds;
+          size_t block_size;
+          FastWpdsReader::SSMap & metaEntry;
+          FastWpdsReader::SSMap & metaExit;
+          size_t num_rules;
+
+          bool in_rule;
+          u32 rule[7];
+
+          u32 attr( std::string const & key )
+          {
+            std::string const * v = value(key);
+            return (v == NULL) ? NONE : block.intern(*v);
+          }
+
+          int finish()
+          {
+            if( in_rule ) {
+              return error("unterminated " + Rule::XMLTag);
+            }
+            return block.flush(pds, true);
+          }
+
+          int startElement()
+          {
+            if( name == WPDS::XMLTag || name == ewpds::EWPDS::XMLTag ) {
+              // do nothing
+            }
+            else if( name == DebugWPDS::XMLTag ) {
+              *waliErr << "[INFO] Begin parsing DebugWPDS." << std::endl;
+            }
+            else if( name == "Function" ) {
+              std::string const & fname = attrs["name"];
+              metaEntry[fname] = attrs["entry"];
+              metaExit[fname] = attrs["exit"];
+            }
+            else if( name == Rule::XMLTag ) {
+              if( in_rule ) {
+                return error("nested " + Rule::XMLTag);
+              }
+              in_rule = true;
+              rule[0] = attr(Rule::XMLFromTag);
+              rule[1] = attr(Rule::XMLFromStackTag);
+              rule[2] = attr(Rule::XMLToTag);
+              rule[3] = attr(Rule::XMLToStack1Tag);
+              rule[4] = attr(Rule::XMLToStack2Tag);
+              rule[5] = NONE;
+              rule[6] = NONE;
+            }
+            else if( in_rule && (name == SemElem::XMLTag || name == "MergeFn") ) {
+              in_text = true;
+              chars.clear();
+            }
+            else {
+              return error("unrecognized element '" + name + "'");
+            }
+            return 0;
+          }
+
+          int endElement()
+          {
+            if( name == SemElem::XMLTag && in_text ) {
+              rule[5] = block.intern(chars);
+              in_text = false;
+            }
+            else if( name == "MergeFn" && in_text ) {
+              rule[6] = block.intern(chars);
+              in_text = false;
+            }
+            else if( name == Rule::XMLTag && in_rule ) {
+              in_rule = false;
+              block.addRule(rule);
+              num_rules++;
+              if( block.numRules() >= block_size ) {
+                return block.flush(pds, true);
+              }
+            }
+            else if( name == DebugWPDS::XMLTag ) {
+              *waliErr << "[INFO] End parsing DebugWPDS." << std::endl;
+            }
+            else if( name != WPDS::XMLTag && name != ewpds::EWPDS::XMLTag
+                     && name != "Function" )
+            {
+              return error("unexpected end tag '" + name + "'");
+            }
+            return 0;
+          }
+      };
+
+
+      /// Keys and weights by the string they were read from, so that
+      /// each distinct one is built once until the next clear()
+      class StringCache
+      {
+        public:
+          StringCache( WeightFactory* wf ) : fWeightFactory(wf) {}
+
+          Key key( std::string const & s )
+          {
+            util::unordered_map<std::string, Key>::iterator it = keys.find(s);
+            if( it != keys.end() ) {
+              return it->second;
+            }
+            Key k = getKey(s);
+            keys.insert(std::make_pair(s, k));
+            return k;
+          }
+
+          sem_elem_t weight( std::string const & s )
+          {
+            util::unordered_map<std::string, sem_elem_t>::iterator it = weights.find(s);
+            if( it != weights.end() ) {
+              return it->second;
+            }
+            sem_elem_t se = fWeightFactory->getWeight(s);
+            weights.insert(std::make_pair(s, se));
+            return se;
+          }
+
+          void clear()
+          {
+            keys.clear();
+            weights.clear();
+          }
+
+        private:
+          WeightFactory* fWeightFactory;
+          util::unordered_map<std::string, Key> keys;
+          util::unordered_map<std::string, sem_elem_t> weights;
+      };
+
+      bool isTrue( std::string const * v )
+      {
+        return v != NULL && (*v == "TRUE" || *v == "true");
+      }
+
+      /// Parses the XML written by WFA::marshall, as WfaHandler does
+      class XmlWfaParser : public XmlReader
+      {
+        public:
+          XmlWfaParser( Scanner & s, wfa::WFA & f, WeightFactory* wf, size_t bs )
+            : XmlReader(s), fa(f), cache(wf), block_size(bs), num_trans(0)
+            , in_state(false), in_trans(false)
+          {}
+
+          size_t numTrans() const { return num_trans; }
+
+        private:
+          wfa::WFA & fa;
+          StringCache cache;
+          size_t block_size;
+          size_t num_trans;
+
+          bool in_state;
+          bool in_trans;
+          Key from, stack, to;    //!< The state is in from
+          bool initial, final;
+          sem_elem_t se;
+
+          bool keyAttr( std::string const & attr, Key & k )
+          {
+            std::string const * v = value(attr);
+            if( v == NULL ) {
+              error("missing attribute '" + attr + "' of '" + name + "'");
+              return false;
+            }
+            k = cache.key(*v);
+            return true;
+          }
+
+          int finish()
+          {
+            if( in_state || in_trans ) {
+              return error("unterminated " + name);
+            }
+            return 0;
+          }
+
+          int startElement()
+          {
+            if( name == wfa::WFA::XMLTag ) {
+              std::string const * q = value(wfa::WFA::XMLQueryTag);
+              if( q != NULL ) {
+                // Anything but REVERSE is INORDER, as in WfaHandler
+                fa.setQuery( (*q == wfa::WFA::XMLReverseTag)
+                             ? wfa::WFA::REVERSE : wfa::WFA::INORDER );
+              }
+            }
+            else if( name == wfa::State::XMLTag && !in_state && !in_trans ) {
+              for( attrs_t::const_iterator it = attrs.begin(); it != attrs.end(); it++ ) {
+                if( it->first != wfa::State::XMLNameTag
+                    && it->first != wfa::State::XMLInitialTag
+                    && it->first != wfa::State::XMLFinalTag )
+                {
+                  return error("unrecognized attribute '" + it->first + "' of '" + name + "'");
+                }
+              }
+              if( !keyAttr(wfa::State::XMLNameTag, from) ) {
+                return 1;
+              }
+              initial = isTrue(value(wfa::State::XMLInitialTag));
+              final = isTrue(value(wfa::State::XMLFinalTag));
+              in_state = true;
+              se = NULL;
+            }
+            else if( name == wfa::ITrans::XMLTag && !in_state && !in_trans ) {
+              if( !keyAttr(wfa::ITrans::XMLFromTag, from)
+                  || !keyAttr(wfa::ITrans::XMLStackTag, stack)
+                  || !keyAttr(wfa::ITrans::XMLToTag, to) )
+              {
+                return 1;
+              }
+              in_trans = true;
+              se = NULL;
+            }
+            else if( name == SemElem::XMLTag && (in_state || in_trans) ) {
+              in_text = true;
+              chars.clear();
+            }
+            else {
+              return error("unrecognized element '" + name + "'");
+            }
+            return 0;
+          }
+
+          int endElement()
+          {
+            if( name == SemElem::XMLTag && in_text ) {
+              se = cache.weight(chars);
+              in_text = false;
+            }
+            else if( (name == wfa::State::XMLTag && in_state)
+                     || (name == wfa::ITrans::XMLTag && in_trans) )
+            {
+              if( !se.is_valid() ) {
+                return error(name + " without a weight");
+              }
+              if( in_state ) {
+                fa.addState(from, se);
+                if( initial ) {
+                  fa.setInitialState(from);
+                }
+                if( final ) {
+                  fa.addFinalState(from);
+                }
+                in_state = false;
+              }
+              else {
+                fa.addTrans(from, stack, to, se);
+                in_trans = false;
+                if( ++num_trans % block_size == 0 ) {
+                  cache.clear();
+                }
+              }
+            }
+            else if( name != wfa::WFA::XMLTag ) {
+              return error("unexpected end tag '" + name + "'");
+            }
+            return 0;
+          }
+      };
+
+      /// Parses the XML written by opennwa::Nwa::marshall
+      class XmlNwaParser : public XmlReader
+      {
+        public:
+          XmlNwaParser( Scanner & s, opennwa::Nwa & n, size_t bs )
+            : XmlReader(s), nwa(n), cache(NULL), block_size(bs), num_trans(0)
+          {}
+
+          size_t numTrans() const { return num_trans; }
+
+        private:
+          typedef opennwa::details::StateStorage StateStorage;
+          typedef opennwa::details::SymbolStorage SymbolStorage;
+          typedef opennwa::details::TransitionStorage Trans;
+
+          opennwa::Nwa & nwa;
+          StringCache cache;
+          size_t block_size;
+          size_t num_trans;
+
+          bool keyAttr( std::string const & attr, Key & k )
+          {
+            std::string const * v = value(attr);
+            if( v == NULL ) {
+              error("missing attribute '" + attr + "' of '" + name + "'");
+              return false;
+            }
+            k = cache.key(*v);
+            return true;
+          }
+
+          int finish()
+          {
+            return 0;
+          }
+
+          /// Everything but the root is an empty element, so the work is
+          /// all done here
+          int startElement()
+          {
+            Key from, pred, sym, to;
+            if( name == NwaXMLTag ) {
+              return 0;
+            }
+            else if( name == SymbolStorage::XMLSymbolTag() ) {
+              if( !keyAttr(SymbolStorage::XMLNameAttr(), sym) ) {
+                return 1;
+              }
+              nwa.addSymbol(sym);
+              return 0;
+            }
+            else if( name == StateStorage::XMLStateTag() ) {
+              if( !keyAttr(StateStorage::XMLNameAttr(), from) ) {
+                return 1;
+              }
+              nwa.addState(from);
+              if( isTrue(value(StateStorage::XMLInitialAttr())) ) {
+                nwa.addInitialState(from);
+              }
+              if( isTrue(value(StateStorage::XMLFinalAttr())) ) {
+                nwa.addFinalState(from);
+              }
+              return 0;
+            }
+            else if( name == Trans::InternalXMLTag() || name == Trans::CallXMLTag() ) {
+              if( !keyAttr(Trans::XMLFromAttr(), from)
+                  || !keyAttr(Trans::XMLSymbolAttr(), sym)
+                  || !keyAttr(Trans::XMLToAttr(), to) )
+              {
+                return 1;
+              }
+              if( name == Trans::InternalXMLTag() ) {
+                nwa.addInternalTrans(from, sym, to);
+              }
+              else {
+                nwa.addCallTrans(from, sym, to);
+              }
+            }
+            else if( name == Trans::ReturnXMLTag() ) {
+              if( !keyAttr(Trans::XMLFromAttr(), from)
+                  || !keyAttr(Trans::XMLPredAttr(), pred)
+                  || !keyAttr(Trans::XMLSymbolAttr(), sym)
+                  || !keyAttr(Trans::XMLToAttr(), to) )
+              {
+                return 1;
+              }
+              nwa.addReturnTrans(from, pred, sym, to);
+            }
+            else {
+              return error("unrecognized element '" + name + "'");
+            }
+            if( ++num_trans % block_size == 0 ) {
+              cache.clear();
+            }
+            return 0;
+          }
+
+          int endElement()
+          {
+            if( name != NwaXMLTag
+                && name != SymbolStorage::XMLSymbolTag()
+                && name != StateStorage::XMLStateTag()
+                && name != Trans::InternalXMLTag()
+                && name != Trans::CallXMLTag()
+                && name != Trans::ReturnXMLTag() )
+            {
+              return error("unexpected end tag '" + name + "'");
+            }
+            return 0;
+          }
+      };
+
+
+      void writeU32( std::ostream & out, u32 v )
+      {
+        char b[4];
+        for( int i = 0; i < 4; i++ ) {
+          b[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+        }
+        out.write(b, 4);
+      }
+
+      bool readU32( std::istream & in, u32 & v )
+      {
+        unsigned char b[4];
+        in.read(reinterpret_cast<char*>(b), 4);
+        if( in.gcount() != 4 ) {
+          return false;
+        }
+        v = b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<u32>(b[3]) << 24);
+        return true;
+      }
+
+      /// Reads len bytes into s a chunk at a time, so a corrupt length
+      /// fails at the end of the stream instead of allocating len bytes
+      /// up front
+      bool readString( std::istream & in, u32 len, std::string & s )
+      {
+        char chunk[4096];
+        s.clear();
+        while( len > 0 ) {
+          std::streamsize want = (len < sizeof(chunk)) ? len : sizeof(chunk);
+          in.read(chunk, want);
+          if( in.gcount() != want ) {
+            return false;
+          }
+          s.append(chunk, static_cast<size_t>(want));
+          len -= static_cast<u32>(want);
+        }
+        return true;
+      }
+
+      bool open( std::string const & file, std::ifstream & in )
+      {
+        in.open(file.c_str(), std::ios::in | std::ios::binary);
+        if( !in ) {
+          *waliErr << "[ERROR] FastWpdsReader - cannot open '" << file << "'.\n";
+          return false;
+        }
+        return true;
+      }
+
+      bool hasWeightFactory( WeightFactory* wf )
+      {
+        if( wf == NULL ) {
+          *waliErr << "[ERROR] FastWpdsReader - no WeightFactory given.\n";
+          return false;
+        }
+        return true;
+      }
+
+      /// Collects the string table and rule indices of a binary dump
+      class BinaryCollector : public ConstRuleFunctor
+      {
+        public:
+          std::vector<std::string> strings;
+          std::vector<u32> rules;
+
+          virtual void operator()( const rule_t & r )
+          {
+            u32 idx[7];
+            idx[0] = name(r->from_state());
+            idx[1] = name(r->from_stack());
+            idx[2] = name(r->to_state());
+            idx[3] = name(r->to_stack1());
+            idx[4] = name(r->to_stack2());
+            std::ostringstream w;
+            r->weight()->marshall(w);
+            idx[5] = intern(w.str());
+            idx[6] = NONE;
+            ewpds::ERule const * er = dynamic_cast<ewpds::ERule const *>(r.get_ptr());
+            if( er != NULL && r->to_stack2() != WALI_EPSILON ) {
+              idx[6] = intern(er->merge_fn().is_valid() ? er->merge_fn()->toString() : "NONE");
+            }
+            rules.insert(rules.end(), idx, idx + 7);
+          }
+
+        private:
+          util::unordered_map<std::string, u32> index;
+
+          u32 name( Key k )
+          {
+            return (k == WALI_EPSILON) ? NONE : intern(key2str(k));
+          }
+
+          u32 intern( std::string const & s )
+          {
+            util::unordered_map<std::string, u32>::iterator it = index.find(s);
+            if( it != index.end() ) {
+              return it->second;
+            }
+            u32 i = static_cast<u32>(strings.size());
+            index.insert(std::make_pair(s, i));
+            strings.push_back(s);
+            return i;
+          }
+      };
+    }
+
+
+    FastWpdsReader::FastWpdsReader( WeightFactory* wf, MergeFnFactory* mf, size_t bs )
+      : fWeightFactory(wf), fMergeFactory(mf), block_size(bs), num_rules(0)
+    {
+      assert(block_size > 0);
+    }
+
+    FastWpdsReader::~FastWpdsReader()
+    {
+    }
+
+    int FastWpdsReader::read( std::istream & in, WPDS & pds )
+    {
+      num_rules = 0;
+      if( !hasWeightFactory(fWeightFactory) ) {
+        return 1;
+      }
+      Scanner scan(in);
+      RuleBlock block(fWeightFactory, fMergeFactory);
+      XmlRuleParser parser(scan, block, pds, block_size, metaEntry, metaExit);
+      int rc = parser.parse();
+      num_rules = parser.numRules();
+      return rc;
+    }
+
+    int FastWpdsReader::read( const std::string & file, WPDS & pds )
+    {
+      std::ifstream in;
+      return open(file, in) ? read(in, pds) : 1;
+    }
+
+    int FastWpdsReader::read( std::istream & in, wfa::WFA & fa )
+    {
+      num_rules = 0;
+      if( !hasWeightFactory(fWeightFactory) ) {
+        return 1;
+      }
+      Scanner scan(in);
+      XmlWfaParser parser(scan, fa, fWeightFactory, block_size);
+      int rc = parser.parse();
+      num_rules = parser.numTrans();
+      return rc;
+    }
+
+    int FastWpdsReader::read( const std::string & file, wfa::WFA & fa )
+    {
+      std::ifstream in;
+      return open(file, in) ? read(in, fa) : 1;
+    }
+
+    int FastWpdsReader::read( std::istream & in, opennwa::Nwa & nwa )
+    {
+      num_rules = 0;
+      Scanner scan(in);
+      XmlNwaParser parser(scan, nwa, block_size);
+      int rc = parser.parse();
+      num_rules = parser.numTrans();
+      return rc;
+    }
+
+    int FastWpdsReader::read( const std::string & file, opennwa::Nwa & nwa )
+    {
+      std::ifstream in;
+      return open(file, in) ? read(in, nwa) : 1;
+    }
+
+    int FastWpdsReader::readBinary( std::istream & in, WPDS & pds )
+    {
+      num_rules = 0;
+      if( !hasWeightFactory(fWeightFactory) ) {
+        return 1;
+      }
+      char magic[8];
+      u32 version, n;
+      in.read(magic, 8);
+      if( in.gcount() != 8 || std::memcmp(magic, BinaryMagic, 8) != 0
+          || !readU32(in, version) || version != BinaryVersion )
+      {
+        *waliErr << "[ERROR] FastWpdsReader - not a binary WPDS dump.\n";
+        return 1;
+      }
+      if( !readU32(in, n) ) {
+        *waliErr << "[ERROR] FastWpdsReader - truncated binary WPDS dump.\n";
+        return 1;
+      }
+      // n and the lengths come from the file, so the table grows as
+      // strings are actually read rather than being sized from them
+      std::vector<std::string> strings;
+      for( u32 i = 0; i < n; i++ ) {
+        u32 len;
+        strings.push_back(std::string());
+        if( !readU32(in, len) || !readString(in, len, strings.back()) ) {
+          *waliErr << "[ERROR] FastWpdsReader - truncated binary WPDS dump.\n";
+          return 1;
+        }
+      }
+
+      // The string table is shared by all the rules, so what is built
+      // from it is kept across blocks
+      RuleBlock block(fWeightFactory, fMergeFactory);
+      block.setStrings(strings);
+      if( !readU32(in, n) ) {
+        *waliErr << "[ERROR] FastWpdsReader - truncated binary WPDS dump.\n";
+        return 1;
+      }
+      for( u32 i = 0; i < n; i++ ) {
+        u32 r[7];
+        for( int j = 0; j < 7; j++ ) {
+          if( !readU32(in, r[j]) ) {
+            *waliErr << "[ERROR] FastWpdsReader - truncated binary WPDS dump.\n";
+            return 1;
+          }
+        }
+        block.addRule(r);
+        num_rules++;
+        if( block.numRules() >= block_size ) {
+          int rc = block.flush(pds, false);
+          if( rc != 0 ) {
+            return rc;
+          }
+        }
+      }
+      return block.flush(pds, false);
+    }
+
+    std::ostream & FastWpdsReader::writeBinary( WPDS const & pds, std::ostream & out )
+    {
+      BinaryCollector collector;
+      pds.for_each(collector);
+
+      out.write(BinaryMagic, 8);
+      writeU32(out, BinaryVersion);
+      writeU32(out, static_cast<u32>(collector.strings.size()));
+      for( size_t i = 0; i < collector.strings.size(); i++ ) {
+        std::string const & s = collector.strings[i];
+        writeU32(out, static_cast<u32>(s.size()));
+        out.write(s.data(), s.size());
+      }
+      writeU32(out, static_cast<u32>(collector.rules.size() / 7));
+      for( size_t i = 0; i < collector.rules.size(); i++ ) {
+        writeU32(out, collector.rules[i]);
+      }
+      return out;
+    }
+
+  } // namespace wpds
+
+} // namespace wali
+
@@ -0,0 +1,129 @@
+#ifndef wali_wpds_FAST_WPDS_READER_GUARD
+#define wali_wpds_FAST_WPDS_READER_GUARD 1
+
+#include "wali/Common.hpp"
+
+#include <iosfwd>
+#include <map>
+#include <string>
+
+namespace opennwa
+{
+  class Nwa;
+}
+
+namespace wali
+{
+  class WeightFactory;
+  class MergeFnFactory;
+
+  namespace wfa
+  {
+    class WFA;
+  }
+
+  namespace wpds
+  {
+    class WPDS;
+
+    /**
+     * @class FastWpdsReader
+     *
+     * Loads the XML written by WPDS::marshall and EWPDS::marshall without
+     * going through Xerces: a small streaming tokenizer reads the input in
+     * fixed-size chunks and understands exactly the elements that
+     * WpdsHandler and EWpdsHandler accept (WPDS, EWPDS, DebugWPDS,
+     * Function, Rule, Weight and MergeFn), plus comments, processing
+     * instructions and the predefined and numeric character entities.
+     * DTDs, namespaces and CDATA sections are not supported.
+     *
+     * Rules are read in blocks of block_size. Within a block each
+     * distinct state or stack name is interned once, and each distinct
+     * weight (resp. merge function) string is passed to the
+     * WeightFactory (resp. MergeFnFactory) once and the result shared by
+     * the rules that use it, so factories must return weights that are
+     * safe to share, as all of WALi's own weights are.
+     *
+     * The same tokenizer reads the XML of WFA::marshall (WFA, State,
+     * Trans and Weight, as WfaHandler accepts) and of
+     * opennwa::Nwa::marshall, interning names and building weights once
+     * per distinct string in each block of block_size transitions.
+     *
+     * The reader also loads and writes a compact binary form of a WPDS
+     * (see writeBinary), with the same content as WPDS::marshall.
+     *
+     * A WeightFactory is needed to read a WPDS or a WFA, but not an NWA.
+     *
+     * Errors are reported on waliErr; the read methods then return a
+     * non-zero code, as Parser::parse does.
+     */
+    class FastWpdsReader
+    {
+      public:
+        //! A map with keys and values of type std::string
+        typedef std::map<std::string,std::string> SSMap;
+
+      public:
+        FastWpdsReader( WeightFactory* wf, MergeFnFactory* mf = NULL,
+                        size_t block_size = 4096 );
+
+        ~FastWpdsReader();
+
+        /** Adds the rules of the XML in [in] to [pds]. @return 0 on success */
+        int read( std::istream & in, WPDS & pds );
+
+        /** Adds the rules of the XML file [file] to [pds]. @return 0 on success */
+        int read( const std::string & file, WPDS & pds );
+
+        /** Adds the states and transitions of the XML in [in] to [fa]. @return 0 on success */
+        int read( std::istream & in, wfa::WFA & fa );
+
+        /** Adds the states and transitions of the XML file [file] to [fa]. @return 0 on success */
+        int read( const std::string & file, wfa::WFA & fa );
+
+        /** Adds the symbols, states and transitions of the XML in [in] to [nwa]. @return 0 on success */
+        int read( std::istream & in, opennwa::Nwa & nwa );
+
+        /** Adds the symbols, states and transitions of the XML file [file] to [nwa]. @return 0 on success */
+        int read( const std::string & file, opennwa::Nwa & nwa );
+
+        /** Adds the rules of the binary dump in [in] to [pds]. @return 0 on success */
+        int readBinary( std::istream & in, WPDS & pds );
+
+        /**
+         * Writes the rules of [pds] in the binary format read by
+         * readBinary: the magic "WALIWPDS" and a version, a table of the
+         * distinct strings (names, and weights and merge functions as
+         * they are marshalled), then seven string indices per rule. All
+         * integers are 32-bit little endian.
+         */
+        static std::ostream & writeBinary( WPDS const & pds, std::ostream & out );
+
+        /** @return the number of rules (or WFA or NWA transitions) read by the last read */
+        size_t numRules() const { return num_rules; }
+
+        /** @return the map from function name to entry node/stack symbol.*/
+        SSMap& getEntryMapping() { return metaEntry; }
+
+        /** @return the map from function name to exit node/stack symbol.*/
+        SSMap& getExitMapping() { return metaExit; }
+
+      private:
+        WeightFactory* fWeightFactory;
+        MergeFnFactory* fMergeFactory;
+        size_t block_size;
+        size_t num_rules;
+        SSMap metaEntry;
+        SSMap metaExit;
+
+        FastWpdsReader( const FastWpdsReader& );
+        FastWpdsReader& operator=( const FastWpdsReader& );
+
+    }; // class FastWpdsReader
+
+  } // namespace wpds
+
+} // namespace wali
+
+#endif  // wali_wpds_FAST_WPDS_READER_GUARD
+
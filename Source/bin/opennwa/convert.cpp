@@ -0,0 +1,67 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/NwaParser.hpp"
+#include "opennwa/NwaBinary.hpp"
+
+using std::string;
+using std::ofstream;
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::exit;
+
+using opennwa::NwaRefPtr;
+using opennwa::read_nwa_file;
+using opennwa::write_nwa_binary;
+
+int main(int argc, char** argv)
+{
+    if (argc != 5
+        || (argv[1] != string("--binary") && argv[1] != string("--text"))
+        || argv[2] != string("-o"))
+    {
+        cerr << "Syntax: " << argv[0] << " (--binary | --text) -o outfilename nwafilename\n"
+             << "  The input may be in either format.\n";
+        exit(1);
+    }
+
+    bool binary = (argv[1] == string("--binary"));
+
+    NwaRefPtr nwa;
+    string name;
+    try {
+        nwa = read_nwa_file(argv[4], &name);
+    }
+    catch (opennwa::BinaryNwaFormatException const & e) {
+        cerr << "Error reading input file " << argv[4] << ": " << e.what() << "\n";
+        exit(2);
+    }
+
+    ofstream outfile(argv[3], binary ? (std::ios::out | std::ios::binary) : std::ios::out);
+    if (!outfile.good()) {
+        cerr << "Error opening output file " << argv[3] << "\n";
+        exit(3);
+    }
+
+    if (binary) {
+        write_nwa_binary(outfile, *nwa, name);
+    }
+    else {
+        if (name != "") {
+            outfile << "nwa " << name << " :\n";
+        }
+        nwa->print(outfile);
+    }
+}
+
+
+// Yo emacs!
+// Local Variables:
+//     c-basic-offset: 4
+//     indent-tabs-mode: nil
+// End:
@@ -0,0 +1,441 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include "opennwa/NwaBinary.hpp"
+#include "opennwa/Nwa.hpp"
+#include "opennwa/NwaParser.hpp"
+#include "wali/util/unordered_map.hpp"
+
+namespace opennwa {
+
+  namespace {
+
+    typedef BinaryNwaImage::Index Index;
+
+    char const magicNumber[8] = { 'O', 'p', 'e', 'n', 'N', 'W', 'A', 'b' };
+    Index const byteOrderMark = 0x01020304u;
+
+    size_t
+    padTo4(size_t bytes)
+    {
+      return (bytes + 3) & ~static_cast<size_t>(3);
+    }
+
+    void
+    fail(std::string const & why)
+    {
+      throw BinaryNwaFormatException("Invalid binary NWA: " + why);
+    }
+
+    void
+    writeIndices(std::ostream & os, std::vector<Index> const & v)
+    {
+      if (!v.empty()) {
+        os.write(reinterpret_cast<char const *>(&v[0]),
+                 static_cast<std::streamsize>(v.size() * sizeof(Index)));
+      }
+    }
+
+  }
+
+
+  const BinaryNwaImage::Index BinaryNwaImage::epsilonSymbol;
+  const BinaryNwaImage::Index BinaryNwaImage::wildSymbol;
+  const BinaryNwaImage::Index BinaryNwaImage::version;
+
+
+  BinaryNwaImage::BinaryNwaImage(std::string const & filename)
+    : m_data(NULL)
+    , m_size(0)
+    , m_mappedSize(0)
+  {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      fail("cannot open " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      fail("cannot stat " + filename);
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size > 0) {
+      void * p = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED) {
+        fail("cannot map " + filename);
+      }
+      m_data = static_cast<char const *>(p);
+      m_mappedSize = m_size;
+    }
+    else {
+      close(fd);
+    }
+#else
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.good()) {
+      fail("cannot open " + filename);
+    }
+    in.seekg(0, std::ios::end);
+    m_size = static_cast<size_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+    m_buffer.resize(padTo4(m_size) / sizeof(Index) + 1);
+    in.read(reinterpret_cast<char *>(&m_buffer[0]), static_cast<std::streamsize>(m_size));
+    m_data = reinterpret_cast<char const *>(&m_buffer[0]);
+#endif
+
+    try {
+      load();
+    }
+    catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+
+  BinaryNwaImage::BinaryNwaImage(char const * data, size_t size)
+    : m_data(data)
+    , m_size(size)
+    , m_mappedSize(0)
+  {
+    load();
+  }
+
+
+  BinaryNwaImage::~BinaryNwaImage()
+  {
+    unmap();
+  }
+
+
+  void
+  BinaryNwaImage::unmap()
+  {
+#ifndef _WIN32
+    if (m_mappedSize > 0) {
+      munmap(const_cast<char *>(m_data), m_mappedSize);
+      m_mappedSize = 0;
+    }
+#endif
+  }
+
+
+  bool
+  BinaryNwaImage::isBinaryNwa(char const * data, size_t size)
+  {
+    return size >= sizeof(magicNumber)
+      && std::memcmp(data, magicNumber, sizeof(magicNumber)) == 0;
+  }
+
+
+  void
+  BinaryNwaImage::load()
+  {
+    if (m_size < sizeof(Header) || !isBinaryNwa(m_data, m_size)) {
+      fail("missing header");
+    }
+    if (reinterpret_cast<size_t>(m_data) % sizeof(Index) != 0) {
+      fail("buffer is not aligned");
+    }
+
+    m_header = reinterpret_cast<Header const *>(m_data);
+    if (m_header->byteOrder != byteOrderMark) {
+      fail("written on a machine with a different byte order");
+    }
+    if (m_header->formatVersion != version) {
+      std::stringstream ss;
+      ss << "unsupported format version " << m_header->formatVersion;
+      fail(ss.str());
+    }
+
+    Header const & h = *m_header;
+    if (static_cast<size_t>(h.numStates) + h.numSymbols + (h.hasName ? 1 : 0) != h.numStrings) {
+      fail("string count does not match state and symbol counts");
+    }
+
+    // Compute where each section lives, in 64-bit arithmetic so that bogus
+    // counts cannot wrap around.
+    boost::uint64_t pos = sizeof(Header);
+    boost::uint64_t offsetsPos = pos;
+    pos += (static_cast<boost::uint64_t>(h.numStrings) + 1) * sizeof(Index);
+    boost::uint64_t blobPos = pos;
+    pos += padTo4(h.stringBytes);
+    boost::uint64_t initialsPos = pos;
+    pos += static_cast<boost::uint64_t>(h.numInitials) * sizeof(Index);
+    boost::uint64_t finalsPos = pos;
+    pos += static_cast<boost::uint64_t>(h.numFinals) * sizeof(Index);
+    boost::uint64_t internalsPos = pos;
+    pos += static_cast<boost::uint64_t>(h.numInternals) * 3 * sizeof(Index);
+    boost::uint64_t callsPos = pos;
+    pos += static_cast<boost::uint64_t>(h.numCalls) * 3 * sizeof(Index);
+    boost::uint64_t returnsPos = pos;
+    pos += static_cast<boost::uint64_t>(h.numReturns) * 4 * sizeof(Index);
+
+    if (pos > m_size) {
+      fail("file is truncated");
+    }
+
+    m_offsets = reinterpret_cast<Index const *>(m_data + offsetsPos);
+    m_blob = m_data + blobPos;
+    m_initials = reinterpret_cast<Index const *>(m_data + initialsPos);
+    m_finals = reinterpret_cast<Index const *>(m_data + finalsPos);
+    m_internals = reinterpret_cast<Index const *>(m_data + internalsPos);
+    m_calls = reinterpret_cast<Index const *>(m_data + callsPos);
+    m_returns = reinterpret_cast<Index const *>(m_data + returnsPos);
+
+    for (Index i = 0; i < h.numStrings; ++i) {
+      if (m_offsets[i] > m_offsets[i+1]) {
+        fail("string offsets are not increasing");
+      }
+    }
+    if (m_offsets[h.numStrings] > h.stringBytes) {
+      fail("string offsets run past the string blob");
+    }
+
+    for (Index i = 0; i < h.numInitials; ++i) {
+      if (m_initials[i] >= h.numStates) fail("out-of-range initial state");
+    }
+    for (Index i = 0; i < h.numFinals; ++i) {
+      if (m_finals[i] >= h.numStates) fail("out-of-range final state");
+    }
+
+    for (Index i = 0; i < h.numInternals; ++i) {
+      Index const * t = m_internals + 3*i;
+      if (t[0] >= h.numStates || t[2] >= h.numStates
+          || (t[1] >= h.numSymbols && t[1] != epsilonSymbol && t[1] != wildSymbol))
+      {
+        fail("out-of-range index in internal transition");
+      }
+    }
+    for (Index i = 0; i < h.numCalls; ++i) {
+      Index const * t = m_calls + 3*i;
+      if (t[0] >= h.numStates || t[2] >= h.numStates
+          || (t[1] >= h.numSymbols && t[1] != wildSymbol))
+      {
+        fail("out-of-range index in call transition");
+      }
+    }
+    for (Index i = 0; i < h.numReturns; ++i) {
+      Index const * t = m_returns + 4*i;
+      if (t[0] >= h.numStates || t[1] >= h.numStates || t[3] >= h.numStates
+          || (t[2] >= h.numSymbols && t[2] != wildSymbol))
+      {
+        fail("out-of-range index in return transition");
+      }
+    }
+  }
+
+
+  std::string
+  BinaryNwaImage::string(Index i) const
+  {
+    return std::string(m_blob + m_offsets[i], m_blob + m_offsets[i+1]);
+  }
+
+
+  std::string
+  BinaryNwaImage::name() const
+  {
+    if (m_header->hasName) {
+      return string(m_header->numStrings - 1);
+    }
+    return std::string();
+  }
+
+
+  NwaRefPtr
+  BinaryNwaImage::toNwa() const
+  {
+    NwaRefPtr nwa = new Nwa();
+
+    std::vector<State> states(numStates());
+    for (Index i = 0; i < numStates(); ++i) {
+      states[i] = wali::getKey(stateName(i));
+      nwa->addState(states[i]);
+    }
+
+    std::vector<Symbol> symbols(numSymbols());
+    for (Index i = 0; i < numSymbols(); ++i) {
+      symbols[i] = wali::getKey(symbolName(i));
+      nwa->addSymbol(symbols[i]);
+    }
+
+    for (Index i = 0; i < numInitialStates(); ++i) {
+      nwa->addInitialState(states[m_initials[i]]);
+    }
+    for (Index i = 0; i < numFinalStates(); ++i) {
+      nwa->addFinalState(states[m_finals[i]]);
+    }
+
+    for (Index i = 0; i < numInternals(); ++i) {
+      Index const * t = m_internals + 3*i;
+      Symbol sym = (t[1] == epsilonSymbol ? EPSILON
+                    : t[1] == wildSymbol ? WILD
+                    : symbols[t[1]]);
+      nwa->addInternalTrans(states[t[0]], sym, states[t[2]]);
+    }
+    for (Index i = 0; i < numCalls(); ++i) {
+      Index const * t = m_calls + 3*i;
+      Symbol sym = (t[1] == wildSymbol ? WILD : symbols[t[1]]);
+      nwa->addCallTrans(states[t[0]], sym, states[t[2]]);
+    }
+    for (Index i = 0; i < numReturns(); ++i) {
+      Index const * t = m_returns + 4*i;
+      Symbol sym = (t[2] == wildSymbol ? WILD : symbols[t[2]]);
+      nwa->addReturnTrans(states[t[0]], states[t[1]], sym, states[t[3]]);
+    }
+
+    return nwa;
+  }
+
+
+  void
+  write_nwa_binary(std::ostream & os, Nwa const & nwa, std::string const & name)
+  {
+    typedef BinaryNwaImage::Header Header;
+
+    wali::util::unordered_map<State, Index> stateIndex;
+    wali::util::unordered_map<Symbol, Index> symbolIndex;
+
+    std::vector<Index> offsets;
+    std::string blob;
+
+    offsets.push_back(0);
+    for (Nwa::StateIterator it = nwa.beginStates(); it != nwa.endStates(); ++it) {
+      Index i = static_cast<Index>(stateIndex.size());
+      stateIndex[*it] = i;
+      blob += wali::key2str(*it);
+      offsets.push_back(static_cast<Index>(blob.size()));
+    }
+    for (Nwa::SymbolIterator it = nwa.beginSymbols(); it != nwa.endSymbols(); ++it) {
+      Index i = static_cast<Index>(symbolIndex.size());
+      symbolIndex[*it] = i;
+      blob += wali::key2str(*it);
+      offsets.push_back(static_cast<Index>(blob.size()));
+    }
+    symbolIndex[EPSILON] = BinaryNwaImage::epsilonSymbol;
+    symbolIndex[WILD] = BinaryNwaImage::wildSymbol;
+    if (!name.empty()) {
+      blob += name;
+      offsets.push_back(static_cast<Index>(blob.size()));
+    }
+
+    std::vector<Index> initials, finals, internals, calls, returns;
+    for (Nwa::StateIterator it = nwa.beginInitialStates(); it != nwa.endInitialStates(); ++it) {
+      initials.push_back(stateIndex[*it]);
+    }
+    for (Nwa::StateIterator it = nwa.beginFinalStates(); it != nwa.endFinalStates(); ++it) {
+      finals.push_back(stateIndex[*it]);
+    }
+    for (Nwa::InternalIterator it = nwa.beginInternalTrans(); it != nwa.endInternalTrans(); ++it) {
+      internals.push_back(stateIndex[it->first]);
+      internals.push_back(symbolIndex[it->second]);
+      internals.push_back(stateIndex[it->third]);
+    }
+    for (Nwa::CallIterator it = nwa.beginCallTrans(); it != nwa.endCallTrans(); ++it) {
+      calls.push_back(stateIndex[it->first]);
+      calls.push_back(symbolIndex[it->second]);
+      calls.push_back(stateIndex[it->third]);
+    }
+    for (Nwa::ReturnIterator it = nwa.beginReturnTrans(); it != nwa.endReturnTrans(); ++it) {
+      returns.push_back(stateIndex[it->first]);
+      returns.push_back(stateIndex[it->second]);
+      returns.push_back(symbolIndex[it->third]);
+      returns.push_back(stateIndex[it->fourth]);
+    }
+
+    Header h;
+    std::memcpy(h.magic, magicNumber, sizeof(magicNumber));
+    h.byteOrder = byteOrderMark;
+    h.formatVersion = BinaryNwaImage::version;
+    h.numStrings = static_cast<Index>(offsets.size() - 1);
+    h.stringBytes = static_cast<Index>(blob.size());
+    h.numStates = static_cast<Index>(nwa.sizeStates());
+    h.numSymbols = static_cast<Index>(nwa.sizeSymbols());
+    h.numInitials = static_cast<Index>(initials.size());
+    h.numFinals = static_cast<Index>(finals.size());
+    h.numInternals = static_cast<Index>(internals.size() / 3);
+    h.numCalls = static_cast<Index>(calls.size() / 3);
+    h.numReturns = static_cast<Index>(returns.size() / 4);
+    h.hasName = name.empty() ? 0 : 1;
+
+    os.write(reinterpret_cast<char const *>(&h), sizeof(h));
+    writeIndices(os, offsets);
+    blob.resize(padTo4(blob.size()), '\0');
+    os.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    writeIndices(os, initials);
+    writeIndices(os, finals);
+    writeIndices(os, internals);
+    writeIndices(os, calls);
+    writeIndices(os, returns);
+  }
+
+
+  NwaRefPtr
+  read_nwa_binary(std::istream & is, std::string * name)
+  {
+    // Read into Index-sized storage so that the image is aligned
+    std::vector<Index> buffer;
+    size_t size = 0;
+    while (is.good()) {
+      buffer.resize(buffer.size() + 16384);
+      is.read(reinterpret_cast<char *>(&buffer[0]) + size,
+              static_cast<std::streamsize>(buffer.size() * sizeof(Index) - size));
+      size += static_cast<size_t>(is.gcount());
+    }
+    if (buffer.empty()) {
+      fail("empty stream");
+    }
+
+    BinaryNwaImage image(reinterpret_cast<char const *>(&buffer[0]), size);
+    if (name) {
+      *name = image.name();
+    }
+    return image.toNwa();
+  }
+
+
+  NwaRefPtr
+  read_nwa_file(std::string const & filename, std::string * name)
+  {
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.good()) {
+      throw BinaryNwaFormatException("Cannot open " + filename);
+    }
+
+    char magic[sizeof(magicNumber)];
+    in.read(magic, sizeof(magic));
+    if (BinaryNwaImage::isBinaryNwa(magic, static_cast<size_t>(in.gcount()))) {
+      in.close();
+      BinaryNwaImage image(filename);
+      if (name) {
+        *name = image.name();
+      }
+      return image.toNwa();
+    }
+
+    in.clear();
+    in.seekg(0, std::ios::beg);
+    return read_nwa(in, name);
+  }
+
+}
+
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
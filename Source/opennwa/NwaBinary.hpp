@@ -0,0 +1,177 @@
+#ifndef NWA_BINARY_HPP
+#define NWA_BINARY_HPP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <boost/cstdint.hpp>
+
+#include "opennwa/NwaFwd.hpp"
+
+// The binary NWA format
+//
+// All fields are 32-bit unsigned integers in the byte order of the machine
+// that wrote the file (recorded in the header; a reader on a machine of the
+// other byte order rejects the file). Every section starts on a 4-byte
+// boundary, so a file mapped at a page boundary can be used in place.
+//
+//   header        magic "OpenNWAb", byte-order mark, version, and counts
+//   offsets       numStrings+1 offsets into the string blob
+//   blob          string bytes, padded to a multiple of 4
+//   initials      numInitials state indices
+//   finals        numFinals state indices
+//   internals     numInternals (source, symbol, target) triples
+//   calls         numCalls (call site, symbol, entry) triples
+//   returns       numReturns (exit, call predecessor, symbol, return site)
+//
+// States are numbered 0..numStates-1 and their names are strings
+// 0..numStates-1. Symbols are numbered 0..numSymbols-1 and their names are
+// the following numSymbols strings. In transitions, the symbol indices
+// 'epsilonSymbol' and 'wildSymbol' stand for EPSILON and WILD. The name of
+// the NWA, if any, is the last string.
+//
+// Names are the same strings the text format uses (wali::key2str), so a
+// round trip through either format produces the same keys.
+
+namespace opennwa {
+
+  /// Raised when a buffer does not hold a valid binary NWA.
+  struct BinaryNwaFormatException : std::exception
+  {
+    std::string message;
+
+    explicit BinaryNwaFormatException(std::string const & m) : message(m) {}
+    virtual ~BinaryNwaFormatException() throw() {}
+
+    virtual const char * what() const throw() { return message.c_str(); }
+  };
+
+
+  /// @brief A read-only, zero-copy view of a binary NWA.
+  ///
+  /// The view either maps a file into memory or wraps a caller-provided
+  /// buffer; in neither case is the data copied. The accessors return
+  /// pointers directly into the mapped data, so tools that only need the
+  /// dense arrays never touch the global KeySpace. toNwa() interns each
+  /// name once and builds a regular Nwa.
+  class BinaryNwaImage
+  {
+  public:
+    typedef boost::uint32_t Index;
+
+    static const Index epsilonSymbol = 0xFFFFFFFEu;
+    static const Index wildSymbol = 0xFFFFFFFDu;
+    static const Index version = 1;
+
+    /// Maps the file 'filename' (or, where mapping is not available,
+    /// reads it into memory).
+    explicit BinaryNwaImage(std::string const & filename);
+
+    /// Views 'size' bytes at 'data', which must stay alive and unchanged
+    /// as long as this object does and must be 4-byte aligned.
+    BinaryNwaImage(char const * data, size_t size);
+
+    ~BinaryNwaImage();
+
+    /// Returns whether 'data' starts with the binary NWA magic number
+    static bool isBinaryNwa(char const * data, size_t size);
+
+    Index numStates() const { return m_header->numStates; }
+    Index numSymbols() const { return m_header->numSymbols; }
+    Index numInitialStates() const { return m_header->numInitials; }
+    Index numFinalStates() const { return m_header->numFinals; }
+    Index numInternals() const { return m_header->numInternals; }
+    Index numCalls() const { return m_header->numCalls; }
+    Index numReturns() const { return m_header->numReturns; }
+
+    std::string stateName(Index state) const { return string(state); }
+    std::string symbolName(Index symbol) const { return string(numStates() + symbol); }
+
+    /// Returns the name the NWA was written with ("" if none)
+    std::string name() const;
+
+    Index const * initialStates() const { return m_initials; }
+    Index const * finalStates() const { return m_finals; }
+
+    /// 3*numInternals() entries: (source, symbol, target) for each
+    Index const * internals() const { return m_internals; }
+    /// 3*numCalls() entries: (call site, symbol, entry) for each
+    Index const * calls() const { return m_calls; }
+    /// 4*numReturns() entries: (exit, call predecessor, symbol, return
+    /// site) for each
+    Index const * returns() const { return m_returns; }
+
+    /// Builds an Nwa with the contents of this image. Each state and symbol
+    /// name is turned into a Key exactly once.
+    NwaRefPtr toNwa() const;
+
+  private:
+    struct Header
+    {
+      char magic[8];
+      Index byteOrder;
+      Index formatVersion;
+      Index numStrings;
+      Index stringBytes;
+      Index numStates;
+      Index numSymbols;
+      Index numInitials;
+      Index numFinals;
+      Index numInternals;
+      Index numCalls;
+      Index numReturns;
+      Index hasName;
+    };
+
+    friend void write_nwa_binary(std::ostream &, Nwa const &, std::string const &);
+
+    std::string string(Index i) const;
+    void load();
+    void unmap();
+
+    // Not copyable
+    BinaryNwaImage(BinaryNwaImage const &);
+    BinaryNwaImage & operator= (BinaryNwaImage const &);
+
+    char const * m_data;
+    size_t m_size;
+    size_t m_mappedSize;
+    std::vector<Index> m_buffer;
+
+    Header const * m_header;
+    Index const * m_offsets;
+    char const * m_blob;
+    Index const * m_initials;
+    Index const * m_finals;
+    Index const * m_internals;
+    Index const * m_calls;
+    Index const * m_returns;
+  };
+
+
+  /// Writes 'nwa' to 'os' in the binary format, recording 'name' as its
+  /// name if it is nonempty. 'os' should be opened in binary mode.
+  extern void write_nwa_binary(std::ostream & os, Nwa const & nwa,
+                               std::string const & name = std::string());
+
+  /// Reads a single binary NWA from the rest of 'is'. If 'name' is nonnull,
+  /// stores the NWA's name (or "") at the location pointed to by 'name'.
+  extern NwaRefPtr read_nwa_binary(std::istream & is, std::string * name = NULL);
+
+  /// Reads the NWA in 'filename', which may be in either the binary or the
+  /// text format (the binary format is recognized by its magic number and
+  /// is memory-mapped). Stores its name at 'name' if that is nonnull.
+  extern NwaRefPtr read_nwa_file(std::string const & filename, std::string * name = NULL);
+
+}
+
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif
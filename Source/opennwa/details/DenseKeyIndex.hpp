@@ -0,0 +1,118 @@
+#ifndef wali_nwa_DenseKeyIndex_GUARD
+#define wali_nwa_DenseKeyIndex_GUARD 1
+
+#include "wali/Key.hpp"
+#include "wali/util/unordered_map.hpp"
+
+#include <vector>
+#include <cassert>
+
+namespace opennwa
+{
+  namespace details
+  {
+
+    /**
+     *
+     *  Renumbers the wali::Keys held by a single storage object to
+     *  0..size()-1, so that per-key data can live in vectors indexed by the
+     *  dense number instead of in trees keyed on the (global, sparse) Key.
+     *
+     *  Numbers are stable while keys are only added. Removing a key gives
+     *  its number to the key that had the largest number, so that the
+     *  numbers stay contiguous; erase() reports the move so that owners
+     *  can move their parallel data the same way.
+     *
+     */
+    class DenseKeyIndex
+    {
+    public:
+      typedef size_t Index;
+
+      static Index npos() { return static_cast<Index>(-1); }
+
+      DenseKeyIndex() {}
+
+      /// Returns the number of 'key', or npos() if it is not present
+      Index find( wali::Key key ) const
+      {
+        Map::const_iterator it = index.find(key);
+        return it == index.end() ? npos() : it->second;
+      }
+
+      bool contains( wali::Key key ) const
+      {
+        return index.find(key) != index.end();
+      }
+
+      /// Adds 'key' if it is not present. Returns its number, and sets
+      /// '*added' to whether it was new.
+      Index insert( wali::Key key, bool * added )
+      {
+        std::pair<Map::iterator, bool> res = index.insert(std::make_pair(key, keys.size()));
+        *added = res.second;
+        if (res.second) {
+          keys.push_back(key);
+        }
+        return res.first->second;
+      }
+
+      /// Removes 'key', returning false if it was not present. Otherwise,
+      /// '*removed' gets the number 'key' had and '*moved' the number of
+      /// the key that now has number '*removed' (equal to '*removed' when
+      /// 'key' had the largest number, in which case nothing moved).
+      bool erase( wali::Key key, Index * removed, Index * moved )
+      {
+        Map::iterator it = index.find(key);
+        if (it == index.end()) {
+          return false;
+        }
+
+        *removed = it->second;
+        *moved = keys.size() - 1;
+        index.erase(it);
+
+        if (*moved != *removed) {
+          wali::Key last = keys[*moved];
+          keys[*removed] = last;
+          index[last] = *removed;
+        }
+        keys.pop_back();
+        return true;
+      }
+
+      /// Returns the key with number 'i'
+      wali::Key keyAt( Index i ) const
+      {
+        assert(i < keys.size());
+        return keys[i];
+      }
+
+      size_t size() const
+      {
+        return keys.size();
+      }
+
+      void clear()
+      {
+        index.clear();
+        keys.clear();
+      }
+
+    private:
+      typedef wali::util::unordered_map<wali::Key, Index> Map;
+
+      Map index;
+      std::vector<wali::Key> keys;
+    };
+
+  }
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif
@@ -26,13 +26,15 @@ namespace opennwa
       , states(other.states)
       , initialStates(other.initialStates)
       , finalStates(other.finalStates)
+      , stateIndex(other.stateIndex)
+      , initialFlags(other.initialFlags)
+      , finalFlags(other.finalFlags)
+      , stateInfos(other.stateInfos.size())
     {
-      for (std::map<State,ClientInfoRefPtr>::const_iterator other_cis = other.stateInfos.begin() ;
-           other_cis != other.stateInfos.end(); ++other_cis)
-      {
-        ClientInfoRefPtr ci = other_cis->second;
+      for (size_t i = 0; i < other.stateInfos.size(); ++i) {
+        ClientInfoRefPtr ci = other.stateInfos[i];
         if (ci.is_valid()) {
-          stateInfos[other_cis->first] = ci->cloneRp();
+          stateInfos[i] = ci->cloneRp();
         }
       }
     }
@@ -49,11 +51,16 @@ namespace opennwa
       initialStates = other.initialStates;
       finalStates = other.finalStates;
 
-      stateInfos.clear();
-      for (std::map<State,ClientInfoRefPtr>::const_iterator other_cis = other.stateInfos.begin() ;
-           other_cis != other.stateInfos.end(); ++other_cis)
-      {
-        stateInfos[other_cis->first] = other_cis->second->cloneRp();
+      stateIndex = other.stateIndex;
+      initialFlags = other.initialFlags;
+      finalFlags = other.finalFlags;
+
+      stateInfos.assign(other.stateInfos.size(), ClientInfoRefPtr());
+      for (size_t i = 0; i < other.stateInfos.size(); ++i) {
+        ClientInfoRefPtr ci = other.stateInfos[i];
+        if (ci.is_valid()) {
+          stateInfos[i] = ci->cloneRp();
+        }
       }
 
       return *this;
@@ -73,12 +80,11 @@ namespace opennwa
     StateStorage::ClientInfoRefPtr
     StateStorage::getClientInfo( State state ) const 
     {
-      typedef std::map<State, ClientInfoRefPtr> Map;
-      Map::const_iterator it = (stateInfos.find(state));
-      if( it == stateInfos.end() )
+      size_t i = stateIndex.find(state);
+      if( i == DenseKeyIndex::npos() )
         return NULL;
       else
-        return it->second;   
+        return stateInfos[i];
     }
 
     /**
@@ -92,13 +98,10 @@ namespace opennwa
     
     void StateStorage::setClientInfo( State state, const ClientInfoRefPtr c )
     {
-      //Check to make sure this is a valid state.
-      if(! isState(state) )
-      {
-        addState(state);
-      }
+      //Make sure this is a valid state.
+      addState(state);
       //Update the state's info.
-      stateInfos[state] = c;
+      stateInfos[stateIndex.find(state)] = c;
     }
 
     //State Accessors
@@ -115,6 +118,9 @@ namespace opennwa
       clearInitialStates();
       clearFinalStates();
 
+      stateIndex.clear();
+      initialFlags.clear();
+      finalFlags.clear();
       stateInfos.clear();
     }    
     
@@ -127,6 +133,7 @@ namespace opennwa
     void StateStorage::clearInitialStates( )
     { 
       initialStates.clear();
+      initialFlags.assign(initialFlags.size(), false);
     }    
     
     /**
@@ -138,6 +145,7 @@ namespace opennwa
     void StateStorage::clearFinalStates( )
     {
       finalStates.clear();
+      finalFlags.assign(finalFlags.size(), false);
     }
     
     /**
@@ -151,7 +159,7 @@ namespace opennwa
     
     bool StateStorage::isState( State state ) const
     {
-      return (states.count(state) > 0);
+      return stateIndex.contains(state);
     } 
      
     /**
@@ -165,7 +173,8 @@ namespace opennwa
     
     bool StateStorage::isInitialState( State initialState ) const
     {
-      return (initialStates.count(initialState) > 0);
+      size_t i = stateIndex.find(initialState);
+      return i != DenseKeyIndex::npos() && initialFlags[i];
     }
        
     /**
@@ -179,7 +188,8 @@ namespace opennwa
     
     bool StateStorage::isFinalState( State finalState ) const
     {
-      return (finalStates.count(finalState) > 0);
+      size_t i = stateIndex.find(finalState);
+      return i != DenseKeyIndex::npos() && finalFlags[i];
     }
     
     /**
@@ -193,8 +203,15 @@ namespace opennwa
     
     bool StateStorage::addState( State state )
     {
-      // If the ClientInfo is requested for the state, it will be null
-      bool inserted = states.insert(state).second;
+      bool inserted;
+      stateIndex.insert(state, &inserted);
+      if (inserted) {
+        states.insert(state);
+        initialFlags.push_back(false);
+        finalFlags.push_back(false);
+        // If the ClientInfo is requested for the state, it will be null
+        stateInfos.push_back(NULL);
+      }
       return inserted;
     }    
     
@@ -209,13 +226,16 @@ namespace opennwa
     
     bool StateStorage::addInitialState( State initialState )
     {
-      bool inserted = initialStates.insert(initialState).second;
-      if (inserted) {
-        // It wasn't a initial state, so we might not have seen it
-        addState(initialState);
+      // It might not have been a state before
+      addState(initialState);
+
+      std::vector<bool>::reference flag = initialFlags[stateIndex.find(initialState)];
+      if (flag) {
+        return false;
       }
-      
-      return inserted;
+      flag = true;
+      initialStates.insert(initialState);
+      return true;
     }    
     
     /**
@@ -229,13 +249,16 @@ namespace opennwa
     
     bool StateStorage::addFinalState( State finalState )
     {
-      bool inserted = finalStates.insert(finalState).second;
-      if (inserted) {
-        // It wasn't a final state, so we might not have seen it
-        addState(finalState);
+      // It might not have been a state before
+      addState(finalState);
+
+      std::vector<bool>::reference flag = finalFlags[stateIndex.find(finalState)];
+      if (flag) {
+        return false;
       }
-      
-      return inserted;
+      flag = true;
+      finalStates.insert(finalState);
+      return true;
     }
       
     /**
@@ -321,16 +344,25 @@ namespace opennwa
     
     bool StateStorage::removeState( State state )
     {
-      size_t erased = states.erase(state);
-      stateInfos.erase(state);
-      if (erased == 0) {
+      if (!isState(state)) {
         return false;
       }
-      else {
-        removeInitialState(state);
-        removeFinalState(state);
-        return true;
-      }
+
+      removeInitialState(state);
+      removeFinalState(state);
+      states.erase(state);
+
+      // The state with the last dense number takes over the freed one;
+      // move its per-state data along with it.
+      size_t removed = 0, moved = 0;
+      stateIndex.erase(state, &removed, &moved);
+      initialFlags[removed] = initialFlags[moved];
+      finalFlags[removed] = finalFlags[moved];
+      stateInfos[removed] = stateInfos[moved];
+      initialFlags.pop_back();
+      finalFlags.pop_back();
+      stateInfos.pop_back();
+      return true;
     }   
      
     /**
@@ -344,8 +376,13 @@ namespace opennwa
     
     bool StateStorage::removeInitialState( State initialState )
     {
-      size_t erased = initialStates.erase(initialState);
-      return erased > 0;
+      size_t i = stateIndex.find(initialState);
+      if (i == DenseKeyIndex::npos() || !initialFlags[i]) {
+        return false;
+      }
+      initialFlags[i] = false;
+      initialStates.erase(initialState);
+      return true;
     }    
     
     /**
@@ -359,8 +396,13 @@ namespace opennwa
     
     bool StateStorage::removeFinalState( State finalState )
     {
-      size_t erased = finalStates.erase(finalState);
-      return erased > 0;
+      size_t i = stateIndex.find(finalState);
+      if (i == DenseKeyIndex::npos() || !finalFlags[i]) {
+        return false;
+      }
+      finalFlags[i] = false;
+      finalStates.erase(finalState);
+      return true;
     }
       
     //Utilities	
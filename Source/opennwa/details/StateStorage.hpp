@@ -13,11 +13,12 @@
 #include "wali/KeyContainer.hpp"
 #include "wali/ref_ptr.hpp"
 #include "opennwa/ClientInfo.hpp"
+#include "opennwa/details/DenseKeyIndex.hpp"
 
 // std::c++
 #include <iostream>
 #include <set>
-#include <map>
+#include <vector>
 
 namespace opennwa
 {
@@ -27,6 +28,12 @@ namespace opennwa
     /**
      *
      *  This class is used to keep track of the states of an NWA.
+     *
+     *  Besides the ordered sets that back iteration, each state gets a
+     *  dense number (see DenseKeyIndex); the initial/final flags and the
+     *  client information are kept in vectors indexed by that number, so
+     *  membership tests and client info lookups are a hash probe rather
+     *  than a tree walk.
      *  
      */
     
@@ -492,6 +499,29 @@ namespace opennwa
        */
       void dupState( State orig, State dup );
 
+      /**
+       *
+       * @brief returns the dense number of 'state' (in 0..sizeStates()-1),
+       *        or DenseKeyIndex::npos() if it is not a state
+       *
+       * Numbers are stable as long as no state is removed.
+       *
+       */
+      size_t denseIndex( State state ) const
+      {
+        return stateIndex.find(state);
+      }
+
+      /**
+       *
+       * @brief returns the state with dense number 'index'
+       *
+       */
+      State denseState( size_t index ) const
+      {
+        return stateIndex.keyAt(index);
+      }
+
       //
       // Variables
       //
@@ -502,7 +532,11 @@ namespace opennwa
       StateSet initialStates;  
       StateSet finalStates;   
 
-      std::map<State,ClientInfoRefPtr> stateInfos;
+      // Parallel to 'stateIndex'
+      DenseKeyIndex stateIndex;
+      std::vector<bool> initialFlags;
+      std::vector<bool> finalFlags;
+      std::vector<ClientInfoRefPtr> stateInfos;
     };
 
 
@@ -18,6 +18,7 @@ namespace opennwa {
     SymbolStorage::SymbolStorage( const SymbolStorage & other )
       : Printable(other)
       , symbols(other.symbols)
+      , symbolIndex(other.symbolIndex)
     { }
 
     SymbolStorage & SymbolStorage::operator=( const SymbolStorage & other )
@@ -26,6 +27,7 @@ namespace opennwa {
         return *this;
   
       symbols = other.symbols;
+      symbolIndex = other.symbolIndex;
 
       return *this;
     }
@@ -46,7 +48,11 @@ namespace opennwa {
         return false;
       }
 
-      bool inserted = symbols.insert(sym).second;
+      bool inserted;
+      symbolIndex.insert(sym, &inserted);
+      if (inserted) {
+        symbols.insert(sym);
+      }
       return inserted;
     }
 
@@ -59,7 +65,11 @@ namespace opennwa {
      */
     void SymbolStorage::addAllSymbols( SymbolStorage symSet )
     {
-      symbols.insert(symSet.symbols.begin(),symSet.symbols.end());
+      for( const_iterator it = symSet.beginSymbols();
+           it != symSet.endSymbols(); it++ )
+      {
+        addSymbol(*it);
+      }
     }
 
     /** 
@@ -72,8 +82,12 @@ namespace opennwa {
      */
     bool SymbolStorage::removeSymbol( Sym sym )
     {
-      size_t erased = symbols.erase(sym);
-      return erased > 0;
+      size_t removed = 0, moved = 0;
+      if (!symbolIndex.erase(sym, &removed, &moved)) {
+        return false;
+      }
+      symbols.erase(sym);
+      return true;
     }
 
     /**
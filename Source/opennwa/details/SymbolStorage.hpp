@@ -7,6 +7,7 @@
 
 #include "opennwa/deprecate.h"
 #include "opennwa/NwaFwd.hpp"
+#include "opennwa/details/DenseKeyIndex.hpp"
 
 // ::wali
 #include "wali/Printable.hpp"
@@ -193,8 +194,35 @@ namespace opennwa
        */
       size_t sizeSymbols( ) const;
 
+      /**
+       *
+       * @brief returns the dense number of 'sym' (in 0..sizeSymbols()-1),
+       *        or DenseKeyIndex::npos() if it is not a symbol
+       *
+       * Numbers are stable while symbols are only added; removing a symbol
+       * can renumber the symbol with the largest number.
+       *
+       */
+      size_t denseIndex( Sym sym ) const
+      {
+        return symbolIndex.find(sym);
+      }
+
+      /**
+       *
+       * @brief returns the symbol with dense number 'index'
+       *
+       */
+      Sym denseSymbol( size_t index ) const
+      {
+        return symbolIndex.keyAt(index);
+      }
+
     private:
+      // 'symbols' keeps the ordered view handed out by getSymbols() and the
+      // iterators; 'symbolIndex' answers membership queries in O(1).
       std::set<Sym> symbols;
+      DenseKeyIndex symbolIndex;
     };
 
     //Accessors
@@ -223,7 +251,7 @@ namespace opennwa
     inline
     bool SymbolStorage::isSymbol( Sym sym ) const
     {
-      return (symbols.count(sym) > 0);
+      return symbolIndex.contains(sym);
     }
     
     /**
@@ -237,6 +265,7 @@ namespace opennwa
     void SymbolStorage::clearSymbols( )
     {
       symbols.clear();
+      symbolIndex.clear();
 
       // Epsilon is always a symbol of the NWA.
       addSymbol( EPSILON );
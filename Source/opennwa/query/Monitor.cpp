@@ -0,0 +1,568 @@
+#include "opennwa/Nwa.hpp"
+#include "opennwa/query/Monitor.hpp"
+
+#include "wali/util/unordered_map.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace opennwa {
+  namespace query {
+
+    namespace details {
+
+      typedef Monitor::Index Index;
+      typedef Monitor::Word Word;
+
+      static const unsigned bitsPerWord = 64;
+
+      // An outgoing internal or call transition: (symbol, target)
+      typedef std::pair<Index, Index> Edge;
+
+      // An outgoing return transition: (symbol, call predecessor, return site)
+      struct ReturnEdge
+      {
+        Index symbol;
+        Index pred;
+        Index target;
+
+        ReturnEdge(Index sym, Index p, Index t) : symbol(sym), pred(p), target(t) {}
+
+        bool operator< (ReturnEdge const & other) const {
+          if (symbol != other.symbol) return symbol < other.symbol;
+          if (pred != other.pred) return pred < other.pred;
+          return target < other.target;
+        }
+
+        bool operator== (ReturnEdge const & other) const {
+          return symbol == other.symbol && pred == other.pred && target == other.target;
+        }
+      };
+
+      inline bool edgeSymbolLess(Edge const & e, Index sym) { return e.first < sym; }
+      inline bool returnEdgeSymbolLess(ReturnEdge const & e, Index sym) { return e.symbol < sym; }
+
+
+      /// The NWA compiled into dense tables. Transition targets have the
+      /// epsilon closure already applied, so a step never has to chase
+      /// epsilon transitions. Outgoing transitions of state q live in
+      /// [xxxBegin[q], xxxBegin[q+1]) of the corresponding edge array,
+      /// sorted by symbol.
+      struct MonitorTables
+      {
+        Index numStates;
+        size_t wordsPerRow;
+
+        wali::util::unordered_map<State, Index> stateIndex;
+        wali::util::unordered_map<Symbol, Index> symbolIndex;
+
+        std::vector<Word> initialRow;     // closed initial states
+        std::vector<Word> initialMask;    // initial states, not closed
+        std::vector<Word> finalMask;
+
+        std::vector<size_t> internalBegin;
+        std::vector<Edge> internalEdges;
+        std::vector<size_t> callBegin;
+        std::vector<Edge> callEdges;
+        std::vector<size_t> returnBegin;
+        std::vector<ReturnEdge> returnEdges;
+
+        explicit MonitorTables(Nwa const & nwa);
+
+        Index symbol(Symbol sym, bool * found) const
+        {
+          wali::util::unordered_map<Symbol, Index>::const_iterator it = symbolIndex.find(sym);
+          *found = (it != symbolIndex.end());
+          return *found ? it->second : 0;
+        }
+
+      private:
+        Index internSymbol(Symbol sym)
+        {
+          std::pair<wali::util::unordered_map<Symbol, Index>::iterator, bool> res
+            = symbolIndex.insert(std::make_pair(sym, static_cast<Index>(symbolIndex.size())));
+          return res.first->second;
+        }
+      };
+
+
+      inline void setBit(Word * row, Index i)
+      {
+        row[i / bitsPerWord] |= (Word(1) << (i % bitsPerWord));
+      }
+
+      inline bool testBit(Word const * row, Index i)
+      {
+        return (row[i / bitsPerWord] >> (i % bitsPerWord)) & 1;
+      }
+
+      inline unsigned lowestBit(Word w)
+      {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+        unsigned i = 0;
+        while (!(w & 1)) {
+          w >>= 1;
+          ++i;
+        }
+        return i;
+#endif
+      }
+
+      inline bool isZero(Word const * row, size_t words)
+      {
+        for (size_t w = 0; w < words; ++w) {
+          if (row[w]) return false;
+        }
+        return true;
+      }
+
+      inline bool intersects(Word const * a, Word const * b, size_t words)
+      {
+        for (size_t w = 0; w < words; ++w) {
+          if (a[w] & b[w]) return true;
+        }
+        return false;
+      }
+
+      inline void orInto(Word * dest, Word const * src, size_t words)
+      {
+        for (size_t w = 0; w < words; ++w) {
+          dest[w] |= src[w];
+        }
+      }
+
+      /// Appends a zeroed row for 'key' and returns its words
+      inline Word * appendRow(Monitor::Level & level, Index key, size_t words)
+      {
+        level.keys.push_back(key);
+        size_t offset = level.bits.size();
+        level.bits.resize(offset + words, 0);
+        return &level.bits[offset];
+      }
+
+      /// Drops the most recently appended row (used when it stayed empty)
+      inline void popRow(Monitor::Level & level, size_t words)
+      {
+        level.keys.pop_back();
+        level.bits.resize(level.bits.size() - words);
+      }
+
+
+      template<typename EdgeT>
+      static void
+      buildCsr(std::vector<std::vector<EdgeT> > & perState,
+               std::vector<size_t> & begin,
+               std::vector<EdgeT> & edges)
+      {
+        begin.resize(perState.size() + 1);
+        size_t total = 0;
+        for (size_t q = 0; q < perState.size(); ++q) {
+          std::sort(perState[q].begin(), perState[q].end());
+          perState[q].erase(std::unique(perState[q].begin(), perState[q].end()), perState[q].end());
+          begin[q] = total;
+          total += perState[q].size();
+        }
+        begin[perState.size()] = total;
+
+        edges.clear();
+        edges.reserve(total);
+        for (size_t q = 0; q < perState.size(); ++q) {
+          edges.insert(edges.end(), perState[q].begin(), perState[q].end());
+        }
+      }
+
+
+      MonitorTables::MonitorTables(Nwa const & nwa)
+      {
+        numStates = 0;
+        for (Nwa::StateIterator it = nwa.beginStates(); it != nwa.endStates(); ++it) {
+          stateIndex[*it] = numStates++;
+        }
+        // Rounds up, and always leaves at least one word per row
+        wordsPerRow = numStates / bitsPerWord + 1;
+
+        // Epsilon closure of every state (each state is in its own closure)
+        std::vector<std::vector<Index> > epsilonSuccs(numStates);
+        for (Nwa::InternalIterator it = nwa.beginInternalTrans(); it != nwa.endInternalTrans(); ++it) {
+          if (it->second == EPSILON) {
+            epsilonSuccs[stateIndex[it->first]].push_back(stateIndex[it->third]);
+          }
+        }
+
+        std::vector<std::vector<Index> > closure(numStates);
+        std::vector<Index> seenBy(numStates, numStates);
+        std::vector<Index> worklist;
+        for (Index q = 0; q < numStates; ++q) {
+          worklist.push_back(q);
+          seenBy[q] = q;
+          while (!worklist.empty()) {
+            Index p = worklist.back();
+            worklist.pop_back();
+            closure[q].push_back(p);
+            for (size_t i = 0; i < epsilonSuccs[p].size(); ++i) {
+              Index next = epsilonSuccs[p][i];
+              if (seenBy[next] != q) {
+                seenBy[next] = q;
+                worklist.push_back(next);
+              }
+            }
+          }
+        }
+
+        initialRow.assign(wordsPerRow, 0);
+        initialMask.assign(wordsPerRow, 0);
+        finalMask.assign(wordsPerRow, 0);
+        for (Nwa::StateIterator it = nwa.beginInitialStates(); it != nwa.endInitialStates(); ++it) {
+          Index q = stateIndex[*it];
+          setBit(&initialMask[0], q);
+          for (size_t i = 0; i < closure[q].size(); ++i) {
+            setBit(&initialRow[0], closure[q][i]);
+          }
+        }
+        for (Nwa::StateIterator it = nwa.beginFinalStates(); it != nwa.endFinalStates(); ++it) {
+          setBit(&finalMask[0], stateIndex[*it]);
+        }
+
+        std::vector<std::vector<Edge> > internals(numStates);
+        for (Nwa::InternalIterator it = nwa.beginInternalTrans(); it != nwa.endInternalTrans(); ++it) {
+          if (it->second == EPSILON) {
+            continue;
+          }
+          Index sym = internSymbol(it->second);
+          std::vector<Index> const & targets = closure[stateIndex[it->third]];
+          std::vector<Edge> & out = internals[stateIndex[it->first]];
+          for (size_t i = 0; i < targets.size(); ++i) {
+            out.push_back(Edge(sym, targets[i]));
+          }
+        }
+        buildCsr(internals, internalBegin, internalEdges);
+
+        std::vector<std::vector<Edge> > calls(numStates);
+        for (Nwa::CallIterator it = nwa.beginCallTrans(); it != nwa.endCallTrans(); ++it) {
+          Index sym = internSymbol(it->second);
+          std::vector<Index> const & targets = closure[stateIndex[it->third]];
+          std::vector<Edge> & out = calls[stateIndex[it->first]];
+          for (size_t i = 0; i < targets.size(); ++i) {
+            out.push_back(Edge(sym, targets[i]));
+          }
+        }
+        buildCsr(calls, callBegin, callEdges);
+
+        std::vector<std::vector<ReturnEdge> > returns(numStates);
+        for (Nwa::ReturnIterator it = nwa.beginReturnTrans(); it != nwa.endReturnTrans(); ++it) {
+          Index sym = internSymbol(it->third);
+          Index pred = stateIndex[it->second];
+          std::vector<Index> const & targets = closure[stateIndex[it->fourth]];
+          std::vector<ReturnEdge> & out = returns[stateIndex[it->first]];
+          for (size_t i = 0; i < targets.size(); ++i) {
+            out.push_back(ReturnEdge(sym, pred, targets[i]));
+          }
+        }
+        buildCsr(returns, returnBegin, returnEdges);
+      }
+
+    } // namespace details
+
+
+    using details::MonitorTables;
+    using details::Edge;
+    using details::ReturnEdge;
+
+
+    Monitor::Monitor(Nwa const & nwa)
+      : m_tables(new MonitorTables(nwa))
+      , m_depth(0)
+      , m_rowOf(m_tables->numStates, m_tables->numStates)
+      , m_accepting(false)
+    {
+      reset();
+    }
+
+
+    void
+    Monitor::reset()
+    {
+      MonitorTables const & t = *m_tables;
+
+      m_depth = 0;
+      m_current.clear();
+      Word * row = details::appendRow(m_current, t.numStates, t.wordsPerRow);
+      std::copy(t.initialRow.begin(), t.initialRow.end(), row);
+
+      finishStep();
+    }
+
+
+    bool
+    Monitor::processInternal(Symbol symbol)
+    {
+      MonitorTables const & t = *m_tables;
+      size_t const words = t.wordsPerRow;
+
+      bool found;
+      Index sym = t.symbol(symbol, &found);
+
+      m_scratch.clear();
+      if (found) {
+        for (size_t r = 0; r < m_current.keys.size(); ++r) {
+          Word * out = details::appendRow(m_scratch, m_current.keys[r], words);
+          Word const * in = &m_current.bits[r * words];
+
+          for (size_t w = 0; w < words; ++w) {
+            for (Word bits = in[w]; bits; bits &= bits - 1) {
+              Index q = static_cast<Index>(w * details::bitsPerWord + details::lowestBit(bits));
+              std::vector<Edge>::const_iterator
+                e = std::lower_bound(t.internalEdges.begin() + t.internalBegin[q],
+                                     t.internalEdges.begin() + t.internalBegin[q+1],
+                                     sym, details::edgeSymbolLess),
+                end = t.internalEdges.begin() + t.internalBegin[q+1];
+              for (; e != end && e->first == sym; ++e) {
+                details::setBit(out, e->second);
+              }
+            }
+          }
+
+          if (details::isZero(out, words)) {
+            details::popRow(m_scratch, words);
+          }
+        }
+      }
+
+      m_current.swap(m_scratch);
+      return finishStep();
+    }
+
+
+    bool
+    Monitor::processCall(Symbol symbol)
+    {
+      MonitorTables const & t = *m_tables;
+      size_t const words = t.wordsPerRow;
+
+      bool found;
+      Index sym = t.symbol(symbol, &found);
+
+      // The new level has a row for each state the call is made from,
+      // holding the entries reachable from it. m_rowOf maps a call
+      // predecessor to its row while we build.
+      m_scratch.clear();
+      if (found) {
+        for (size_t r = 0; r < m_current.keys.size(); ++r) {
+          for (size_t w = 0; w < words; ++w) {
+            for (Word bits = m_current.bits[r * words + w]; bits; bits &= bits - 1) {
+              Index q = static_cast<Index>(w * details::bitsPerWord + details::lowestBit(bits));
+              std::vector<Edge>::const_iterator
+                e = std::lower_bound(t.callEdges.begin() + t.callBegin[q],
+                                     t.callEdges.begin() + t.callBegin[q+1],
+                                     sym, details::edgeSymbolLess),
+                end = t.callEdges.begin() + t.callBegin[q+1];
+              if (e == end || e->first != sym) {
+                continue;
+              }
+
+              if (m_rowOf[q] == t.numStates) {
+                m_rowOf[q] = static_cast<Index>(m_scratch.keys.size());
+                details::appendRow(m_scratch, q, words);
+              }
+              Word * out = &m_scratch.bits[m_rowOf[q] * words];
+              for (; e != end && e->first == sym; ++e) {
+                details::setBit(out, e->second);
+              }
+            }
+          }
+        }
+
+        for (size_t r = 0; r < m_scratch.keys.size(); ++r) {
+          m_rowOf[m_scratch.keys[r]] = t.numStates;
+        }
+      }
+
+      Level & frame = pushFrame();
+      frame.swap(m_current);
+      m_current.swap(m_scratch);
+      return finishStep();
+    }
+
+
+    bool
+    Monitor::processReturn(Symbol symbol)
+    {
+      MonitorTables const & t = *m_tables;
+      size_t const words = t.wordsPerRow;
+
+      bool found;
+      Index sym = t.symbol(symbol, &found);
+
+      if (m_depth == 0) {
+        // Pending return: the only row is the bottom-of-stack row, and the
+        // call predecessor must be an initial state.
+        m_scratch.clear();
+        if (found && !m_current.keys.empty()) {
+          Word * out = details::appendRow(m_scratch, t.numStates, words);
+          for (size_t w = 0; w < words; ++w) {
+            for (Word bits = m_current.bits[w]; bits; bits &= bits - 1) {
+              Index q = static_cast<Index>(w * details::bitsPerWord + details::lowestBit(bits));
+              std::vector<ReturnEdge>::const_iterator
+                e = std::lower_bound(t.returnEdges.begin() + t.returnBegin[q],
+                                     t.returnEdges.begin() + t.returnBegin[q+1],
+                                     sym, details::returnEdgeSymbolLess),
+                end = t.returnEdges.begin() + t.returnBegin[q+1];
+              for (; e != end && e->symbol == sym; ++e) {
+                if (details::testBit(&t.initialMask[0], e->pred)) {
+                  details::setBit(out, e->target);
+                }
+              }
+            }
+          }
+          if (details::isZero(out, words)) {
+            details::popRow(m_scratch, words);
+          }
+        }
+        m_current.swap(m_scratch);
+        return finishStep();
+      }
+
+      // First, for each call predecessor c (a row of the current level),
+      // collect the return sites reachable by returning to c. These go in
+      // m_scratch, row-aligned with m_current.
+      m_scratch.clear();
+      if (found) {
+        for (size_t r = 0; r < m_current.keys.size(); ++r) {
+          Index c = m_current.keys[r];
+          Word * out = details::appendRow(m_scratch, c, words);
+          for (size_t w = 0; w < words; ++w) {
+            for (Word bits = m_current.bits[r * words + w]; bits; bits &= bits - 1) {
+              Index q = static_cast<Index>(w * details::bitsPerWord + details::lowestBit(bits));
+              std::vector<ReturnEdge>::const_iterator
+                e = std::lower_bound(t.returnEdges.begin() + t.returnBegin[q],
+                                     t.returnEdges.begin() + t.returnBegin[q+1],
+                                     sym, details::returnEdgeSymbolLess),
+                end = t.returnEdges.begin() + t.returnBegin[q+1];
+              for (; e != end && e->symbol == sym; ++e) {
+                if (e->pred == c) {
+                  details::setBit(out, e->target);
+                }
+              }
+            }
+          }
+          if (details::isZero(out, words)) {
+            details::popRow(m_scratch, words);
+          }
+        }
+      }
+
+      // Then join with the frame below: a row h of the caller's level that
+      // contains c gets everything c can return to.
+      Level & caller = m_frames[m_depth - 1];
+      m_current.clear();
+      if (!m_scratch.keys.empty()) {
+        for (size_t h = 0; h < caller.keys.size(); ++h) {
+          Word const * callerRow = &caller.bits[h * words];
+          Word * out = details::appendRow(m_current, caller.keys[h], words);
+          for (size_t r = 0; r < m_scratch.keys.size(); ++r) {
+            if (details::testBit(callerRow, m_scratch.keys[r])) {
+              details::orInto(out, &m_scratch.bits[r * words], words);
+            }
+          }
+          if (details::isZero(out, words)) {
+            details::popRow(m_current, words);
+          }
+        }
+      }
+
+      --m_depth;
+      return finishStep();
+    }
+
+
+    bool
+    Monitor::process(NestedWord::Position const & pos)
+    {
+      switch (pos.type) {
+        case NestedWord::Position::CallType:
+          return processCall(pos.symbol);
+        case NestedWord::Position::ReturnType:
+          return processReturn(pos.symbol);
+        default:
+          return processInternal(pos.symbol);
+      }
+    }
+
+
+    bool
+    Monitor::process(NestedWord const & word)
+    {
+      for (NestedWord::const_iterator pos = word.begin(); pos != word.end(); ++pos) {
+        process(*pos);
+      }
+      return m_accepting;
+    }
+
+
+    bool
+    Monitor::isStuck() const
+    {
+      return m_current.keys.empty();
+    }
+
+
+    void
+    Monitor::snapshot(Snapshot & snap) const
+    {
+      snap.frames.assign(m_frames.begin(), m_frames.begin() + m_depth);
+      snap.current = m_current;
+      snap.accepting = m_accepting;
+    }
+
+
+    void
+    Monitor::restore(Snapshot const & snap)
+    {
+      if (m_frames.size() < snap.frames.size()) {
+        m_frames.resize(snap.frames.size());
+      }
+      for (size_t i = 0; i < snap.frames.size(); ++i) {
+        m_frames[i].keys.assign(snap.frames[i].keys.begin(), snap.frames[i].keys.end());
+        m_frames[i].bits.assign(snap.frames[i].bits.begin(), snap.frames[i].bits.end());
+      }
+      m_depth = snap.frames.size();
+      m_current.keys.assign(snap.current.keys.begin(), snap.current.keys.end());
+      m_current.bits.assign(snap.current.bits.begin(), snap.current.bits.end());
+      m_accepting = snap.accepting;
+    }
+
+
+    bool
+    Monitor::finishStep()
+    {
+      MonitorTables const & t = *m_tables;
+
+      m_accepting = false;
+      for (size_t r = 0; r < m_current.keys.size() && !m_accepting; ++r) {
+        m_accepting = details::intersects(&m_current.bits[r * t.wordsPerRow],
+                                          &t.finalMask[0], t.wordsPerRow);
+      }
+      return m_accepting;
+    }
+
+
+    Monitor::Level &
+    Monitor::pushFrame()
+    {
+      if (m_frames.size() == m_depth) {
+        m_frames.push_back(Level());
+      }
+      return m_frames[m_depth++];
+    }
+
+  }
+}
+
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
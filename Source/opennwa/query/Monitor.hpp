@@ -0,0 +1,139 @@
+#ifndef WALI_NWA_QUERY_MONITOR_HPP
+#define WALI_NWA_QUERY_MONITOR_HPP
+
+#include "opennwa/NwaFwd.hpp"
+#include "opennwa/NestedWord.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace opennwa {
+  namespace query {
+
+    namespace details {
+      struct MonitorTables;
+    }
+
+    /// @brief Incrementally simulates an NWA over a stream of symbols.
+    ///
+    /// Where languageContains() needs the whole NestedWord up front, a
+    /// Monitor is fed one call, internal, or return symbol at a time and
+    /// reports after each event whether the prefix read so far is
+    /// accepted. After feeding all positions of a word, accepting() gives
+    /// the same answer as languageContains() on that word.
+    ///
+    /// On construction the NWA is compiled into densely-numbered
+    /// transition tables (with epsilon closures folded in), so later
+    /// changes to the NWA are not seen by the monitor. The set of
+    /// current configurations is kept as a relation from call
+    /// predecessor to current state, with one bitset row per call
+    /// predecessor; each pending call pushes the relation as a frame. The
+    /// frame buffers are reused, so in steady state processing an event
+    /// does not allocate.
+    ///
+    /// Copying a Monitor shares the compiled tables but not the
+    /// configuration set.
+    class Monitor
+    {
+    public:
+      typedef boost::uint64_t Word;
+      typedef unsigned int Index;
+
+      /// One level of the configuration set: the rows 'keys[i]' (call
+      /// predecessors, or the bottom-of-stack marker) each own
+      /// 'wordsPerRow' words of 'bits' holding the current states.
+      struct Level
+      {
+        std::vector<Index> keys;
+        std::vector<Word> bits;
+
+        void clear() { keys.clear(); bits.clear(); }
+        void swap(Level & other) { keys.swap(other.keys); bits.swap(other.bits); }
+      };
+
+      /// @brief An opaque copy of the monitor's configuration set
+      ///
+      /// Obtained from snapshot() and accepted by restore() of any
+      /// monitor built from the same NWA.
+      class Snapshot
+      {
+        friend class Monitor;
+        std::vector<Level> frames;
+        Level current;
+        bool accepting;
+      };
+
+      /// Compiles 'nwa' and positions the monitor at the start of the
+      /// stream (see reset()).
+      explicit Monitor(Nwa const & nwa);
+
+      /// Returns to the initial configurations, i.e. the epsilon closure
+      /// of the initial states with an empty stack.
+      void reset();
+
+      /// Reads 'sym' as a call position. Returns accepting().
+      bool processCall(Symbol sym);
+
+      /// Reads 'sym' as an internal position. Returns accepting().
+      bool processInternal(Symbol sym);
+
+      /// Reads 'sym' as a return position. Returns accepting().
+      ///
+      /// If no call is pending, this is treated as a pending return whose
+      /// call predecessor must be an initial state, as in
+      /// Nwa::isMemberNondet.
+      bool processReturn(Symbol sym);
+
+      /// Reads one position of a nested word. Returns accepting().
+      bool process(NestedWord::Position const & pos);
+
+      /// Reads each position of 'word' in order. Returns accepting().
+      bool process(NestedWord const & word);
+
+      /// Returns whether some current configuration is in a final state
+      bool accepting() const { return m_accepting; }
+
+      /// Returns whether there are no current configurations left. Once
+      /// this holds, no extension of the stream can be accepted.
+      bool isStuck() const;
+
+      /// Returns the number of pending (unmatched) calls read so far
+      size_t stackDepth() const { return m_depth; }
+
+      /// Saves the current configuration set into 'snap'
+      void snapshot(Snapshot & snap) const;
+
+      /// Makes the configuration set the one saved in 'snap'
+      void restore(Snapshot const & snap);
+
+    private:
+      bool finishStep();
+      Level & pushFrame();
+
+      boost::shared_ptr<details::MonitorTables const> m_tables;
+
+      // m_frames[0..m_depth) are live; entries beyond that keep their
+      // buffers around for reuse.
+      std::vector<Level> m_frames;
+      size_t m_depth;
+
+      Level m_current;
+      Level m_scratch;
+      std::vector<Index> m_rowOf;
+
+      bool m_accepting;
+    };
+
+  }
+}
+
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif
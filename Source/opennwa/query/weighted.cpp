@@ -1,28 +1,565 @@
 #include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/GenKeySource.hpp"
 #include "wali/wpds/fwpds/FWPDS.hpp"
 #include "wali/wfa/WFA.hpp"
 #include "wali/wfa/State.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/DefaultWorklist.hpp"
+#include "wali/HashMap.hpp"
+#include "wali/KeyContainer.hpp"
+#include "wali/util/unordered_map.hpp"
 #include "opennwa/Nwa.hpp"
 #include "opennwa/query/automaton.hpp"
 #include "opennwa/nwa_pds/conversions.hpp"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 namespace opennwa {
   namespace query {
 
     using wali::wpds::WPDS;
     using wali::wfa::WFA;
 
+    namespace {
+
+      using wali::wfa::ITrans;
+      using wali::KeyPair;
+      using wali::KeyTriple;
+
+      typedef ref_ptr< wali::Worklist<ITrans> > worklist_t;
+
+
+      /// One rule of the PDS that NwaToWpdsCalls() would build, as seen
+      /// from one of the NWA states it mentions: the NWA state at the
+      /// other end, and the rule's weight
+      struct Edge
+      {
+        State state;
+        sem_elem_t weight;
+
+        Edge(State s, sem_elem_t w) : state(s), weight(w) {}
+      };
+
+      typedef std::vector<Edge> Edges;
+
+
+      /// Merges edges to the same state by combining their weights, as
+      /// WPDS::add_rule does with duplicate rules
+      void combineDuplicates(Edges & edges)
+      {
+        Edges unique;
+        std::map<State, size_t> position;
+        for (Edges::const_iterator e = edges.begin(); e != edges.end(); ++e) {
+          std::pair<std::map<State, size_t>::iterator, bool> res
+            = position.insert(std::make_pair(e->state, unique.size()));
+          if (res.second) {
+            unique.push_back(*e);
+          }
+          else {
+            sem_elem_t & w = unique[res.first->second].weight;
+            w = w->combine(e->weight);
+          }
+        }
+        edges.swap(unique);
+      }
+
+
+      class TransCollector : public wali::wfa::ConstTransFunctor
+      {
+      public:
+        std::vector<ITrans const *> transitions;
+
+        virtual void operator()(ITrans const * t)
+        {
+          transitions.push_back(t);
+        }
+      };
+
+
+      /// Clears the Config links, which this file never sets but copies
+      /// of input transitions may carry
+      class Unlinker : public wali::wfa::TransFunctor
+      {
+      public:
+        virtual void operator()(ITrans * t)
+        {
+          t->setConfig(0);
+        }
+      };
+
+
+      /// @brief Runs prestar and poststar on the "stack calls" PDS of an
+      /// NWA without building that PDS.
+      ///
+      /// NwaToWpdsCalls() turns each NWA transition into Rule and Config
+      /// objects, and the WPDS solver generates a fresh (state, stack) key
+      /// every time it applies a push rule. Here the transitions are read
+      /// once out of the NWA's TransitionStorage into per-state rule lists,
+      /// and the generated keys -- the control location p_x of each exit
+      /// and the poststar mid-state of each entry -- are made once per
+      /// query.
+      ///
+      /// The saturation follows WPDS::prestar and WPDS::poststar step for
+      /// step, and names states the same way, so the output automaton is
+      /// the one the WPDS would produce.
+      class Saturation
+      {
+      public:
+        Saturation(Nwa const & nwa, WeightGen const & wg, worklist_t worklist);
+
+        void prestar(WFA const & input, WFA & output);
+        void poststar(WFA const & input, WFA & output);
+
+      private:
+        /// The rules that mention one NWA state q
+        struct StateRules
+        {
+          State state;                     // q
+          Edges internalsFrom;             // <p,q> -> <p,q'>
+          Edges internalsTo;               // <p,q'> -> <p,q>
+          Edges callsFrom;                 // <p,q> -> <p,q_e q>
+          Edges callsTo;                   // <p,q_c> -> <p,q q_c>
+          sem_elem_t pop;                  // <p,q> -> <p_q,eps> (or NULL)
+          Key exitLocation;                // p_q, if 'pop' is not NULL
+          std::vector<KeyPair> returnsTo;  // <p_x,q_c> -> <p,q>, as (p_x,q_c)
+
+          Key midState;                    // poststar only
+          sem_elem_t quasi;
+
+          explicit StateRules(State q)
+            : state(q), exitLocation(wali::WALI_EPSILON), midState(wali::WALI_EPSILON)
+          {}
+        };
+
+        typedef wali::HashMap<KeyTriple, ITrans*> TransMap;
+        typedef wali::HashMap<KeyPair, std::vector<ITrans*> > TransListMap;
+        typedef wali::HashMap<Key, std::vector<ITrans*> > EpsilonMap;
+        typedef wali::HashMap<KeyPair, std::vector<State> > ReturnMap;
+
+        StateRules & intern(State state)
+        {
+          std::pair<wali::util::unordered_map<State, size_t>::iterator, bool> res
+            = index.insert(std::make_pair(state, rules.size()));
+          if (res.second) {
+            rules.push_back(StateRules(state));
+          }
+          return rules[res.first->second];
+        }
+
+        StateRules * rulesFor(Key stack)
+        {
+          wali::util::unordered_map<State, size_t>::const_iterator it = index.find(stack);
+          return it == index.end() ? NULL : &rules[it->second];
+        }
+
+        void setupOutput(WFA const & input, WFA & output);
+
+        ITrans * insert(ITrans * tnew);
+        void update(Key from, Key stack, Key to, sem_elem_t weight);
+        ITrans * find(Key from, Key stack, Key to) const;
+
+        void pre(ITrans * t);
+        void post(ITrans * t);
+        void postRewrite(ITrans * t, sem_elem_t delta, Key state, Key stack, sem_elem_t weight);
+        void postPush(ITrans * t, sem_elem_t delta, StateRules & entry, sem_elem_t weight);
+
+        Key program;
+        sem_elem_t one;
+        worklist_t worklist;
+
+        wali::util::unordered_map<State, size_t> index;
+        std::vector<StateRules> rules;
+        ReturnMap returnsFrom;             // <p_x,q_c> -> <p,q_r>, by (p_x,q_c)
+
+        // The automaton being saturated, and lookups into it. Every
+        // transition of 'fa' goes through insert(), which keeps these
+        // up to date.
+        WFA * fa;
+        sem_elem_t zero;
+        TransMap transitions;
+        TransListMap transitionsFrom;
+        EpsilonMap epsilonsTo;
+      };
+
+
+      Saturation::Saturation(Nwa const & nwa, WeightGen const & wg, worklist_t wl)
+        : program(nwa_pds::getProgramControlLocation())
+        , one(wg.getOne())
+        , worklist(wl.is_valid() ? wl : worklist_t(new wali::DefaultWorklist<ITrans>()))
+        , fa(NULL)
+      {
+        typedef details::TransitionStorage Trans;
+        Trans const & trans = nwa._private_get_transition_storage_();
+        sem_elem_t wgt;
+
+        // The weights come from 'wg' exactly as in _private_NwaToPdsCalls_
+
+        for (Trans::InternalIterator iit = trans.beginInternal(); iit != trans.endInternal(); ++iit) {
+          State src = Trans::getSource(*iit);
+          State tgt = Trans::getTarget(*iit);
+
+          if (Trans::getInternalSym(*iit) == WILD)
+            wgt = wg.getWildWeight(src, nwa.getClientInfo(src), tgt, nwa.getClientInfo(tgt));
+          else
+            wgt = wg.getWeight(src, nwa.getClientInfo(src),
+                               Trans::getInternalSym(*iit),
+                               WeightGen::INTRA,
+                               tgt, nwa.getClientInfo(tgt));
+
+          intern(tgt);
+          intern(src).internalsFrom.push_back(Edge(tgt, wgt));
+        }
+
+        for (Trans::CallIterator cit = trans.beginCall(); cit != trans.endCall(); ++cit) {
+          State src = Trans::getCallSite(*cit);
+          State tgt = Trans::getEntry(*cit);
+
+          if (Trans::getCallSym(*cit) == WILD)
+            wgt = wg.getWildWeight(src, nwa.getClientInfo(src), tgt, nwa.getClientInfo(tgt));
+          else
+            wgt = wg.getWeight(src, nwa.getClientInfo(src),
+                               Trans::getCallSym(*cit),
+                               WeightGen::CALL_TO_ENTRY,
+                               tgt, nwa.getClientInfo(tgt));
+
+          intern(tgt);
+          intern(src).callsFrom.push_back(Edge(tgt, wgt));
+        }
+
+        for (Trans::ReturnIterator rit = trans.beginReturn(); rit != trans.endReturn(); ++rit) {
+          State src = Trans::getExit(*rit);
+          State pred = Trans::getCallSite(*rit);
+          State tgt = Trans::getReturnSite(*rit);
+
+          if (Trans::getReturnSym(*rit) == WILD)
+            wgt = wg.getWildWeight(src, nwa.getClientInfo(src), tgt, nwa.getClientInfo(tgt));
+          else
+            wgt = wg.getWeight(src, nwa.getClientInfo(src),
+                               Trans::getReturnSym(*rit),
+                               WeightGen::EXIT_TO_RET,
+                               tgt, nwa.getClientInfo(tgt));
+
+          intern(tgt);
+          Key exitLocation;
+          {
+            StateRules & exit = intern(src);
+            if (exit.pop == NULL) {
+              exit.exitLocation = nwa_pds::getControlLocation(src);
+              exit.pop = wgt;
+            }
+            else {
+              exit.pop = exit.pop->combine(wgt);
+            }
+            exitLocation = exit.exitLocation;
+          }
+
+          KeyPair from(exitLocation, pred);
+          std::vector<State> & returnSites = returnsFrom[from];
+          if (std::find(returnSites.begin(), returnSites.end(), tgt) == returnSites.end()) {
+            returnSites.push_back(tgt);
+            rulesFor(tgt)->returnsTo.push_back(from);
+          }
+        }
+
+        for (size_t i = 0; i < rules.size(); ++i) {
+          combineDuplicates(rules[i].internalsFrom);
+          combineDuplicates(rules[i].callsFrom);
+        }
+
+        for (size_t i = 0; i < rules.size(); ++i) {
+          State state = rules[i].state;
+          for (Edges::const_iterator e = rules[i].internalsFrom.begin();
+               e != rules[i].internalsFrom.end(); ++e)
+          {
+            rulesFor(e->state)->internalsTo.push_back(Edge(state, e->weight));
+          }
+          for (Edges::const_iterator e = rules[i].callsFrom.begin();
+               e != rules[i].callsFrom.end(); ++e)
+          {
+            rulesFor(e->state)->callsTo.push_back(Edge(state, e->weight));
+          }
+        }
+      }
+
+
+      /// Adds 'tnew' to the output (taking ownership) and returns the
+      /// transition that holds its weight
+      ITrans *
+      Saturation::insert(ITrans * tnew)
+      {
+        std::pair<ITrans*, bool> res = fa->insert(tnew);
+        ITrans * t = res.first;
+        if (res.second) {
+          transitions[KeyTriple(t->from(), t->stack(), t->to())] = t;
+          transitionsFrom[KeyPair(t->from(), t->stack())].push_back(t);
+          if (t->stack() == wali::WALI_EPSILON) {
+            epsilonsTo[t->to()].push_back(t);
+          }
+        }
+        return t;
+      }
+
+
+      void
+      Saturation::update(Key from, Key stack, Key to, sem_elem_t weight)
+      {
+        ITrans * t = insert(new wali::wfa::Trans(from, stack, to, weight));
+        if (t->modified()) {
+          worklist->put(t);
+        }
+      }
+
+
+      ITrans *
+      Saturation::find(Key from, Key stack, Key to) const
+      {
+        TransMap::const_iterator it = transitions.find(KeyTriple(from, stack, to));
+        return it == transitions.end() ? NULL : it->second;
+      }
+
+
+      /// Makes 'output' a copy of 'input' and puts every transition on the
+      /// worklist (WPDS::setupOutput)
+      void
+      Saturation::setupOutput(WFA const & input, WFA & output)
+      {
+        // 'input' and 'output' may be the same automaton
+        WFA copy(input);
+
+        fa = &output;
+        fa->clear();
+        transitions.clear();
+        transitionsFrom.clear();
+        epsilonsTo.clear();
+
+        TransCollector collect;
+        copy.for_each(collect);
+        for (size_t i = 0; i < collect.transitions.size(); ++i) {
+          worklist->put(insert(collect.transitions[i]->copy()));
+        }
+
+        zero = fa->getSomeWeight()->zero();
+
+        fa->addState(copy.getInitialState(), zero);
+        fa->setInitialState(copy.getInitialState());
+        for (std::set<Key>::const_iterator f = copy.getFinalStates().begin();
+             f != copy.getFinalStates().end(); ++f)
+        {
+          fa->addState(*f, zero);
+          fa->addFinalState(*f);
+        }
+        fa->setGeneration(copy.getGeneration() + 1);
+      }
+
+
+      void
+      Saturation::prestar(WFA const & input, WFA & output)
+      {
+        if (input.numTransitions() == 0u) {
+          output.clear();
+          return;
+        }
+
+        setupOutput(input, output);
+        fa->setQuery(WFA::INORDER);
+
+        // Pop rules fire right away
+        for (size_t i = 0; i < rules.size(); ++i) {
+          if (rules[i].pop != NULL) {
+            fa->addState(program, zero);
+            fa->addState(rules[i].exitLocation, zero);
+            update(program, rules[i].state, rules[i].exitLocation, rules[i].pop);
+          }
+        }
+
+        while (!worklist->empty()) {
+          pre(worklist->get());
+        }
+
+        Unlinker unlinker;
+        fa->for_each(unlinker);
+        fa = NULL;
+      }
+
+
+      void
+      Saturation::pre(ITrans * t)
+      {
+        sem_elem_t delta = t->getDelta();
+        t->setDelta(delta->zero());
+
+        Key from = t->from();
+        Key to = t->to();
+        StateRules * rs = rulesFor(t->stack());
+        if (rs == NULL) {
+          return;
+        }
+
+        if (from == program) {
+          // Rules whose right-hand side starts with <p,q>
+
+          for (Edges::const_iterator e = rs->internalsTo.begin(); e != rs->internalsTo.end(); ++e) {
+            update(program, e->state, to, e->weight->extend(delta));
+          }
+
+          for (Edges::const_iterator e = rs->callsTo.begin(); e != rs->callsTo.end(); ++e) {
+            TransListMap::iterator below = transitionsFrom.find(KeyPair(to, e->state));
+            if (below != transitionsFrom.end()) {
+              sem_elem_t wrule = e->weight->extend(delta);
+              // update() can append to this very list
+              std::vector<ITrans*> & list = below->second;
+              for (size_t i = 0; i < list.size(); ++i) {
+                ITrans * tprime = list[i];
+                update(program, e->state, tprime->to(), wrule->extend(tprime->weight()));
+              }
+            }
+          }
+
+          for (std::vector<KeyPair>::const_iterator r = rs->returnsTo.begin(); r != rs->returnsTo.end(); ++r) {
+            update(r->first, r->second, to, one->extend(delta));
+          }
+        }
+
+        // Push rules <p,q_c> -> <p,q_e q_c> with q_c on top of t
+        for (Edges::const_iterator e = rs->callsFrom.begin(); e != rs->callsFrom.end(); ++e) {
+          ITrans * tp = find(program, e->state, from);
+          if (tp != NULL) {
+            update(program, rs->state, to, e->weight->extend(tp->weight())->extend(delta));
+          }
+        }
+      }
+
+
+      void
+      Saturation::poststar(WFA const & input, WFA & output)
+      {
+        if (input.numTransitions() == 0u) {
+          output.clear();
+          return;
+        }
+
+        setupOutput(input, output);
+        fa->setQuery(WFA::REVERSE);
+
+        for (size_t i = 0; i < rules.size(); ++i) {
+          if (!rules[i].callsTo.empty()) {
+            rules[i].midState =
+              wali::getKey(new wali::wpds::GenKeySource(fa->getGeneration(),
+                                                        wali::getKey(program, rules[i].state)));
+            rules[i].quasi = zero;
+            fa->addState(rules[i].midState, zero);
+          }
+        }
+
+        while (!worklist->empty()) {
+          post(worklist->get());
+        }
+
+        Unlinker unlinker;
+        fa->for_each(unlinker);
+        fa = NULL;
+      }
+
+
+      void
+      Saturation::post(ITrans * t)
+      {
+        sem_elem_t delta = t->getDelta();
+        t->setDelta(zero);
+
+        if (t->stack() == wali::WALI_EPSILON) {
+          // (p,eps,q) + (q,y,q') => (p,y,q')
+          wali::wfa::State * state = fa->getState(t->to());
+          for (wali::wfa::State::iterator it = state->begin(); it != state->end(); ++it) {
+            ITrans * tprime = *it;
+            update(t->from(), tprime->stack(), tprime->to(), tprime->poststar_eps_closure(delta));
+          }
+          return;
+        }
+
+        if (t->from() == program) {
+          StateRules * rs = rulesFor(t->stack());
+          if (rs == NULL) {
+            return;
+          }
+
+          for (Edges::const_iterator e = rs->internalsFrom.begin(); e != rs->internalsFrom.end(); ++e) {
+            postRewrite(t, delta, program, e->state, e->weight);
+          }
+          if (rs->pop != NULL) {
+            postRewrite(t, delta, rs->exitLocation, wali::WALI_EPSILON, rs->pop);
+          }
+          for (Edges::const_iterator e = rs->callsFrom.begin(); e != rs->callsFrom.end(); ++e) {
+            postPush(t, delta, *rulesFor(e->state), e->weight);
+          }
+        }
+        else {
+          ReturnMap::const_iterator it = returnsFrom.find(KeyPair(t->from(), t->stack()));
+          if (it != returnsFrom.end()) {
+            std::vector<State> const & returnSites = it->second;
+            for (size_t i = 0; i < returnSites.size(); ++i) {
+              postRewrite(t, delta, program, returnSites[i], one);
+            }
+          }
+        }
+      }
+
+
+      /// Applies <t.from,t.stack> -> <state,stack> to t (stack may be
+      /// epsilon)
+      void
+      Saturation::postRewrite(ITrans * t, sem_elem_t delta, Key state, Key stack, sem_elem_t weight)
+      {
+        ITrans * existing = find(state, stack, t->to());
+        sem_elem_t wrule = delta->extendAndDiff(weight, existing ? existing->weight() : zero);
+        update(state, stack, t->to(), wrule);
+      }
+
+
+      /// Applies <p,q_c> -> <p,q_e q_c> to t = (p,q_c,q), where 'entry'
+      /// holds q_e: adds (m,q_c,q) and (p,q_e,m) for q_e's mid-state m
+      void
+      Saturation::postPush(ITrans * t, sem_elem_t delta, StateRules & entry, sem_elem_t weight)
+      {
+        Key callSite = t->stack();
+        Key m = entry.midState;
+
+        ITrans * existing = find(m, callSite, t->to());
+        sem_elem_t wrule = delta->extendAndDiff(weight, existing ? existing->weight() : zero);
+
+        // Transitions out of a mid-state never go on the worklist
+        ITrans * tprime = insert(new wali::wfa::Trans(m, callSite, t->to(), wrule));
+
+        entry.quasi = entry.quasi->combine(wrule->quasi_one());
+        update(program, entry.state, m, entry.quasi);
+
+        if (tprime->modified()) {
+          EpsilonMap::iterator eps = epsilonsTo.find(m);
+          if (eps != epsilonsTo.end()) {
+            std::vector<ITrans*> const & list = eps->second;
+            for (size_t i = 0; i < list.size(); ++i) {
+              ITrans * teps = list[i];
+              update(teps->from(), callSite, tprime->to(),
+                     tprime->getDelta()->extend(teps->weight()));
+            }
+          }
+        }
+      }
+
+    } // namespace
+
+
     wali::wfa::WFA
     prestar(Nwa const & nwa,
             WeightGen const & wg,
             ref_ptr< wali::Worklist<wali::wfa::ITrans> > worklist,
             wali::wfa::WFA const & input)
     {
-      WPDS wpds = nwa_pds::NwaToWpdsCalls(nwa, wg);
-      if (worklist != NULL) {
-        wpds.setWorklist(worklist);
-      }
-      return wpds.prestar(input);
+      WFA output;
+      prestar(nwa, wg, worklist, input, output);
+      return output;
     }
 
     
@@ -33,11 +570,7 @@ namespace opennwa {
             wali::wfa::WFA const & input,
             wali::wfa::WFA & output)
     {
-      WPDS wpds = nwa_pds::NwaToWpdsCalls(nwa, wg);
-      if (worklist != NULL) {
-        wpds.setWorklist(worklist);
-      }
-      wpds.prestar(input, output);
+      Saturation(nwa, wg, worklist).prestar(input, output);
     }
 
     
@@ -47,11 +580,9 @@ namespace opennwa {
              ref_ptr< wali::Worklist<wali::wfa::ITrans> > worklist,
              wali::wfa::WFA const & input)
     {
-      WPDS wpds = nwa_pds::NwaToWpdsCalls(nwa, wg);
-      if (worklist != NULL) {
-        wpds.setWorklist(worklist);
-      }
-      return wpds.poststar(input);
+      WFA output;
+      poststar(nwa, wg, worklist, input, output);
+      return output;
     }
 
     
@@ -62,11 +593,7 @@ namespace opennwa {
              wali::wfa::WFA const & input,
              wali::wfa::WFA & output)
     {
-      WPDS wpds = nwa_pds::NwaToWpdsCalls(nwa, wg);
-      if (worklist != NULL) {
-        wpds.setWorklist(worklist);
-      }
-      wpds.poststar(input, output);
+      Saturation(nwa, wg, worklist).poststar(input, output);
     }
 
 
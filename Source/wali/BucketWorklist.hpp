@@ -0,0 +1,127 @@
+#ifndef wali_BUCKET_WORKLIST_GUARD
+#define wali_BUCKET_WORKLIST_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Worklist.hpp"
+#include "wali/wfa/Trans.hpp"
+#include <map>
+#include <vector>
+
+namespace wali
+{
+  /*!
+   * @class BucketWorklist
+   *
+   * A monotone bucket queue (Dial's algorithm) for weights that rank as
+   * small non-negative integers. Rank is a functor mapping a
+   * const wfa::ITrans* to a size_t; lower ranks come out first.
+   *
+   * A transition of rank r goes in bucket r / width, and get() scans
+   * forward from the lowest bucket that may be non-empty, so put and get
+   * are O(1) amortized when ranks grow slowly. Within a bucket the order
+   * is last-in first-out; with a width greater than one the order is
+   * therefore only approximately by rank, like a calendar queue that
+   * never wraps. Buckets are allocated as ranks are seen, up to
+   * max_buckets; ranks beyond that (e.g., the "infinity" of a
+   * shortest-path zero) go to an ordered overflow map.
+   *
+   * A put whose rank is below the scan position moves the scan back, so
+   * the worklist is correct, if slower, when ranks are not monotone.
+   */
+  template< typename Rank >
+  class BucketWorklist : public Worklist<wfa::ITrans>
+  {
+    public:
+      BucketWorklist( size_t width = 1, size_t max_buckets = 1 << 16,
+                      Rank const & rank = Rank() );
+
+      virtual ~BucketWorklist();
+
+      virtual bool put( wfa::ITrans *t );
+
+      virtual wfa::ITrans * get();
+
+      virtual bool empty() const;
+
+      virtual void clear();
+
+      virtual size_t size() const;
+
+    protected:
+      Rank const & getRank() const { return rank; }
+
+    private:
+      typedef std::vector< wfa::ITrans* > bucket_t;
+      typedef std::multimap< size_t, wfa::ITrans* > overflow_t;
+
+      Rank rank;
+      size_t width;
+      size_t max_buckets;
+      std::vector< bucket_t > buckets;
+      overflow_t overflow;
+      size_t cursor;  //!< No bucket below cursor is non-empty
+      size_t count;
+
+  }; // class BucketWorklist
+
+
+  /*!
+   * @class RadixHeapWorklist
+   *
+   * A radix heap over the ranks given by Rank (see BucketWorklist).
+   * Items are kept in one bucket per bit position of the difference
+   * between their rank and the last rank removed, so each item is
+   * moved at most once per bit and put and get are O(log C) amortized
+   * for a rank range C, with no per-node allocation.
+   *
+   * A radix heap needs ranks that do not decrease. A transition whose
+   * rank is below the last one removed is queued with the last rank
+   * instead, i.e., it comes out next. That only changes the order of a
+   * saturation, not its result. The last rank is reset when the
+   * worklist empties.
+   */
+  template< typename Rank >
+  class RadixHeapWorklist : public Worklist<wfa::ITrans>
+  {
+    public:
+      RadixHeapWorklist();
+
+      virtual ~RadixHeapWorklist();
+
+      virtual bool put( wfa::ITrans *t );
+
+      virtual wfa::ITrans * get();
+
+      virtual bool empty() const;
+
+      virtual void clear();
+
+      virtual size_t size() const;
+
+    private:
+      typedef std::vector< std::pair< size_t, wfa::ITrans* > > bucket_t;
+
+      enum { num_buckets = sizeof(size_t) * 8 + 1 };
+
+      /// 0 if r == last, else the number of bits of r ^ last
+      size_t bucketOf( size_t r ) const;
+
+      Rank rank;
+      size_t last;
+      bucket_t buckets[num_buckets];
+      size_t count;
+
+  }; // class RadixHeapWorklist
+
+} // namespace wali
+
+#include "wali/details/BucketWorklist.cpp"
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif  // wali_BUCKET_WORKLIST_GUARD
+
@@ -50,6 +50,21 @@ namespace wali
       virtual bool equal(merge_fn_t mf) = 0;
       //virtual MergeFn *parse_element(const char *s, sem_elem_t sem) = 0;
 
+      /**
+       * A merge function is pure if apply_f depends only on the merge
+       * function and the (SemElem::equal) values of its arguments, and
+       * the weights it is applied to implement SemElem::hash. The results
+       * of pure merge functions may be memoized (see
+       * wpds::ewpds::MergeFnMemo). Merge functions are impure unless
+       * declared otherwise.
+       */
+      bool isPure() const { return pure; }
+
+      void setPure(bool p) { pure = p; }
+
+    private:
+      bool pure;
+
   };
 
 } // namespacw wali
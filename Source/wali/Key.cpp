@@ -80,6 +80,16 @@ namespace wali
     return getKeySpace()->getKey(ks);
   }
 
+  Key pinKey( Key k )
+  {
+    return getKeySpace()->pinKey(k);
+  }
+
+  void getKeys( const std::vector<std::string>& names, std::vector<Key>& keys )
+  {
+    getKeySpace()->getKeys(names,keys);
+  }
+
 
   //
   // Return KeySource associated with the key k
@@ -109,5 +119,14 @@ namespace wali
     return getKeySpace()->key2str(k);
   }
 
+  KeyScope::KeyScope() : start(getKeySpace()->size())
+  {
+  }
+
+  KeyScope::~KeyScope()
+  {
+    getKeySpace()->releaseKeys(start);
+  }
+
 } // namespace wali
 
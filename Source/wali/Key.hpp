@@ -13,6 +13,7 @@
  */
 #include <string>
 #include <set>
+#include <vector>
 #include "wali/ref_ptr.hpp"
 
 namespace wali
@@ -55,6 +56,17 @@ namespace wali
   // @author Amanda Burton
   Key getKey( std::set<Key> ks );
 
+  /**
+   * Keeps k valid even if it was created inside a KeyScope.
+   * @see KeySpace::pinKey
+   */
+  Key pinKey( Key k );
+
+  /**
+   * Appends the key of each string in names to keys
+   */
+  void getKeys( const std::vector<std::string>& names, std::vector<Key>& keys );
+
   /**
    * Return KeySource associated with the key k
    */
@@ -79,6 +91,45 @@ namespace wali
    */
   std::string key2str( Key k );
 
+  /**
+   * @class KeyScope
+   * @brief Releases the keys created during its lifetime
+   *
+   * A KeyScope notes how many keys exist when it is created and, when
+   * it is destroyed, releases every key created since (see
+   * KeySpace::releaseKeys). Keys that existed before, including
+   * WALI_EPSILON and WALI_WILD, stay valid.
+   *
+   * This lets a long-running process handle independent requests
+   * without the KeySpace growing forever:
+   *
+   *   {
+   *     KeyScope scope;
+   *     WPDS pds;
+   *     ... build pds, run poststar, report results ...
+   *   }   // pds is destroyed, then its keys are released
+   *
+   * Everything that holds a key from the scope must be destroyed
+   * before the scope is, and such keys must not be stored elsewhere
+   * (e.g., in a static) unless they are pinned with pinKey. Scopes
+   * must nest.
+   */
+  class KeyScope
+  {
+    public:
+      KeyScope();
+      ~KeyScope();
+
+      /// The number of keys that existed when the scope began
+      size_t mark() const { return start; }
+
+    private:
+      size_t start;
+
+      KeyScope( const KeyScope& );
+      KeyScope& operator=( const KeyScope& );
+  };
+
 } // namespace wali
 
 #endif  // wali_KEY_GUARD
@@ -45,7 +45,7 @@ namespace wali
     return o;
   }
 
-  std::set<Key> KeySetSource::get_key_set() const
+  const std::set<Key>& KeySetSource::get_key_set() const
   {
     return kys;
   }
@@ -27,7 +27,7 @@ namespace wali
       virtual std::ostream& print( std::ostream& o ) const;
 
       // TODO: probably shouldn't be virtual
-      virtual std::set<Key> get_key_set() const;
+      virtual const std::set<Key>& get_key_set() const;
 
     protected:
       std::set<Key> kys;
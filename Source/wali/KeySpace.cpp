@@ -16,13 +16,109 @@
 
 namespace wali
 {
+  namespace
+  {
+    //
+    // Probes describe a KeySource without allocating one. Each hashes
+    // the same way as the KeySource it describes, so KeySpace::find
+    // can look it up in the keymap directly.
+    //
+    struct StringProbe
+    {
+      const char* s;
+      size_t len;
+      StringProbe( const char* str, size_t n ) : s(str), len(n) {}
+    };
+
+    struct IntProbe
+    {
+      int i;
+      explicit IntProbe( int v ) : i(v) {}
+    };
+
+    struct PairProbe
+    {
+      KeyPair kp;
+      PairProbe( Key k1, Key k2 ) : kp(k1,k2) {}
+    };
+
+    struct SetProbe
+    {
+      const std::set<Key>& kys;
+      explicit SetProbe( const std::set<Key>& ks ) : kys(ks) {}
+    };
 
-  KeySpace::KeySpace()
+    struct ProbeHash
+    {
+      size_t operator()( const StringProbe& p ) const {
+        return hm_hash< const char * >()(p.s);
+      }
+      size_t operator()( const IntProbe& p ) const {
+        return hm_hash< int >()(p.i);
+      }
+      size_t operator()( const PairProbe& p ) const {
+        return hm_hash< KeyPair >()(p.kp);
+      }
+      size_t operator()( const SetProbe& p ) const {
+        return hm_hash< std::set<Key> >()(p.kys);
+      }
+    };
+
+    struct ProbeEqual
+    {
+      bool operator()( const StringProbe& p, const key_src_t& ks ) const {
+        StringSource* src = dynamic_cast< StringSource* >(ks.get_ptr());
+        return src != 0
+          && src->getString().size() == p.len
+          && 0 == memcmp(src->getString().data(), p.s, p.len);
+      }
+      bool operator()( const IntProbe& p, const key_src_t& ks ) const {
+        IntSource* src = dynamic_cast< IntSource* >(ks.get_ptr());
+        return src != 0 && src->getInt() == p.i;
+      }
+      bool operator()( const PairProbe& p, const key_src_t& ks ) const {
+        KeyPairSource* src = dynamic_cast< KeyPairSource* >(ks.get_ptr());
+        return src != 0 && src->get_key_pair() == p.kp;
+      }
+      bool operator()( const SetProbe& p, const key_src_t& ks ) const {
+        KeySetSource* src = dynamic_cast< KeySetSource* >(ks.get_ptr());
+        return src != 0 && src->get_key_set() == p.kys;
+      }
+
+      template< typename Probe >
+      bool operator()( const key_src_t& ks, const Probe& p ) const {
+        return (*this)(p, ks);
+      }
+    };
+  }
+
+  KeySpace::KeySpace() : num_keys(0), num_pinned(0)
   {
   }
 
   KeySpace::~KeySpace()
   {
+    clear();
+  }
+
+  template< typename Probe >
+  Key KeySpace::find( const Probe& probe ) const
+  {
+    ks_hash_map_t::const_iterator it =
+      keymap.find(probe, ProbeHash(), ProbeEqual());
+    return (it == keymap.end()) ? num_keys : it->second;
+  }
+
+  Key KeySpace::insert( key_src_t ks )
+  {
+    Key key = num_keys;
+    if( (key >> chunk_bits) == values.size() ) {
+      values.push_back(new key_src_t[chunk_size]);
+    }
+    values[key >> chunk_bits][key & (chunk_size - 1)] = ks;
+    keymap.insert(std::make_pair(ks,key));
+    ++num_keys;
+    return key;
   }
 
   /**
@@ -39,17 +135,11 @@ namespace wali
   wali_key_t KeySpace::getKey( key_src_t ks )
   {
     ks_hash_map_t::iterator it = keymap.find(ks);
-    wali_key_t key;
     if( it != keymap.end() )
     {
-      key = it->second;
-    }
-    else {
-      key = values.size();
-      keymap.insert(ks,key);
-      values.push_back(ks);
+      return it->second;
     }
-    return key;
+    return insert(ks);
   }
 
   /**
@@ -58,7 +148,11 @@ namespace wali
    */
   Key KeySpace::getKey( const std::string& s )
   {
-    return (s == "") ? WALI_EPSILON : getKey( new StringSource(s) );
+    if( s == "" ) {
+      return WALI_EPSILON;
+    }
+    Key key = find(StringProbe(s.c_str(), s.size()));
+    return (key != num_keys) ? key : insert( new StringSource(s) );
   }
 
   /**
@@ -67,8 +161,11 @@ namespace wali
    */
   Key KeySpace::getKey( const char* s )
   {
-    return ((s == NULL) || (strlen(s) == 0)) ?
-      WALI_EPSILON : getKey( new StringSource(s) );
+    if( (s == NULL) || (s[0] == '\0') ) {
+      return WALI_EPSILON;
+    }
+    Key key = find(StringProbe(s, strlen(s)));
+    return (key != num_keys) ? key : insert( new StringSource(s) );
   }
 
   /**
@@ -77,7 +174,8 @@ namespace wali
    */
   Key KeySpace::getKey( int i )
   {
-    return getKey( new IntSource(i) );
+    Key key = find(IntProbe(i));
+    return (key != num_keys) ? key : insert( new IntSource(i) );
   }
 
   /**
@@ -86,13 +184,33 @@ namespace wali
    */
   Key KeySpace::getKey( Key k1, Key k2 )
   {
-    return getKey( new KeyPairSource(k1,k2) );
+    Key key = find(PairProbe(k1,k2));
+    return (key != num_keys) ? key : insert( new KeyPairSource(k1,k2) );
   }
 
   // @author Amanda Burton  
   wali_key_t KeySpace::getKey( std::set<wali_key_t> kys )
   {
-    return getKey( new KeySetSource(kys) );
+    Key key = find(SetProbe(kys));
+    return (key != num_keys) ? key : insert( new KeySetSource(kys) );
+  }
+
+  void KeySpace::getKeys( const std::vector<std::string>& names,
+                          std::vector<Key>& keys )
+  {
+    reserve(num_keys + names.size());
+    keys.reserve(keys.size() + names.size());
+    for( std::vector<std::string>::const_iterator it = names.begin();
+         it != names.end(); ++it )
+    {
+      keys.push_back(getKey(*it));
+    }
+  }
+
+  void KeySpace::reserve( size_t n )
+  {
+    keymap.reserve(n);
+    values.reserve((n + chunk_size - 1) >> chunk_bits);
   }
 
 
@@ -110,9 +228,9 @@ namespace wali
   key_src_t KeySpace::getKeySource( Key key )
   {
     key_src_t ksrc = 0;
-    if( key < size() )
+    if( key < num_keys )
     {
-      ksrc = values[key];
+      ksrc = values[key >> chunk_bits][key & (chunk_size - 1)];
     }
     return ksrc;
   }
@@ -124,10 +242,15 @@ namespace wali
   void KeySpace::clear()
   {
     keymap.clear();
+    for( size_t i = 0 ; i < values.size() ; ++i ) {
+      delete [] values[i];
+    }
     {
-      ks_vector_t TEMP;
+      std::vector< key_src_t* > TEMP;
       TEMP.swap(values);
     }
+    num_keys = 0;
+    num_pinned = 0;
     assert( keymap.size() == 0 );
     assert( values.size() == 0 );
   }
@@ -137,7 +260,36 @@ namespace wali
    */
   size_t KeySpace::size()
   {
-    return values.size();
+    return num_keys;
+  }
+
+  void KeySpace::releaseKeys( size_t mark )
+  {
+    if( mark < num_pinned ) {
+      mark = num_pinned;
+    }
+    for( ; num_keys > mark ; --num_keys ) {
+      Key key = num_keys - 1;
+      key_src_t& ks = values[key >> chunk_bits][key & (chunk_size - 1)];
+      keymap.erase(ks);
+      ks = 0;
+    }
+    // Keep one spare chunk so a scope that ends near a chunk boundary
+    // does not reallocate on every use
+    size_t chunks_used = (num_keys + chunk_size - 1) >> chunk_bits;
+    while( values.size() > chunks_used + 1 ) {
+      delete [] values.back();
+      values.pop_back();
+    }
+  }
+
+  Key KeySpace::pinKey( Key key )
+  {
+    assert( key < num_keys );
+    if( key >= num_pinned ) {
+      num_pinned = key + 1;
+    }
+    return key;
   }
 
   /**
@@ -175,7 +327,12 @@ namespace wali
   std::string KeySpace::key2str( Key key )
   {
     key_src_t ksrc = getKeySource(key);
-    if( ksrc.is_valid() ) {
+    // Most keys are strings; skip the ostringstream in toString()
+    StringSource* str = dynamic_cast< StringSource* >(ksrc.get_ptr());
+    if( str != 0 ) {
+      return str->getString();
+    }
+    else if( ksrc.is_valid() ) {
       return ksrc->toString();
     }
     else {
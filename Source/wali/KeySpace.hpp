@@ -6,14 +6,20 @@
  */
 
 #include "wali/Common.hpp"
-#include "wali/HashMap.hpp"
 #include "wali/KeySource.hpp"   //! defines hm_hash<wali::KeySource*>
+#include "wali/util/unordered_map.hpp"
+#include <set>
+#include <string>
 #include <vector>
 
 namespace wali
 {
   /**
    * @class KeySpace
+   *
+   * The string, int, pair, and set versions of getKey look up an
+   * existing key without allocating a KeySource; one is only created
+   * when the key is new.
    */
   class KeySpace
   {
@@ -83,6 +89,25 @@ namespace wali
      */
     size_t size();
 
+    /**
+     * Forgets every key numbered mark or higher, so that their numbers
+     * (and, once nothing else refers to them, their KeySources) are
+     * reused. Keys below mark are unaffected. Use size() to get a
+     * mark before creating the keys to be released.
+     *
+     * Nothing may still use a released key: WFAs, WPDSs, etc. that
+     * were built with them must be gone (or never used again).
+     */
+    void releaseKeys( size_t mark );
+
+    /**
+     * Marks key as permanent: releaseKeys will not release it, nor
+     * (since keys are released from the top down) any key below it.
+     * This is for keys the library keeps in statics, which may first
+     * be created while a KeyScope is active. Returns key.
+     */
+    wali::Key pinKey( wali::Key key );
+
     // @author Amanda Burton
     /** 
      * Wrapper method for creating a KeySetSource and
@@ -90,6 +115,19 @@ namespace wali
      */
     wali::Key getKey( std::set<wali::Key> kys );
 
+    /**
+     * Appends the key of each string in names to keys, creating the
+     * ones that do not exist yet
+     */
+    void getKeys( const std::vector<std::string>& names,
+                  std::vector<wali::Key>& keys );
+
+    /**
+     * Makes room for n keys in total, so that creating them does not
+     * rehash the KeySpace
+     */
+    void reserve( size_t n );
+
     /**
      * Helper method that looks up the key and calls KeySource::print
      *
@@ -110,21 +148,47 @@ namespace wali
     std::string key2str( wali::Key key );
 
   protected:
-    typedef wali::HashMap< key_src_t, wali::Key > ks_hash_map_t;
-    typedef std::vector< key_src_t > ks_vector_t;
+    typedef wali::util::unordered_map< key_src_t, wali::Key,
+                                       hm_hash< key_src_t >,
+                                       hm_equal< key_src_t > > ks_hash_map_t;
+
+    /// values is stored in chunks of 2^chunk_bits KeySources
+    static const size_t chunk_bits = 12;
+    static const size_t chunk_size = size_t(1) << chunk_bits;
 
     /** 
      * keymap maps key_src_t to wali::Key. The wali::Key is
-     * an index into the vector values
+     * an index into values
      */
     ks_hash_map_t keymap;
 
     /**
      * wali::Key's are guaranteed to be unique w.r.t. this KeySpace
-     * because they are indexes into the vector values. KeySource's
-     * are retrieved by a lookup into values
+     * because they are indexes into values. KeySource's are retrieved
+     * by a lookup into values.
+     *
+     * values is split into fixed-size chunks that never move, so adding
+     * a key never copies the existing key_src_t's.
      */
-    ks_vector_t values;
+    std::vector< key_src_t* > values;
+
+    /// The number of keys in use
+    size_t num_keys;
+
+    /// releaseKeys keeps at least this many keys (see pinKey)
+    size_t num_pinned;
+
+    /// Finds the key of a probe (see KeySpace.cpp) or returns
+    /// num_keys if there is none
+    template< typename Probe >
+    wali::Key find( const Probe& probe ) const;
+
+    /// Adds ks, which must not already have a key
+    wali::Key insert( key_src_t ks );
+
+  private:
+    KeySpace( const KeySpace& );
+    KeySpace& operator=( const KeySpace& );
 
   }; // class KeySpace
 
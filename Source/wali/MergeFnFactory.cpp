@@ -12,5 +12,11 @@ namespace wali
 
   MergeFnFactory::~MergeFnFactory() {}
 
+  merge_fn_t MergeFnFactory::declarePure( merge_fn_t mf )
+  {
+    mf->setPure(true);
+    return mf;
+  }
+
 }
 
@@ -20,6 +20,15 @@ namespace wali
 
       virtual wali::merge_fn_t getMergeFn( std::string s ) = 0;
 
+    protected:
+      /**
+       * Marks mf as pure (see IMergeFn::isPure) and returns it, for use
+       * by factories whose merge functions qualify:
+       *
+       *   return declarePure(new MyMergeFn(...));
+       */
+      static wali::merge_fn_t declarePure( wali::merge_fn_t mf );
+
   }; // class MergeFnFactory
 
 } // namespace wali
@@ -59,6 +59,28 @@ bool Reach::equal( SemElem* se ) const
   return ( rhs && isreached == rhs->isreached );
 }
 
+void Reach::extend_many( size_t n, sem_elem_t const * lhs,
+                         sem_elem_t const * rhs, sem_elem_t * out )
+{
+  sem_elem_t O = one(), Z = zero();
+  for (size_t i = 0; i < n; ++i) {
+    bool reached = static_cast< Reach* >(lhs[i].get_ptr())->isreached
+                   && static_cast< Reach* >(rhs[i].get_ptr())->isreached;
+    out[i] = reached ? O : Z;
+  }
+}
+
+void Reach::combine_many( size_t n, sem_elem_t const * lhs,
+                          sem_elem_t const * rhs, sem_elem_t * out )
+{
+  sem_elem_t O = one(), Z = zero();
+  for (size_t i = 0; i < n; ++i) {
+    bool reached = static_cast< Reach* >(lhs[i].get_ptr())->isreached
+                   || static_cast< Reach* >(rhs[i].get_ptr())->isreached;
+    out[i] = reached ? O : Z;
+  }
+}
+
 std::ostream & Reach::print( std::ostream & o ) const
 {
   return (isreached) ? o << "ONE" : o << "ZERO";
@@ -30,6 +30,13 @@ class Reach : public SemElem
 
     bool equal( SemElem* rhs ) const;
 
+    // Avoids a virtual call per pair
+    void extend_many( size_t n, sem_elem_t const * lhs,
+                      sem_elem_t const * rhs, sem_elem_t * out );
+
+    void combine_many( size_t n, sem_elem_t const * lhs,
+                       sem_elem_t const * rhs, sem_elem_t * out );
+
     std::ostream & print( std::ostream & o ) const;
 
     sem_elem_t from_string( const std::string& s ) const;
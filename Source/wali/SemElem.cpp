@@ -81,7 +81,7 @@ namespace wali
     // we simply see if the combine is equal to the passed in parameter.
     // If not, we say that our new "delta" or "difference" is the 
     // combined weight
-    if( se->equal( rp.first ) ) {
+    if( se == rp.first.get_ptr() || se->equal( rp.first ) ) {
       rp.second = zero();
     }
     else {
@@ -109,6 +109,26 @@ namespace wali
     return wn;
   }
 
+  void SemElem::extend_many( size_t n,
+                             sem_elem_t const * lhs,
+                             sem_elem_t const * rhs,
+                             sem_elem_t * out )
+  {
+    for( size_t i = 0 ; i < n ; i++ ) {
+      out[i] = lhs[i]->extend(rhs[i]);
+    }
+  }
+
+  void SemElem::combine_many( size_t n,
+                              sem_elem_t const * lhs,
+                              sem_elem_t const * rhs,
+                              sem_elem_t * out )
+  {
+    for( size_t i = 0 ; i < n ; i++ ) {
+      out[i] = lhs[i]->combine(rhs[i]);
+    }
+  }
+
 
 #if defined(__GNUC__)
   std::ostream &
@@ -164,6 +164,30 @@ namespace wali
        */
       virtual sem_elem_t star();
 
+      /**
+       *  Batched extend: out[i] = lhs[i] EXTEND rhs[i] for 0 <= i < n.
+       *  Call this on any element of the domain (e.g., lhs[0]); it
+       *  does not use "this" otherwise. out may be the same array as
+       *  lhs or rhs.
+       *
+       *  The default implementation just loops over extend(). Domains
+       *  that can do better for a whole batch (e.g., by sharing work
+       *  between pairs with a common operand) can override it.
+       */
+      virtual void extend_many( size_t n,
+                                sem_elem_t const * lhs,
+                                sem_elem_t const * rhs,
+                                sem_elem_t * out );
+
+      /**
+       *  Batched combine: out[i] = lhs[i] COMBINE rhs[i] for 0 <= i < n.
+       *  @see extend_many
+       */
+      virtual void combine_many( size_t n,
+                                 sem_elem_t const * lhs,
+                                 sem_elem_t const * rhs,
+                                 sem_elem_t * out );
+
       /** 
        * Wrapper method for extend that will remove the ref_ptr
        * to make the call to the user's code. 
@@ -6,6 +6,7 @@
 #include "wali/ShortestPathWorklist.hpp"
 #include "wali/ShortestPathSemiring.hpp"
 #include "wali/wfa/Trans.hpp"
+#include "wali/witness/Witness.hpp"
 #include <climits>
 #include <cstdlib>
 #include <iostream>
@@ -21,26 +22,41 @@ namespace wali
   {
   }
 
-  int ShortestPathWorklist::doRankOf( sem_elem_t a ) const
+  namespace
   {
-    ShortestPathSemiring * p = dynamic_cast<ShortestPathSemiring*>(a.get_ptr());
-    if (p == NULL) {
-      std::cout << "Error: weight not a shortestpathsemiring. It is: ";
-      if (a != NULL) {
-        std::cout << typeid(*a).name() << "\n";
-      }
-      else {
-        std::cout << "null\n";
+    ShortestPathSemiring * distanceOf( sem_elem_t a )
+    {
+      ShortestPathSemiring * p = dynamic_cast<ShortestPathSemiring*>(a.get_ptr());
+      if (p == NULL) {
+        std::cout << "Error: weight not a shortestpathsemiring. It is: ";
+        if (a != NULL) {
+          std::cout << typeid(*a).name() << "\n";
+        }
+        else {
+          std::cout << "null\n";
+        }
+        std::exit(1);
       }
-      std::exit(1);
+      return p;
     }
-    
-    unsigned int rank = p->getNum();
+  }
+
+  int ShortestPathWorklist::doRankOf( sem_elem_t a ) const
+  {
+    unsigned int rank = distanceOf(a)->getNum();
     if (rank > INT_MAX) {
       rank = INT_MAX;
     }
     return rank;
   }
 
-}
+  size_t ShortestPathRank::operator()( const wfa::ITrans* t ) const
+  {
+    witness::Witness * w = dynamic_cast<witness::Witness*>(t->weight().get_ptr());
+    if (w != NULL) {
+      return distanceOf(w->weight())->getNum();
+    }
+    return distanceOf(t->weight())->getNum();
+  }
 
+}
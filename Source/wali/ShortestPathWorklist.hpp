@@ -7,6 +7,7 @@
 
 #include "wali/Common.hpp"
 #include "wali/RankedWorklist.hpp"
+#include "wali/BucketWorklist.hpp"
 
 namespace wali
 {
@@ -23,6 +24,35 @@ namespace wali
 
   }; // class PriorityWorklist
 
+
+  /*!
+   * The rank of a transition whose weight (or the weight of whose
+   * witness) is a ShortestPathSemiring: its distance.
+   */
+  struct ShortestPathRank
+  {
+    size_t operator()( const wfa::ITrans* t ) const;
+  };
+
+  /*!
+   * A ShortestPathWorklist backed by a bucket queue; best when path
+   * lengths are small integers.
+   */
+  class ShortestPathBucketWorklist : public BucketWorklist<ShortestPathRank>
+  {
+    public:
+      ShortestPathBucketWorklist( size_t width = 1, size_t max_buckets = 1 << 16 )
+        : BucketWorklist<ShortestPathRank>(width, max_buckets)
+      {}
+  };
+
+  /*!
+   * A ShortestPathWorklist backed by a radix heap; best when path
+   * lengths spread over a large range.
+   */
+  class ShortestPathRadixWorklist : public RadixHeapWorklist<ShortestPathRank>
+  {};
+
 } // namespace wali
 
 #endif  // wali_SHORTEST_PATH_WORKLIST_GUARD
@@ -36,7 +36,7 @@ namespace wali
     return o << s;
   }
 
-  std::string StringSource::getString() const
+  const std::string& StringSource::getString() const
   {
     return s;
   }
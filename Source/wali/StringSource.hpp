@@ -29,7 +29,7 @@ namespace wali
 
       virtual std::ostream& print( std::ostream& o ) const;
 
-      std::string getString() const;
+      const std::string& getString() const;
 
     private:
       const std::string s;
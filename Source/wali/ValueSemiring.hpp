@@ -0,0 +1,145 @@
+#ifndef wali_VALUE_SEMIRING_GUARD
+#define wali_VALUE_SEMIRING_GUARD 1
+
+/**
+ * Value-semantics versions of the simple semirings that ship with WALi,
+ * for use with the templated solvers (see wpds::ValueWPDS).
+ *
+ * A value semiring is a class with no state that provides
+ *
+ *   typedef ... value_type;        // copyable, cheap to pass by value
+ *   static value_type one();
+ *   static value_type zero();
+ *   static value_type extend( value_type a, value_type b );
+ *   static value_type combine( value_type a, value_type b );
+ *   static bool equal( value_type a, value_type b );
+ *
+ * and, to move between it and the SemElem-based solvers,
+ *
+ *   static sem_elem_t to_sem_elem( value_type v );
+ *   static value_type from_sem_elem( sem_elem_t se );
+ *
+ * All of the functions are inline and non-virtual, and weights are never
+ * heap-allocated or reference counted.
+ */
+
+#include "wali/Common.hpp"
+#include "wali/Reach.hpp"
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/LongestSaturatingPathSemiring.hpp"
+
+namespace wali
+{
+  /**
+   * @class ReachValue
+   * @brief Reach as a bool
+   */
+  struct ReachValue
+  {
+    typedef bool value_type;
+
+    static value_type one() { return true; }
+    static value_type zero() { return false; }
+
+    static value_type extend( value_type a, value_type b ) { return a && b; }
+    static value_type combine( value_type a, value_type b ) { return a || b; }
+    static bool equal( value_type a, value_type b ) { return a == b; }
+
+    static sem_elem_t to_sem_elem( value_type v ) {
+      return v ? Reach(true).one() : Reach(true).zero();
+    }
+
+    static value_type from_sem_elem( sem_elem_t se ) {
+      return se->equal(Reach(true).one());
+    }
+  };
+
+
+  /**
+   * @class ShortestPathValue
+   * @brief ShortestPathSemiring as an unsigned int, with UINT_MAX as zero
+   */
+  struct ShortestPathValue
+  {
+    typedef unsigned int value_type;
+
+    static value_type one() { return 0u; }
+    static value_type zero() { return (unsigned int)(-1); }
+
+    static value_type extend( value_type a, value_type b ) {
+      if( a == zero() || b == zero() ) {
+        return zero();
+      }
+      return a + b;
+    }
+
+    static value_type combine( value_type a, value_type b ) {
+      return (a < b) ? a : b;
+    }
+
+    static bool equal( value_type a, value_type b ) { return a == b; }
+
+    static sem_elem_t to_sem_elem( value_type v ) {
+      return new ShortestPathSemiring(v);
+    }
+
+    static value_type from_sem_elem( sem_elem_t se ) {
+      ShortestPathSemiring * sp = dynamic_cast<ShortestPathSemiring*>(se.get_ptr());
+      assert(sp);
+      return sp->getNum();
+    }
+  };
+
+
+  /**
+   * @class LongestSaturatingPathValue
+   * @brief LongestSaturatingPathSemiring as an unsigned int
+   *
+   * The saturation bound is a template parameter rather than a
+   * constructor argument, since value semirings have no state.
+   */
+  template< unsigned int Biggest >
+  struct LongestSaturatingPathValue
+  {
+    typedef unsigned int value_type;
+
+    static value_type one() { return 0u; }
+    static value_type zero() { return (unsigned int)(-1); }
+
+    static value_type extend( value_type a, value_type b ) {
+      if( a == zero() || b == zero() ) {
+        return zero();
+      }
+      if( a + b < a || a + b > Biggest ) {
+        return Biggest;
+      }
+      return a + b;
+    }
+
+    static value_type combine( value_type a, value_type b ) {
+      if( a == zero() ) {
+        return b;
+      }
+      if( b == zero() ) {
+        return a;
+      }
+      return (a < b) ? b : a;
+    }
+
+    static bool equal( value_type a, value_type b ) { return a == b; }
+
+    static sem_elem_t to_sem_elem( value_type v ) {
+      return new LongestSaturatingPathSemiring(v, Biggest);
+    }
+
+    static value_type from_sem_elem( sem_elem_t se ) {
+      LongestSaturatingPathSemiring * lp =
+        dynamic_cast<LongestSaturatingPathSemiring*>(se.get_ptr());
+      assert(lp);
+      return lp->getNum();
+    }
+  };
+
+} // namespace wali
+
+#endif  // wali_VALUE_SEMIRING_GUARD
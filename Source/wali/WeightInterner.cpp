@@ -0,0 +1,102 @@
+#include "wali/WeightInterner.hpp"
+
+#include <algorithm>
+
+namespace wali
+{
+  namespace
+  {
+    /// Don't bother sweeping tables smaller than this
+    const size_t min_sweep_size = 1024;
+  }
+
+  WeightInterner::WeightInterner() :
+    sweep_at(min_sweep_size),
+    lookups(0),
+    hits(0)
+  {
+  }
+
+  sem_elem_t WeightInterner::intern( sem_elem_t w )
+  {
+    if( w.is_empty() ) {
+      return w;
+    }
+    ++lookups;
+    std::pair< table_t::iterator, bool > ins = table.insert(w);
+    if( !ins.second ) {
+      ++hits;
+      return *ins.first;
+    }
+    if( table.size() >= sweep_at ) {
+      sweep();
+      sweep_at = std::max(min_sweep_size, 2 * table.size());
+    }
+    return w;
+  }
+
+  bool WeightInterner::isCanonical( sem_elem_t w ) const
+  {
+    table_t::const_iterator it = table.find(w);
+    return it != table.end() && it->get_ptr() == w.get_ptr();
+  }
+
+  size_t WeightInterner::sweep()
+  {
+    size_t dropped = 0;
+    table_t::iterator it = table.begin();
+    while( it != table.end() ) {
+      // The table's own reference is the only one left
+      if( (*it)->count == 1 ) {
+        it = table.erase(it);
+        ++dropped;
+      }
+      else {
+        ++it;
+      }
+    }
+    return dropped;
+  }
+
+  void WeightInterner::clear()
+  {
+    table.clear();
+    sweep_at = min_sweep_size;
+  }
+
+  size_t WeightInterner::size() const
+  {
+    return table.size();
+  }
+
+  size_t WeightInterner::numLookups() const
+  {
+    return lookups;
+  }
+
+  size_t WeightInterner::numHits() const
+  {
+    return hits;
+  }
+
+
+  InterningWeightFactory::InterningWeightFactory( WeightFactory & b,
+                                                  weight_interner_t i ) :
+    base(b),
+    interner(i.is_valid() ? i : weight_interner_t(new WeightInterner()))
+  {
+  }
+
+  InterningWeightFactory::~InterningWeightFactory() {}
+
+  sem_elem_t InterningWeightFactory::getWeight( std::string s )
+  {
+    return interner->intern(base.getWeight(s));
+  }
+
+  weight_interner_t InterningWeightFactory::getInterner() const
+  {
+    return interner;
+  }
+
+} // namespace wali
@@ -0,0 +1,104 @@
+#ifndef wali_WEIGHT_INTERNER_GUARD
+#define wali_WEIGHT_INTERNER_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Countable.hpp"
+#include "wali/SemElem.hpp"
+#include "wali/WeightFactory.hpp"
+#include "wali/util/unordered_set.hpp"
+
+#include <string>
+
+namespace wali
+{
+  /**
+   * @class WeightInterner
+   * @brief Maps structurally-equal weights to one canonical instance
+   *
+   * intern(w) returns the weight already in the table that is equal()
+   * to w, or adds w and returns it. Weights that went through the same
+   * interner can then be compared with ==, and duplicates share memory.
+   * The weight type must implement SemElem::hash() consistently with
+   * equal(); the default hash() aborts.
+   *
+   * The table is weak in the sense that it does not keep weights alive
+   * by itself: an entry whose only remaining reference is the table's
+   * is dropped by sweep(). intern() sweeps automatically whenever the
+   * table has doubled in size since the last sweep, so the table stays
+   * proportional to the number of live canonical weights.
+   *
+   * Like ref_ptr, this class is not thread safe.
+   *
+   * @see WPDS::setWeightInterner
+   */
+  class WeightInterner : public Countable
+  {
+    public:
+      WeightInterner();
+
+      /**
+       * @return the canonical weight equal to w (w itself if there was
+       * none yet). Null is returned unchanged.
+       */
+      sem_elem_t intern( sem_elem_t w );
+
+      /**
+       * @return true if w is the canonical instance of its value
+       */
+      bool isCanonical( sem_elem_t w ) const;
+
+      /**
+       * Drop every weight that nothing outside the table refers to.
+       * @return the number of weights dropped
+       */
+      size_t sweep();
+
+      void clear();
+
+      size_t size() const;
+      size_t numLookups() const;
+      size_t numHits() const;
+
+    private:
+      typedef util::unordered_set< sem_elem_t,
+                                   SemElemRefPtrHash,
+                                   SemElemRefPtrEqual > table_t;
+
+      table_t table;
+      size_t sweep_at;
+      size_t lookups;
+      size_t hits;
+
+  }; // class WeightInterner
+
+  typedef ref_ptr<WeightInterner> weight_interner_t;
+
+
+  /**
+   * @class InterningWeightFactory
+   * @brief A WeightFactory that interns what another factory returns
+   *
+   * Useful when weights are read from a file (see UserFactoryHandler),
+   * where the same weight string tends to appear on many rules.
+   */
+  class InterningWeightFactory : public WeightFactory
+  {
+    public:
+      InterningWeightFactory( WeightFactory & base,
+                              weight_interner_t interner = 0 );
+
+      virtual ~InterningWeightFactory();
+
+      virtual sem_elem_t getWeight( std::string s );
+
+      weight_interner_t getInterner() const;
+
+    private:
+      WeightFactory & base;
+      weight_interner_t interner;
+
+  }; // class InterningWeightFactory
+
+} // namespace wali
+
+#endif  // wali_WEIGHT_INTERNER_GUARD
@@ -0,0 +1,220 @@
+#include "wali/Common.hpp"
+
+namespace wali
+{
+  ////////////////////////////////////////////////////////////
+  // BucketWorklist
+
+  template< typename Rank >
+  BucketWorklist<Rank>::BucketWorklist( size_t w, size_t max, Rank const & r )
+    : Worklist<wfa::ITrans>()
+    , rank(r)
+    , width(w)
+    , max_buckets(max)
+    , cursor(0)
+    , count(0)
+  {
+    assert(width > 0);
+  }
+
+  template< typename Rank >
+  BucketWorklist<Rank>::~BucketWorklist()
+  {
+    clear();
+  }
+
+  template< typename Rank >
+  bool BucketWorklist<Rank>::put( wfa::ITrans *t )
+  {
+    if( t->marked() ) {
+      return false;
+    }
+    t->mark();
+    size_t r = rank(t);
+    size_t b = r / width;
+    if( b >= max_buckets ) {
+      overflow.insert(std::make_pair(r, t));
+    }
+    else {
+      if( b >= buckets.size() ) {
+        buckets.resize(b + 1);
+      }
+      buckets[b].push_back(t);
+      if( b < cursor ) {
+        cursor = b;
+      }
+    }
+    count++;
+    return true;
+  }
+
+  template< typename Rank >
+  wfa::ITrans * BucketWorklist<Rank>::get()
+  {
+    assert(count > 0);
+    wfa::ITrans * t;
+    while( cursor < buckets.size() && buckets[cursor].empty() ) {
+      cursor++;
+    }
+    if( cursor < buckets.size() ) {
+      t = buckets[cursor].back();
+      buckets[cursor].pop_back();
+    }
+    else {
+      typename overflow_t::iterator i = overflow.begin();
+      assert(i != overflow.end());
+      t = i->second;
+      overflow.erase(i);
+    }
+    count--;
+    t->unmark();
+    return t;
+  }
+
+  template< typename Rank >
+  bool BucketWorklist<Rank>::empty() const
+  {
+    return count == 0;
+  }
+
+  template< typename Rank >
+  size_t BucketWorklist<Rank>::size() const
+  {
+    return count;
+  }
+
+  template< typename Rank >
+  void BucketWorklist<Rank>::clear()
+  {
+    // unmark everything
+    for( size_t b = 0; b < buckets.size(); b++ ) {
+      for( size_t i = 0; i < buckets[b].size(); i++ ) {
+        buckets[b][i]->unmark();
+      }
+      buckets[b].clear();
+    }
+    typename overflow_t::iterator i = overflow.begin();
+    typename overflow_t::iterator iEND = overflow.end();
+    for( ; i != iEND ; i++ ) {
+      i->second->unmark();
+    }
+    overflow.clear();
+    cursor = 0;
+    count = 0;
+  }
+
+
+  ////////////////////////////////////////////////////////////
+  // RadixHeapWorklist
+
+  template< typename Rank >
+  RadixHeapWorklist<Rank>::RadixHeapWorklist()
+    : Worklist<wfa::ITrans>()
+    , last(0)
+    , count(0)
+  {
+  }
+
+  template< typename Rank >
+  RadixHeapWorklist<Rank>::~RadixHeapWorklist()
+  {
+    clear();
+  }
+
+  template< typename Rank >
+  size_t RadixHeapWorklist<Rank>::bucketOf( size_t r ) const
+  {
+    size_t x = r ^ last;
+    size_t bits = 0;
+    while( x != 0 ) {
+      x >>= 1;
+      bits++;
+    }
+    return bits;
+  }
+
+  template< typename Rank >
+  bool RadixHeapWorklist<Rank>::put( wfa::ITrans *t )
+  {
+    if( t->marked() ) {
+      return false;
+    }
+    t->mark();
+    size_t r = rank(t);
+    if( r < last ) {
+      r = last;
+    }
+    buckets[bucketOf(r)].push_back(std::make_pair(r, t));
+    count++;
+    return true;
+  }
+
+  template< typename Rank >
+  wfa::ITrans * RadixHeapWorklist<Rank>::get()
+  {
+    assert(count > 0);
+    if( buckets[0].empty() ) {
+      size_t b = 1;
+      while( buckets[b].empty() ) {
+        b++;
+        assert(b < num_buckets);
+      }
+      // Every rank in bucket b shares the bits of last above bit b-1 and
+      // is larger than last, so after moving last up to the least of
+      // them each one lands in a lower bucket.
+      bucket_t & from = buckets[b];
+      size_t least = from[0].first;
+      for( size_t i = 1; i < from.size(); i++ ) {
+        if( from[i].first < least ) {
+          least = from[i].first;
+        }
+      }
+      last = least;
+      bucket_t moving;
+      moving.swap(from);
+      for( size_t i = 0; i < moving.size(); i++ ) {
+        buckets[bucketOf(moving[i].first)].push_back(moving[i]);
+      }
+    }
+    wfa::ITrans * t = buckets[0].back().second;
+    buckets[0].pop_back();
+    if( --count == 0 ) {
+      last = 0;
+    }
+    t->unmark();
+    return t;
+  }
+
+  template< typename Rank >
+  bool RadixHeapWorklist<Rank>::empty() const
+  {
+    return count == 0;
+  }
+
+  template< typename Rank >
+  size_t RadixHeapWorklist<Rank>::size() const
+  {
+    return count;
+  }
+
+  template< typename Rank >
+  void RadixHeapWorklist<Rank>::clear()
+  {
+    // unmark everything
+    for( size_t b = 0; b < num_buckets; b++ ) {
+      for( size_t i = 0; i < buckets[b].size(); i++ ) {
+        buckets[b][i].second->unmark();
+      }
+      buckets[b].clear();
+    }
+    last = 0;
+    count = 0;
+  }
+
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
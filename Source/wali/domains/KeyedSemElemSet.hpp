@@ -5,10 +5,13 @@
 
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include "wali/util/unordered_map.hpp"
 #include "wali/util/unordered_set.hpp"
+#include <algorithm>
 #include <limits>
 #include <typeinfo>
+#include <vector>
 
 #include <iostream>
 
@@ -64,19 +67,37 @@ namespace wali
                                         SemElemRefPtrHash, SemElemRefPtrEqual>
               BackingMap;
 
-      typedef BackingMap::const_iterator const_iterator;
+      /// One key and its weight. Sets store these in a flat vector sorted
+      /// by key_hash, with at most one entry per key.
+      struct Entry
+      {
+        sem_elem_t first;
+        sem_elem_t second;
+        size_t key_hash;
+
+        Entry(sem_elem_t key, sem_elem_t weight)
+          : first(key)
+          , second(weight)
+          , key_hash(key->hash())
+        {}
+
+        bool operator< (Entry const & other) const {
+          return key_hash < other.key_hash;
+        }
+      };
+
+      typedef std::vector<Entry> Entries;
+      typedef Entries::const_iterator const_iterator;
 
 
       static
       size_t
-      get_hash(BackingMap const & m) {
+      get_hash(Entries const & entries) {
         size_t xor_part = 0u;
         size_t sum_part = 0u;
 
-        for (BackingMap::const_iterator it = m.begin();
-             it != m.end(); ++it)
-        {
-          size_t elem_hash = it->first->hash() + 17*it->second->hash();
+        for (const_iterator it = entries.begin(); it != entries.end(); ++it) {
+          size_t elem_hash = it->key_hash + 17*it->second->hash();
           xor_part ^= elem_hash;
           sum_part += elem_hash;
         }
@@ -85,31 +106,75 @@ namespace wali
 
 
       static
-      BackingMap
-      remove_zeroes(BackingMap m)
+      bool
+      is_zero_entry(sem_elem_t guard, sem_elem_t weight)
       {
-        for (BackingMap::const_iterator it = m.begin();
-             it != m.end(); /*nothing*/ )
-        {
-          sem_elem_t guard = it->first;
-          sem_elem_t weight = it->second;
+        return guard->equal(guard->zero())
+          || weight->equal(weight->zero());
+      }
 
-          if (guard->equal(guard->zero())
-              || weight->equal(weight->zero()))
-          {
-            it = m.erase(it);
+
+      /// Sorts 'entries' by key hash, combines the weights of entries with
+      /// equal keys, and drops entries that are zero.
+      static
+      void
+      normalize(Entries & entries)
+      {
+        std::stable_sort(entries.begin(), entries.end());
+
+        Entries::iterator out = entries.begin();
+        Entries::iterator run = entries.begin();
+        while (run != entries.end()) {
+          Entries::iterator run_end = run;
+          while (run_end != entries.end() && run_end->key_hash == run->key_hash) {
+            ++run_end;
           }
-          else {
-            ++it;
+
+          // Keys in this run that are already in [run_out, out) are merged
+          Entries::iterator run_out = out;
+          for (Entries::iterator e = run; e != run_end; ++e) {
+            Entries::iterator same = run_out;
+            while (same != out && !same->first->equal(e->first)) {
+              ++same;
+            }
+            if (same == out) {
+              *out++ = *e;
+            }
+            else {
+              same->second = same->second->combine(e->second);
+            }
           }
+          run = run_end;
         }
-        return m;
+        entries.erase(out, entries.end());
+
+        out = entries.begin();
+        for (Entries::iterator e = entries.begin(); e != entries.end(); ++e) {
+          if (!is_zero_entry(e->first, e->second)) {
+            *out++ = *e;
+          }
+        }
+        entries.erase(out, entries.end());
+      }
+
+
+      static
+      boost::shared_ptr<Entries const>
+      entries_of(BackingMap const & m)
+      {
+        boost::shared_ptr<Entries> entries(new Entries());
+        entries->reserve(m.size());
+        for (BackingMap::const_iterator it = m.begin(); it != m.end(); ++it) {
+          entries->push_back(Entry(it->first, it->second));
+        }
+        normalize(*entries);
+        return entries;
       }
       
 
       KeyedSemElemSet(BackingMap const & m)
-        : map_(remove_zeroes(m))
-        , hash_(get_hash(map_))
+        : entries_(entries_of(m))
+        , hash_(get_hash(*entries_))
       {
         assert(m.size() > 0u);
         one_key_ = m.begin()->first->one();
@@ -119,29 +184,43 @@ namespace wali
       KeyedSemElemSet(BackingMap const & m,
                       sem_elem_t example_key,
                       sem_elem_t example_value)
-        : map_(remove_zeroes(m))
+        : entries_(entries_of(m))
         , one_key_(example_key->one())
         , one_value_(example_value->one())
-        , hash_(get_hash(map_))
+        , hash_(get_hash(*entries_))
       {}
 
       std::pair<const_iterator, const_iterator>
       equal_range(sem_elem_t key) const {
-        return map_.equal_range(key);
+        Entry probe(key, key);
+        const_iterator it = std::lower_bound(begin(), end(), probe);
+        for (; it != end() && it->key_hash == probe.key_hash; ++it) {
+          if (it->first->equal(key)) {
+            return std::make_pair(it, it + 1);
+          }
+        }
+        return std::make_pair(end(), end());
       }
 
       const_iterator
       begin() const {
-        return map_.begin();
+        return entries_->begin();
       }
 
       const_iterator
       end() const {
-        return map_.end();
+        return entries_->end();
       }
 
       size_t size() const {
-        return map_.size();
+        return entries_->size();
+      }
+
+      /// Returns whether this and 'other' share their storage, e.g. because
+      /// one is the result of combining the other with something that added
+      /// nothing to it
+      bool shares_storage_with(KeyedSemElemSet const & other) const {
+        return entries_ == other.entries_;
       }
       
       sem_elem_t one() const {
@@ -159,75 +238,114 @@ namespace wali
         KeyedSemElemSet * that = dynamic_cast<KeyedSemElemSet*>(se);
         assert(that);
 
-        BackingMap m;
+        boost::shared_ptr<Entries> entries(new Entries());
 
-        for (BackingMap::const_iterator this_guard = this->map_.begin();
-             this_guard != this->map_.end(); ++this_guard)
+        for (const_iterator this_guard = this->begin();
+             this_guard != this->end(); ++this_guard)
         {
-          for (BackingMap::const_iterator that_guard = that->map_.begin();
-               that_guard != that->map_.end(); ++that_guard)
+          for (const_iterator that_guard = that->begin();
+               that_guard != that->end(); ++that_guard)
           {
             sem_elem_t new_guard = this_guard->first->extend(that_guard->first);
 
             if (!new_guard->equal(new_guard->zero())) {
-              sem_elem_t new_weight =
-                this_guard->second->extend(that_guard->second);
-
-              BackingMap::iterator loc = m.find(new_guard);
-              if (loc == m.end()) {
-                m.insert(loc, std::make_pair(new_guard, new_weight));
-              }
-              else {
-                new_weight = new_weight->combine(loc->second);
-                loc->second = new_weight;
-              }
+              entries->push_back(Entry(new_guard,
+                                       this_guard->second->extend(that_guard->second)));
             }
           }
         }
-        
-        return new KeyedSemElemSet(m, one_key_, one_value_);
+
+        normalize(*entries);
+        return new KeyedSemElemSet(entries, one_key_, one_value_);
       }
-      
+
+      /// Merges the two sorted entry vectors in linear time (plus the
+      /// quadratic matching within a run of equal key hashes, which is
+      /// almost always a single entry). If 'that' adds nothing to this,
+      /// the result shares this set's storage.
       sem_elem_t combine(SemElem * se) {
         KeyedSemElemSet * that = dynamic_cast<KeyedSemElemSet*>(se);
         assert(that);
 
-        BackingMap m(this->map_);
-        for (BackingMap::const_iterator that_guard = that->map_.begin();
-             that_guard != that->map_.end(); ++that_guard)
-        {
-          BackingMap::iterator new_loc = m.find(that_guard->first);
+        if (that->size() == 0u || this->shares_storage_with(*that)) {
+          return new KeyedSemElemSet(this->entries_, one_key_, one_value_, hash_);
+        }
+        if (this->size() == 0u) {
+          return new KeyedSemElemSet(that->entries_, one_key_, one_value_, that->hash_);
+        }
+
+        boost::shared_ptr<Entries> entries(new Entries());
+        entries->reserve(this->size() + that->size());
+        bool changed = false;
 
-          if (new_loc == m.end()) {
-            m.insert(new_loc, *that_guard);
+        const_iterator i = this->begin(), j = that->begin();
+        while (i != this->end() || j != that->end()) {
+          if (j == that->end() || (i != this->end() && i->key_hash < j->key_hash)) {
+            entries->push_back(*i++);
+          }
+          else if (i == this->end() || j->key_hash < i->key_hash) {
+            entries->push_back(*j++);
+            changed = true;
           }
           else {
-            sem_elem_t new_weight = new_loc->second->combine(that_guard->second);
-            new_loc->second = new_weight;
+            size_t h = i->key_hash;
+            const_iterator i_end = i, j_end = j;
+            while (i_end != this->end() && i_end->key_hash == h) ++i_end;
+            while (j_end != that->end() && j_end->key_hash == h) ++j_end;
+
+            size_t run_start = entries->size();
+            entries->insert(entries->end(), i, i_end);
+            for (; j != j_end; ++j) {
+              Entries::iterator same = entries->begin() + run_start;
+              while (same != entries->end() && !same->first->equal(j->first)) {
+                ++same;
+              }
+              if (same == entries->end()) {
+                entries->push_back(*j);
+                changed = true;
+              }
+              else {
+                sem_elem_t old_weight = same->second;
+                same->second = old_weight->combine(j->second);
+                if (same->second != old_weight && !same->second->equal(old_weight)) {
+                  changed = true;
+                }
+              }
+            }
+            i = i_end;
           }
         }
 
-        return new KeyedSemElemSet(m, one_key_, one_value_);
+        if (!changed) {
+          return new KeyedSemElemSet(this->entries_, one_key_, one_value_, hash_);
+        }
+        return new KeyedSemElemSet(entries, one_key_, one_value_);
       }
 
       bool equal(SemElem * se) const {
         KeyedSemElemSet * that = dynamic_cast<KeyedSemElemSet*>(se);
         assert(that);
 
-        if (this->map_.size() != that->map_.size()
+        if (this->size() != that->size()
+            || this->hash_ != that->hash_
             || !this->one_key_->equal(that->one_key_)
             || !this->one_value_->equal(that->one_value_))
         {
           return false;
         }
 
-        for (BackingMap::const_iterator this_guard = this->map_.begin();
-             this_guard != this->map_.end(); ++this_guard)
+        if (this->shares_storage_with(*that)) {
+          return true;
+        }
+
+        for (const_iterator this_guard = this->begin();
+             this_guard != this->end(); ++this_guard)
         {
-          BackingMap::const_iterator that_loc = that->map_.find(this_guard->first);
+          std::pair<const_iterator, const_iterator> that_loc =
+            that->equal_range(this_guard->first);
 
-          if (that_loc == that->map_.end()
-              || !that_loc->second->equal(this_guard->second))
+          if (that_loc.first == that_loc.second
+              || !that_loc.first->second->equal(this_guard->second))
           {
             return false;
           }  
@@ -239,8 +357,8 @@ namespace wali
       std::ostream& print( std::ostream & o ) const {
         o << "{ ";
         bool first = true;
-        for (BackingMap::const_iterator element = this->map_.begin();
-             element != this->map_.end(); ++element)
+        for (const_iterator element = this->begin();
+             element != this->end(); ++element)
         {
           if (!first) {
             o << ", ";
@@ -276,8 +394,30 @@ namespace wali
       using SemElem::combine;
       using SemElem::equal;
 
-    private:      
-      BackingMap map_;
+    private:
+      /// 'entries' must already be normalized
+      KeyedSemElemSet(boost::shared_ptr<Entries const> entries,
+                      sem_elem_t one_key,
+                      sem_elem_t one_value)
+        : entries_(entries)
+        , one_key_(one_key)
+        , one_value_(one_value)
+        , hash_(get_hash(*entries_))
+      {}
+
+      KeyedSemElemSet(boost::shared_ptr<Entries const> entries,
+                      sem_elem_t one_key,
+                      sem_elem_t one_value,
+                      size_t hash)
+        : entries_(entries)
+        , one_key_(one_key)
+        , one_value_(one_value)
+        , hash_(hash)
+      {}
+
+      /// Never modified once the set is constructed, so it can be shared
+      /// between sets
+      boost::shared_ptr<Entries const> entries_;
       sem_elem_t one_key_, one_value_;
       size_t hash_;
     };
@@ -136,6 +136,7 @@ namespace
       assert(keep_these.first == element || keep_these.second == element);
       assert(keep_these.first == *iter || keep_these.second == *iter);
     }
+    the_hash ^= element->hash();
     set.insert(element);
   }
                               
@@ -269,7 +270,11 @@ namespace wali
       //assert(this->keep_what == other->keep_what);
       assert(this->base_one->equal(other->base_one)); // or return false? or what?
 
-      if (this->elements.size() != other->elements.size()) {
+      // the_hash is the xor of the element hashes, so equal sets have
+      // equal hashes
+      if (this->elements.size() != other->elements.size()
+          || this->the_hash != other->the_hash)
+      {
         return false;
       }
 
@@ -10,12 +10,13 @@ namespace wali
   namespace regex 
   {
     static Key getNilKey() {
-      static Key k = getKey("$");
+      // Pinned: the first call may be inside a KeyScope
+      static Key k = pinKey(getKey("$"));
       return k;
     }
 
     static Key getIdKey() {
-      static Key k = getKey("");
+      static Key k = pinKey(getKey(""));
       return k;
     }
 
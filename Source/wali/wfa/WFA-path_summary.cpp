@@ -116,10 +116,28 @@ namespace wali
         // Tell predecessors we have changed
         std::vector<ITrans*> & incoming = incomingTransIt->second;
 
-        std::vector<ITrans*>::iterator transit = incoming.begin();
-        for ( ; transit != incoming.end() ; ++transit)
+        // The extends of the_delta with each incoming transition's
+        // weight are independent, so compute them as one batch
+        std::vector<sem_elem_t> trans_weights, deltas(incoming.size(), the_delta);
+        std::vector<sem_elem_t> extensions(incoming.size());
+        trans_weights.reserve(incoming.size());
+        for (size_t i = 0 ; i < incoming.size() ; ++i) {
+          trans_weights.push_back(incoming[i]->weight());
+        }
+        if (!incoming.empty()) {
+          if (query == INORDER) {
+            the_delta->extend_many(incoming.size(), &trans_weights[0],
+                                   &deltas[0], &extensions[0]);
+          }
+          else {
+            the_delta->extend_many(incoming.size(), &deltas[0],
+                                   &trans_weights[0], &extensions[0]);
+          }
+        }
+
+        for (size_t i = 0 ; i < incoming.size() ; ++i)
         {
-          ITrans* t = *transit;
+          ITrans* t = incoming[i];
           
           // We are looking at a transition (q', _, q)
           State* qprime = state_map[t->from()];
@@ -132,14 +150,7 @@ namespace wali
 
           assert(t->to() == q->name());
 
-          sem_elem_t extended;
-          if (query == INORDER) {
-            extended = t->weight()->extend(the_delta);
-          }
-          else {
-            extended = the_delta->extend(t->weight());
-          }
-          newW = newW->combine(extended);
+          newW = newW->combine(extensions[i]);
 
           // delta => (w+se,w-se)
           // Use extended->delta b/c we want the diff b/w the new
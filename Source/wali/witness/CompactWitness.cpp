@@ -0,0 +1,146 @@
+/*!
+ * Compact witnesses
+ */
+
+#include "wali/Common.hpp"
+#include "wali/witness/CompactWitness.hpp"
+#include "wali/witness/Visitor.hpp"
+
+#include <typeinfo>
+
+namespace wali
+{
+  namespace witness
+  {
+    CompactWitness::CompactWitness( witness_arena_t arena, node_t node,
+                                    sem_elem_t se ) :
+      SemElem(),
+      fArena(arena),
+      fNode(node),
+      user_se(se),
+      isEmpty(node == WitnessArena::NONE)
+    {
+      assert(fArena.is_valid());
+      fArena->retain(fNode);
+    }
+
+    CompactWitness::CompactWitness( CompactWitness const & that ) :
+      SemElem(),
+      fArena(that.fArena),
+      fNode(that.fNode),
+      user_se(that.user_se),
+      isEmpty(that.isEmpty)
+    {
+      fArena->retain(fNode);
+    }
+
+    CompactWitness::~CompactWitness()
+    {
+      fArena->release(fNode);
+    }
+
+    sem_elem_t CompactWitness::one() const
+    {
+      return new CompactWitness(fArena, WitnessArena::NONE, user_se->one());
+    }
+
+    sem_elem_t CompactWitness::zero() const
+    {
+      return new CompactWitness(fArena, WitnessArena::NONE, user_se->zero());
+    }
+
+    sem_elem_t CompactWitness::extend( SemElem * se )
+    {
+      CompactWitness * that = down(se);
+      if( isEmpty && isOne() ) {
+        return that;
+      }
+      else if( that->isEmpty && that->isOne() ) {
+        return this;
+      }
+      node_t n = fArena->addExtend(node(), that->node());
+      return new CompactWitness(fArena, n, user_se->extend(that->user_se));
+    }
+
+    sem_elem_t CompactWitness::combine( SemElem * se )
+    {
+      CompactWitness * that = down(se);
+      if( isZero() ) {
+        return that;
+      }
+      else if( that->isZero() ) {
+        return this;
+      }
+      sem_elem_t combined = user_se->combine(that->user_se);
+      if( combined->equal(that->user_se) ) {
+        return that;
+      }
+      else if( combined->equal(user_se) ) {
+        return this;
+      }
+      node_t n = fArena->addCombine(node(), that->node());
+      return new CompactWitness(fArena, n, combined);
+    }
+
+    bool CompactWitness::equal( SemElem * se ) const
+    {
+      return user_se->equal(down(se)->user_se);
+    }
+
+    std::ostream& CompactWitness::print( std::ostream& o ) const
+    {
+      o << "CompactWitness[" << fNode << "]: ";
+      return user_se->print(o);
+    }
+
+    CompactWitness::node_t CompactWitness::node()
+    {
+      if( fNode == WitnessArena::NONE ) {
+        fNode = fArena->addEmpty(user_se);
+        fArena->retain(fNode);
+      }
+      return fNode;
+    }
+
+    witness_t CompactWitness::reconstruct()
+    {
+      return fArena->reconstruct(node());
+    }
+
+    void CompactWitness::accept( Visitor& v, bool visitOnce )
+    {
+      witness_t w = reconstruct();
+      w->accept(v, visitOnce);
+    }
+
+    CompactWitness * CompactWitness::down( SemElem * se ) const
+    {
+      CompactWitness * that = dynamic_cast< CompactWitness * >(se);
+      if( 0 == that ) {
+        *waliErr << "SemElem is \"" << typeid(*se).name() << "\"\n";
+        assert(0);
+      }
+      // Weights from different arenas could not be reconstructed together
+      assert(that->fArena == fArena);
+      return that;
+    }
+
+    bool CompactWitness::isZero() const
+    {
+      return user_se->equal(user_se->zero());
+    }
+
+    bool CompactWitness::isOne() const
+    {
+      return user_se->equal(user_se->one());
+    }
+
+  } // namespace witness
+
+} // namespace wali
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
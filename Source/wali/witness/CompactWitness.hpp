@@ -0,0 +1,105 @@
+#ifndef wali_witness_COMPACT_WITNESS_GUARD
+#define wali_witness_COMPACT_WITNESS_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/SemElem.hpp"
+#include "wali/witness/WitnessArena.hpp"
+
+namespace wali
+{
+  namespace witness
+  {
+    class Visitor;
+
+    /**
+     * @class CompactWitness
+     * @brief A Witness whose history is kept in a WitnessArena
+     *
+     * CompactWitness combines and extends exactly like Witness, but
+     * instead of a tree of Witness objects it records a node in a shared
+     * WitnessArena. Only the weights that are still in use (e.g., on
+     * transitions of the result WFA) are SemElem objects; the rest of
+     * the DAG is a few words per node. Each CompactWitness holds a
+     * reference to its node, so the history of a weight is freed with
+     * the last weight that refers to it.
+     *
+     * Use reconstruct() (or accept()) to get an ordinary Witness DAG for
+     * one weight, e.g. to walk it with a CalculatingVisitor.
+     *
+     * @see CompactWitnessWrapper
+     */
+    class CompactWitness : public SemElem
+    {
+      public:
+        typedef WitnessArena::node_t node_t;
+
+        /**
+         * @param node the weight's history, or WitnessArena::NONE for a
+         * weight with no history (e.g., one() or zero())
+         */
+        CompactWitness( witness_arena_t arena, node_t node, sem_elem_t user_se );
+
+        CompactWitness( CompactWitness const & that );
+
+        //! Releases the node
+        virtual ~CompactWitness();
+
+        virtual sem_elem_t one() const;
+
+        virtual sem_elem_t zero() const;
+
+        //! Same shortcuts as Witness::extend
+        virtual sem_elem_t extend( SemElem * se );
+
+        //! Same shortcuts as Witness::combine
+        virtual sem_elem_t combine( SemElem * se );
+
+        //! Test for equality of the user weights
+        virtual bool equal( SemElem * se ) const;
+
+        virtual bool equal( sem_elem_t se ) const {
+          return equal(se.get_ptr());
+        }
+
+        virtual std::ostream& print( std::ostream& o ) const;
+
+        //! The user's weight
+        sem_elem_t weight() const { return user_se; }
+
+        witness_arena_t arena() const { return fArena; }
+
+        //! The arena node, creating one if this weight has no history yet
+        node_t node();
+
+        //! Build the ordinary Witness DAG for this weight
+        witness_t reconstruct();
+
+        //! Reconstruct, then let v visit the result
+        void accept( Visitor& v, bool visitOnce=false );
+
+      private:
+        CompactWitness& operator=( CompactWitness const & );
+
+        CompactWitness * down( SemElem * se ) const;
+
+        bool isZero() const;
+        bool isOne() const;
+
+        witness_arena_t fArena;
+        node_t fNode;
+        sem_elem_t user_se;
+        bool isEmpty;   //!< True if this weight came from one() or zero()
+
+    }; // class CompactWitness
+
+  } // namespace witness
+
+} // namespace wali
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif  // wali_witness_COMPACT_WITNESS_GUARD
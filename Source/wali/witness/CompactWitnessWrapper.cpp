@@ -0,0 +1,123 @@
+/*!
+ * Wrapper for compact witnesses
+ */
+
+#include "wali/Common.hpp"
+#include "wali/wfa/ITrans.hpp"
+#include "wali/wpds/ewpds/ERule.hpp"
+#include "wali/witness/CompactWitness.hpp"
+#include "wali/witness/CompactWitnessWrapper.hpp"
+
+namespace wali
+{
+  namespace witness
+  {
+    CompactWitnessWrapper::CompactWitnessWrapper() :
+      Wrapper(),
+      arena(new WitnessArena())
+    {
+    }
+
+    sem_elem_t CompactWitnessWrapper::wrap( wfa::ITrans const & t )
+    {
+      return new CompactWitness(arena, arena->addTrans(t), t.weight());
+    }
+
+    sem_elem_t CompactWitnessWrapper::wrap( wpds::Rule const & r )
+    {
+      return new CompactWitness(arena, arena->addRule(r), r.weight());
+    }
+
+    // NOTE
+    //   The weight r->weight() is already a wrapped
+    //   witness, so no need to rewrap it here.
+    merge_fn_t CompactWitnessWrapper::wrap(
+        wpds::ewpds::ERule const & r,
+        merge_fn_t user_merge )
+    {
+      sem_elem_t se = r.weight();
+      CompactWitness * cw = dynamic_cast< CompactWitness* >(se.get_ptr());
+      assert(cw != NULL);
+      return new CompactWitnessMergeFn(arena, cw->node(), user_merge);
+    }
+
+    sem_elem_t CompactWitnessWrapper::unwrap( sem_elem_t se )
+    {
+      CompactWitness * cw = dynamic_cast< CompactWitness* >(se.get_ptr());
+      if( 0 != cw ) {
+        return cw->weight();
+      }
+      else {
+        *waliErr << "[ERROR] Unwrap called on non CompactWitness weight.\n";
+        assert(0);
+        return 0;
+      }
+    }
+
+    merge_fn_t CompactWitnessWrapper::unwrap( merge_fn_t mf )
+    {
+      CompactWitnessMergeFn * cmf =
+        dynamic_cast< CompactWitnessMergeFn* >(mf.get_ptr());
+      if( 0 != cmf ) {
+        return cmf->get_user_merge();
+      }
+      else {
+        *waliErr << "[ERROR] Unwrap<merge_fn_t> called on non CompactWitnessMergeFn.\n";
+        assert(0);
+        return 0;
+      }
+    }
+
+
+    CompactWitnessMergeFn::CompactWitnessMergeFn(
+        witness_arena_t the_arena,
+        WitnessArena::node_t the_rule,
+        merge_fn_t the_user_merge ) :
+      MergeFn(),
+      arena(the_arena),
+      rule(the_rule),
+      user_merge(the_user_merge)
+    {
+      arena->retain(rule);
+    }
+
+    CompactWitnessMergeFn::~CompactWitnessMergeFn()
+    {
+      arena->release(rule);
+    }
+
+    sem_elem_t CompactWitnessMergeFn::apply_f( sem_elem_t a, sem_elem_t b )
+    {
+      CompactWitness * caller = dynamic_cast< CompactWitness* >(a.get_ptr());
+      CompactWitness * callee = dynamic_cast< CompactWitness* >(b.get_ptr());
+      if( caller == 0 || callee == 0 ) {
+        *waliErr << "[ERROR] Attempt to apply CompactWitnessMergeFn to non witness.\n";
+        assert(0);
+      }
+      sem_elem_t user_se = user_merge->apply_f(caller->weight(), callee->weight());
+      WitnessArena::node_t n =
+        arena->addMerge(caller->node(), rule, callee->node(), user_merge);
+      return new CompactWitness(arena, n, user_se);
+    }
+
+    std::ostream& CompactWitnessMergeFn::print( std::ostream& o ) const
+    {
+      o << "CompactWitnessMergeFn[ ";
+      user_merge->print(o) << "]";
+      return o;
+    }
+
+    bool CompactWitnessMergeFn::equal( merge_fn_t mf )
+    {
+      CompactWitnessMergeFn * cmf = static_cast< CompactWitnessMergeFn* >(mf.get_ptr());
+      return user_merge->equal(cmf->user_merge);
+    }
+
+    merge_fn_t CompactWitnessMergeFn::get_user_merge()
+    {
+      return user_merge;
+    }
+
+  } // namespace witness
+
+} // namespace wali
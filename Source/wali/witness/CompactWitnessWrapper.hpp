@@ -0,0 +1,82 @@
+#ifndef wali_witness_COMPACT_WITNESS_WRAPPER_GUARD
+#define wali_witness_COMPACT_WITNESS_WRAPPER_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/MergeFn.hpp"
+#include "wali/wpds/Wrapper.hpp"
+#include "wali/witness/WitnessArena.hpp"
+
+namespace wali
+{
+  namespace witness
+  {
+    /**
+     * @class CompactWitnessWrapper
+     *
+     * A drop-in replacement for WitnessWrapper that produces
+     * CompactWitness weights, all sharing one WitnessArena. Results are
+     * the same as with WitnessWrapper once reconstructed, but the
+     * witness DAG takes a small fraction of the memory.
+     *
+     * @see CompactWitness
+     */
+    class CompactWitnessWrapper : public ::wali::wpds::Wrapper
+    {
+      public:
+        CompactWitnessWrapper();
+
+        virtual ~CompactWitnessWrapper() {}
+
+        virtual sem_elem_t wrap( wfa::ITrans const & t );
+
+        virtual sem_elem_t wrap( wpds::Rule const & r );
+
+        virtual merge_fn_t wrap( wpds::ewpds::ERule const & r, merge_fn_t user_merge );
+
+        virtual sem_elem_t unwrap( sem_elem_t se );
+
+        virtual merge_fn_t unwrap( merge_fn_t mf );
+
+        witness_arena_t getArena() const { return arena; }
+
+      private:
+        witness_arena_t arena;
+
+    }; // class CompactWitnessWrapper
+
+
+    /**
+     * @class CompactWitnessMergeFn
+     *
+     * Applies the user's merge function and records a merge node.
+     * Holds a reference to the rule's node.
+     */
+    class CompactWitnessMergeFn : public MergeFn
+    {
+      public:
+        CompactWitnessMergeFn( witness_arena_t arena,
+                               WitnessArena::node_t rule,
+                               merge_fn_t user_merge );
+
+        virtual ~CompactWitnessMergeFn();
+
+        virtual sem_elem_t apply_f( sem_elem_t w1, sem_elem_t w2 );
+
+        virtual std::ostream& print( std::ostream& o ) const;
+
+        virtual bool equal( merge_fn_t mf );
+
+        merge_fn_t get_user_merge();
+
+      private:
+        witness_arena_t arena;
+        WitnessArena::node_t rule;
+        merge_fn_t user_merge;
+
+    }; // class CompactWitnessMergeFn
+
+  } // namespace witness
+
+} // namespace wali
+
+#endif  // wali_witness_COMPACT_WITNESS_WRAPPER_GUARD
@@ -0,0 +1,308 @@
+/*!
+ * Compact witness DAG storage
+ */
+
+#include "wali/Common.hpp"
+#include "wali/wfa/ITrans.hpp"
+#include "wali/wfa/Trans.hpp"
+#include "wali/wpds/Rule.hpp"
+#include "wali/witness/WitnessArena.hpp"
+#include "wali/witness/WitnessTrans.hpp"
+#include "wali/witness/WitnessExtend.hpp"
+#include "wali/witness/WitnessCombine.hpp"
+#include "wali/witness/WitnessMerge.hpp"
+#include "wali/witness/WitnessMergeFn.hpp"
+
+#include <utility>
+
+namespace wali
+{
+  namespace witness
+  {
+    const WitnessArena::node_t WitnessArena::NONE;
+    const unsigned char WitnessArena::FREE;
+
+    WitnessArena::WitnessArena() :
+      Countable(),
+      free_nodes(NONE),
+      num_live(0)
+    {
+    }
+
+    WitnessArena::~WitnessArena()
+    {
+    }
+
+    template< typename T >
+    WitnessArena::node_t WitnessArena::slot(
+        std::vector< T > & table,
+        std::vector< node_t > & freed,
+        T const & value )
+    {
+      if( !freed.empty() ) {
+        node_t i = freed.back();
+        freed.pop_back();
+        table[i] = value;
+        return i;
+      }
+      assert(table.size() < (size_t)NONE);
+      table.push_back(value);
+      return (node_t)(table.size() - 1);
+    }
+
+    WitnessArena::node_t WitnessArena::push( Kind k, node_t a, node_t b )
+    {
+      node_t n;
+      if( free_nodes != NONE ) {
+        n = free_nodes;
+        free_nodes = nodes[n].a;
+        nodes[n] = Node(k, a, b);
+      }
+      else {
+        assert(nodes.size() < (size_t)NONE);
+        nodes.push_back(Node(k, a, b));
+        n = (node_t)(nodes.size() - 1);
+      }
+      ++num_live;
+      return n;
+    }
+
+    WitnessArena::node_t WitnessArena::addEmpty( sem_elem_t user_se )
+    {
+      return push(EMPTY, slot(empties, free_empties, user_se), NONE);
+    }
+
+    WitnessArena::node_t WitnessArena::addTrans( wfa::ITrans const & t )
+    {
+      TransStub stub;
+      stub.from = t.from();
+      stub.stack = t.stack();
+      stub.to = t.to();
+      stub.se = t.weight();
+      return push(TRANS, slot(transs, free_transs, stub), NONE);
+    }
+
+    WitnessArena::node_t WitnessArena::addRule( wpds::Rule const & r )
+    {
+      return push(RULE, slot(rules, free_rules, RuleStub(r)), NONE);
+    }
+
+    WitnessArena::node_t WitnessArena::addExtend( node_t left, node_t right )
+    {
+      retain(left);
+      retain(right);
+      return push(EXTEND, left, right);
+    }
+
+    WitnessArena::node_t WitnessArena::addCombine( node_t first, node_t second )
+    {
+      retain(first);
+      retain(second);
+      return push(COMBINE, first, second);
+    }
+
+    WitnessArena::node_t WitnessArena::addMerge(
+        node_t caller, node_t rule, node_t callee, merge_fn_t user_merge )
+    {
+      retain(caller);
+      retain(rule);
+      retain(callee);
+      MergeStub stub;
+      stub.rule = rule;
+      stub.callee = callee;
+      stub.user_merge = user_merge;
+      return push(MERGE, caller, slot(merges, free_merges, stub));
+    }
+
+    void WitnessArena::retain( node_t n )
+    {
+      if( n == NONE ) {
+        return;
+      }
+      assert(n < nodes.size() && nodes[n].kind != FREE);
+      ++nodes[n].refs;
+    }
+
+    //
+    // Frees with an explicit stack, since dropping the last weight of a
+    // saturation can free a long chain of extends at once.
+    //
+    void WitnessArena::release( node_t root )
+    {
+      std::vector< node_t > stack;
+      stack.push_back(root);
+
+      while( !stack.empty() ) {
+        node_t n = stack.back();
+        stack.pop_back();
+        if( n == NONE ) {
+          continue;
+        }
+        assert(n < nodes.size() && nodes[n].kind != FREE && nodes[n].refs > 0);
+        Node & node = nodes[n];
+        if( --node.refs > 0 ) {
+          continue;
+        }
+
+        switch( node.kind ) {
+          case EMPTY:
+            empties[node.a] = 0;
+            free_empties.push_back(node.a);
+            break;
+          case TRANS:
+            transs[node.a].se = 0;
+            free_transs.push_back(node.a);
+            break;
+          case RULE:
+            rules[node.a].se = 0;
+            free_rules.push_back(node.a);
+            break;
+          case EXTEND:
+          case COMBINE:
+            stack.push_back(node.a);
+            stack.push_back(node.b);
+            break;
+          case MERGE: {
+            MergeStub & stub = merges[node.b];
+            stack.push_back(node.a);
+            stack.push_back(stub.rule);
+            stack.push_back(stub.callee);
+            stub.user_merge = 0;
+            free_merges.push_back(node.b);
+            break;
+          }
+          default:
+            assert(0);
+        }
+        node.kind = FREE;
+        node.a = free_nodes;
+        free_nodes = n;
+        --num_live;
+      }
+    }
+
+    WitnessArena::Kind WitnessArena::kind( node_t n ) const
+    {
+      assert(n < nodes.size() && nodes[n].kind != FREE);
+      return (Kind)nodes[n].kind;
+    }
+
+    size_t WitnessArena::size() const
+    {
+      return num_live;
+    }
+
+    size_t WitnessArena::bytes() const
+    {
+      return nodes.capacity() * sizeof(Node)
+        + empties.capacity() * sizeof(sem_elem_t)
+        + transs.capacity() * sizeof(TransStub)
+        + rules.capacity() * sizeof(RuleStub)
+        + merges.capacity() * sizeof(MergeStub);
+    }
+
+    witness_t WitnessArena::reconstruct( node_t n ) const
+    {
+      assert(n < nodes.size() && nodes[n].kind != FREE);
+      memo_t memo;
+      return build(n, memo);
+    }
+
+    //
+    // Builds bottom-up with an explicit stack so that long chains of
+    // extends do not exhaust the C++ stack.
+    //
+    witness_t WitnessArena::build( node_t root, memo_t & memo ) const
+    {
+      std::vector< std::pair< node_t, bool > > stack;
+      stack.push_back(std::make_pair(root, false));
+
+      while( !stack.empty() ) {
+        node_t n = stack.back().first;
+        bool children_done = stack.back().second;
+        if( memo.find(n) != memo.end() ) {
+          stack.pop_back();
+          continue;
+        }
+        Node const & node = nodes[n];
+
+        if( !children_done ) {
+          stack.back().second = true;
+          switch( node.kind ) {
+            case EXTEND:
+            case COMBINE:
+              stack.push_back(std::make_pair(node.b, false));
+              stack.push_back(std::make_pair(node.a, false));
+              break;
+            case MERGE:
+              stack.push_back(std::make_pair(merges[node.b].callee, false));
+              stack.push_back(std::make_pair(merges[node.b].rule, false));
+              stack.push_back(std::make_pair(node.a, false));
+              break;
+            default:
+              break;
+          }
+          continue;
+        }
+
+        stack.pop_back();
+        witness_t w;
+        switch( node.kind ) {
+          case EMPTY:
+            w = new Witness(empties[node.a]);
+            break;
+          case TRANS: {
+            TransStub const & stub = transs[node.a];
+            wfa::Trans t(stub.from, stub.stack, stub.to, stub.se);
+            w = new WitnessTrans(t);
+            break;
+          }
+          case RULE:
+            w = new WitnessRule(rules[node.a]);
+            break;
+          case EXTEND: {
+            witness_t left = memo[node.a];
+            witness_t right = memo[node.b];
+            w = new WitnessExtend(left->weight()->extend(right->weight()),
+                                  left, right);
+            break;
+          }
+          case COMBINE: {
+            witness_t first = memo[node.a];
+            witness_t second = memo[node.b];
+            WitnessCombine * wc =
+              new WitnessCombine(first->weight()->combine(second->weight()));
+            w = wc;
+            wc->addChild(first);
+            wc->addChild(second);
+            break;
+          }
+          case MERGE: {
+            MergeStub const & stub = merges[node.b];
+            witness_t caller = memo[node.a];
+            witness_t rule = memo[stub.rule];
+            witness_t callee = memo[stub.callee];
+            sem_elem_t user_se =
+              stub.user_merge->apply_f(caller->weight(), callee->weight());
+            w = new WitnessMerge(user_se,
+                                 new WitnessMergeFn(rule, stub.user_merge),
+                                 caller, rule, callee);
+            break;
+          }
+          default:
+            assert(0);
+        }
+        memo[n] = w;
+      }
+      return memo[root];
+    }
+
+  } // namespace witness
+
+} // namespace wali
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
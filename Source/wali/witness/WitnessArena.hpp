@@ -0,0 +1,174 @@
+#ifndef wali_witness_WITNESS_ARENA_GUARD
+#define wali_witness_WITNESS_ARENA_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Countable.hpp"
+#include "wali/ref_ptr.hpp"
+#include "wali/SemElem.hpp"
+#include "wali/MergeFn.hpp"
+#include "wali/witness/Witness.hpp"
+#include "wali/witness/WitnessRule.hpp"
+
+#include <map>
+#include <vector>
+
+namespace wali
+{
+  namespace wfa
+  {
+    class ITrans;
+  }
+
+  namespace witness
+  {
+    /**
+     * @class WitnessArena
+     * @brief Compact storage for a witness DAG
+     *
+     * Each node of the DAG is a fixed-size record in a vector, and refers
+     * to its children by index. Only the leaves (rules, transitions, and
+     * empty witnesses) keep a weight, which is the user's own sem_elem_t;
+     * the weights of extend, combine, and merge nodes are recomputed from
+     * the leaves when a node is reconstructed.
+     *
+     * Nodes are reference counted. A CompactWitness retains its node and
+     * each interior node retains its children, so once no weight refers
+     * to a node, directly or through a parent, release() puts it (and
+     * the leaf it may own) on a free list for the next add to reuse.
+     * Saturation throws most of its intermediate weights away, and this
+     * keeps the arena to the DAGs of the weights still alive.
+     *
+     * The arena itself goes away when the last CompactWitness (and
+     * Wrapper) that refers to it does.
+     *
+     * @see CompactWitness
+     * @see CompactWitnessWrapper
+     */
+    class WitnessArena : public Countable
+    {
+      public:
+        typedef unsigned int node_t;
+
+        //! No node (e.g., an empty witness that was never a child)
+        static const node_t NONE = ~0u;
+
+        enum Kind { EMPTY, TRANS, RULE, EXTEND, COMBINE, MERGE };
+
+        WitnessArena();
+
+        ~WitnessArena();
+
+        //
+        // The add methods return a node with no references; whoever
+        // keeps it (e.g. a CompactWitness) must retain() it.
+        //
+
+        //! A leaf for a Witness with no history, e.g. one()
+        node_t addEmpty( sem_elem_t user_se );
+
+        node_t addTrans( wfa::ITrans const & t );
+
+        node_t addRule( wpds::Rule const & r );
+
+        node_t addExtend( node_t left, node_t right );
+
+        node_t addCombine( node_t first, node_t second );
+
+        node_t addMerge( node_t caller, node_t rule, node_t callee,
+                         merge_fn_t user_merge );
+
+        //! Adds a reference to n. NONE is ignored.
+        void retain( node_t n );
+
+        //! Drops a reference to n, freeing n and then any of its
+        //! children that no longer have references. NONE is ignored.
+        void release( node_t n );
+
+        Kind kind( node_t n ) const;
+
+        //! @return the number of live (not freed) nodes
+        size_t size() const;
+
+        /**
+         * @return (roughly) the bytes used by the nodes and leaf tables.
+         * Freed slots are kept for reuse, so this follows the largest
+         * the arena has been rather than its current size.
+         */
+        size_t bytes() const;
+
+        /**
+         * Builds the ordinary Witness DAG rooted at n, so it can be
+         * visited with a Visitor or CalculatingVisitor. Nodes shared in
+         * the arena are shared in the result.
+         */
+        witness_t reconstruct( node_t n ) const;
+
+      private:
+        //! The kind of a node on the free list
+        static const unsigned char FREE = 0xff;
+
+        struct Node
+        {
+          unsigned char kind;
+          node_t a;     //!< left/first/caller child, a leaf table index,
+                        //!< or the next free node
+          node_t b;     //!< right/second child, or a merge table index
+          node_t refs;
+
+          Node( Kind k, node_t first, node_t second ) :
+            kind((unsigned char)k), a(first), b(second), refs(0) {}
+        };
+
+        struct TransStub
+        {
+          Key from, stack, to;
+          sem_elem_t se;
+        };
+
+        struct MergeStub
+        {
+          node_t rule;
+          node_t callee;
+          merge_fn_t user_merge;
+        };
+
+        typedef std::map< node_t, witness_t > memo_t;
+
+        node_t push( Kind k, node_t a, node_t b );
+
+        //! @return a slot of table, reusing a freed one if there is one
+        template< typename T >
+        static node_t slot( std::vector< T > & table,
+                            std::vector< node_t > & freed,
+                            T const & value );
+
+        witness_t build( node_t n, memo_t & memo ) const;
+
+        std::vector< Node > nodes;
+        std::vector< sem_elem_t > empties;
+        std::vector< TransStub > transs;
+        std::vector< RuleStub > rules;
+        std::vector< MergeStub > merges;
+
+        node_t free_nodes;    //!< Head of the free list threaded through Node::a
+        size_t num_live;
+        std::vector< node_t > free_empties;
+        std::vector< node_t > free_transs;
+        std::vector< node_t > free_rules;
+        std::vector< node_t > free_merges;
+
+    }; // class WitnessArena
+
+    typedef ref_ptr< WitnessArena > witness_arena_t;
+
+  } // namespace witness
+
+} // namespace wali
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
+
+#endif  // wali_witness_WITNESS_ARENA_GUARD
@@ -8,6 +8,7 @@
 #include "wali/Common.hpp"
 #include "wali/witness/Witness.hpp"
 #include "wali/PriorityWorklist.hpp"
+#include "wali/BucketWorklist.hpp"
 
 namespace wali
 {
@@ -40,6 +41,32 @@ namespace wali
         virtual ~WitnessLengthWorklist();
     }; // class WitnessLengthWorklist
 
+
+    /// The rank of a transition for a BucketWorklist or
+    /// RadixHeapWorklist: the minimum length of its witness.
+    struct WitnessLength
+    {
+      size_t operator()( const wfa::ITrans* t ) const
+      {
+        Witness *wit = dynamic_cast<Witness*>(t->weight().get_ptr());
+        assert (wit && "Transition without witness used with WitnessLengthWorklist");
+        return wit->getMinimumLength();
+      }
+    };
+
+    /// A WitnessLengthWorklist backed by a bucket queue
+    class WitnessLengthBucketWorklist : public BucketWorklist<WitnessLength>
+    {
+      public:
+        WitnessLengthBucketWorklist( size_t width = 1, size_t max_buckets = 1 << 16 )
+          : BucketWorklist<WitnessLength>(width, max_buckets)
+        {}
+    };
+
+    /// A WitnessLengthWorklist backed by a radix heap
+    class WitnessLengthRadixWorklist : public RadixHeapWorklist<WitnessLength>
+    {};
+
   } // namespace witness
 
 } // namespace wali
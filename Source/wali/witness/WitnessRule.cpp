@@ -90,6 +90,13 @@ namespace wali
       min_length = 1UL;
     }
 
+    WitnessRule::WitnessRule( const RuleStub& the_stub ) :
+      Witness(the_stub.se),
+      stub(the_stub)
+    {
+      min_length = 1UL;
+    }
+
     //! Destructor does nothing.
     WitnessRule::~WitnessRule()
     {
@@ -58,6 +58,9 @@ namespace wali
          */
         WitnessRule( const Rule& r );
 
+        //! Creates a WitnessRule for an already-copied rule
+        WitnessRule( const RuleStub& stub );
+
         //! Destructor does nothing.
         ~WitnessRule();
 
@@ -189,7 +189,7 @@ namespace wali
         sem_elem_t se, Config * cfg
         )
     {
-      wfa::ITrans* tmp = new Trans(from,stack,to,se);
+      wfa::ITrans* tmp = new Trans(from,stack,to,canonical(se));
       tmp->print( *waliErr << "  --- [DebugWPDS::update] t_gen ==" ) << std::endl;
 
       wfa::ITrans* t = currentOutputWFA->insert(tmp).first;
@@ -207,7 +207,7 @@ namespace wali
         sem_elem_t wWithRule //<! delta \extends r->weight()
         )
     {
-      wfa::ITrans* tmp = new Trans(from,r->to_stack2(),call->to(),wWithRule);
+      wfa::ITrans* tmp = new Trans(from,r->to_stack2(),call->to(),canonical(wWithRule));
       tmp->print( *waliErr << "  --- [DebugWPDS::update_prime] t_gen ==" ) << std::endl;
       wfa::ITrans* t = currentOutputWFA->insert(tmp).first;
       return t;
@@ -0,0 +1,309 @@
+/*!
+ * Best-first search for short witnesses
+ */
+
+#include "wali/Common.hpp"
+#include "wali/ValueSemiring.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/RuleFunctor.hpp"
+#include "wali/wpds/ValueWPDS.hpp"
+#include "wali/wpds/ShortestWitnessSearch.hpp"
+
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+namespace wali
+{
+  namespace wpds
+  {
+    typedef ValueWPDS<ShortestPathValue> LengthWPDS;
+
+    const unsigned int ShortestWitnessSearch::UNREACHABLE;
+
+    namespace
+    {
+      bool isZero( sem_elem_t se )
+      {
+        return se->equal(se->zero());
+      }
+
+      //
+      // Indexes the rules by their right-hand sides and gives each
+      // a length of 1
+      //
+      struct RuleIndexer : ConstRuleFunctor
+      {
+        LengthWPDS & lengths;
+        std::map< std::pair<Key, Key>, std::vector<rule_t> > & steps;
+        std::map< std::pair< Key, std::pair<Key, Key> >, std::vector<rule_t> > & pushes;
+        std::map< Key, std::vector<rule_t> > & pops;
+
+        RuleIndexer( LengthWPDS & l,
+                     std::map< std::pair<Key, Key>, std::vector<rule_t> > & s,
+                     std::map< std::pair< Key, std::pair<Key, Key> >, std::vector<rule_t> > & pu,
+                     std::map< Key, std::vector<rule_t> > & po ) :
+          lengths(l), steps(s), pushes(pu), pops(po) {}
+
+        virtual void operator()( rule_t const & r )
+        {
+          if( isZero(r->weight()) ) {
+            return;
+          }
+          lengths.add_rule(r->from_state(), r->from_stack(),
+                           r->to_state(), r->to_stack1(), r->to_stack2(), 1);
+          if( r->to_stack1() == WALI_EPSILON ) {
+            pops[r->to_state()].push_back(r);
+          }
+          else if( r->to_stack2() == WALI_EPSILON ) {
+            steps[std::make_pair(r->to_state(), r->to_stack1())].push_back(r);
+          }
+          else {
+            pushes[std::make_pair(r->to_state(),
+                                  std::make_pair(r->to_stack1(), r->to_stack2()))].push_back(r);
+          }
+        }
+      };
+
+      struct TransCopier : wfa::ConstTransFunctor
+      {
+        LengthWPDS::Automaton & fa;
+        TransCopier( LengthWPDS::Automaton & a ) : fa(a) {}
+
+        virtual void operator()( wfa::ITrans const * t )
+        {
+          if( !isZero(t->weight()) ) {
+            fa.addTrans(t->from(), t->stack(), t->to(), ShortestPathValue::one());
+          }
+        }
+      };
+
+      //
+      // A configuration reached by undoing rules from the target. The
+      // rules from here back to the target are found by following
+      // parent links.
+      //
+      struct SearchNode
+      {
+        Key state;
+        ShortestWitnessSearch::stack_t rstack;   // top last
+        unsigned int undone;
+        rule_t rule;                             // takes this node to its parent
+        size_t parent;
+      };
+
+      const size_t NO_PARENT = (size_t)-1;
+    }
+
+
+    void ShortestWitnessSearch::LengthAutomaton::add(
+        Key from, Key stack, Key to, unsigned int length )
+    {
+      if( stack == WALI_EPSILON ) {
+        eps[from].push_back(Edge(to, length));
+      }
+      else {
+        out[std::make_pair(from, stack)].push_back(Edge(to, length));
+      }
+    }
+
+    unsigned int ShortestWitnessSearch::LengthAutomaton::distance(
+        Key state, stack_t const & rstack ) const
+    {
+      typedef std::map< Key, unsigned int > frontier_t;
+      frontier_t current;
+      current[state] = 0;
+
+      for( size_t i = rstack.size() ; ; --i ) {
+        // Epsilon closure
+        bool changed = true;
+        while( changed ) {
+          changed = false;
+          for( frontier_t::const_iterator it = current.begin() ; it != current.end() ; ++it ) {
+            std::map< Key, std::vector<Edge> >::const_iterator es = eps.find(it->first);
+            if( es == eps.end() ) {
+              continue;
+            }
+            for( size_t e = 0 ; e < es->second.size() ; ++e ) {
+              unsigned int d = it->second + es->second[e].length;
+              frontier_t::iterator old = current.find(es->second[e].to);
+              if( old == current.end() || d < old->second ) {
+                current[es->second[e].to] = d;
+                changed = true;
+              }
+            }
+          }
+        }
+
+        if( i == 0 || current.empty() ) {
+          break;
+        }
+
+        frontier_t next;
+        Key symbol = rstack[i - 1];
+        for( frontier_t::const_iterator it = current.begin() ; it != current.end() ; ++it ) {
+          std::map< std::pair<Key, Key>, std::vector<Edge> >::const_iterator es =
+            out.find(std::make_pair(it->first, symbol));
+          if( es == out.end() ) {
+            continue;
+          }
+          for( size_t e = 0 ; e < es->second.size() ; ++e ) {
+            unsigned int d = it->second + es->second[e].length;
+            frontier_t::iterator old = next.find(es->second[e].to);
+            if( old == next.end() || d < old->second ) {
+              next[es->second[e].to] = d;
+            }
+          }
+        }
+        current.swap(next);
+      }
+
+      unsigned int best = UNREACHABLE;
+      for( frontier_t::const_iterator it = current.begin() ; it != current.end() ; ++it ) {
+        if( finals.count(it->first) > 0 ) {
+          best = std::min(best, it->second);
+        }
+      }
+      return best;
+    }
+
+
+    ShortestWitnessSearch::ShortestWitnessSearch( WPDS const & pds, wfa::WFA const & init ) :
+      num_expanded(0)
+    {
+      assert(UNREACHABLE == ShortestPathValue::zero());
+      LengthWPDS lengths;
+      RuleIndexer indexer(lengths, steps, pushes, pops);
+      pds.for_each(indexer);
+
+      LengthWPDS::Automaton query;
+      TransCopier copier(query);
+      init.for_each(copier);
+      LengthWPDS::Automaton saturated = lengths.poststar(query);
+
+      for( LengthWPDS::Automaton::const_iterator it = query.begin() ; it != query.end() ; ++it ) {
+        initial.add(it->from, it->stack, it->to, it->weight);
+      }
+      for( LengthWPDS::Automaton::const_iterator it = saturated.begin() ; it != saturated.end() ; ++it ) {
+        reachable.add(it->from, it->stack, it->to, it->weight);
+      }
+      initial.finals = init.getFinalStates();
+      reachable.finals = init.getFinalStates();
+    }
+
+
+    unsigned int ShortestWitnessSearch::distance( Key state, stack_t const & stack ) const
+    {
+      stack_t rstack(stack.rbegin(), stack.rend());
+      return reachable.distance(state, rstack);
+    }
+
+
+    std::vector<ShortestWitnessSearch::RuleSequence>
+    ShortestWitnessSearch::find( Key state, stack_t const & stack,
+                                 size_t k, unsigned int max_length ) const
+    {
+      std::vector<RuleSequence> found;
+      num_expanded = 0;
+
+      // (undone + still needed, node index); ties go to older nodes
+      typedef std::pair< unsigned int, size_t > entry_t;
+      std::priority_queue< entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+      std::vector< SearchNode > nodes;
+
+      SearchNode target;
+      target.state = state;
+      target.rstack.assign(stack.rbegin(), stack.rend());
+      target.undone = 0;
+      target.parent = NO_PARENT;
+      unsigned int needed = reachable.distance(target.state, target.rstack);
+      if( needed == UNREACHABLE || needed > max_length || k == 0 ) {
+        return found;
+      }
+      nodes.push_back(target);
+      queue.push(entry_t(needed, 0));
+
+      while( !queue.empty() && found.size() < k ) {
+        size_t n = queue.top().second;
+        queue.pop();
+        ++num_expanded;
+
+        // Copy: nodes grows below
+        SearchNode node = nodes[n];
+
+        if( initial.distance(node.state, node.rstack) != UNREACHABLE ) {
+          RuleSequence witness;
+          witness.start_state = node.state;
+          witness.start_stack.assign(node.rstack.rbegin(), node.rstack.rend());
+          for( size_t i = n ; nodes[i].parent != NO_PARENT ; i = nodes[i].parent ) {
+            witness.rules.push_back(nodes[i].rule);
+          }
+          found.push_back(witness);
+        }
+
+        // Undo one more rule. A predecessor with a finite distance is
+        // itself reachable, so every node queued is on some witness.
+        std::vector< SearchNode > preds;
+        size_t height = node.rstack.size();
+
+        if( height >= 1 ) {
+          Key top = node.rstack[height - 1];
+          rule_index_t::const_iterator ss = steps.find(std::make_pair(node.state, top));
+          if( ss != steps.end() ) {
+            for( size_t i = 0 ; i < ss->second.size() ; ++i ) {
+              SearchNode pred = node;
+              pred.rstack[height - 1] = ss->second[i]->from_stack();
+              pred.state = ss->second[i]->from_state();
+              pred.rule = ss->second[i];
+              preds.push_back(pred);
+            }
+          }
+        }
+        if( height >= 2 ) {
+          Key top = node.rstack[height - 1];
+          Key below = node.rstack[height - 2];
+          push_index_t::const_iterator ps =
+            pushes.find(std::make_pair(node.state, std::make_pair(top, below)));
+          if( ps != pushes.end() ) {
+            for( size_t i = 0 ; i < ps->second.size() ; ++i ) {
+              SearchNode pred = node;
+              pred.rstack.pop_back();
+              pred.rstack[height - 2] = ps->second[i]->from_stack();
+              pred.state = ps->second[i]->from_state();
+              pred.rule = ps->second[i];
+              preds.push_back(pred);
+            }
+          }
+        }
+        std::map< Key, std::vector<rule_t> >::const_iterator pops_to = pops.find(node.state);
+        if( pops_to != pops.end() ) {
+          for( size_t i = 0 ; i < pops_to->second.size() ; ++i ) {
+            SearchNode pred = node;
+            pred.rstack.push_back(pops_to->second[i]->from_stack());
+            pred.state = pops_to->second[i]->from_state();
+            pred.rule = pops_to->second[i];
+            preds.push_back(pred);
+          }
+        }
+
+        for( size_t i = 0 ; i < preds.size() ; ++i ) {
+          SearchNode & pred = preds[i];
+          unsigned int rest = reachable.distance(pred.state, pred.rstack);
+          if( rest == UNREACHABLE || node.undone + 1 + rest > max_length ) {
+            continue;
+          }
+          pred.undone = node.undone + 1;
+          pred.parent = n;
+          nodes.push_back(pred);
+          queue.push(entry_t(pred.undone + rest, nodes.size() - 1));
+        }
+      }
+
+      return found;
+    }
+
+  } // namespace wpds
+
+} // namespace wali
@@ -0,0 +1,116 @@
+#ifndef wali_wpds_SHORTEST_WITNESS_SEARCH_GUARD
+#define wali_wpds_SHORTEST_WITNESS_SEARCH_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Key.hpp"
+#include "wali/wpds/Rule.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace wali
+{
+  namespace wfa
+  {
+    class WFA;
+  }
+
+  namespace wpds
+  {
+    class WPDS;
+
+    /**
+     * @class ShortestWitnessSearch
+     * @brief Finds the k shortest rule sequences that reach a configuration
+     *
+     * The constructor saturates the initial automaton once, with every
+     * rule costing 1 (ValueWPDS over ShortestPathValue). That gives, for
+     * any configuration, the exact number of rules needed to reach it
+     * from an initial configuration, or "unreachable".
+     *
+     * find() then searches backwards from the target configuration,
+     * undoing one rule at a time, best-first on (rules undone so far +
+     * rules still needed). Since the estimate is exact, the search only
+     * follows predecessors that lie on a witness no longer than the
+     * ones it still has to find, and it never builds a witness DAG.
+     *
+     * Stacks are given top first, as words are read in a WFA. Rules
+     * whose weight is zero are ignored; other weights do not matter.
+     */
+    class ShortestWitnessSearch
+    {
+      public:
+        typedef std::vector<Key> stack_t;
+
+        //! One witness: apply rules, in order, to (start_state, start_stack)
+        struct RuleSequence
+        {
+          Key start_state;
+          stack_t start_stack;
+          std::vector<rule_t> rules;
+        };
+
+        //! Distance to an unreachable configuration
+        static const unsigned int UNREACHABLE = ~0u;
+
+        ShortestWitnessSearch( WPDS const & pds, wfa::WFA const & initial );
+
+        /**
+         * @return the fewest rules that take an initial configuration
+         * to (state, stack), or UNREACHABLE
+         */
+        unsigned int distance( Key state, stack_t const & stack ) const;
+
+        /**
+         * @return up to k rule sequences of at most max_length rules
+         * that reach (state, stack), shortest first
+         */
+        std::vector<RuleSequence> find( Key state, stack_t const & stack,
+                                        size_t k,
+                                        unsigned int max_length = UNREACHABLE - 1 ) const;
+
+        //! @return the number of search nodes the last find() expanded
+        size_t numExpanded() const { return num_expanded; }
+
+      private:
+        struct Edge
+        {
+          Key to;
+          unsigned int length;
+          Edge( Key t, unsigned int l ) : to(t), length(l) {}
+        };
+
+        //! A WFA with lengths as weights, indexed for reading words
+        struct LengthAutomaton
+        {
+          std::map< std::pair<Key, Key>, std::vector<Edge> > out;
+          std::map< Key, std::vector<Edge> > eps;
+          std::set< Key > finals;
+
+          void add( Key from, Key stack, Key to, unsigned int length );
+
+          //! stack is stored top last
+          unsigned int distance( Key state, stack_t const & rstack ) const;
+        };
+
+        typedef std::map< std::pair<Key, Key>, std::vector<rule_t> > rule_index_t;
+        typedef std::map< std::pair< Key, std::pair<Key, Key> >,
+                          std::vector<rule_t> > push_index_t;
+
+        LengthAutomaton reachable;   //!< poststar of the initial automaton
+        LengthAutomaton initial;     //!< the initial automaton itself
+
+        rule_index_t steps;          //!< by (to_state, to_stack1)
+        push_index_t pushes;         //!< by (to_state, (to_stack1, to_stack2))
+        std::map< Key, std::vector<rule_t> > pops;   //!< by to_state
+
+        mutable size_t num_expanded;
+
+    }; // class ShortestWitnessSearch
+
+  } // namespace wpds
+
+} // namespace wali
+
+#endif  // wali_wpds_SHORTEST_WITNESS_SEARCH_GUARD
@@ -0,0 +1,430 @@
+#ifndef wali_wpds_VALUE_WPDS_GUARD
+#define wali_wpds_VALUE_WPDS_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Key.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/wpds/GenKeySource.hpp"
+#include "wali/wpds/Rule.hpp"
+#include "wali/wpds/RuleFunctor.hpp"
+#include "wali/util/unordered_map.hpp"
+
+#include <boost/functional/hash.hpp>
+
+#include <vector>
+
+namespace wali
+{
+  namespace wpds
+  {
+    /**
+     * @class ValueWPDS
+     * @brief A WPDS specialized at compile time to a value semiring
+     *
+     * ValueWPDS answers the same poststar queries as WPDS, but its weights
+     * are plain values of Semiring::value_type stored inline in the rules
+     * and transitions, and the semiring operations are inlined static calls
+     * (see ValueSemiring.hpp for the concept and for adapters of Reach,
+     * ShortestPathSemiring, and LongestSaturatingPathSemiring). For
+     * semirings whose elements are a bool or an int, that removes the
+     * allocation, reference counting, and virtual dispatch that dominate
+     * the running time of WPDS::poststar.
+     *
+     * The semiring must be idempotent (combine(a, a) == a), as all of the
+     * adapters are: a changed transition passes on its new weight rather
+     * than a difference.
+     *
+     * Only poststar is supported, and there are no witnesses, merge
+     * functions, or Wrappers; use WPDS (or EWPDS) for those.
+     */
+    template< typename Semiring >
+    class ValueWPDS
+    {
+      public:
+        typedef typename Semiring::value_type weight_t;
+
+        struct Trans
+        {
+          Key from;
+          Key stack;
+          Key to;
+          weight_t weight;
+
+          Trans( Key f, Key s, Key t, weight_t w ) :
+            from(f), stack(s), to(t), weight(w) {}
+        };
+
+        /**
+         * @class Automaton
+         * @brief The input and output of a query: a set of weighted
+         * transitions
+         */
+        class Automaton
+        {
+          public:
+            typedef typename std::vector<Trans>::const_iterator const_iterator;
+
+            /**
+             * Adds the transition, or combines w into its weight if it
+             * is already present.
+             *
+             * @return true if the transition's weight changed
+             */
+            bool addTrans( Key from, Key stack, Key to, weight_t w )
+            {
+              TransKey k(from, stack, to);
+              typename index_t::iterator it = index.find(k);
+              if( it == index.end() ) {
+                index[k] = trans.size();
+                trans.push_back(Trans(from, stack, to, w));
+                return true;
+              }
+              Trans & t = trans[it->second];
+              weight_t combined = Semiring::combine(t.weight, w);
+              if( Semiring::equal(combined, t.weight) ) {
+                return false;
+              }
+              t.weight = combined;
+              return true;
+            }
+
+            /**
+             * @return true and sets w if (from, stack, to) is present
+             */
+            bool find( Key from, Key stack, Key to, weight_t & w ) const
+            {
+              typename index_t::const_iterator it =
+                index.find(TransKey(from, stack, to));
+              if( it == index.end() ) {
+                return false;
+              }
+              w = trans[it->second].weight;
+              return true;
+            }
+
+            size_t numTransitions() const { return trans.size(); }
+
+            const_iterator begin() const { return trans.begin(); }
+            const_iterator end() const { return trans.end(); }
+
+            /**
+             * Copies the transitions of a WFA, converting its weights
+             * with Semiring::from_sem_elem
+             */
+            static Automaton fromWfa( wfa::WFA const & fa )
+            {
+              Automaton a;
+              Copier copier(a);
+              fa.for_each(copier);
+              return a;
+            }
+
+          private:
+            friend class ValueWPDS;
+
+            struct TransKey
+            {
+              Key from, stack, to;
+
+              TransKey( Key f, Key s, Key t ) : from(f), stack(s), to(t) {}
+
+              bool operator==( TransKey const & other ) const {
+                return from == other.from && stack == other.stack && to == other.to;
+              }
+            };
+
+            struct TransKeyHash
+            {
+              size_t operator()( TransKey const & k ) const {
+                size_t seed = 0;
+                boost::hash_combine(seed, k.from);
+                boost::hash_combine(seed, k.stack);
+                boost::hash_combine(seed, k.to);
+                return seed;
+              }
+            };
+
+            struct Copier : wfa::ConstTransFunctor
+            {
+              Automaton & a;
+              Copier( Automaton & aut ) : a(aut) {}
+              virtual void operator()( wfa::ITrans const * t ) {
+                a.addTrans(t->from(), t->stack(), t->to(),
+                           Semiring::from_sem_elem(t->weight()));
+              }
+            };
+
+            typedef util::unordered_map<TransKey, size_t, TransKeyHash> index_t;
+
+            std::vector<Trans> trans;
+            index_t index;
+        };
+
+
+        ValueWPDS() {}
+
+        /** @brief add the rule <from_state, from_stack> -> <to_state> */
+        void add_rule( Key from_state, Key from_stack, Key to_state, weight_t w )
+        {
+          add_rule(from_state, from_stack, to_state, WALI_EPSILON, WALI_EPSILON, w);
+        }
+
+        /** @brief add the rule <from_state, from_stack> -> <to_state, to_stack1> */
+        void add_rule( Key from_state, Key from_stack,
+                       Key to_state, Key to_stack1, weight_t w )
+        {
+          add_rule(from_state, from_stack, to_state, to_stack1, WALI_EPSILON, w);
+        }
+
+        /** @brief add the rule
+         *  <from_state, from_stack> -> <to_state, to_stack1 to_stack2> */
+        void add_rule( Key from_state, Key from_stack,
+                       Key to_state, Key to_stack1, Key to_stack2, weight_t w )
+        {
+          assert(to_stack1 != WALI_EPSILON || to_stack2 == WALI_EPSILON);
+          Rule r;
+          r.to_state = to_state;
+          r.to_stack1 = to_stack1;
+          r.to_stack2 = to_stack2;
+          r.weight = w;
+          rules[std::make_pair(from_state, from_stack)].push_back(r);
+        }
+
+        /** @brief add every rule of a WPDS, converting its weights with
+         *  Semiring::from_sem_elem */
+        template< typename RuleContainer >
+        void add_rules( RuleContainer const & pds )
+        {
+          RuleCopier copier(*this);
+          pds.for_each(copier);
+        }
+
+        size_t count_rules() const
+        {
+          size_t n = 0;
+          for( typename rule_map_t::const_iterator it = rules.begin() ;
+               it != rules.end() ; ++it )
+          {
+            n += it->second.size();
+          }
+          return n;
+        }
+
+        Automaton poststar( Automaton const & input ) const
+        {
+          Automaton output;
+          poststar(input, output);
+          return output;
+        }
+
+        /**
+         * Computes poststar of input into output (which is cleared first).
+         * Mid-states for push rules are named by GenKeySource keys, as in
+         * WPDS::poststar.
+         */
+        void poststar( Automaton const & input, Automaton & output ) const
+        {
+          Solver solver(*this, output);
+          for( typename Automaton::const_iterator it = input.begin() ;
+               it != input.end() ; ++it )
+          {
+            solver.update(it->from, it->stack, it->to, it->weight);
+          }
+          solver.run();
+        }
+
+      private:
+        struct Rule
+        {
+          Key to_state;
+          Key to_stack1;
+          Key to_stack2;
+          weight_t weight;
+        };
+
+        typedef util::unordered_map< std::pair<Key, Key>,
+                                     std::vector<Rule>,
+                                     boost::hash< std::pair<Key, Key> > >
+                rule_map_t;
+
+        rule_map_t rules;
+
+        struct RuleCopier : ConstRuleFunctor
+        {
+          ValueWPDS & pds;
+          RuleCopier( ValueWPDS & p ) : pds(p) {}
+          virtual void operator()( rule_t const & r ) {
+            pds.add_rule(r->from_state(), r->from_stack(),
+                         r->to_state(), r->to_stack1(), r->to_stack2(),
+                         Semiring::from_sem_elem(r->weight()));
+          }
+        };
+
+        /// The state of one poststar query
+        class Solver
+        {
+          public:
+            Solver( ValueWPDS const & p, Automaton & out ) :
+              pds(p),
+              fa(out),
+              generation(next_generation())
+            {
+              fa.trans.clear();
+              fa.index.clear();
+            }
+
+            /// Combines w into (from, stack, to) and queues it if it changed
+            size_t update( Key from, Key stack, Key to, weight_t w )
+            {
+              size_t before = fa.trans.size();
+              bool changed = fa.addTrans(from, stack, to, w);
+              size_t i = fa.index[typename Automaton::TransKey(from, stack, to)];
+              if( fa.trans.size() != before ) {
+                delta.push_back(Semiring::zero());
+                queued.push_back(false);
+                by_from[from].push_back(i);
+                if( stack == WALI_EPSILON ) {
+                  eps_into[to].push_back(i);
+                }
+              }
+              if( changed ) {
+                delta[i] = Semiring::combine(delta[i], w);
+                if( !queued[i] ) {
+                  queued[i] = true;
+                  worklist.push_back(i);
+                }
+              }
+              return i;
+            }
+
+            void run()
+            {
+              while( !worklist.empty() ) {
+                size_t i = worklist.back();
+                worklist.pop_back();
+                queued[i] = false;
+                weight_t d = delta[i];
+                delta[i] = Semiring::zero();
+                // Copy: fa.trans may grow (and move) during post
+                Trans t = fa.trans[i];
+                if( t.stack == WALI_EPSILON ) {
+                  post_eps(t, d);
+                }
+                else {
+                  post(t, d);
+                }
+              }
+            }
+
+          private:
+            /// (p,eps,q) + (q,y,q') => (p,y,q')
+            void post_eps( Trans const & t, weight_t d )
+            {
+              typename adjacency_t::const_iterator out = by_from.find(t.to);
+              if( out == by_from.end() ) {
+                return;
+              }
+              // Indices are stable; the vector itself may grow
+              for( size_t k = 0 ; k < by_from[t.to].size() ; ++k ) {
+                Trans const & next = fa.trans[by_from[t.to][k]];
+                if( next.stack != WALI_EPSILON ) {
+                  Key stack = next.stack, to = next.to;
+                  weight_t w = Semiring::extend(next.weight, d);
+                  update(t.from, stack, to, w);
+                }
+              }
+            }
+
+            void post( Trans const & t, weight_t d )
+            {
+              typename rule_map_t::const_iterator rs =
+                pds.rules.find(std::make_pair(t.from, t.stack));
+              if( rs == pds.rules.end() ) {
+                return;
+              }
+              std::vector<Rule> const & ls = rs->second;
+              for( size_t k = 0 ; k < ls.size() ; ++k ) {
+                Rule const & r = ls[k];
+                weight_t w = Semiring::extend(d, r.weight);
+                if( r.to_stack2 == WALI_EPSILON ) {
+                  // Pop rules create epsilon transitions
+                  update(r.to_state, r.to_stack1, t.to, w);
+                }
+                else {
+                  Key g = gen_state(r.to_state, r.to_stack1);
+                  update(r.to_state, r.to_stack1, g, Semiring::one());
+                  // Transitions out of generated states are not queued;
+                  // a change is passed on to the epsilon transitions
+                  // into g directly.
+                  if( fa.addTrans(g, r.to_stack2, t.to, w) ) {
+                    note_new(g, r.to_stack2, t.to);
+                    typename adjacency_t::const_iterator eps = eps_into.find(g);
+                    if( eps != eps_into.end() ) {
+                      for( size_t e = 0 ; e < eps_into[g].size() ; ++e ) {
+                        Trans const & teps = fa.trans[eps_into[g][e]];
+                        Key from = teps.from;
+                        weight_t epsW = Semiring::extend(w, teps.weight);
+                        update(from, r.to_stack2, t.to, epsW);
+                      }
+                    }
+                  }
+                }
+              }
+            }
+
+            /// Bookkeeping for a transition added without update()
+            void note_new( Key from, Key stack, Key to )
+            {
+              if( delta.size() < fa.trans.size() ) {
+                size_t i = fa.index[typename Automaton::TransKey(from, stack, to)];
+                delta.push_back(Semiring::zero());
+                queued.push_back(false);
+                by_from[from].push_back(i);
+              }
+            }
+
+            Key gen_state( Key state, Key stack )
+            {
+              std::pair<Key, Key> k(state, stack);
+              typename gen_map_t::const_iterator it = gen_states.find(k);
+              if( it != gen_states.end() ) {
+                return it->second;
+              }
+              Key g = getKey(new GenKeySource(generation, getKey(state, stack)));
+              gen_states[k] = g;
+              return g;
+            }
+
+            static size_t next_generation()
+            {
+              // Far from the generations WFAs hand out
+              static size_t generation = ((size_t)-1) / 2;
+              return generation++;
+            }
+
+            typedef util::unordered_map< Key, std::vector<size_t> > adjacency_t;
+            typedef util::unordered_map< std::pair<Key, Key>, Key,
+                                         boost::hash< std::pair<Key, Key> > >
+                    gen_map_t;
+
+            ValueWPDS const & pds;
+            Automaton & fa;
+            size_t generation;
+
+            // Indexed like fa.trans
+            std::vector<weight_t> delta;
+            std::vector<bool> queued;
+
+            std::vector<size_t> worklist;
+            adjacency_t by_from;
+            adjacency_t eps_into;
+            gen_map_t gen_states;
+        };
+    };
+
+  } // namespace wpds
+
+} // namespace wali
+
+#endif  // wali_wpds_VALUE_WPDS_GUARD
@@ -59,6 +59,7 @@ namespace wali
       wali::wfa::ConstTransFunctor(),
       wrapper(w.wrapper),
       worklist( new DefaultWorklist<wfa::ITrans>() ),
+      interner(w.interner),
       currentOutputWFA(0)
     {
       RuleCopier rc(*this,wrapper);
@@ -114,6 +115,16 @@ namespace wali
       worklist = wl;
     }
 
+    void WPDS::setWeightInterner( weight_interner_t i )
+    {
+      interner = i;
+    }
+
+    weight_interner_t WPDS::getWeightInterner() const
+    {
+      return interner;
+    }
+
     bool WPDS::add_rule(
         Key from_state,
         Key from_stack,
@@ -1120,7 +1131,7 @@ namespace wali
         Config * cfg
         )
     {
-      wfa::ITrans*t = currentOutputWFA->insert(new Trans(from,stack,to,se)).first;
+      wfa::ITrans*t = currentOutputWFA->insert(new Trans(from,stack,to,canonical(se))).first;
       t->setConfig(cfg);
       if (t->modified()) {
         //t->print(std::cout << "Adding transition: ") << "\n";
@@ -1144,7 +1155,7 @@ namespace wali
         sem_elem_t wWithRule //<! delta \extends r->weight()
         )
     {
-      wfa::ITrans* tmp = new Trans(from,r->to_stack2(),call->to(),wWithRule);
+      wfa::ITrans* tmp = new Trans(from,r->to_stack2(),call->to(),canonical(wWithRule));
       wfa::ITrans* t = currentOutputWFA->insert(tmp).first;
       return t;
     }
@@ -12,6 +12,7 @@
 #include "wali/KeyContainer.hpp"
 #include "wali/SemElem.hpp"
 #include "wali/Worklist.hpp"
+#include "wali/WeightInterner.hpp"
 
 // ::wali::wfa
 #include "wali/wfa/WFA.hpp"
@@ -82,6 +83,20 @@ namespace wali
          */
         void setWorklist( ref_ptr< Worklist<wfa::ITrans> > wl );
 
+        /**
+         * Intern the weights of transitions generated by pre and
+         * poststar queries, so structurally-equal weights share one
+         * instance. (Weights combined into an existing transition are
+         * not interned.) Pass 0 (the default) to
+         * turn interning off. The weight domain must implement
+         * SemElem::hash().
+         *
+         * @see WeightInterner
+         */
+        void setWeightInterner( weight_interner_t interner );
+
+        weight_interner_t getWeightInterner() const;
+
 
         /** 
          * @brief create rule with no r.h.s. stack symbols
@@ -313,7 +328,7 @@ namespace wali
 
         sem_elem_t get_theZero() {return theZero; }
 
-        void printStatistics(std::ostream & os) const;
+        virtual void printStatistics(std::ostream & os) const;
         
         void toWfa(wfa::WFA & wfa) const;
 
@@ -536,6 +551,14 @@ namespace wali
             sem_elem_t wWithRule //<! delta \extends r->weight()
             );
 
+        /**
+         * @return the canonical instance of se if there is a weight
+         * interner, and se itself otherwise
+         */
+        sem_elem_t canonical( sem_elem_t se ) const {
+          return interner.is_valid() ? interner->intern(se) : se;
+        }
+
         /**
          * @return const chash_t reference
          */
@@ -577,6 +600,7 @@ namespace wali
       protected: // data members
         ref_ptr<Wrapper> wrapper;
         ref_ptr< Worklist<wfa::ITrans> > worklist;
+        weight_interner_t interner;
         chash_t configs;
         std::set< Config * > rule_zeroes;
         r2hash_t r2hash;
@@ -0,0 +1,301 @@
+#include "wali/wpds/WtoWorklist.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/Rule.hpp"
+#include "wali/wpds/RuleFunctor.hpp"
+#include "wali/wfa/ITrans.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace wali
+{
+  namespace wpds
+  {
+    namespace
+    {
+      /// The stack symbols of a WPDS and the edges between them
+      class WtoGraph : public ConstRuleFunctor
+      {
+        public:
+          std::vector<Key> keys;
+          std::vector< std::vector<size_t> > succ;
+
+          virtual void operator()( const rule_t & r ) {
+            size_t from = node(r->from_stack());
+            // node() may grow succ, so look the target up first. The
+            // return point goes first: the DFS finishes it before the
+            // callee, so the callee comes first in the order.
+            if( r->to_stack2() != WALI_EPSILON ) {
+              size_t to = node(r->to_stack2());
+              succ[from].push_back(to);
+            }
+            if( r->to_stack1() != WALI_EPSILON ) {
+              size_t to = node(r->to_stack1());
+              succ[from].push_back(to);
+            }
+          }
+
+        private:
+          std::map<Key, size_t> index;
+
+          size_t node( Key k ) {
+            std::map<Key, size_t>::iterator it = index.find(k);
+            if( it != index.end() ) {
+              return it->second;
+            }
+            index[k] = keys.size();
+            keys.push_back(k);
+            succ.push_back(std::vector<size_t>());
+            return keys.size() - 1;
+          }
+      };
+
+      /// Bourdoncle's decomposition, with Tarjan's algorithm run
+      /// iteratively so that long chains of procedures do not exhaust
+      /// the call stack. Only the nesting of components recurses.
+      class Decomposer
+      {
+        public:
+          typedef std::vector<size_t> nodes_t;
+
+          Decomposer( WtoGraph const & g )
+            : graph(g)
+            , region(g.keys.size(), 0)
+            , num(g.keys.size(), 0)
+            , low(g.keys.size(), 0)
+            , on_stack(g.keys.size(), false)
+            , next_region(0)
+          {}
+
+          /// Appends the order of the nodes of region r, which are
+          /// listed in starts, to out
+          void decompose( nodes_t const & starts, size_t r, int depth,
+                          std::vector< std::pair<size_t, int> > & out,
+                          std::vector<bool> & is_head )
+          {
+            std::vector<nodes_t> sccs;
+            components(starts, r, sccs);
+            for( size_t c = sccs.size(); c-- > 0; ) {
+              nodes_t const & scc = sccs[c];
+              size_t head = scc[0];
+              if( scc.size() == 1 && !hasSelfLoop(head) ) {
+                out.push_back(std::make_pair(head, depth));
+                continue;
+              }
+              out.push_back(std::make_pair(head, depth + 1));
+              is_head[head] = true;
+              size_t inner = ++next_region;
+              region[head] = ~size_t(0);
+              for( size_t i = 1; i < scc.size(); i++ ) {
+                region[scc[i]] = inner;
+              }
+              // The DFS enters the body where the head leads first
+              nodes_t inner_starts;
+              std::vector<size_t> const & hs = graph.succ[head];
+              for( size_t i = 0; i < hs.size(); i++ ) {
+                if( region[hs[i]] == inner ) {
+                  inner_starts.push_back(hs[i]);
+                }
+              }
+              inner_starts.insert(inner_starts.end(), scc.begin() + 1, scc.end());
+              decompose(inner_starts, inner, depth + 1, out, is_head);
+            }
+          }
+
+        private:
+          WtoGraph const & graph;
+          std::vector<size_t> region;
+          std::vector<size_t> num;   //!< DFS number + 1; 0 if unvisited
+          std::vector<size_t> low;
+          std::vector<bool> on_stack;
+          size_t next_region;
+
+          bool hasSelfLoop( size_t v ) const {
+            std::vector<size_t> const & s = graph.succ[v];
+            return std::find(s.begin(), s.end(), v) != s.end();
+          }
+
+          /// Tarjan's algorithm on region r. Components come out in
+          /// reverse topological order, each with its DFS root first.
+          void components( nodes_t const & starts, size_t r,
+                           std::vector<nodes_t> & sccs )
+          {
+            for( size_t i = 0; i < starts.size(); i++ ) {
+              num[starts[i]] = 0;
+            }
+            size_t counter = 0;
+            std::vector<size_t> stack;
+            std::vector< std::pair<size_t, size_t> > frames;
+            for( size_t s = 0; s < starts.size(); s++ ) {
+              if( num[starts[s]] != 0 ) {
+                continue;
+              }
+              visit(starts[s], counter, stack, frames);
+              while( !frames.empty() ) {
+                size_t v = frames.back().first;
+                size_t e = frames.back().second;
+                std::vector<size_t> const & vs = graph.succ[v];
+                if( e < vs.size() ) {
+                  frames.back().second++;
+                  size_t w = vs[e];
+                  if( region[w] != r ) {
+                    continue;
+                  }
+                  if( num[w] == 0 ) {
+                    visit(w, counter, stack, frames);
+                  }
+                  else if( on_stack[w] && num[w] < low[v] ) {
+                    low[v] = num[w];
+                  }
+                  continue;
+                }
+                frames.pop_back();
+                if( !frames.empty() ) {
+                  size_t u = frames.back().first;
+                  if( low[v] < low[u] ) {
+                    low[u] = low[v];
+                  }
+                }
+                if( low[v] == num[v] ) {
+                  nodes_t scc;
+                  size_t w;
+                  do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    scc.push_back(w);
+                  } while( w != v );
+                  std::reverse(scc.begin(), scc.end());
+                  sccs.push_back(scc);
+                }
+              }
+            }
+          }
+
+          void visit( size_t v, size_t & counter, std::vector<size_t> & stack,
+                      std::vector< std::pair<size_t, size_t> > & frames )
+          {
+            num[v] = low[v] = ++counter;
+            stack.push_back(v);
+            on_stack[v] = true;
+            frames.push_back(std::make_pair(v, 0));
+          }
+      };
+    }
+
+    WeakTopologicalOrder::WeakTopologicalOrder( WPDS const & pds )
+    {
+      WtoGraph graph;
+      pds.for_each(graph);
+      size_t n = graph.keys.size();
+
+      // Start from the symbols nothing leads to, then the rest, each by
+      // key so the order does not depend on the rule hash tables
+      std::vector<bool> has_pred(n, false);
+      for( size_t v = 0; v < n; v++ ) {
+        for( size_t i = 0; i < graph.succ[v].size(); i++ ) {
+          if( graph.succ[v][i] != v ) {
+            has_pred[graph.succ[v][i]] = true;
+          }
+        }
+      }
+      std::vector< std::pair<Key, size_t> > by_key;
+      for( size_t v = 0; v < n; v++ ) {
+        by_key.push_back(std::make_pair(graph.keys[v], v));
+      }
+      std::sort(by_key.begin(), by_key.end());
+      Decomposer::nodes_t starts;
+      for( int pass = 0; pass < 2; pass++ ) {
+        for( size_t i = 0; i < n; i++ ) {
+          if( has_pred[by_key[i].second] == (pass == 1) ) {
+            starts.push_back(by_key[i].second);
+          }
+        }
+      }
+
+      std::vector< std::pair<size_t, int> > out;
+      std::vector<bool> is_head(n, false);
+      Decomposer(graph).decompose(starts, 0, 0, out, is_head);
+      assert(out.size() == n);
+
+      for( size_t i = 0; i < out.size(); i++ ) {
+        Key k = graph.keys[out[i].first];
+        positions.insert(k, order.size());
+        order.push_back(k);
+        depths.push_back(out[i].second);
+        if( is_head[out[i].first] ) {
+          heads.insert(k);
+        }
+      }
+    }
+
+    WeakTopologicalOrder::~WeakTopologicalOrder()
+    {
+    }
+
+    size_t WeakTopologicalOrder::position( Key stack ) const
+    {
+      position_map_t::const_iterator it = positions.find(stack);
+      return (it == positions.end()) ? order.size() : it->second;
+    }
+
+    bool WeakTopologicalOrder::isWideningPoint( Key stack ) const
+    {
+      return heads.find(stack) != heads.end();
+    }
+
+    int WeakTopologicalOrder::depth( Key stack ) const
+    {
+      size_t i = position(stack);
+      return (i == order.size()) ? 0 : depths[i];
+    }
+
+    std::ostream & WeakTopologicalOrder::print( std::ostream & o ) const
+    {
+      for( size_t i = 0; i < order.size(); i++ ) {
+        if( i > 0 ) {
+          o << " ";
+        }
+        if( heads.find(order[i]) != heads.end() ) {
+          o << "(";
+        }
+        printKey(o, order[i]);
+        int next = 0;
+        if( i + 1 < order.size() ) {
+          next = depths[i + 1] - (isWideningPoint(order[i + 1]) ? 1 : 0);
+        }
+        for( int d = depths[i]; d > next; d-- ) {
+          o << ")";
+        }
+      }
+      return o;
+    }
+
+    size_t WtoRank::operator()( const wfa::ITrans* t ) const
+    {
+      size_t n = wto->size();
+      size_t i = wto->position(t->stack());
+      return (reverse && i < n) ? n - 1 - i : i;
+    }
+
+    // Ranks are at most the size of the order, so every transition has
+    // a bucket and the overflow map is never used.
+    WtoWorklist::WtoWorklist( WPDS const & pds, bool reverse )
+      : BucketWorklist<WtoRank>(1, ~size_t(0), WtoRank(new WeakTopologicalOrder(pds), reverse))
+    {
+    }
+
+    WtoWorklist::WtoWorklist( wto_t wto, bool reverse )
+      : BucketWorklist<WtoRank>(1, ~size_t(0), WtoRank(wto, reverse))
+    {
+    }
+
+    WtoWorklist::~WtoWorklist()
+    {
+    }
+
+  } // namespace wpds
+
+} // namespace wali
+
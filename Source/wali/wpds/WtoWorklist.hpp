@@ -0,0 +1,132 @@
+#ifndef wali_wpds_WTO_WORKLIST_GUARD
+#define wali_wpds_WTO_WORKLIST_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Countable.hpp"
+#include "wali/HashMap.hpp"
+#include "wali/BucketWorklist.hpp"
+
+#include <iosfwd>
+#include <set>
+#include <vector>
+
+namespace wali
+{
+  namespace wpds
+  {
+    class WPDS;
+
+    /**
+     * @class WeakTopologicalOrder
+     * @brief A weak topological order (Bourdoncle, 1993) of the stack
+     *        symbols of a WPDS
+     *
+     * The graph has an edge from the from-stack of each rule to its
+     * first to-stack, and from the from-stack of each push rule to its
+     * second to-stack (the return point, reached once the callee's
+     * summary is known). Pop rules add no edges.
+     *
+     * The order is built by splitting the graph into strongly connected
+     * components in topological order; each component with a cycle is
+     * headed by the symbol its depth-first search entered first, and the
+     * rest of the component is ordered the same way after removing the
+     * head. The heads are the widening points.
+     */
+    class WeakTopologicalOrder : public Countable
+    {
+      public:
+        explicit WeakTopologicalOrder( WPDS const & pds );
+
+        ~WeakTopologicalOrder();
+
+        /** @return the number of stack symbols in the order */
+        size_t size() const { return order.size(); }
+
+        /** @return the position of stack, or size() if the WPDS has
+         *          no rule that mentions stack */
+        size_t position( Key stack ) const;
+
+        /** @return the symbol at position i */
+        Key at( size_t i ) const { return order[i]; }
+
+        /** @return true if stack heads a component */
+        bool isWideningPoint( Key stack ) const;
+
+        /** @return the heads of the components */
+        std::set<Key> const & wideningPoints() const { return heads; }
+
+        /** @return the number of components that contain stack */
+        int depth( Key stack ) const;
+
+        /** Prints the order with each component in parentheses */
+        std::ostream & print( std::ostream & o ) const;
+
+      private:
+        typedef HashMap< Key, size_t > position_map_t;
+
+        std::vector<Key> order;
+        std::vector<int> depths;        //!< By position
+        position_map_t positions;
+        std::set<Key> heads;
+
+    }; // class WeakTopologicalOrder
+
+    typedef ref_ptr<WeakTopologicalOrder> wto_t;
+
+    /// The rank of a transition in a WtoWorklist
+    struct WtoRank
+    {
+      wto_t wto;
+      bool reverse;
+
+      WtoRank() : reverse(false) {}
+
+      WtoRank( wto_t w, bool r ) : wto(w), reverse(r) {}
+
+      size_t operator()( const wfa::ITrans* t ) const;
+    };
+
+    /**
+     * @class WtoWorklist
+     * @brief A worklist that hands out transitions by the position of
+     *        their stack symbol in a WeakTopologicalOrder
+     *
+     * Since the head of a component precedes its body and the body
+     * precedes what follows the component, a change that flows back to a
+     * head is processed before anything after the loop, i.e., inner
+     * components are stabilized before the outer ones continue. This
+     * cuts re-evaluations on programs with loops compared to FIFO order.
+     *
+     * The order follows control flow forward, which suits poststar; for
+     * prestar construct the worklist with reverse = true. Symbols the
+     * WPDS does not mention come last, in no particular order. The
+     * order is computed once, so rules added afterwards are not placed.
+     *
+     * The worklist only orders; saturation does not widen. Domains that
+     * need widening can consult wideningPoints().
+     */
+    class WtoWorklist : public BucketWorklist<WtoRank>
+    {
+      public:
+        explicit WtoWorklist( WPDS const & pds, bool reverse = false );
+
+        explicit WtoWorklist( wto_t wto, bool reverse = false );
+
+        virtual ~WtoWorklist();
+
+        /** @return the order this worklist follows */
+        wto_t weakTopologicalOrder() const { return getRank().wto; }
+
+        /** @return the heads of the components of the order */
+        std::set<Key> const & wideningPoints() const {
+          return getRank().wto->wideningPoints();
+        }
+
+    }; // class WtoWorklist
+
+  } // namespace wpds
+
+} // namespace wali
+
+#endif  // wali_wpds_WTO_WORKLIST_GUARD
+
@@ -17,16 +17,18 @@ namespace wali {
           Key f, Key s, Key t,
           sem_elem_t weightAtCall,
           sem_elem_t wAfterCall,
-          erule_t er)
-        : DecoratorTrans(new wfa::Trans(f,s,t,wAfterCall)),wAtCall(weightAtCall),erule(er)
+          erule_t er,
+          merge_memo_t m)
+        : DecoratorTrans(new wfa::Trans(f,s,t,wAfterCall)),wAtCall(weightAtCall),erule(er),memo(m)
       {
       }
 
       ETrans::ETrans(
           ITrans* d,
           sem_elem_t weightAtCall,
-          erule_t er)
-        : DecoratorTrans(d),wAtCall(weightAtCall),erule(er)
+          erule_t er,
+          merge_memo_t m)
+        : DecoratorTrans(d),wAtCall(weightAtCall),erule(er),memo(m)
       {
       }
 
@@ -42,11 +44,11 @@ namespace wali {
 
 
       wfa::ITrans* ETrans::copy() const {
-        return new ETrans(getDelegate()->copy(),wAtCall,erule);
+        return new ETrans(getDelegate()->copy(),wAtCall,erule,memo);
       }
 
       wfa::ITrans* ETrans::copy(Key f, Key s, Key t) const {
-        return new ETrans(getDelegate()->copy(f,s,t),wAtCall,erule);
+        return new ETrans(getDelegate()->copy(f,s,t),wAtCall,erule,memo);
       }
 
       merge_fn_t ETrans::getMergeFn() const {
@@ -65,13 +67,20 @@ namespace wali {
         wAtCall = wt;
       }
 
-      sem_elem_t ETrans::poststar_eps_closure( sem_elem_t se ) {
+      sem_elem_t ETrans::merge( sem_elem_t se ) const {
+        if( memo.is_valid() ) {
+          return memo->apply(getMergeFn(),wAtCall,se);
+        }
         return getMergeFn()->apply_f(wAtCall,se);
       }
 
+      sem_elem_t ETrans::poststar_eps_closure( sem_elem_t se ) {
+        return merge(se);
+      }
+
       TaggedWeight ETrans::apply_post( TaggedWeight tw) const {
         if(tw.isRet()) {
-          sem_elem_t wt = getMergeFn()->apply_f(wAtCall, tw.getWeight());
+          sem_elem_t wt = merge(tw.getWeight());
           return TaggedWeight(wt, walienum::NONE);
         }
         return TaggedWeight(weight()->extend(tw.getWeight()), walienum::CALL);
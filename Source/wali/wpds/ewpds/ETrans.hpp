@@ -9,6 +9,7 @@
 #include "wali/wfa/ITrans.hpp"
 #include "wali/wfa/DecoratorTrans.hpp"
 #include "wali/wpds/ewpds/ERule.hpp"
+#include "wali/wpds/ewpds/MergeFnMemo.hpp"
 
 namespace wali {
 
@@ -23,13 +24,15 @@ namespace wali {
               Key from, Key stack, Key to,
               sem_elem_t wAtCall,    //!< Weight on path to the call transition
               sem_elem_t wAfterCall, //!< For call rule R, wAtCall->extend(R->weight())
-              erule_t erule          //!< The ERule
+              erule_t erule,         //!< The ERule
+              merge_memo_t memo = 0  //!< Memo for the merge, if any
               );
 
           ETrans(
               ITrans* d,          //!< Trans that is being decorated
               sem_elem_t wAtCall, //!< Weight on path to the call transition
-              erule_t erule       //!< The merge function
+              erule_t erule,      //!< The merge function
+              merge_memo_t memo = 0 //!< Memo for the merge, if any
               );
 
           virtual ~ETrans();
@@ -73,6 +76,9 @@ namespace wali {
         protected:
           sem_elem_t wAtCall;
           erule_t erule;
+          merge_memo_t memo;
+
+          sem_elem_t merge( sem_elem_t se ) const;
 
       }; // class ETrans
 
@@ -28,6 +28,7 @@
 #include "wali/wpds/ewpds/ERule.hpp"
 #include "wali/wpds/ewpds/EWPDS.hpp"
 #include "wali/wpds/ewpds/ETrans.hpp"
+#include "wali/wpds/ewpds/MergeFnMemo.hpp"
 
 #include <iostream>
 #include <cassert>
@@ -74,18 +75,20 @@ namespace wali
 
       const std::string EWPDS::XMLTag("EWPDS");
 
-      EWPDS::EWPDS() : WPDS(), addEtrans(false)
+      EWPDS::EWPDS() : WPDS(), addEtrans(false), merge_memo(new MergeFnMemo())
       {
       }
 
-      EWPDS::EWPDS( ref_ptr<Wrapper> wr ) : WPDS(wr), addEtrans(false)
+      EWPDS::EWPDS( ref_ptr<Wrapper> wr ) : WPDS(wr), addEtrans(false),
+        merge_memo(new MergeFnMemo())
       { 
       }
 
 
       EWPDS::EWPDS( const EWPDS& e ) :
         WPDS(e.wrapper),
-        addEtrans(false)
+        addEtrans(false),
+        merge_memo(new MergeFnMemo(e.merge_memo->capacity()))
       {
         ERuleCopier copier(*this,wrapper);
         e.for_each(copier);
@@ -325,7 +328,7 @@ namespace wali
         // Compute weight on the resulting transition
         if(et1 != 0) {
           erule_t er = (ERule *)(r.get_ptr());
-          w1 = er->merge_fn()->apply_f(t1->weight()->one(), t1->weight());
+          w1 = merge_memo->apply(er->merge_fn(), t1->weight()->one(), t1->weight());
           wNew = w1->extend(delta);
         } else {
           w1 = r->weight()->extend(t1->weight());
@@ -380,7 +383,7 @@ namespace wali
           if(et == 0) {
             wrule_trans = r->weight()->extend( delta );
           } else {
-            wrule_trans = er->merge_fn()->apply_f(delta->one(), delta);
+            wrule_trans = merge_memo->apply(er->merge_fn(), delta->one(), delta);
           }
 
           KeyPair kp( t->to(),r->stack2() );
@@ -507,6 +510,13 @@ namespace wali
         return WPDS::print(o);
       }
 
+      void EWPDS::printStatistics( std::ostream & os ) const
+      {
+        WPDS::printStatistics(os);
+        os << "\n";
+        merge_memo->print(os);
+      }
+
       std::ostream & EWPDS::marshall( std::ostream & o ) const
       {
         RuleMarshaller rm(o);
@@ -569,9 +579,9 @@ namespace wali
         wfa::ITrans *t;
         if(addEtrans) {
           t = currentOutputWFA->insert(new ETrans(from, stack, to,
-                0, se, 0)).first;
+                0, canonical(se), 0)).first;
         } else {
-          t = currentOutputWFA->insert(new wfa::Trans(from, stack, to, se)).first;
+          t = currentOutputWFA->insert(new wfa::Trans(from, stack, to, canonical(se))).first;
         }
 
         t->setConfig(cfg);
@@ -598,7 +608,7 @@ namespace wali
         wfa::ITrans* tmp = 
           new ETrans(
               from, r->to_stack2(), call->to(),
-              delta, wWithRule, er);
+              delta, canonical(wWithRule), er, merge_memo);
         wfa::ITrans* t = currentOutputWFA->insert(tmp).first;
         return t;
       }
@@ -9,6 +9,7 @@
 #include "wali/SemElemPair.hpp"
 #include "wali/IMergeFn.hpp"
 #include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/ewpds/MergeFnMemo.hpp"
 #include <set>
 
 namespace wali
@@ -198,6 +199,19 @@ namespace wali
 
           rule_t lookup_rule(wali::Key to_state, wali::Key to_stack1, wali::Key to_stack2) const;
 
+          /**
+           * @return the memo of pure merge function results used during
+           * prestar and poststar (flushed whenever it fills up). It is
+           * kept across queries; use MergeFnMemo::clear or setCapacity to
+           * bound or turn it off.
+           */
+          merge_memo_t mergeMemo() const { return merge_memo; }
+
+          /**
+           * Prints the WPDS statistics followed by the merge memo counters
+           */
+          virtual void printStatistics( std::ostream & os ) const;
+
         
           ///////////////////////////
           // These next two functions just forward to the base class. They are
@@ -341,6 +355,7 @@ namespace wali
           merge_rule_hash_t merge_rule_hash; // FIXME: verify correct usage of HashMap
         protected:
           bool addEtrans; // Used during update()
+          merge_memo_t merge_memo;
 
       }; // class EWPDS
 
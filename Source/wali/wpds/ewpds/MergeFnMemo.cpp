@@ -0,0 +1,98 @@
+#include "wali/wpds/ewpds/MergeFnMemo.hpp"
+
+namespace wali
+{
+  namespace wpds
+  {
+    namespace ewpds
+    {
+      const size_t MergeFnMemo::DEFAULT_CAPACITY;
+
+      MergeFnMemo::MemoKey::MemoKey( merge_fn_t f, sem_elem_t a, sem_elem_t b )
+        : mf(f), w1(a), w2(b)
+      {
+        size_t h = util::hash<IMergeFn*>()(mf.get_ptr());
+        h ^= w1->hash() + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= w2->hash() + 0x9e3779b9 + (h << 6) + (h >> 2);
+        hashval = h;
+      }
+
+      bool MergeFnMemo::MemoKeyEqual::operator()(
+          const MemoKey& a, const MemoKey& b ) const
+      {
+        return a.mf.get_ptr() == b.mf.get_ptr()
+          && a.hashval == b.hashval
+          && a.w1->equal(b.w1)
+          && a.w2->equal(b.w2);
+      }
+
+      MergeFnMemo::MergeFnMemo( size_t capacity )
+        : Countable()
+        , max_size(capacity)
+        , num_hits(0)
+        , num_misses(0)
+        , num_bypassed(0)
+        , num_flushes(0)
+      {
+      }
+
+      MergeFnMemo::~MergeFnMemo()
+      {
+      }
+
+      sem_elem_t MergeFnMemo::apply( merge_fn_t mf, sem_elem_t w1, sem_elem_t w2 )
+      {
+        if( max_size == 0 || !mf->isPure() || !w1.is_valid() || !w2.is_valid() ) {
+          num_bypassed++;
+          return mf->apply_f(w1,w2);
+        }
+        MemoKey key(mf,w1,w2);
+        table_t::const_iterator it = table.find(key);
+        if( it != table.end() ) {
+          num_hits++;
+          return it->second;
+        }
+        num_misses++;
+        sem_elem_t result = mf->apply_f(w1,w2);
+        if( table.size() >= max_size ) {
+          table.clear();
+          num_flushes++;
+        }
+        table.insert(std::make_pair(key,result));
+        return result;
+      }
+
+      void MergeFnMemo::clear()
+      {
+        table.clear();
+      }
+
+      void MergeFnMemo::setCapacity( size_t capacity )
+      {
+        max_size = capacity;
+        if( table.size() > max_size ) {
+          table.clear();
+        }
+      }
+
+      void MergeFnMemo::resetCounters()
+      {
+        num_hits = num_misses = num_bypassed = num_flushes = 0;
+      }
+
+      std::ostream& MergeFnMemo::print( std::ostream& o ) const
+      {
+        o << "   merge memo: " << table.size() << "/" << max_size << " entries\n"
+          << "   merge hits:     " << num_hits << "\n"
+          << "   merge misses:   " << num_misses << "\n"
+          << "   merge bypassed: " << num_bypassed << "\n"
+          << "   merge flushes:  " << num_flushes << "\n";
+        return o;
+      }
+
+    } // namespace ewpds
+
+  } // namespace wpds
+
+} // namespace wali
+
@@ -0,0 +1,121 @@
+#ifndef wali_wpds_ewpds_MERGE_FN_MEMO_GUARD
+#define wali_wpds_ewpds_MERGE_FN_MEMO_GUARD 1
+
+#include "wali/Common.hpp"
+#include "wali/Countable.hpp"
+#include "wali/IMergeFn.hpp"
+#include "wali/util/unordered_map.hpp"
+
+#include <iostream>
+
+namespace wali
+{
+  namespace wpds
+  {
+    namespace ewpds
+    {
+      class MergeFnMemo;
+      typedef ref_ptr<MergeFnMemo> merge_memo_t;
+
+      /**
+       * @class MergeFnMemo
+       * @brief Memoizes the results of pure merge functions
+       *
+       * An EWPDS applies a merge function at every return site. Call
+       * sites often share a merge function, so the same (merge function,
+       * caller weight, callee weight) triple is merged over and over.
+       * apply() remembers the result of each triple whose merge function
+       * is pure (see IMergeFn::isPure) and returns it on the next request.
+       * Merges by impure functions are passed straight through.
+       *
+       * Entries are keyed on the identity of the merge function and on
+       * the hash and equality of the two weights, so the weights of a
+       * pure merge function must implement SemElem::hash.
+       *
+       * The table holds at most capacity() entries. It is not an LRU
+       * cache: when it is full it is flushed entirely (see flushes())
+       * before the next entry is added.
+       */
+      class MergeFnMemo : public Countable
+      {
+        public:
+          static const size_t DEFAULT_CAPACITY = 1 << 16;
+
+          explicit MergeFnMemo( size_t capacity = DEFAULT_CAPACITY );
+
+          ~MergeFnMemo();
+
+          /**
+           * @return mf->apply_f(w1,w2), reusing an earlier result
+           *         if mf is pure
+           */
+          sem_elem_t apply( merge_fn_t mf, sem_elem_t w1, sem_elem_t w2 );
+
+          /** Empties the table. The counters are kept. */
+          void clear();
+
+          /** Sets the number of entries kept. 0 turns memoization off. */
+          void setCapacity( size_t capacity );
+
+          size_t capacity() const { return max_size; }
+          size_t size() const { return table.size(); }
+
+          /// Merges answered from the table
+          size_t hits() const { return num_hits; }
+
+          /// Merges by a pure function that had to be computed
+          size_t misses() const { return num_misses; }
+
+          /// Merges by an impure function
+          size_t bypassed() const { return num_bypassed; }
+
+          /// Times the table was emptied because it was full
+          size_t flushes() const { return num_flushes; }
+
+          void resetCounters();
+
+          std::ostream& print( std::ostream& o ) const;
+
+        private:
+          struct MemoKey
+          {
+            merge_fn_t mf;
+            sem_elem_t w1;
+            sem_elem_t w2;
+            size_t hashval;
+
+            MemoKey( merge_fn_t f, sem_elem_t a, sem_elem_t b );
+          };
+
+          struct MemoKeyHash
+          {
+            size_t operator()( const MemoKey& k ) const { return k.hashval; }
+          };
+
+          struct MemoKeyEqual
+          {
+            bool operator()( const MemoKey& a, const MemoKey& b ) const;
+          };
+
+          typedef util::unordered_map< MemoKey, sem_elem_t,
+                                       MemoKeyHash, MemoKeyEqual > table_t;
+
+          table_t table;
+          size_t max_size;
+          size_t num_hits;
+          size_t num_misses;
+          size_t num_bypassed;
+          size_t num_flushes;
+
+          MergeFnMemo( const MergeFnMemo& );
+          MergeFnMemo& operator=( const MergeFnMemo& );
+      };
+
+    } // namespace ewpds
+
+  } // namespace wpds
+
+} // namespace wali
+
+#endif  // wali_wpds_ewpds_MERGE_FN_MEMO_GUARD
+
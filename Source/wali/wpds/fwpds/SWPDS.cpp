@@ -1,4 +1,5 @@
 #include "wali/wfa/State.hpp"
+#include "wali/wpds/Config.hpp"
 #include "wali/wpds/ewpds/ETrans.hpp"
 #include "wali/wpds/fwpds/SWPDS.hpp"
 #include "wali/graph/GraphCommon.hpp"
@@ -41,12 +42,12 @@ namespace wali
 
       const std::string SWPDS::XMLTag("SWPDS");
 
-      SWPDS::SWPDS() : FWPDS(), preprocessed(false), sgr(NULL) 
+      SWPDS::SWPDS() : FWPDS(), preprocessed(false), num_preprocessed(0), sgr(NULL) 
       { 
       }
 
       SWPDS::SWPDS(ref_ptr<Wrapper> wr) : 
-        FWPDS(wr), preprocessed(false), sgr(NULL) 
+        FWPDS(wr), preprocessed(false), num_preprocessed(0), sgr(NULL) 
       { 
       }
 
@@ -58,11 +59,24 @@ namespace wali
       }
 
       void SWPDS::addEntryPoint(Key n) {
-        syms.entryPoints.insert(n);
+        if(entry_points.insert(n).second) {
+          invalidateSummaries();
+        }
       }
 
-      // Carried over from WPDS to ensure that no rules are added after
-      // SWPDS is preprocessed
+      void SWPDS::invalidateSummaries() {
+        if(sgr != NULL) {
+          delete sgr;
+          sgr = NULL;
+        }
+        syms = WpdsStackSymbols();
+        pre_pds.clear();
+        interGr = NULL;
+        preprocessed = false;
+      }
+
+      // Carried over from WPDS. Discards the summaries if the rule
+      // set changes after SWPDS is preprocessed
       bool SWPDS::make_rule(
           Config *f,
           Config *t,
@@ -70,17 +84,50 @@ namespace wali
 	  bool replace_weight,
           rule_t& r ) 
       {
+        if(!preprocessed) {
+          return WPDS::make_rule(f,t,stk2,replace_weight,r);
+        }
 
-        if(preprocessed) {
-          *waliErr << "[ERROR] SWPDS cannot add rules after calling preprocess.\n";
-          assert(0);
+        sem_elem_t old_weight;
+        for(Config::iterator it = f->begin(); it != f->end(); it++) {
+          rule_t tmp = *it;
+          if(tmp->to_state() == t->state() && tmp->to_stack1() == t->stack()
+             && tmp->to_stack2() == stk2) {
+            old_weight = tmp->weight();
+            break;
+          }
         }
 
-        return WPDS::make_rule(f,t,stk2,replace_weight,r);
+        bool exists = WPDS::make_rule(f,t,stk2,replace_weight,r);
+        if(!exists || !r->weight()->equal(old_weight)) {
+          invalidateSummaries();
+        }
+        return exists;
+      }
+
+      bool SWPDS::erase_rule(
+          Key from_state,
+          Key from_stack,
+          Key to_state,
+          Key to_stack1,
+          Key to_stack2 )
+      {
+        bool erased = FWPDS::erase_rule(from_state, from_stack, to_state, to_stack1, to_stack2);
+        if(erased) {
+          invalidateSummaries();
+        }
+        return erased;
+      }
+
+      void SWPDS::clear() {
+        invalidateSummaries();
+        FWPDS::clear();
       }
 
       void SWPDS::preprocess() {
-        assert(!preprocessed);
+        if(preprocessed) {
+          return;
+        }
         assert(theZero.is_valid());
 
         if(pds_states.size() != 1) {
@@ -91,6 +138,7 @@ namespace wali
         Key start_state = *pds_states.begin();
 
         // Get all EWPDS symbols
+        syms.entryPoints = entry_points;
         for_each(syms);
 
         // Create an automaton Agrow with transitions (start_state, e, <start_state,e>)
@@ -113,8 +161,6 @@ namespace wali
         Agrow.setGeneration(Agrow.getGeneration() - 1);
         currentOutputWFA = 0;
 
-        cout << "Entry points found: " << syms.entryPoints.size() << "\n";
-        
         // Then run FWPDS post* on Agrow and get the InterGraph that it creates
         wfa::WFA postAgrow;
         poststarIGR(Agrow, postAgrow);
@@ -143,6 +189,7 @@ namespace wali
         for_each(cr);
         
         preprocessed = true;
+        num_preprocessed++;
       }
 
       bool SWPDS::reachable(Key k) {
@@ -157,10 +204,9 @@ namespace wali
 
       void SWPDS::poststar(wfa::WFA const & ca_in, wfa::WFA &ca_out) {
 
-        if(!preprocessed) {
-          *waliErr << "SWPDS: Error: Must preprocess before running query\n";
-          assert(0);
-        }
+        // The summaries are kept across queries; compute them only if
+        // this is the first query or the rules changed since the last one
+        preprocess();
 
         if(&ca_out != &ca_in) {
           ca_out.clear();
@@ -189,10 +235,9 @@ namespace wali
       //TODO: Can probably implement this like poststar, where SummaryGraph
       //creates regexp for performing saturation. But this is OK for now.
       void SWPDS::prestar(wfa::WFA const & ca_in, wfa::WFA &ca_out) {
-        if(!preprocessed) {
-          *waliErr << "SWPDS: Error: Must preprocess before running query\n";
-          assert(0);
-        }
+        // The summaries are kept across queries; compute them only if
+        // this is the first query or the rules changed since the last one
+        preprocess();
 
         if(&ca_out != &ca_in) {
           ca_out.operator=(ca_in);
@@ -77,10 +77,41 @@ namespace wali
         void nonSummaryPoststar( wfa::WFA &input, wfa::WFA &output);
 
         void addEntryPoint(Key e);
+
+        /*!
+         * Computes the procedure summaries. The summaries depend only on
+         * the rules, so they are kept and shared by every later prestar
+         * and poststar query, whatever its input automaton. A query
+         * calls preprocess itself if the summaries are missing.
+         *
+         * Adding a rule that changes the rule set (a new rule, or a new
+         * weight on an existing one), erasing a rule, or clearing the
+         * SWPDS discards the summaries; the next query recomputes them.
+         * Re-adding a rule with a weight it already has keeps them.
+         */
         void preprocess();
+
+        /*! @return true if the summaries are computed and current */
+        bool isPreprocessed() const { return preprocessed; }
+
+        /*! Discards the summaries */
+        void invalidateSummaries();
+
+        /*! @return the number of times the summaries were computed */
+        size_t numPreprocessed() const { return num_preprocessed; }
+
         bool reachable(Key k);
         bool multiple_proc(Key k);
 
+        virtual bool erase_rule(
+            Key from_state,
+            Key from_stack,
+            Key to_state,
+            Key to_stack1,
+            Key to_stack2 );
+
+        virtual void clear();
+
       private:
         virtual bool make_rule(
             Config *f,
@@ -102,8 +133,10 @@ namespace wali
         }
 
       private:
+        std::set<Key> entry_points; // Given to addEntryPoint
         WpdsStackSymbols syms;
         bool preprocessed;
+        size_t num_preprocessed;
         EWPDS pre_pds;
         graph::SummaryGraph *sgr;
       }; // class SWPDS
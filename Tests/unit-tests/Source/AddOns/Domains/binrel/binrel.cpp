@@ -1392,6 +1392,122 @@ namespace{
     bdd b = p.Assume(p.From("a"), p.Const(0));
     ASSERT_NE(b, bddfalse);
   }
+
+  TEST(wali$domains$binrel$$BinRel, memoMatchesRecomputing)
+  {
+    program_bdd_context_t con = new ProgramBddContext();
+    map< string, int> m;
+    m["a"] = 4;
+    m["b"] = 4;
+    con->setIntVars(m);
+    EXPECT_EQ((size_t) BINREL_MEMO_CAPACITY, con->getMemoCapacity());
+
+    binrel_t inc = new BinRel(con.get_ptr(), con->Assign("a", con->Plus(con->From("a"), con->Const(1))));
+    binrel_t copy = new BinRel(con.get_ptr(), con->Assign("b", con->From("a")));
+
+    binrel_t composed = inc->Compose(copy);
+    binrel_t unioned = inc->Union(copy);
+    sem_elem_t starred = inc->star();
+
+    // The second time round these come out of the memo; union in either order
+#ifdef BINREL_STATS
+    con->resetStats();
+#endif
+    EXPECT_TRUE(composed->Equal(inc->Compose(copy)));
+    EXPECT_TRUE(unioned->Equal(copy->Union(inc)));
+    EXPECT_TRUE(starred->equal(inc->star()));
+#ifdef BINREL_STATS
+    stringstream ss;
+    con->printStats(ss);
+    EXPECT_NE(string::npos, ss.str().find("#MemoHits: 3 / 3"));
+#endif
+
+    // Shrinking to nothing switches it off, and answers don't change
+    con->setMemoCapacity(0);
+    EXPECT_TRUE(composed->Equal(inc->Compose(copy)));
+    EXPECT_TRUE(starred->equal(inc->star()));
+
+    // A tiny memo still gives the same answers while evicting
+    con->setMemoCapacity(2);
+    binrel_t w = inc;
+    for(int i = 0; i < 8; ++i)
+      w = w->Compose(inc)->Union(copy);
+    binrel_t v = inc;
+    for(int i = 0; i < 8; ++i)
+      v = v->Compose(inc)->Union(copy);
+    EXPECT_TRUE(w->Equal(v));
+
+    // Adding a variable changes what star means, so the memo is dropped
+    con->setMemoCapacity(BINREL_MEMO_CAPACITY);
+    sem_elem_t before = copy->star();
+    con->addIntVar("c", 2);
+    binrel_t copyAfter = new BinRel(con.get_ptr(), copy->getBdd());
+    EXPECT_FALSE(before->equal(copyAfter->star()));
+  }
+
+  TEST(wali$domains$binrel$$BinRel, transferBetweenContexts)
+  {
+    // Same variables, allocated differently
+    program_bdd_context_t left = new ProgramBddContext();
+    map< string, int> m;
+    m["x"] = 4;
+    m["y"] = 4;
+    left->setIntVars(m);
+    program_bdd_context_t right = new ProgramBddContext();
+    right->addIntVar("y", 4);
+    right->addIntVar("x", 4);
+    program_bdd_context_t other = new ProgramBddContext();
+    other->addIntVar("y", 4);
+
+    binrel_t inLeft = new BinRel(left.get_ptr(),
+        left->Assign("y", left->Plus(left->From("y"), left->From("x"))));
+    binrel_t inRight = new BinRel(right.get_ptr(),
+        right->Assign("y", right->Plus(right->From("y"), right->From("x"))));
+    EXPECT_NE(inLeft->getBdd(), inRight->getBdd());
+
+    binrel_t moved = inLeft->transferTo(right.get_ptr());
+    EXPECT_EQ(right.get_ptr(), &moved->getVocabulary());
+    EXPECT_TRUE(moved->Equal(inRight));
+    EXPECT_TRUE(moved->transferTo(left.get_ptr())->Equal(inLeft));
+
+    // Tensored relations keep their plies
+    binrel_t tensored = inLeft->Kronecker(inLeft);
+    EXPECT_TRUE(tensored->transferTo(right.get_ptr())->Equal(inRight->Kronecker(inRight)));
+
+    // The saved form names variables, not BDD levels
+    stringstream ss;
+    inLeft->save(ss);
+    EXPECT_TRUE(BinRel::load(right.get_ptr(), ss)->Equal(inRight));
+
+#ifdef NDEBUG
+    stringstream mismatched;
+    inLeft->save(mismatched);
+    EXPECT_TRUE(BinRel::load(other.get_ptr(), mismatched)->isZero());
+    stringstream truncated(ss.str().substr(0, ss.str().size() / 2));
+    EXPECT_TRUE(BinRel::load(right.get_ptr(), truncated)->isZero());
+#endif
+  }
+
+  TEST(wali$domains$binrel$$BinRel, saveAndLoadAcrossBuddyRestarts)
+  {
+    // Each process has its own BuDDy kernel; shutting BuDDy down and
+    // starting it again with a differently built context stands in for that
+    stringstream ss;
+    {
+      program_bdd_context_t con = new ProgramBddContext();
+      con->addIntVar("a", 4);
+      con->addIntVar("b", 4);
+      binrel_t r = new BinRel(con.get_ptr(), con->Assign("a", con->From("b")));
+      r->Kronecker(r)->save(ss);
+    }
+    program_bdd_context_t con = new ProgramBddContext();
+    map< string, int> m;
+    m["a"] = 4;
+    m["b"] = 4;
+    con->setIntVars(m);
+    binrel_t r = new BinRel(con.get_ptr(), con->Assign("a", con->From("b")));
+    EXPECT_TRUE(BinRel::load(con.get_ptr(), ss)->Equal(r->Kronecker(r)));
+  }
 } //namespace
 
 
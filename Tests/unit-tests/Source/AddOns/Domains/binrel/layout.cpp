@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+#include "buddy/bdd.h"
+
+// ::std
+#include <map>
+#include <string>
+#include <vector>
+
+// ::wali::domains::binrel
+#include "wali/domains/binrel/ProgramBddContext.hpp"
+#include "wali/domains/binrel/BinRel.hpp"
+
+using namespace std;
+using namespace wali::domains::binrel;
+
+namespace{
+
+  class BinRelLayoutTest: public ::testing::Test{
+    protected:
+      program_bdd_context_t brm;
+      binrel_t b1, b2;
+
+      virtual void SetUp(){
+        brm = new ProgramBddContext();
+        map<string, int> vars;
+        vars["a"] = 4;
+        vars["b"] = 4;
+        vars["c"] = 2;
+        brm->setIntVars(vars);
+        brm->addIntVar("d", 3);
+
+        b1 = new BinRel(brm.get_ptr(), brm->Assign("a", brm->Plus(brm->From("b"), brm->From("d"))));
+        b2 = new BinRel(brm.get_ptr(),
+            brm->Assign("b", brm->From("a")) &
+            brm->Assume(brm->From("c"), brm->Const(1)));
+      }
+
+      // Detensoring a Kronecker product is the same as composing, whatever
+      // the layout and detensor method
+      void expectDetensorAgrees(){
+        binrel_t t = b1->Kronecker(b2);
+        EXPECT_TRUE(t->Eq23Project()->Equal(b1->Compose(b2)));
+        EXPECT_TRUE(t->Eq13Project()->Equal(b1->Transpose()->Compose(b2)));
+      }
+  };
+
+#if (NWA_DETENSOR != 1)
+  TEST_F(BinRelLayoutTest, allLayoutsDetensor){
+    BddContext::TensorLayout layouts[] = {
+      BddContext::MaxAffinityLayout,
+      BddContext::MinAffinityLayout,
+      BddContext::BaseMaxAffinityTensorMixedLayout,
+      BddContext::MatchedParenLayout
+    };
+    BddContext::DetensorMethod methods[] = {
+      BddContext::DetensorTogether,
+      BddContext::DetensorBitByBit
+    };
+
+    // Weights built before a switch have to stay the same relation
+    binrel_t before = b1->Compose(b2);
+    for(size_t l = 0; l < sizeof(layouts)/sizeof(layouts[0]); ++l){
+      brm->setTensorLayout(layouts[l]);
+      EXPECT_EQ(layouts[l], brm->getTensorLayout());
+      EXPECT_TRUE(before->Equal(b1->Compose(b2)));
+      for(size_t m = 0; m < sizeof(methods)/sizeof(methods[0]); ++m){
+        brm->setDetensorMethod(methods[m]);
+        EXPECT_EQ(methods[m], brm->getDetensorMethod());
+        expectDetensorAgrees();
+      }
+    }
+  }
+
+  TEST_F(BinRelLayoutTest, layoutSurvivesAddIntVar){
+    brm->setTensorLayout(BddContext::MinAffinityLayout);
+    brm->addIntVar("e", 4);
+    EXPECT_EQ(BddContext::MinAffinityLayout, brm->getTensorLayout());
+
+    binrel_t b3 = new BinRel(brm.get_ptr(), brm->Assign("e", brm->From("a")));
+    binrel_t t = b1->Kronecker(b3);
+    EXPECT_TRUE(t->Eq23Project()->Equal(b1->Compose(b3)));
+    expectDetensorAgrees();
+  }
+
+  TEST_F(BinRelLayoutTest, autoTune){
+    vector<binrel_t> samples;
+    samples.push_back(b1);
+    samples.push_back(b2);
+    BddContext::TensorLayout picked = brm->autoTune(samples);
+    EXPECT_EQ(picked, brm->getTensorLayout());
+    expectDetensorAgrees();
+  }
+
+  TEST_F(BinRelLayoutTest, reorderNow){
+    binrel_t before = b1->Compose(b2);
+    BddContext::reorderNow();
+    EXPECT_TRUE(before->Equal(b1->Compose(b2)));
+    expectDetensorAgrees();
+  }
+
+  TEST(BinRelReorderTest, reorderNowShrinksABadOrder){
+    // Grouping a and b apart puts all of a's bits above all of b's, so
+    // a' = b needs a node per assignment of b's bits until sifting
+    // interleaves them
+    program_bdd_context_t con = new ProgramBddContext();
+    vector<map<string, int> > groups(2);
+    groups[0]["a"] = 64;
+    groups[1]["b"] = 64;
+    con->setIntVars(groups);
+
+    binrel_t copy = new BinRel(con.get_ptr(), con->Assign("a", con->From("b")));
+    int before = bdd_nodecount(copy->getBdd());
+    BddContext::reorderNow();
+    EXPECT_LT(bdd_nodecount(copy->getBdd()), before);
+
+    binrel_t again = new BinRel(con.get_ptr(), con->Assign("a", con->From("b")));
+    EXPECT_TRUE(copy->Equal(again));
+    EXPECT_TRUE(copy->Compose(copy)->Equal(copy));
+
+    // Reordering leaves no variable blocks behind to stop layout changes
+    con->setTensorLayout(BddContext::MinAffinityLayout);
+    EXPECT_EQ(BddContext::MinAffinityLayout, con->getTensorLayout());
+    EXPECT_TRUE(copy->Equal(again));
+  }
+#endif
+
+}
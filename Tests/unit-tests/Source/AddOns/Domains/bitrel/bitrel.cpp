@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+
+#include <map>
+#include <string>
+#include <cstdlib>
+
+#include "wali/domains/bitrel/BitRel.hpp"
+
+using namespace wali;
+using namespace wali::domains::bitrel;
+using wali::domains::bitrel::details::BitMatrix;
+
+namespace {
+
+  BitMatrix
+  randomMatrix(size_t dim, unsigned seed, int percent)
+  {
+    std::srand(seed);
+    BitMatrix m(dim);
+    for (size_t i = 0; i < dim; ++i) {
+      for (size_t j = 0; j < dim; ++j) {
+        if (std::rand() % 100 < percent) {
+          m.set(i, j);
+        }
+      }
+    }
+    return m;
+  }
+
+  /// The obvious cubic implementation, to check the word-level one against
+  BitMatrix
+  slowProduct(BitMatrix const & a, BitMatrix const & b)
+  {
+    BitMatrix m(a.dim());
+    for (size_t i = 0; i < a.dim(); ++i) {
+      for (size_t j = 0; j < a.dim(); ++j) {
+        for (size_t k = 0; k < a.dim(); ++k) {
+          if (a.get(i, k) && b.get(k, j)) {
+            m.set(i, j);
+          }
+        }
+      }
+    }
+    return m;
+  }
+
+  /// Three variables, 5 * 5 * 3 = 75 states, so rows span two words and
+  /// blocks of a tensored row straddle word boundaries
+  struct ThreeVarContext
+  {
+    bitrel_context_t con;
+
+    ThreeVarContext()
+      : con(new BitRelContext())
+    {
+      std::map<std::string, int> vars;
+      vars["a"] = 5;
+      vars["b"] = 5;
+      con->setIntVars(vars);
+      con->addIntVar("c", 3);
+    }
+  };
+
+}
+
+
+namespace wali {
+  namespace domains {
+    namespace bitrel {
+
+      TEST(wali$domains$bitrel$BitRelContext, vocabulary)
+      {
+        BitRelContext con;
+        EXPECT_EQ(1u, con.numStates());
+
+        con.addBoolVar("x");
+        con.addIntVar("y", 3);
+        EXPECT_EQ(6u, con.numStates());
+        EXPECT_EQ(3u, con.getVarSize("y"));
+        EXPECT_FALSE(con.hasVar("z"));
+
+        std::map<std::string, unsigned> values;
+        values["x"] = 1;
+        values["y"] = 2;
+        size_t s = con.getState(values);
+        EXPECT_EQ(1u, con.getValue(s, "x"));
+        EXPECT_EQ(2u, con.getValue(s, "y"));
+      }
+
+
+      TEST(wali$domains$bitrel$BitRelContext, assignAndAssume)
+      {
+        BitRelContext con;
+        con.addBoolVar("x");
+        con.addIntVar("y", 4);
+
+        // y := y + 1
+        bitrel_t inc = con.Assign("y", con.Plus(con.From("y"), con.Const(1)));
+        // assume(x == 1)
+        bitrel_t xTrue = con.Assume(con.From("x"), con.True());
+        // x := !x
+        bitrel_t flip = con.Assign("x", con.Not(con.From("x")));
+
+        for (size_t s = 0; s < con.numStates(); ++s) {
+          unsigned x = con.getValue(s, "x");
+          unsigned y = con.getValue(s, "y");
+          for (size_t t = 0; t < con.numStates(); ++t) {
+            unsigned x2 = con.getValue(t, "x");
+            unsigned y2 = con.getValue(t, "y");
+            EXPECT_EQ(x2 == x && y2 == (y + 1) % 4, inc->contains(s, t));
+            EXPECT_EQ(s == t && x == 1, xTrue->contains(s, t));
+            EXPECT_EQ(y2 == y && x2 != x, flip->contains(s, t));
+          }
+        }
+
+        // Applying y++ four times gets back where we started
+        bitrel_t four = inc * inc * inc * inc;
+        EXPECT_TRUE(four->isOne());
+
+        // The star of y++ can reach any y, but never changes x
+        sem_elem_t reach = inc->star();
+        bitrel_t keepX = con.setPre("x")->Intersect(con.setPost("x"))
+                         | con.unsetPre("x")->Intersect(con.unsetPost("x"));
+        EXPECT_TRUE(reach->equal(keepX.get_ptr()));
+
+        // Something nondeterministic, then assume it's 2
+        bitrel_t havoc = con.Assign("y", con.NonDet());
+        bitrel_t pick = havoc * con.Assume(con.From("y"), con.Const(2));
+        EXPECT_TRUE(pick->Equal(con.setPost("y", 2)->Intersect(havoc)));
+      }
+
+
+      TEST(wali$domains$bitrel$BitMatrix, productMatchesNaive)
+      {
+        size_t dims[] = { 1, 7, 64, 65, 130 };
+        for (size_t i = 0; i < sizeof(dims)/sizeof(dims[0]); ++i) {
+          unsigned seed = static_cast<unsigned>(i);
+          BitMatrix a = randomMatrix(dims[i], 1 + seed, 10);
+          BitMatrix b = randomMatrix(dims[i], 100 + seed, 10);
+          EXPECT_TRUE(slowProduct(a, b) == a.product(b));
+        }
+      }
+
+
+      TEST(wali$domains$bitrel$BitRel, semElemLaws)
+      {
+        ThreeVarContext f;
+        bitrel_t r = new BitRel(f.con.get_ptr(), randomMatrix(f.con->numStates(), 7, 5));
+        test_semelem_impl(r);
+      }
+
+
+      TEST(wali$domains$bitrel$BitRel, starIsLeastFixpoint)
+      {
+        ThreeVarContext f;
+        bitrel_t r = new BitRel(f.con.get_ptr(), randomMatrix(f.con->numStates(), 3, 2));
+
+        sem_elem_t w = r->combine(r->one().get_ptr());
+        sem_elem_t wn = w->extend(w);
+        while (!w->equal(wn)) {
+          w = wn;
+          wn = wn->extend(wn);
+        }
+
+        EXPECT_TRUE(r->star()->equal(w));
+      }
+
+
+      TEST(wali$domains$bitrel$BitRel, detensorOfKronecker)
+      {
+        ThreeVarContext f;
+        size_t n = f.con->numStates();
+        bitrel_t r1 = new BitRel(f.con.get_ptr(), randomMatrix(n, 11, 5));
+        bitrel_t r2 = new BitRel(f.con.get_ptr(), randomMatrix(n, 12, 5));
+
+        bitrel_t t = r1->Kronecker(r2);
+        EXPECT_TRUE(t->isTensoredRel());
+        EXPECT_EQ(r1->contains(3, 70) && r2->contains(66, 1),
+                  t->contains(3*n + 66, 70*n + 1));
+
+        // Detensoring the Kronecker product composes the two relations...
+        EXPECT_TRUE(t->Eq23Project()->Equal(r1 * r2));
+
+        // ...and detensorTranspose composes the transpose of the first
+        EXPECT_TRUE(t->Eq13Project()->Equal(r1->Transpose() * r2));
+
+        // Tensoring distributes over extend
+        bitrel_t s1 = new BitRel(f.con.get_ptr(), randomMatrix(n, 13, 5));
+        bitrel_t s2 = new BitRel(f.con.get_ptr(), randomMatrix(n, 14, 5));
+        EXPECT_TRUE((t * s1->Kronecker(s2))->Equal((r1 * s1)->Kronecker(r2 * s2)));
+
+        EXPECT_TRUE(f.con->baseOne()->Kronecker(f.con->baseOne())->Equal(f.con->tensorOne()));
+      }
+
+
+      TEST(wali$domains$bitrel$BitRel, transferBetweenContexts)
+      {
+        // Same variables, different layouts
+        BitRelContext left, right;
+        left.addBoolVar("x");
+        left.addIntVar("y", 5);
+        right.addIntVar("y", 5);
+        right.addBoolVar("x");
+
+        BitRelContext other;
+        other.addIntVar("y", 5);
+        EXPECT_TRUE(left.sameVocabulary(right));
+        EXPECT_FALSE(left.sameVocabulary(other));
+
+        bitrel_t inLeft = left.Assign("y", left.Plus(left.From("y"), left.From("x")))
+                          * left.Assign("x", left.NonDet());
+        bitrel_t inRight = right.Assign("y", right.Plus(right.From("y"), right.From("x")))
+                           * right.Assign("x", right.NonDet());
+
+        EXPECT_FALSE(inLeft->getMatrix() == inRight->getMatrix());
+
+        bitrel_t moved = inLeft->transferTo(&right);
+        EXPECT_EQ(&right, &moved->getVocabulary());
+        EXPECT_TRUE(moved->Equal(inRight));
+        EXPECT_TRUE(moved->transferTo(&left)->Equal(inLeft));
+
+        // Tensored relations move pairwise
+        bitrel_t tensored = inLeft->Kronecker(left.setPre("x"));
+        EXPECT_TRUE(tensored->transferTo(&right)->Equal(inRight->Kronecker(right.setPre("x"))));
+      }
+
+    }
+  }
+}
@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <set>
+
+#include "wali/domains/genkill/BitVectorGenKill.hpp"
+#include "wali/domains/genkill/GenKillXformerTemplate.hpp"
+
+using namespace wali;
+using namespace wali::domains::genkill;
+
+namespace {
+
+    /// A random subset of [0, 200), or the complement of one
+    BitVectorSet
+    randomSet(std::set<size_t> & members, bool complement)
+    {
+        BitVectorSet s;
+        members.clear();
+        for (size_t i = 0; i < 200; ++i) {
+            if (std::rand() % 5 == 0) {
+                s.insert(i);
+                members.insert(i);
+            }
+        }
+        if (complement) {
+            std::set<size_t> comp;
+            for (size_t i = 0; i < 200; ++i) {
+                if (members.count(i) == 0) {
+                    comp.insert(i);
+                }
+            }
+            members.swap(comp);
+            return s.complement();
+        }
+        return s;
+    }
+
+    void
+    expectSameMembers(std::set<size_t> const & expected, BitVectorSet const & actual)
+    {
+        for (size_t i = 0; i < 300; ++i) {
+            // Everything from 200 up is in a complemented set
+            bool in_expected = i < 200 ? expected.count(i) > 0 : actual.contains(250);
+            EXPECT_EQ(in_expected, actual.contains(i));
+        }
+    }
+
+    sem_elem_t
+    randomTransformer()
+    {
+        std::set<size_t> ignored;
+        BitVectorSet kill = randomSet(ignored, std::rand() % 4 == 0);
+        BitVectorSet gen = randomSet(ignored, false);
+        return BitVectorGenKill::make(kill, gen);
+    }
+
+    BitVectorGenKill *
+    down(sem_elem_t se)
+    {
+        return dynamic_cast<BitVectorGenKill *>(se.get_ptr());
+    }
+
+}
+
+
+namespace wali {
+namespace domains {
+namespace genkill {
+
+TEST(wali$domains$genkill$BitVectorSet, operationsMatchStdSet)
+{
+    std::srand(17);
+    for (int round = 0; round < 50; ++round) {
+        std::set<size_t> a_members, b_members;
+        BitVectorSet a = randomSet(a_members, round % 2 == 0);
+        BitVectorSet b = randomSet(b_members, round % 3 == 0);
+
+        std::set<size_t> u, i, d;
+        for (size_t x = 0; x < 200; ++x) {
+            bool in_a = a_members.count(x) > 0, in_b = b_members.count(x) > 0;
+            if (in_a || in_b)  u.insert(x);
+            if (in_a && in_b)  i.insert(x);
+            if (in_a && !in_b) d.insert(x);
+        }
+
+        expectSameMembers(u, BitVectorSet::Union(a, b));
+        expectSameMembers(i, BitVectorSet::Intersect(a, b));
+        expectSameMembers(d, BitVectorSet::Diff(a, b));
+    }
+
+    BitVectorSet s = BitVectorSet::singleton(100000);
+    EXPECT_TRUE(s.contains(100000));
+    s.erase(100000);
+    EXPECT_TRUE(BitVectorSet::Eq(s, BitVectorSet::EmptySet()));
+    EXPECT_EQ(BitVectorSet::EmptySet().hash(), s.hash());
+    EXPECT_TRUE(BitVectorSet::EmptySet().complement().isUniverse());
+}
+
+
+TEST(wali$domains$genkill$BitVectorGenKill, transformersAreInterned)
+{
+    size_t before = BitVectorGenKill::numInterned();
+    {
+        BitVectorSet kill = BitVectorSet::singleton(3);
+        BitVectorSet gen = BitVectorSet::singleton(7);
+        sem_elem_t t1 = BitVectorGenKill::make(kill, gen);
+        // Kill is normalized to kill - gen, so this is the same transformer
+        sem_elem_t t2 = BitVectorGenKill::make(BitVectorSet::Union(kill, gen), gen);
+        EXPECT_EQ(t1.get_ptr(), t2.get_ptr());
+        EXPECT_TRUE(t1->equal(t2));
+        EXPECT_EQ(t1->hash(), t2->hash());
+
+        EXPECT_EQ(BitVectorGenKill::MkOne().get_ptr(),
+                  BitVectorGenKill::make(BitVectorSet(), BitVectorSet()).get_ptr());
+        EXPECT_EQ(BitVectorGenKill::MkBottom().get_ptr(),
+                  BitVectorGenKill::make(kill, BitVectorSet::UniverseSet()).get_ptr());
+
+        // Combining a transformer with itself builds nothing new
+        sem_elem_t t3 = t1->combine(t2);
+        EXPECT_EQ(t1.get_ptr(), t3.get_ptr());
+        EXPECT_GT(BitVectorGenKill::numInterned(), before);
+    }
+    // one and bottom stay, everything else goes away with its last reference
+    EXPECT_LE(BitVectorGenKill::numInterned(), before + 2);
+}
+
+
+TEST(wali$domains$genkill$BitVectorGenKill, matchesGenKillTransformerTemplate)
+{
+    typedef GenKillTransformer_T<BitVectorSet> Reference;
+
+    std::srand(23);
+    for (int round = 0; round < 30; ++round) {
+        sem_elem_t a = randomTransformer();
+        sem_elem_t b = randomTransformer();
+
+        sem_elem_t ra = Reference::makeGenKillTransformer_T(down(a)->getKill(), down(a)->getGen());
+        sem_elem_t rb = Reference::makeGenKillTransformer_T(down(b)->getKill(), down(b)->getGen());
+
+        sem_elem_t ext_se = a->extend(b), rext_se = ra->extend(rb);
+        BitVectorGenKill * ext = down(ext_se);
+        Reference * rext = dynamic_cast<Reference *>(rext_se.get_ptr());
+        EXPECT_TRUE(BitVectorSet::Eq(rext->getKill(), ext->getKill()));
+        EXPECT_TRUE(BitVectorSet::Eq(rext->getGen(), ext->getGen()));
+
+        sem_elem_t comb_se = a->combine(b), rcomb_se = ra->combine(rb);
+        BitVectorGenKill * comb = down(comb_se);
+        Reference * rcomb = dynamic_cast<Reference *>(rcomb_se.get_ptr());
+        EXPECT_TRUE(BitVectorSet::Eq(rcomb->getKill(), comb->getKill()));
+        EXPECT_TRUE(BitVectorSet::Eq(rcomb->getGen(), comb->getGen()));
+
+        // extend applies a, then b
+        std::set<size_t> ignored;
+        BitVectorSet input = randomSet(ignored, false);
+        EXPECT_TRUE(BitVectorSet::Eq(down(b)->apply(down(a)->apply(input)),
+                                     ext->apply(input)));
+    }
+}
+
+
+TEST(wali$domains$genkill$BitVectorGenKill, largeUniverse)
+{
+    // Kill the low half of 10^5 variables, keeping the high half, then
+    // gen one
+    BitVectorSet high;
+    for (size_t v = 50000; v < 100000; ++v) {
+        high.insert(v);
+    }
+    sem_elem_t keep_high = BitVectorGenKill::make(high.complement(), BitVectorSet());
+    sem_elem_t gen_top = BitVectorGenKill::make(BitVectorSet(), BitVectorSet::singleton(99999));
+
+    sem_elem_t composed = keep_high->extend(gen_top);
+    BitVectorGenKill * t = down(composed);
+    BitVectorSet out = t->apply(BitVectorSet::UniverseSet());
+    EXPECT_TRUE(out.contains(50000));
+    EXPECT_TRUE(out.contains(99999));
+    EXPECT_FALSE(out.contains(3));
+    EXPECT_FALSE(out.contains(100000));
+}
+
+
+TEST(wali$domains$genkill$BitVectorGenKill, callWaliTestSemElemImpl)
+{
+    std::srand(5);
+    test_semelem_impl(randomTransformer());
+}
+
+}
+}
+}
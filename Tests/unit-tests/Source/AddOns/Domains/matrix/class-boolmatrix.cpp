@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 
 #include <sstream>
+#include <cstdlib>
 #include <boost/scoped_ptr.hpp>
 
 #include "wali/domains/matrix/Matrix.hpp"
@@ -179,5 +180,82 @@ TEST(wali$domains$matrix$BoolMatrix, callWaliTestSemElemImpl)
     test_semelem_impl(m);
 }
 
+
+namespace {
+
+BoolMatrix::BackingMatrix
+randomBoolBacking(size_t rows, size_t cols, unsigned seed)
+{
+    std::srand(seed);
+    BoolMatrix::BackingMatrix m(rows, cols);
+    for (size_t i=0; i<rows; ++i) {
+        for (size_t j=0; j<cols; ++j) {
+            m(i,j) = (std::rand() % 20 == 0);
+        }
+    }
+    return m;
+}
+
+}
+
+
+TEST(wali$domains$matrix$BoolMatrix$$extend_raw, largeMatchesUblas)
+{
+    // Big enough for several words per row and more than one block
+    BoolMatrix::BackingMatrix
+        a = randomBoolBacking(70, 130, 1),
+        b = randomBoolBacking(130, 300, 2),
+        c = randomBoolBacking(70, 300, 3);
+    BoolMatrix ma(a), mb(b), mc(c);
+
+    BoolMatrix::BackingMatrix expected = boost::numeric::ublas::prod(a, b);
+    boost::scoped_ptr<BoolMatrix> product(ma.extend_raw(&mb));
+    EXPECT_EQ(expected, product->matrix());
+
+    BoolMatrix::BackingMatrix fused_expected = expected + c;
+    boost::scoped_ptr<BoolMatrix> fused(ma.extend_and_combine_raw(&mb, &mc));
+    EXPECT_EQ(fused_expected, fused->matrix());
+}
+
+
+TEST(wali$domains$matrix$BoolMatrix$$star, matchesRepeatedSquaring)
+{
+    BoolMatrix m(randomBoolBacking(100, 100, 4));
+
+    sem_elem_t w = m.combine(m.one().get_ptr());
+    sem_elem_t wn = w->extend(w);
+    while (!w->equal(wn)) {
+        w = wn;
+        wn = wn->extend(wn);
+    }
+
+    EXPECT_TRUE(m.star()->equal(w));
+}
+
+
+TEST(wali$domains$matrix$BoolMatrix$$extend_many, matchesExtend)
+{
+    sem_elem_t common = new BoolMatrix(randomBoolBacking(40, 70, 5));
+    sem_elem_t other = new BoolMatrix(randomBoolBacking(40, 70, 6));
+    sem_elem_t lhs[4], rhs[4], out[4];
+    for (unsigned i = 0; i < 4; ++i) {
+        lhs[i] = new BoolMatrix(randomBoolBacking(30, 40, 10 + i));
+        rhs[i] = common;
+    }
+
+    // All rhs the same, so the lhs matrices are stacked
+    common->extend_many(4, lhs, rhs, out);
+    for (unsigned i = 0; i < 4; ++i) {
+        EXPECT_TRUE(out[i]->equal(lhs[i]->extend(common)));
+    }
+
+    // Not all the same; also writes the results over rhs
+    rhs[2] = other;
+    sem_elem_t expected2 = lhs[2]->extend(other);
+    common->extend_many(4, lhs, rhs, rhs);
+    EXPECT_TRUE(rhs[0]->equal(out[0]));
+    EXPECT_TRUE(rhs[2]->equal(expected2));
+}
+
 }
 }
@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 
 #include <sstream>
+#include <cstdlib>
 #include <boost/scoped_ptr.hpp>
 
 #include "wali/domains/matrix/Matrix.hpp"
@@ -162,5 +163,71 @@ TEST(wali$domains$matrix$MinPlusIntMatrix, callWaliTestSemElemImpl)
     test_semelem_impl(m);
 }
 
+
+namespace {
+
+MinPlusIntMatrix::BackingMatrix
+randomMinPlusBacking(size_t rows, size_t cols, unsigned seed)
+{
+    typedef MinPlusIntMatrix::value_type Value;
+    std::srand(seed);
+    MinPlusIntMatrix::BackingMatrix m(rows, cols);
+    for (size_t i=0; i<rows; ++i) {
+        for (size_t j=0; j<cols; ++j) {
+            if (std::rand() % 4 == 0) {
+                m(i,j) = Value::make(std::rand() % 100);
+            }
+        }
+    }
+    return m;
+}
+
+}
+
+
+TEST(wali$domains$matrix$MinPlusIntMatrix$$extend_raw, largeMatchesUblas)
+{
+    MinPlusIntMatrix::BackingMatrix
+        a = randomMinPlusBacking(70, 130, 1),
+        b = randomMinPlusBacking(130, 300, 2),
+        c = randomMinPlusBacking(70, 300, 3);
+    MinPlusIntMatrix ma(a), mb(b), mc(c);
+
+    MinPlusIntMatrix::BackingMatrix expected = boost::numeric::ublas::prod(a, b);
+    boost::scoped_ptr<MinPlusIntMatrix> product(ma.extend_raw(&mb));
+    EXPECT_EQ(expected, product->matrix());
+
+    MinPlusIntMatrix::BackingMatrix fused_expected = expected + c;
+    boost::scoped_ptr<MinPlusIntMatrix> fused(ma.extend_and_combine_raw(&mb, &mc));
+    EXPECT_EQ(fused_expected, fused->matrix());
+}
+
+
+TEST(wali$domains$matrix$MinPlusIntMatrix$$star, matchesRepeatedSquaring)
+{
+    MinPlusIntMatrix m(randomMinPlusBacking(60, 60, 4));
+
+    sem_elem_t w = m.combine(m.one().get_ptr());
+    sem_elem_t wn = w->extend(w);
+    while (!w->equal(wn)) {
+        w = wn;
+        wn = wn->extend(wn);
+    }
+
+    EXPECT_TRUE(m.star()->equal(w));
+}
+
+
+TEST(wali$domains$matrix$MinPlusIntMatrix$$star_raw, negativeCycleHasNoStar)
+{
+    typedef MinPlusIntMatrix::value_type Value;
+    MinPlusIntMatrix::BackingMatrix b(2, 2);
+    b(0,1) = Value::make(-3);
+    b(1,0) = Value::make(1);
+    MinPlusIntMatrix m(b);
+
+    EXPECT_TRUE(m.star_raw() == NULL);
+}
+
 }
 }
@@ -0,0 +1,356 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "wali/MergeFn.hpp"
+#include "wali/MergeFnFactory.hpp"
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/WeightFactory.hpp"
+#include "wali/wpds/Rule.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/ewpds/EWPDS.hpp"
+#include "wali/wpds/FastWpdsReader.hpp"
+#include "wali/wfa/WFA.hpp"
+
+#include "opennwa/Nwa.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wpds::ewpds;
+using wali::wfa::WFA;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// Reads weights as ShortestPathSemiring marshalls them
+    struct ShortestPathFactory : WeightFactory
+    {
+        virtual sem_elem_t getWeight(std::string s) {
+            unsigned int n = 0;
+            EXPECT_EQ(1, std::sscanf(s.c_str(), " ShortestPathSemiring(%u)", &n));
+            return dist(n);
+        }
+    };
+
+    /// Reads merge functions as MergeFn prints them
+    struct ShortestPathMergeFactory : MergeFnFactory
+    {
+        virtual merge_fn_t getMergeFn(std::string s) {
+            unsigned int n = 0;
+            EXPECT_EQ(1, std::sscanf(s.c_str(), " MergeFn[ShortestPathSemiring(%u)]", &n));
+            return new MergeFn(dist(n));
+        }
+    };
+
+    /// The marshalled rules of pds, which marshall lists in no
+    /// particular order
+    std::multiset<std::string>
+    marshalledRules(WPDS const & pds)
+    {
+        std::ostringstream ss;
+        pds.marshall(ss);
+        std::string const s = ss.str();
+        std::string const close = "</" + Rule::XMLTag + ">";
+
+        std::multiset<std::string> rules;
+        size_t start = 0, end;
+        while ((end = s.find(close, start)) != std::string::npos) {
+            size_t open = s.find("<" + Rule::XMLTag, start);
+            rules.insert(s.substr(open, end - open));
+            start = end + close.size();
+        }
+        return rules;
+    }
+
+    /// A step, a push, another step and a pop for each of a few
+    /// procedures; the pushes carry merge functions if epds is given
+    void
+    addRules(WPDS & pds, EWPDS * epds)
+    {
+        Key p = getKey("reader p");
+        for (unsigned int i = 0; i < 5; ++i) {
+            std::stringstream name;
+            name << "proc " << i;
+            Key entry = getKey(name.str() + " entry");
+            Key call = getKey(name.str() + " call");
+            Key ret = getKey(name.str() + " ret");
+            Key exit = getKey(name.str() + " exit");
+
+            pds.add_rule(p, entry, p, call, dist(i));
+            if (epds != NULL) {
+                epds->add_rule(p, call, p, entry, ret, dist(1), new MergeFn(dist(i + 2)));
+            }
+            else {
+                pds.add_rule(p, call, p, entry, ret, dist(1));
+            }
+            pds.add_rule(p, ret, p, exit, dist(0));
+            pds.add_rule(p, exit, p, dist(3));
+        }
+    }
+
+    std::string
+    binaryDump(WPDS const & pds)
+    {
+        std::ostringstream out(std::ios::out | std::ios::binary);
+        FastWpdsReader::writeBinary(pds, out);
+        return out.str();
+    }
+
+    /// v as the four little-endian bytes the binary dump uses
+    std::string
+    u32Bytes(unsigned int v)
+    {
+        std::string b;
+        for (int i = 0; i < 4; ++i) {
+            b += static_cast<char>((v >> (8 * i)) & 0xFF);
+        }
+        return b;
+    }
+
+} // namespace
+
+
+TEST(wali$wpds$FastWpdsReader$$read, readsWhatWpdsMarshallWrites)
+{
+    WPDS original;
+    addRules(original, NULL);
+    std::stringstream xml;
+    original.marshall(xml);
+
+    ShortestPathFactory weights;
+    // A small block size makes the reader flush several times
+    FastWpdsReader reader(&weights, NULL, 3);
+    WPDS read;
+    ASSERT_EQ(0, reader.read(xml, read));
+
+    EXPECT_EQ(20u, reader.numRules());
+    EXPECT_EQ(original.count_rules(), read.count_rules());
+    EXPECT_EQ(marshalledRules(original), marshalledRules(read));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, readsWhatEwpdsMarshallWrites)
+{
+    EWPDS original;
+    addRules(original, &original);
+    std::stringstream xml;
+    original.marshall(xml);
+
+    ShortestPathFactory weights;
+    ShortestPathMergeFactory merges;
+    FastWpdsReader reader(&weights, &merges, 3);
+    EWPDS read;
+    ASSERT_EQ(0, reader.read(xml, read));
+
+    EXPECT_EQ(original.count_rules(), read.count_rules());
+    EXPECT_EQ(marshalledRules(original), marshalledRules(read));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$readBinary, roundTripsWriteBinary)
+{
+    ShortestPathFactory weights;
+    ShortestPathMergeFactory merges;
+
+    WPDS wpds;
+    addRules(wpds, NULL);
+    std::istringstream wpdsDump(binaryDump(wpds));
+    FastWpdsReader wpdsReader(&weights, NULL, 3);
+    WPDS wpdsRead;
+    ASSERT_EQ(0, wpdsReader.readBinary(wpdsDump, wpdsRead));
+    EXPECT_EQ(20u, wpdsReader.numRules());
+    EXPECT_EQ(marshalledRules(wpds), marshalledRules(wpdsRead));
+
+    EWPDS ewpds;
+    addRules(ewpds, &ewpds);
+    std::istringstream ewpdsDump(binaryDump(ewpds));
+    FastWpdsReader ewpdsReader(&weights, &merges);
+    EWPDS ewpdsRead;
+    ASSERT_EQ(0, ewpdsReader.readBinary(ewpdsDump, ewpdsRead));
+    EXPECT_EQ(marshalledRules(ewpds), marshalledRules(ewpdsRead));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, rejectsABadEntity)
+{
+    std::istringstream xml(
+        "<WPDS>\n"
+        "<Rule from='p' fromStack='a &bogus; b' to='p' toStack1='c'>"
+        "<Weight>ShortestPathSemiring(1)</Weight></Rule>\n"
+        "</WPDS>\n");
+    ShortestPathFactory weights;
+    FastWpdsReader reader(&weights);
+    WPDS pds;
+    EXPECT_NE(0, reader.read(xml, pds));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, rejectsAnUnterminatedRule)
+{
+    std::istringstream xml(
+        "<WPDS>\n"
+        "<Rule from='p' fromStack='a' to='p' toStack1='c'>"
+        "<Weight>ShortestPathSemiring(1)</Weight>\n"
+        "</WPDS>\n");
+    ShortestPathFactory weights;
+    FastWpdsReader reader(&weights);
+    WPDS pds;
+    EXPECT_NE(0, reader.read(xml, pds));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$readBinary, rejectsATruncatedDump)
+{
+    WPDS original;
+    addRules(original, NULL);
+    std::string const dump = binaryDump(original);
+
+    ShortestPathFactory weights;
+    // Cut in the string table, in the rules, and just before the end
+    size_t const cuts[] = { 4, 20, dump.size() / 2, dump.size() - 1 };
+    for (size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); ++i) {
+        std::istringstream truncated(dump.substr(0, cuts[i]));
+        FastWpdsReader reader(&weights);
+        WPDS pds;
+        EXPECT_NE(0, reader.readBinary(truncated, pds)) << "cut at " << cuts[i];
+    }
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$readBinary, rejectsAnOutOfRangeStringIndex)
+{
+    WPDS original;
+    original.add_rule(getKey("reader p"), getKey("reader a"),
+                      getKey("reader p"), getKey("reader b"), dist(1));
+    std::string dump = binaryDump(original);
+
+    // The dump ends with the seven 32-bit indices of the only rule; point
+    // its from-state past the string table
+    size_t const from = dump.size() - 7 * 4;
+    dump[from] = static_cast<char>(200);
+    dump[from + 1] = 0;
+    dump[from + 2] = 0;
+    dump[from + 3] = 0;
+
+    std::istringstream in(dump);
+    ShortestPathFactory weights;
+    FastWpdsReader reader(&weights);
+    WPDS pds;
+    EXPECT_NE(0, reader.readBinary(in, pds));
+    EXPECT_EQ(0, pds.count_rules());
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$readBinary, rejectsHugeCountsWithoutAllocatingThem)
+{
+    WPDS original;
+    original.add_rule(getKey("reader p"), getKey("reader a"),
+                      getKey("reader p"), getKey("reader b"), dist(1));
+    // The magic and the version
+    std::string const header = binaryDump(original).substr(0, 12);
+    ShortestPathFactory weights;
+
+    // About 4G strings, of which only one is there
+    {
+        std::istringstream in(header + u32Bytes(0xFFFFFFF0u) + u32Bytes(1) + "x");
+        FastWpdsReader reader(&weights);
+        WPDS pds;
+        EXPECT_NE(0, reader.readBinary(in, pds));
+    }
+
+    // One string of about 4GB, of which only a few bytes are there
+    {
+        std::istringstream in(header + u32Bytes(1) + u32Bytes(0xFFFFFFF0u) + "reader p");
+        FastWpdsReader reader(&weights);
+        WPDS pds;
+        EXPECT_NE(0, reader.readBinary(in, pds));
+    }
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, readsWhatWfaMarshallWrites)
+{
+    Key p = getKey("reader p"), q = getKey("reader q"), acc = getKey("reader acc");
+    WFA original(WFA::REVERSE);
+    original.addState(p, dist(0)->zero());
+    original.addState(q, dist(0)->zero());
+    original.addState(acc, dist(0)->zero());
+    original.setInitialState(p);
+    original.addFinalState(acc);
+    original.addFinalState(p);
+    original.addTrans(p, getKey("reader a"), q, dist(1));
+    original.addTrans(p, getKey("reader b"), q, dist(2));
+    original.addTrans(q, getKey("reader a"), acc, dist(3));
+    original.addTrans(q, WALI_EPSILON, acc, dist(4));
+    original.addTrans(p, getKey("reader c"), acc, dist(1));
+    std::stringstream xml;
+    original.marshall(xml);
+
+    ShortestPathFactory weights;
+    FastWpdsReader reader(&weights, NULL, 2);
+    WFA read;
+    ASSERT_EQ(0, reader.read(xml, read));
+
+    EXPECT_EQ(5u, reader.numRules());
+    EXPECT_EQ(WFA::REVERSE, read.getQuery());
+    EXPECT_TRUE(original.equal(read));
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, readsWhatNwaMarshallWrites)
+{
+    using opennwa::State;
+    using opennwa::Symbol;
+    State q0 = getKey("reader q0"), q1 = getKey("reader q1"),
+          q2 = getKey("reader q2"), q3 = getKey("reader q3");
+    Symbol a = getKey("reader a"), call = getKey("reader call"),
+           ret = getKey("reader ret");
+
+    opennwa::Nwa original;
+    original.addSymbol(getKey("reader unused"));
+    original.addState(getKey("reader lonely"));
+    original.addInitialState(q0);
+    original.addFinalState(q3);
+    original.addInternalTrans(q0, a, q1);
+    original.addInternalTrans(q1, opennwa::EPSILON, q0);
+    original.addCallTrans(q1, call, q2);
+    original.addInternalTrans(q2, opennwa::WILD, q2);
+    original.addReturnTrans(q2, q1, ret, q3);
+    std::stringstream xml;
+    original.marshall(xml);
+
+    FastWpdsReader reader(NULL, NULL, 2);
+    opennwa::Nwa read;
+    ASSERT_EQ(0, reader.read(xml, read));
+
+    EXPECT_EQ(5u, reader.numRules());
+    EXPECT_TRUE(original == read);
+}
+
+
+TEST(wali$wpds$FastWpdsReader$$read, rejectsMalformedWfaAndNwaElements)
+{
+    ShortestPathFactory weights;
+    FastWpdsReader reader(&weights);
+
+    // A transition without a weight
+    std::istringstream wfa_xml(
+        "<WFA query='INORDER'>\n"
+        "<Trans from='p' stack='a' to='q'></Trans>\n"
+        "</WFA>\n");
+    WFA fa;
+    EXPECT_NE(0, reader.read(wfa_xml, fa));
+
+    // A return transition without its call predecessor
+    std::istringstream nwa_xml(
+        "<XML>\n"
+        "<ReturnTrans from='p' symbol='r' to='q'/>\n"
+        "</XML>\n");
+    opennwa::Nwa nwa;
+    EXPECT_NE(0, reader.read(nwa_xml, nwa));
+}
@@ -1,3 +1,5 @@
+#include "gtest/gtest.h"
+
 #include "SimpleWeights.hpp"
 
 using wali::ShortestPathSemiring;
@@ -30,6 +32,20 @@ namespace testing
       dist50(new ShortestPathSemiring(50)),
       dist60(new ShortestPathSemiring(60)),
       semiring_zero = dist1->zero();
+
+    wali::sem_elem_t
+    dist(unsigned int n)
+    {
+      return new ShortestPathSemiring(n);
+    }
+
+    unsigned int
+    distanceOf(wali::sem_elem_t se)
+    {
+      ShortestPathSemiring * w = dynamic_cast<ShortestPathSemiring*>(se.get_ptr());
+      EXPECT_TRUE(w != NULL);
+      return w ? w->getNum() : 0u;
+    }
   }
 
   namespace ReachWeights
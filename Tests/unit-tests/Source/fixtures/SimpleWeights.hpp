@@ -1,5 +1,10 @@
+#ifndef WALI_TESTING_SIMPLE_WEIGHTS_HPP
+#define WALI_TESTING_SIMPLE_WEIGHTS_HPP
+
 #include "wali/ShortestPathSemiring.hpp"
 #include "wali/Reach.hpp"
+#include "wali/wfa/ITrans.hpp"
+#include "wali/wfa/TransFunctor.hpp"
 
 namespace testing
 {
@@ -16,6 +21,26 @@ namespace testing
       dist10, dist11, dist12, dist20, dist21, dist22,
       dist30, dist31, dist40, dist50, dist60,
       semiring_zero;
+
+    /// A new weight of length n, for lengths without a distN above
+    wali::sem_elem_t dist(unsigned int n);
+
+    /// The length of a ShortestPathSemiring weight
+    unsigned int distanceOf(wali::sem_elem_t se);
+
+    /// Sums the lengths of the transitions of a WFA, and counts them
+    struct SumDistances : wali::wfa::ConstTransFunctor
+    {
+      unsigned long total;
+      int count;
+
+      SumDistances() : total(0), count(0) {}
+
+      virtual void operator()(wali::wfa::ITrans const * t) {
+        total += distanceOf(t->weight());
+        ++count;
+      }
+    };
   }
 
   namespace ReachWeights
@@ -30,3 +55,5 @@ namespace testing
 //     c-basic-offset: 2
 //     indent-tabs-mode: nil
 // End:
+
+#endif
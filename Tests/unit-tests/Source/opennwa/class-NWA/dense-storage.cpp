@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/details/StateStorage.hpp"
+#include "opennwa/details/SymbolStorage.hpp"
+
+#include "Tests/unit-tests/Source/opennwa/int-client-info.hpp"
+
+using namespace opennwa;
+using opennwa::details::StateStorage;
+using opennwa::details::SymbolStorage;
+using opennwa::details::DenseKeyIndex;
+
+namespace opennwa
+{
+
+        TEST(opennwa$details$$StateStorage, denseNumbersAreContiguous)
+        {
+            StateStorage storage;
+            State q1 = getKey("dense q1");
+            State q2 = getKey("dense q2");
+            State q3 = getKey("dense q3");
+
+            storage.addState(q1);
+            storage.addInitialState(q2);
+            storage.addFinalState(q3);
+
+            EXPECT_EQ(0u, storage.denseIndex(q1));
+            EXPECT_EQ(1u, storage.denseIndex(q2));
+            EXPECT_EQ(2u, storage.denseIndex(q3));
+            EXPECT_EQ(q2, storage.denseState(1));
+            EXPECT_EQ(DenseKeyIndex::npos(), storage.denseIndex(getKey("dense nope")));
+
+            // Removing q1 gives its number to q3, which must keep being final
+            EXPECT_TRUE(storage.removeState(q1));
+            EXPECT_FALSE(storage.removeState(q1));
+
+            EXPECT_EQ(DenseKeyIndex::npos(), storage.denseIndex(q1));
+            EXPECT_EQ(0u, storage.denseIndex(q3));
+            EXPECT_EQ(q3, storage.denseState(0));
+
+            EXPECT_FALSE(storage.isState(q1));
+            EXPECT_TRUE(storage.isInitialState(q2));
+            EXPECT_FALSE(storage.isFinalState(q2));
+            EXPECT_FALSE(storage.isInitialState(q3));
+            EXPECT_TRUE(storage.isFinalState(q3));
+            EXPECT_EQ(2u, storage.sizeStates());
+            EXPECT_EQ(1u, storage.sizeInitialStates());
+            EXPECT_EQ(1u, storage.sizeFinalStates());
+        }
+
+
+        TEST(opennwa$details$$StateStorage, clientInfoFollowsRenumbering)
+        {
+            StateStorage storage;
+            State q1 = getKey("dense q1");
+            State q2 = getKey("dense q2");
+            State q3 = getKey("dense q3");
+
+            storage.addState(q1);
+            storage.addState(q2);
+            storage.setClientInfo(q3, new IntClientInfo(3));
+
+            EXPECT_TRUE(storage.isState(q3));
+            EXPECT_TRUE(storage.getClientInfo(q1) == NULL);
+
+            storage.removeState(q1);
+
+            IntClientInfo * info = dynamic_cast<IntClientInfo*>(storage.getClientInfo(q3).get_ptr());
+            ASSERT_TRUE(info != NULL);
+            EXPECT_EQ(3, info->n);
+            EXPECT_TRUE(storage.getClientInfo(q2) == NULL);
+            EXPECT_TRUE(storage.getClientInfo(q1) == NULL);
+
+            // Copies get their own client info
+            StateStorage copy(storage);
+            IntClientInfo * copied = dynamic_cast<IntClientInfo*>(copy.getClientInfo(q3).get_ptr());
+            ASSERT_TRUE(copied != NULL);
+            EXPECT_NE(info, copied);
+            EXPECT_EQ(3, copied->n);
+        }
+
+
+        TEST(opennwa$details$$SymbolStorage, removeAndReAddSymbols)
+        {
+            SymbolStorage storage;
+            Symbol a = getKey("dense a");
+            Symbol b = getKey("dense b");
+
+            EXPECT_TRUE(storage.addSymbol(a));
+            EXPECT_TRUE(storage.addSymbol(b));
+            EXPECT_FALSE(storage.addSymbol(a));
+            EXPECT_FALSE(storage.addSymbol(EPSILON));
+            EXPECT_EQ(b, storage.denseSymbol(storage.denseIndex(b)));
+
+            EXPECT_TRUE(storage.removeSymbol(a));
+            EXPECT_FALSE(storage.isSymbol(a));
+            EXPECT_TRUE(storage.isSymbol(b));
+            EXPECT_EQ(b, storage.denseSymbol(storage.denseIndex(b)));
+
+            SymbolStorage other;
+            other.addSymbol(a);
+            storage.addAllSymbols(other);
+            EXPECT_TRUE(storage.isSymbol(a));
+            EXPECT_EQ(2u, storage.sizeSymbols());
+        }
+
+}
@@ -0,0 +1,154 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/query/language.hpp"
+#include "opennwa/query/Monitor.hpp"
+
+#include "Tests/unit-tests/Source/opennwa/fixtures.hpp"
+#include "Tests/unit-tests/Source/opennwa/class-NWA/supporting.hpp"
+
+using namespace opennwa;
+
+#define NUM_ELEMENTS(array)  (sizeof(array)/sizeof((array)[0]))
+
+static Nwa const nwas[] = {
+    Nwa(),
+    AcceptsBalancedOnly().nwa,
+    AcceptsStrictlyUnbalancedLeft().nwa,
+    AcceptsPossiblyUnbalancedLeft().nwa,
+    AcceptsStrictlyUnbalancedRight().nwa,
+    AcceptsPossiblyUnbalancedRight().nwa,
+    AcceptsPositionallyConsistentString().nwa,
+    OddNumEvenGroupsNwa().nwa
+};
+
+static const unsigned num_nwas = NUM_ELEMENTS(nwas);
+
+static NestedWord const words[] = {
+    WordCollection().empty,
+    WordCollection().balanced,
+    WordCollection().balanced0,
+    WordCollection().unbalancedLeft,
+    WordCollection().unbalancedLeft0,
+    WordCollection().unbalancedRight,
+    WordCollection().unbalancedRight0,
+    WordCollection().fullyUnbalanced,
+    WordCollection().fullyUnbalanced0
+};
+
+static const unsigned num_words = NUM_ELEMENTS(words);
+
+
+static NestedWord
+prefix(NestedWord const & word, size_t length)
+{
+    NestedWord result;
+    for (NestedWord::const_iterator pos = word.begin();
+         pos != word.begin() + length; ++pos)
+    {
+        result.append(*pos);
+    }
+    return result;
+}
+
+
+namespace opennwa {
+        namespace query {
+
+            TEST(opennwa$query$Monitor, agreesWithLanguageContainsOnEveryPrefix)
+            {
+                for (unsigned nwa = 0 ; nwa < num_nwas ; ++nwa) {
+                    Monitor monitor(nwas[nwa]);
+
+                    for (unsigned word = 0 ; word < num_words ; ++word) {
+                        monitor.reset();
+                        EXPECT_EQ(languageContains(nwas[nwa], NestedWord()), monitor.accepting());
+
+                        for (size_t len = 1 ; len <= words[word].size() ; ++len) {
+                            std::stringstream ss;
+                            ss << "Current NWA number " << nwa << ", word number " << word
+                               << ", prefix length " << len;
+                            SCOPED_TRACE(ss.str());
+
+                            bool answer = monitor.process(*(words[word].begin() + len - 1));
+                            EXPECT_EQ(languageContains(nwas[nwa], prefix(words[word], len)), answer);
+                        }
+                    }
+                }
+            }
+
+
+            TEST(opennwa$query$Monitor, epsilonClosureAtStart)
+            {
+                Nwa nwa;
+                SomeElements e;
+
+                //              *           symbol
+                //  --> state ----->  state2 ----> ((state3))
+
+                nwa.addInitialState(e.state);
+                nwa.addFinalState(e.state3);
+
+                nwa.addInternalTrans(e.state, EPSILON, e.state2);
+                nwa.addInternalTrans(e.state2, e.symbol, e.state3);
+
+                Monitor monitor(nwa);
+                EXPECT_FALSE(monitor.accepting());
+                EXPECT_TRUE(monitor.processInternal(e.symbol));
+                EXPECT_FALSE(monitor.isStuck());
+            }
+
+
+            TEST(opennwa$query$Monitor, unknownSymbolGetsStuck)
+            {
+                AcceptsBalancedOnly balanced;
+                Monitor monitor(balanced.nwa);
+
+                EXPECT_TRUE(monitor.accepting());
+                EXPECT_FALSE(monitor.processInternal(getKey("not a symbol of the NWA")));
+                EXPECT_TRUE(monitor.isStuck());
+                EXPECT_FALSE(monitor.processInternal(getKey("0")));
+
+                monitor.reset();
+                EXPECT_TRUE(monitor.accepting());
+                EXPECT_FALSE(monitor.isStuck());
+            }
+
+
+            TEST(opennwa$query$Monitor, snapshotAndRestore)
+            {
+                AcceptsBalancedOnly balanced;
+                WordCollection words;
+                Monitor monitor(balanced.nwa);
+
+                monitor.processCall(words.call);
+                monitor.processCall(words.call);
+                EXPECT_EQ(2u, monitor.stackDepth());
+                EXPECT_FALSE(monitor.accepting());
+
+                Monitor::Snapshot snap;
+                monitor.snapshot(snap);
+
+                EXPECT_FALSE(monitor.processReturn(words.ret));
+                EXPECT_TRUE(monitor.processReturn(words.ret));
+                EXPECT_EQ(0u, monitor.stackDepth());
+
+                monitor.restore(snap);
+                EXPECT_EQ(2u, monitor.stackDepth());
+                EXPECT_FALSE(monitor.accepting());
+                EXPECT_FALSE(monitor.processReturn(words.ret));
+                EXPECT_TRUE(monitor.processReturn(words.ret));
+
+                // A copy of the monitor can pick up from the same snapshot
+                Monitor other(monitor);
+                other.reset();
+                other.restore(snap);
+                EXPECT_EQ(2u, other.stackDepth());
+                EXPECT_FALSE(other.processReturn(words.ret));
+                EXPECT_TRUE(other.processReturn(words.ret));
+            }
+
+    }
+}
@@ -0,0 +1,165 @@
+#include "gtest/gtest.h"
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/query/weighted.hpp"
+#include "opennwa/nwa_pds/conversions.hpp"
+#include "opennwa/WeightGen.hpp"
+
+#include "Tests/unit-tests/Source/opennwa/fixtures.hpp"
+#include "Tests/unit-tests/Source/opennwa/class-NWA/supporting.hpp"
+
+using namespace opennwa;
+using wali::wfa::WFA;
+
+#define NUM_ELEMENTS(array)  (sizeof(array)/sizeof((array)[0]))
+
+namespace {
+
+    /// Some fixtures use WILD, which ReachGen doesn't handle
+    struct WildReachGen : ReachGen
+    {
+        virtual sem_elem_t getWildWeight(Key, ClientInfoRefPtr, Key, ClientInfoRefPtr) const
+        {
+            return getOne();
+        }
+    };
+
+
+    Nwa
+    withShortcut()
+    {
+        // A call site with two entries, a return site reachable two ways,
+        // and an exit that returns to two different call sites
+        Nwa nwa = AcceptsPossiblyUnbalancedRight().nwa;
+        State q = getKey("saturation q");
+        State e = getKey("saturation e");
+        State x = getKey("saturation x");
+        State r = getKey("saturation r");
+        Symbol a = getKey("saturation a");
+
+        nwa.addInitialState(q);
+        nwa.addCallTrans(q, a, e);
+        nwa.addCallTrans(q, getKey("saturation b"), e);
+        nwa.addInternalTrans(e, a, x);
+        nwa.addInternalTrans(e, EPSILON, x);
+        nwa.addReturnTrans(x, q, a, r);
+        nwa.addReturnTrans(x, *nwa.beginInitialStates(), a, r);
+        nwa.addFinalState(r);
+        return nwa;
+    }
+
+    Nwa const saturation_nwas[] = {
+        AcceptsBalancedOnly().nwa,
+        AcceptsStrictlyUnbalancedLeft().nwa,
+        AcceptsPossiblyUnbalancedLeft().nwa,
+        AcceptsStrictlyUnbalancedRight().nwa,
+        AcceptsPossiblyUnbalancedRight().nwa,
+        AcceptsPositionallyConsistentString().nwa,
+        OddNumEvenGroupsNwa().nwa,
+        withShortcut()
+    };
+
+    const unsigned num_saturation_nwas = NUM_ELEMENTS(saturation_nwas);
+
+
+    /// The query automaton for "start in an initial state"
+    WFA
+    initialConfigurations(Nwa const & nwa, WeightGen const & wg)
+    {
+        State program = nwa_pds::getProgramControlLocation();
+        State accept = getKey("accept");
+
+        WFA fa;
+        fa.addState(program, wg.getOne()->zero());
+        fa.addState(accept, wg.getOne()->zero());
+        fa.setInitialState(program);
+        fa.addFinalState(accept);
+        for (Nwa::StateIterator q = nwa.beginInitialStates(); q != nwa.endInitialStates(); ++q) {
+            fa.addTrans(program, *q, accept, wg.getOne());
+        }
+        return fa;
+    }
+
+
+    /// The query automaton for "in a final state, with anything on the
+    /// stack"
+    WFA
+    finalConfigurations(Nwa const & nwa, WeightGen const & wg)
+    {
+        State program = nwa_pds::getProgramControlLocation();
+        State accept = getKey("accept");
+
+        WFA fa;
+        fa.addState(program, wg.getOne()->zero());
+        fa.addState(accept, wg.getOne()->zero());
+        fa.setInitialState(program);
+        fa.addFinalState(accept);
+        for (Nwa::StateIterator q = nwa.beginFinalStates(); q != nwa.endFinalStates(); ++q) {
+            fa.addTrans(program, *q, accept, wg.getOne());
+        }
+        for (Nwa::StateIterator q = nwa.beginStates(); q != nwa.endStates(); ++q) {
+            fa.addTrans(accept, *q, accept, wg.getOne());
+        }
+        return fa;
+    }
+
+
+    void
+    expectSameAsWpds(WeightGen const & wg)
+    {
+        for (unsigned i = 0; i < num_saturation_nwas; ++i) {
+            std::stringstream ss;
+            ss << "Testing NWA " << i;
+            SCOPED_TRACE(ss.str());
+
+            Nwa const & nwa = saturation_nwas[i];
+
+            WFA post_in = initialConfigurations(nwa, wg);
+            WFA post_native = query::poststar(nwa, wg, post_in);
+            WFA post_wpds = nwa_pds::NwaToWpdsCalls(nwa, wg).poststar(post_in);
+            EXPECT_TRUE(post_native.equal(post_wpds));
+
+            WFA pre_in = finalConfigurations(nwa, wg);
+            WFA pre_native = query::prestar(nwa, wg, pre_in);
+            WFA pre_wpds = nwa_pds::NwaToWpdsCalls(nwa, wg).prestar(pre_in);
+            EXPECT_TRUE(pre_native.equal(pre_wpds));
+
+            // Same answer when the output is also the input
+            WFA in_place = initialConfigurations(nwa, wg);
+            query::poststar(nwa, wg, in_place, in_place);
+            EXPECT_TRUE(in_place.equal(post_wpds));
+        }
+    }
+
+}
+
+
+namespace opennwa {
+    namespace query {
+
+        TEST(opennwa$query$$prestar$and$poststar, reachMatchesWpds)
+        {
+            WildReachGen wg;
+            expectSameAsWpds(wg);
+        }
+
+        TEST(opennwa$query$$prestar$and$poststar, shortestPathMatchesWpds)
+        {
+            ShortestPathGen wg;
+            expectSameAsWpds(wg);
+        }
+
+        TEST(opennwa$query$$poststar, shortestPathLengths)
+        {
+            Nwa nwa = withShortcut();
+            ShortestPathGen wg;
+
+            std::map<State, sem_elem_t> lengths = doForwardAnalysis(nwa, wg, wg.getOne());
+
+            // q -> e -> x -> r is a call, an internal, and a return
+            sem_elem_t three = new wali::ShortestPathSemiring(3);
+            EXPECT_TRUE(lengths[getKey("saturation r")]->equal(three));
+        }
+
+    }
+}
@@ -0,0 +1,147 @@
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/NwaParser.hpp"
+#include "opennwa/NwaBinary.hpp"
+
+#include "Tests/unit-tests/Source/opennwa/fixtures.hpp"
+#include "Tests/unit-tests/Source/opennwa/class-NWA/supporting.hpp"
+
+using namespace opennwa;
+
+#define NUM_ELEMENTS(array)  (sizeof(array)/sizeof((array)[0]))
+
+namespace opennwa {
+
+        static Nwa const binary_nwas[] = {
+            Nwa(),
+            AcceptsBalancedOnly().nwa,
+            AcceptsStrictlyUnbalancedLeft().nwa,
+            AcceptsPossiblyUnbalancedLeft().nwa,
+            AcceptsStrictlyUnbalancedRight().nwa,
+            AcceptsPossiblyUnbalancedRight().nwa,
+            AcceptsPositionallyConsistentString().nwa,
+            OddNumEvenGroupsNwa().nwa
+        };
+
+        static const unsigned num_binary_nwas = NUM_ELEMENTS(binary_nwas);
+
+
+        TEST(opennwa$$write_nwa_binary$and$read_nwa_binary, roundTripIsIdentity)
+        {
+            for (unsigned nwa = 0; nwa < num_binary_nwas; ++nwa) {
+                std::stringstream ss;
+                ss << "Testing NWA " << nwa;
+                SCOPED_TRACE(ss.str());
+
+                std::stringstream output(std::ios::in | std::ios::out | std::ios::binary);
+                write_nwa_binary(output, binary_nwas[nwa], "some_name");
+
+                std::string name;
+                NwaRefPtr again = read_nwa_binary(output, &name);
+
+                EXPECT_EQ(binary_nwas[nwa], *again);
+                EXPECT_EQ("some_name", name);
+            }
+        }
+
+
+        TEST(opennwa$$BinaryNwaImage, exposesDenseArrays)
+        {
+            OddNumEvenGroupsNwa fixture;
+            Nwa const & nwa = fixture.nwa;
+
+            std::stringstream output(std::ios::in | std::ios::out | std::ios::binary);
+            write_nwa_binary(output, nwa);
+            std::string bytes = output.str();
+
+            std::vector<BinaryNwaImage::Index> buffer(bytes.size() / sizeof(BinaryNwaImage::Index) + 1);
+            std::copy(bytes.begin(), bytes.end(), reinterpret_cast<char *>(&buffer[0]));
+
+            BinaryNwaImage image(reinterpret_cast<char const *>(&buffer[0]), bytes.size());
+
+            EXPECT_EQ(nwa.sizeStates(), image.numStates());
+            EXPECT_EQ(nwa.sizeSymbols(), image.numSymbols());
+            EXPECT_EQ(nwa.sizeInitialStates(), image.numInitialStates());
+            EXPECT_EQ(nwa.sizeFinalStates(), image.numFinalStates());
+            EXPECT_EQ(nwa.sizeInternalTrans(), image.numInternals());
+            EXPECT_EQ(nwa.sizeCallTrans(), image.numCalls());
+            EXPECT_EQ(nwa.sizeReturnTrans(), image.numReturns());
+            EXPECT_EQ("", image.name());
+
+            bool saw_epsilon = false;
+            for (unsigned i = 0; i < image.numInternals(); ++i) {
+                BinaryNwaImage::Index const * trans = image.internals() + 3*i;
+                if (trans[1] == BinaryNwaImage::epsilonSymbol) {
+                    saw_epsilon = true;
+                    EXPECT_EQ(fixture.q2, getKey(image.stateName(trans[0])));
+                    EXPECT_EQ(fixture.dummy, getKey(image.stateName(trans[2])));
+                }
+            }
+            EXPECT_TRUE(saw_epsilon);
+
+            EXPECT_EQ(nwa, *image.toNwa());
+        }
+
+
+        TEST(opennwa$$BinaryNwaImage, rejectsBadInput)
+        {
+            AcceptsBalancedOnly fixture;
+
+            std::stringstream output(std::ios::in | std::ios::out | std::ios::binary);
+            write_nwa_binary(output, fixture.nwa);
+            std::string bytes = output.str();
+
+            std::vector<BinaryNwaImage::Index> buffer(bytes.size() / sizeof(BinaryNwaImage::Index) + 1);
+            char * data = reinterpret_cast<char *>(&buffer[0]);
+            std::copy(bytes.begin(), bytes.end(), data);
+
+            // Truncated
+            EXPECT_THROW(BinaryNwaImage(data, bytes.size() - 4), BinaryNwaFormatException);
+
+            // Not a binary NWA at all
+            std::stringstream text;
+            fixture.nwa.print(text);
+            EXPECT_THROW(read_nwa_binary(text), BinaryNwaFormatException);
+
+            // A transition refers to a state that doesn't exist
+            BinaryNwaImage::Index * last = reinterpret_cast<BinaryNwaImage::Index *>(data + bytes.size()) - 1;
+            *last = 1000000;
+            EXPECT_THROW(BinaryNwaImage(data, bytes.size()), BinaryNwaFormatException);
+        }
+
+
+        TEST(opennwa$$read_nwa_file, readsEitherFormat)
+        {
+            AcceptsPossiblyUnbalancedLeft fixture;
+            char const * binary_filename = "binary-format-test.nwab";
+            char const * text_filename = "binary-format-test.nwa";
+
+            {
+                std::ofstream out(binary_filename, std::ios::out | std::ios::binary);
+                write_nwa_binary(out, fixture.nwa, "binary");
+            }
+            {
+                std::ofstream out(text_filename);
+                out << "nwa text :\n";
+                fixture.nwa.print(out);
+            }
+
+            std::string name;
+            NwaRefPtr from_binary = read_nwa_file(binary_filename, &name);
+            EXPECT_EQ(fixture.nwa, *from_binary);
+            EXPECT_EQ("binary", name);
+
+            NwaRefPtr from_text = read_nwa_file(text_filename, &name);
+            EXPECT_EQ(fixture.nwa, *from_text);
+            EXPECT_EQ("text", name);
+
+            std::remove(binary_filename);
+            std::remove(text_filename);
+        }
+
+}
@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/ShortestPathWorklist.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// Puts transitions with the given distances, then checks they come
+    /// out in non-decreasing order
+    void
+    checkOrder(Worklist<ITrans> & wl)
+    {
+        unsigned int distances[] = { 7, 3, 3, 100000, 0, (unsigned)-1, 12, 5 };
+        size_t n = sizeof(distances) / sizeof(distances[0]);
+        std::vector<Trans*> ts;
+        Key p = getKey("bucket p");
+        for (size_t i = 0; i < n; ++i) {
+            std::stringstream ss;
+            ss << "bucket a" << i;
+            ts.push_back(new Trans(p, getKey(ss.str()), p, dist(distances[i])));
+            EXPECT_TRUE(wl.put(ts.back()));
+        }
+        EXPECT_FALSE(wl.put(ts[0]));
+        EXPECT_EQ(n, wl.size());
+
+        unsigned int last = 0;
+        size_t got = 0;
+        while (!wl.empty()) {
+            ITrans * t = wl.get();
+            unsigned int d = distanceOf(t->weight());
+            EXPECT_LE(last, d);
+            EXPECT_FALSE(t->marked());
+            last = d;
+            ++got;
+        }
+        EXPECT_EQ(n, got);
+
+        // A rank below the last one removed is still accepted
+        EXPECT_TRUE(wl.put(ts[4]));
+        EXPECT_TRUE(wl.put(ts[1]));
+        EXPECT_EQ(ts[4], wl.get());
+        wl.clear();
+        EXPECT_TRUE(wl.empty());
+        EXPECT_FALSE(ts[1]->marked());
+
+        for (size_t i = 0; i < n; ++i) {
+            delete ts[i];
+        }
+    }
+
+    /// poststar of a random program with worklist wl
+    SumDistances
+    poststarWith(ref_ptr< Worklist<ITrans> > wl)
+    {
+        srand(17);
+        WPDS pds;
+        pds.setWorklist(wl);
+        Key p = getKey("bucket p");
+        for (int n = 0; n < 40; ++n) {
+            std::stringstream a, b, c;
+            a << "bucket n" << n;
+            b << "bucket n" << n + 1;
+            c << "bucket n" << rand() % 40;
+            pds.add_rule(p, getKey(a.str()), p, getKey(b.str()), dist(rand() % 10));
+            pds.add_rule(p, getKey(a.str()), p, getKey(c.str()), dist(rand() % 10));
+        }
+        WFA query;
+        Key acc = getKey("bucket acc");
+        query.addState(p, dist(0)->zero());
+        query.addState(acc, dist(0)->zero());
+        query.setInitialState(p);
+        query.addFinalState(acc);
+        query.addTrans(p, getKey("bucket n0"), acc, dist(0));
+
+        WFA answer;
+        pds.poststar(query, answer);
+        SumDistances sum;
+        answer.for_each(sum);
+        return sum;
+    }
+}
+
+
+TEST(wali$BucketWorklist, bucketQueueGivesLeastRankFirst)
+{
+    ShortestPathBucketWorklist wl;
+    checkOrder(wl);
+    ShortestPathBucketWorklist small(1, 8);
+    checkOrder(small);
+}
+
+TEST(wali$RadixHeapWorklist, radixHeapGivesLeastRankFirst)
+{
+    ShortestPathRadixWorklist wl;
+    checkOrder(wl);
+}
+
+TEST(wali$BucketWorklist, poststarAgreesWithOtherWorklists)
+{
+    SumDistances expected = poststarWith(new ShortestPathWorklist());
+    SumDistances bucket = poststarWith(new ShortestPathBucketWorklist());
+    SumDistances calendar = poststarWith(new ShortestPathBucketWorklist(4));
+    SumDistances radix = poststarWith(new ShortestPathRadixWorklist());
+
+    EXPECT_GT(expected.count, 0);
+    EXPECT_EQ(expected.count, bucket.count);
+    EXPECT_EQ(expected.total, bucket.total);
+    EXPECT_EQ(expected.count, calendar.count);
+    EXPECT_EQ(expected.total, calendar.total);
+    EXPECT_EQ(expected.count, radix.count);
+    EXPECT_EQ(expected.total, radix.total);
+}
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/WeightInterner.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+
+namespace {
+
+    struct DistanceFactory : WeightFactory
+    {
+        virtual sem_elem_t getWeight(std::string s) {
+            return new ShortestPathSemiring(std::atoi(s.c_str()));
+        }
+    };
+
+    /// Counts the transitions whose weights are canonical in the interner
+    struct CanonicalChecker : ConstTransFunctor
+    {
+        weight_interner_t interner;
+        int num_canonical;
+
+        CanonicalChecker(weight_interner_t i) : interner(i), num_canonical(0) {}
+
+        virtual void operator()(ITrans const * t) {
+            if (interner->isCanonical(t->weight())) {
+                ++num_canonical;
+            }
+        }
+    };
+
+    /// A chain p --a0--> ... over nine stack symbols, where each step
+    /// costs 1 and a shortcut from a0 to a8 costs 5
+    void
+    addChain(WPDS & pds, Key p)
+    {
+        sem_elem_t one_step = new ShortestPathSemiring(1);
+        for (int i = 0; i < 8; ++i) {
+            std::stringstream from, to;
+            from << "a" << i;
+            to << "a" << i + 1;
+            pds.add_rule(p, getKey(from.str()), p, getKey(to.str()), one_step);
+        }
+        pds.add_rule(p, getKey("a0"), p, getKey("a8"), new ShortestPathSemiring(5));
+    }
+
+    WFA
+    chainQuery(Key p, Key accept)
+    {
+        WFA query;
+        sem_elem_t zero = ShortestPathSemiring(0).zero();
+        query.addState(p, zero);
+        query.addState(accept, zero);
+        query.setInitialState(p);
+        query.addFinalState(accept);
+        query.addTrans(p, getKey("a0"), accept, ShortestPathSemiring(0).one());
+        return query;
+    }
+
+}
+
+
+TEST(wali$WeightInterner, equalWeightsShareAnInstance)
+{
+    WeightInterner interner;
+    sem_elem_t a = interner.intern(new ShortestPathSemiring(3));
+    sem_elem_t b = interner.intern(new ShortestPathSemiring(3));
+    sem_elem_t c = interner.intern(new ShortestPathSemiring(4));
+
+    EXPECT_EQ(a.get_ptr(), b.get_ptr());
+    EXPECT_NE(a.get_ptr(), c.get_ptr());
+    EXPECT_TRUE(interner.isCanonical(a));
+    EXPECT_FALSE(interner.isCanonical(new ShortestPathSemiring(4)));
+    EXPECT_EQ(2u, interner.size());
+    EXPECT_EQ(3u, interner.numLookups());
+    EXPECT_EQ(1u, interner.numHits());
+
+    EXPECT_TRUE(interner.intern(0).is_empty());
+}
+
+
+TEST(wali$WeightInterner, sweepDropsUnreferencedWeights)
+{
+    WeightInterner interner;
+    sem_elem_t kept = interner.intern(new ShortestPathSemiring(1));
+    interner.intern(new ShortestPathSemiring(2));
+    interner.intern(new ShortestPathSemiring(3));
+
+    EXPECT_EQ(2u, interner.sweep());
+    EXPECT_EQ(1u, interner.size());
+    EXPECT_TRUE(interner.isCanonical(kept));
+}
+
+
+TEST(wali$WeightInterner, tableStaysProportionalToLiveWeights)
+{
+    WeightInterner interner;
+    for (unsigned i = 0; i < 100000; ++i) {
+        interner.intern(new ShortestPathSemiring(i));
+    }
+    EXPECT_LT(interner.size(), 5000u);
+}
+
+
+TEST(wali$InterningWeightFactory, returnsCanonicalWeights)
+{
+    DistanceFactory base;
+    InterningWeightFactory factory(base);
+    sem_elem_t a = factory.getWeight("7");
+    sem_elem_t b = factory.getWeight("7");
+    EXPECT_EQ(a.get_ptr(), b.get_ptr());
+    EXPECT_EQ(1u, factory.getInterner()->size());
+}
+
+
+TEST(wali$wpds$WPDS$poststar, internedWeightsGiveTheSameAnswer)
+{
+    Key p = getKey("p"), accept = getKey("accept");
+
+    WPDS plain, interned;
+    addChain(plain, p);
+    addChain(interned, p);
+    weight_interner_t interner = new WeightInterner();
+    interned.setWeightInterner(interner);
+    EXPECT_EQ(interner.get_ptr(), interned.getWeightInterner().get_ptr());
+
+    WFA expected = plain.poststar(chainQuery(p, accept));
+    WFA actual = interned.poststar(chainQuery(p, accept));
+
+    for (int i = 0; i <= 8; ++i) {
+        std::stringstream sym;
+        sym << "a" << i;
+        TransSet expected_trans = expected.match(p, getKey(sym.str()));
+        TransSet actual_trans = actual.match(p, getKey(sym.str()));
+        ASSERT_EQ(1u, expected_trans.size());
+        ASSERT_EQ(1u, actual_trans.size());
+        EXPECT_TRUE((*expected_trans.begin())->weight()->equal(
+                        (*actual_trans.begin())->weight()));
+    }
+
+    // a1 .. a7 are each reached once, so their transitions hold the
+    // interned weights (a8's weight combines two paths)
+    CanonicalChecker checker(interner);
+    actual.for_each(checker);
+    EXPECT_GE(checker.num_canonical, 7);
+    EXPECT_GT(interner->numLookups(), 0u);
+}
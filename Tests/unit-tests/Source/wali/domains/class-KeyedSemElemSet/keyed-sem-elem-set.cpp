@@ -410,6 +410,95 @@ TEST(wali$domains$KeyedSemElemSet$$constructor, havingAWeightSetWithZeroWeightAn
 }
 
 
+
+namespace {
+    unsigned distance(KeyedSemElemSet const & ks, sem_elem_t key)
+    {
+        std::pair<KeyedSemElemSet::const_iterator, KeyedSemElemSet::const_iterator>
+            p = ks.equal_range(key);
+        if (p.first == p.second) {
+            return 0u;
+        }
+        return dynamic_cast<ShortestPathSemiring*>(p.first->second.get_ptr())->getNum();
+    }
+}
+
+
+TEST(wali$domains$KeyedSemElemSet$$combine, largeSetsCombinePerKey)
+{
+    typedef PositionKey<int> Pki;
+    KeyedSemElemSet::BackingMap evens, threes;
+    for (int i = 0; i < 3000; i += 2) {
+        evens[new Pki(i, i % 7)] = new ShortestPathSemiring(i + 10);
+    }
+    for (int i = 0; i < 3000; i += 3) {
+        threes[new Pki(i, i % 7)] = new ShortestPathSemiring(i + 5);
+    }
+
+    KeyedSemElemSet e(evens), t(threes);
+    sem_elem_t both_se = e.combine(&t);
+    KeyedSemElemSet * both = down_ks(both_se);
+
+    EXPECT_EQ(2000u, both->size());
+    for (int i = 0; i < 3000; ++i) {
+        sem_elem_t key = new Pki(i, i % 7);
+        unsigned expected = (i % 3 == 0) ? i + 5 : (i % 2 == 0) ? i + 10 : 0;
+        EXPECT_EQ(expected, distance(*both, key));
+    }
+    EXPECT_TRUE(both->equal(t.combine(&e)));
+    EXPECT_EQ(both->hash(), t.combine(&e)->hash());
+}
+
+
+TEST(wali$domains$KeyedSemElemSet$$combine, combiningInNothingNewSharesStorage)
+{
+    PKFixtures keys;
+    ShortestPathLengths paths;
+
+    KeyedSemElemSet::BackingMap big, small;
+    big[keys.i00] = paths.ten;
+    big[keys.i01] = paths.twenty;
+    small[keys.i01] = paths.thirty;
+
+    KeyedSemElemSet b(big), s(small);
+    sem_elem_t result = b.combine(&s);
+    EXPECT_TRUE(down_ks(result)->shares_storage_with(b));
+    EXPECT_TRUE(result->equal(&b));
+
+    sem_elem_t other_way = s.combine(&b);
+    EXPECT_FALSE(down_ks(other_way)->shares_storage_with(s));
+    EXPECT_TRUE(other_way->equal(&b));
+
+    EXPECT_TRUE(down_ks(b.combine(b.zero()))->shares_storage_with(b));
+}
+
+
+TEST(wali$domains$KeyedSemElemSet$$combine, keysWithCollidingHashesStayApart)
+{
+    typedef PositionKey<int> Pki;
+    // PositionKey<int> hashes to pre + 17*post
+    sem_elem_t k1 = new Pki(17, 0), k2 = new Pki(0, 1), k3 = new Pki(34, 0);
+    ASSERT_EQ(k1->hash(), k2->hash());
+
+    KeyedSemElemSet::BackingMap m1, m2;
+    m1[k1] = new ShortestPathSemiring(10);
+    m1[k2] = new ShortestPathSemiring(20);
+    m2[k2] = new ShortestPathSemiring(5);
+    m2[k3] = new ShortestPathSemiring(7);
+
+    KeyedSemElemSet s1(m1), s2(m2);
+    EXPECT_EQ(10u, distance(s1, k1));
+    EXPECT_EQ(20u, distance(s1, k2));
+
+    sem_elem_t both_se = s1.combine(&s2);
+    KeyedSemElemSet * both = down_ks(both_se);
+    EXPECT_EQ(3u, both->size());
+    EXPECT_EQ(10u, distance(*both, k1));
+    EXPECT_EQ(5u, distance(*both, k2));
+    EXPECT_EQ(7u, distance(*both, k3));
+    EXPECT_TRUE(both->equal(s2.combine(&s1)));
+}
+
 // Yo emacs!
 // Local Variables:
 //     c-file-style: "ellemtel"
@@ -1,9 +1,15 @@
 #include "gtest/gtest.h"
 
 #include "wali/Key.hpp"
+#include "wali/KeySpace.hpp"
+#include "wali/StringSource.hpp"
+#include "wali/KeyPairSource.hpp"
 #include "wali/Common.hpp"
+#include "wali/regex/Root.hpp"
 #include "opennwa/NwaFwd.hpp"
 
+#include <sstream>
+
 namespace wali {
 
     struct KeyFixture {
@@ -85,6 +91,113 @@ namespace wali {
         EXPECT_EQ("@", key2str(WALI_WILD));
     }
 
+    TEST(wali$getKey, lookupsAgreeWithKeySources)
+    {
+        Key by_string = getKey("probe agreement");
+        EXPECT_EQ(by_string, getKey(new StringSource("probe agreement")));
+
+        Key by_source = getKey(new StringSource("source agreement"));
+        EXPECT_EQ(by_source, getKey(std::string("source agreement")));
+
+        Key pair = getKey(by_string, by_source);
+        EXPECT_EQ(pair, getKey(new KeyPairSource(by_string, by_source)));
+        EXPECT_NE(pair, getKey(by_source, by_string));
+
+        // A string that matches a prefix is a different key
+        EXPECT_NE(by_string, getKey(std::string("probe agreement", 5)));
+    }
+
+    TEST(wali$getKeys, matchesGetKey)
+    {
+        std::vector<std::string> names;
+        names.push_back("bulk a");
+        names.push_back("bulk b");
+        names.push_back("bulk a");
+
+        Key const before = getKey("before bulk");
+        std::vector<Key> keys(1, before);
+        getKeys(names, keys);
+
+        ASSERT_EQ(4u, keys.size());
+        EXPECT_EQ(before, keys[0]);
+        EXPECT_EQ(getKey("bulk a"), keys[1]);
+        EXPECT_EQ(getKey("bulk b"), keys[2]);
+        EXPECT_EQ(keys[1], keys[3]);
+    }
+
+    TEST(wali$KeySpace, keysSurviveGrowth)
+    {
+        KeySpace space;
+        space.reserve(100);
+        std::vector<Key> keys;
+        for (int i = 0; i < 10000; ++i) {
+            std::stringstream ss;
+            ss << "k" << i;
+            keys.push_back(space.getKey(ss.str()));
+        }
+        EXPECT_EQ(10000u, space.size());
+        EXPECT_EQ("k0", space.key2str(keys[0]));
+        EXPECT_EQ("k4096", space.key2str(keys[4096]));
+        EXPECT_EQ("k9999", space.key2str(keys[9999]));
+        EXPECT_EQ(keys[5000], space.getKey("k5000"));
+        EXPECT_FALSE(space.getKeySource(10000).is_valid());
+
+        space.clear();
+        EXPECT_EQ(0u, space.size());
+        EXPECT_EQ(0u, space.getKey("again"));
+    }
+
+    TEST(wali$KeyScope, releasesOnlyTheKeysItCreated)
+    {
+        Key const kept = getKey("kept across scopes");
+        size_t mark;
+        Key scoped;
+        {
+            KeyScope scope;
+            mark = scope.mark();
+            EXPECT_EQ(getKeySpace()->size(), mark);
+            scoped = getKey("made in scope");
+            EXPECT_EQ(mark, scoped);
+            {
+                KeyScope inner;
+                getKey("made in inner scope");
+            }
+            EXPECT_EQ(mark + 1, getKeySpace()->size());
+        }
+        EXPECT_EQ(mark, getKeySpace()->size());
+        EXPECT_FALSE(getKeySource(scoped).is_valid());
+        EXPECT_EQ("kept across scopes", key2str(kept));
+        EXPECT_EQ(kept, getKey("kept across scopes"));
+
+        // The number is reused for the next new key
+        EXPECT_EQ(scoped, getKey("made after scope"));
+    }
+
+    TEST(wali$KeyScope, keepsPinnedKeys)
+    {
+        Key pinned;
+        {
+            KeyScope scope;
+            getKey("made before the pinned key");
+            pinned = pinKey(getKey("pinned in scope"));
+            getKey("made after the pinned key");
+        }
+        // Keys are released from the top, so everything up to the pinned
+        // key stays
+        EXPECT_EQ(pinned + 1, getKeySpace()->size());
+        EXPECT_EQ("pinned in scope", key2str(pinned));
+        EXPECT_EQ(pinned, getKey("pinned in scope"));
+
+        // regex::Root caches the keys of "$" and "" in statics
+        Key nil;
+        {
+            KeyScope scope;
+            nil = dynamic_cast<regex::Root*>(regex::Root::NIL().get_ptr())->lbl;
+        }
+        EXPECT_EQ("$", key2str(nil));
+        EXPECT_EQ(nil, getKey("$"));
+    }
+
     TEST(DISABLED_wali$clearKeySpace, clearingKeySpaceLeavesWildAndEpsilon)
     {
         clearKeyspace();
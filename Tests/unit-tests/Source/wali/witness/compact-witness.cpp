@@ -0,0 +1,276 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/GenKeySource.hpp"
+#include "wali/wpds/ewpds/EWPDS.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/witness/CalculatingVisitor.hpp"
+#include "wali/witness/CompactWitness.hpp"
+#include "wali/witness/CompactWitnessWrapper.hpp"
+#include "wali/witness/WitnessWrapper.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::witness;
+using namespace wali::wpds;
+using namespace wali::wfa;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// Describes the shape of a witness DAG and the weight of each node
+    struct Describer : public CalculatingVisitor<std::string>
+    {
+        static std::string
+        weight(Witness * w)
+        {
+            return w->weight()->toString();
+        }
+
+        virtual std::string calculateExtend(WitnessExtend * w,
+                                            std::string & left,
+                                            std::string & right)
+        {
+            return "(" + left + " . " + right + ")=" + weight(w);
+        }
+
+        virtual std::string calculateCombine(WitnessCombine * w,
+                                             std::list<std::string> & children)
+        {
+            std::string s = "{";
+            for (std::list<std::string>::const_iterator child = children.begin();
+                 child != children.end(); ++child)
+            {
+                s += *child + "|";
+            }
+            return s + "}=" + weight(w);
+        }
+
+        virtual std::string calculateMerge(WitnessMerge * w,
+                                           std::string & caller,
+                                           std::string & rule,
+                                           std::string & callee)
+        {
+            return "m(" + caller + ", " + rule + ", " + callee + ")=" + weight(w);
+        }
+
+        virtual std::string calculateRule(WitnessRule * w)
+        {
+            std::stringstream ss;
+            w->getRuleStub().print(ss);
+            return ss.str();
+        }
+
+        virtual std::string calculateTrans(WitnessTrans * w)
+        {
+            std::stringstream ss;
+            w->getTrans().print(ss);
+            return ss.str();
+        }
+    };
+
+    bool
+    isGenerated(Key k)
+    {
+        return dynamic_cast<GenKeySource*>(getKeySource(k).get_ptr()) != NULL;
+    }
+
+    /// Compares the witness of each transition of a WitnessWrapper
+    /// result with the reconstructed witness of a CompactWitnessWrapper
+    /// result
+    struct Comparer : ConstTransFunctor
+    {
+        WFA const & compact;
+        int num_compared;
+
+        Comparer(WFA const & c) : compact(c), num_compared(0) {}
+
+        virtual void operator()(ITrans const * t) {
+            if (isGenerated(t->from()) || isGenerated(t->to())) {
+                return;
+            }
+            Trans ct;
+            ASSERT_TRUE(compact.find(t->from(), t->stack(), t->to(), ct));
+
+            Witness * expected = dynamic_cast<Witness*>(t->weight().get_ptr());
+            CompactWitness * actual =
+                dynamic_cast<CompactWitness*>(ct.weight().get_ptr());
+            ASSERT_TRUE(expected != NULL);
+            ASSERT_TRUE(actual != NULL);
+
+            witness_t rebuilt = actual->reconstruct();
+            EXPECT_TRUE(expected->weight()->equal(rebuilt->weight()));
+            EXPECT_TRUE(actual->weight()->equal(rebuilt->weight()));
+            EXPECT_EQ(expected->getMinimumLength(), rebuilt->getMinimumLength());
+
+            Describer expected_description, actual_description;
+            expected->accept(expected_description);
+            actual->accept(actual_description);
+            EXPECT_EQ(expected_description.answer(), actual_description.answer());
+            ++num_compared;
+        }
+    };
+
+    Key
+    sym(char const * prefix, int i)
+    {
+        std::stringstream ss;
+        ss << prefix << i;
+        return getKey(ss.str());
+    }
+
+    /// main steps m0 -> m1, calls f at m1 (returning to m2), and has a
+    /// costlier path m0 -> m2; f either returns or calls itself
+    void
+    addProgram(WPDS & pds)
+    {
+        Key p = getKey("p");
+        pds.add_rule(p, sym("m", 0), p, sym("m", 1), dist(1));
+        pds.add_rule(p, sym("m", 0), p, sym("m", 2), dist(9));
+        pds.add_rule(p, sym("m", 1), p, sym("f", 0), sym("m", 2), dist(2));
+        pds.add_rule(p, sym("m", 2), p, sym("m", 3), dist(1));
+        pds.add_rule(p, sym("f", 0), p, sym("f", 1), dist(1));
+        pds.add_rule(p, sym("f", 0), p, sym("f", 0), sym("f", 2), dist(3));
+        pds.add_rule(p, sym("f", 1), p, dist(1));
+        pds.add_rule(p, sym("f", 2), p, dist(1));
+    }
+
+    WFA
+    query(Key start)
+    {
+        Key p = getKey("p"), accept = getKey("accept");
+        sem_elem_t one = ShortestPathSemiring(0).one();
+        WFA fa;
+        fa.addState(p, one->zero());
+        fa.addState(accept, one->zero());
+        fa.setInitialState(p);
+        fa.addFinalState(accept);
+        fa.addTrans(p, start, accept, one);
+        return fa;
+    }
+
+    /// Procedures of ten nodes in a chain; a quarter of the steps call
+    /// a random procedure instead, and a third also have a shortcut
+    /// further down the chain
+    void
+    addRandomProgram(WPDS & pds, int procs)
+    {
+        Key p = getKey("p");
+        srand(42);
+        for (int f = 0; f < procs; ++f) {
+            for (int j = 0; j < 10; ++j) {
+                Key here = sym("r", 10*f + j);
+                if (j == 9) {
+                    pds.add_rule(p, here, p, dist(1));
+                    continue;
+                }
+                Key next = sym("r", 10*f + j + 1);
+                if (rand() % 4 == 0) {
+                    pds.add_rule(p, here, p, sym("r", 10*(rand() % procs)), next,
+                                 dist(rand() % 10));
+                }
+                else {
+                    pds.add_rule(p, here, p, next, dist(rand() % 10));
+                }
+                if (rand() % 3 == 0) {
+                    pds.add_rule(p, here, p, sym("r", 10*f + j + 1 + rand() % (9 - j)),
+                                 dist(rand() % 10));
+                }
+            }
+        }
+    }
+
+    template<typename Pds>
+    void
+    checkAgreesWithWitnessWrapper()
+    {
+        ref_ptr<CompactWitnessWrapper> compact_wrapper = new CompactWitnessWrapper();
+        Pds full(new WitnessWrapper());
+        Pds compact(compact_wrapper.get_ptr());
+        addProgram(full);
+        addProgram(compact);
+
+        WFA expected = full.poststar(query(sym("m", 0)));
+        WFA actual = compact.poststar(query(sym("m", 0)));
+
+        Comparer comparer(actual);
+        expected.for_each(comparer);
+        EXPECT_GE(comparer.num_compared, 4);
+        EXPECT_GT(compact_wrapper->getArena()->size(), 0u);
+    }
+
+}
+
+
+TEST(wali$witness$CompactWitness, wpdsPoststarMatchesWitnessWrapper)
+{
+    checkAgreesWithWitnessWrapper<WPDS>();
+}
+
+
+TEST(wali$witness$CompactWitness, ewpdsPoststarMatchesWitnessWrapper)
+{
+    checkAgreesWithWitnessWrapper<ewpds::EWPDS>();
+}
+
+
+TEST(wali$witness$CompactWitness, sharedNodesStaySharedWhenRebuilt)
+{
+    witness_arena_t arena = new WitnessArena();
+    Trans t(getKey("p"), sym("a", 0), getKey("q"), dist(2));
+
+    sem_elem_t leaf = new CompactWitness(arena, arena->addTrans(t), dist(2));
+    sem_elem_t twice = leaf->extend(leaf);
+    sem_elem_t four_times = twice->extend(twice);
+    EXPECT_EQ(3u, arena->size());
+
+    CompactWitness * cw = dynamic_cast<CompactWitness*>(four_times.get_ptr());
+    EXPECT_TRUE(cw->weight()->equal(dist(8)));
+
+    witness_t rebuilt = cw->reconstruct();
+    WitnessExtend * top = dynamic_cast<WitnessExtend*>(rebuilt.get_ptr());
+    ASSERT_TRUE(top != NULL);
+    EXPECT_EQ(top->left().get_ptr(), top->right().get_ptr());
+    EXPECT_TRUE(top->weight()->equal(dist(8)));
+
+    // Extending by an empty one() adds nothing to the arena
+    sem_elem_t same = four_times->extend(four_times->one());
+    EXPECT_EQ(four_times.get_ptr(), same.get_ptr());
+    EXPECT_EQ(3u, arena->size());
+}
+
+
+TEST(wali$witness$CompactWitness, saturationKeepsOnlyLiveHistory)
+{
+    ref_ptr<CompactWitnessWrapper> compact_wrapper = new CompactWitnessWrapper();
+    witness_arena_t arena = compact_wrapper->getArena();
+    size_t live_witnesses;
+    {
+        int before = Witness::COUNT;
+        WPDS full(new WitnessWrapper());
+        addRandomProgram(full, 400);
+        WFA expected = full.poststar(query(sym("r", 0)));
+        live_witnesses = static_cast<size_t>(Witness::COUNT - before);
+    }
+    {
+        WPDS compact(compact_wrapper.get_ptr());
+        addRandomProgram(compact, 400);
+        WFA actual = compact.poststar(query(sym("r", 0)));
+
+        // Without freeing, the arena kept every intermediate extend and
+        // combine of the saturation, many times the live witnesses
+        EXPECT_LE(arena->size(), live_witnesses);
+
+        // bytes() follows the arena's high-water mark, so this compares
+        // its peak with what the witnesses take once saturation is done
+        EXPECT_LT(arena->bytes(), live_witnesses * sizeof(WitnessExtend));
+    }
+
+    // Once the answer and the rules are gone, so is all of their history
+    EXPECT_EQ(0u, arena->size());
+}
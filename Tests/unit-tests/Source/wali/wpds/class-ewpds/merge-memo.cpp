@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "wali/MergeFnFactory.hpp"
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/Trans.hpp"
+#include "wali/wpds/ewpds/EWPDS.hpp"
+#include "wali/wpds/ewpds/MergeFnMemo.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wfa;
+using namespace wali::wpds::ewpds;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// Extends the caller weight by the callee weight, counting calls
+    struct CountingMerge : IMergeFn
+    {
+        int * calls;
+
+        CountingMerge(int * c) : calls(c) {}
+
+        virtual sem_elem_t apply_f(sem_elem_t w1, sem_elem_t w2) {
+            ++*calls;
+            return w1->extend(w2);
+        }
+
+        virtual bool equal(merge_fn_t mf) {
+            return mf.get_ptr() == this;
+        }
+
+        virtual std::ostream & print(std::ostream & o) const {
+            return o << "CountingMerge";
+        }
+    };
+
+    struct CountingFactory : MergeFnFactory
+    {
+        int calls;
+
+        CountingFactory() : calls(0) {}
+
+        virtual merge_fn_t getMergeFn(std::string s) {
+            if (s == "pure") {
+                return declarePure(new CountingMerge(&calls));
+            }
+            return new CountingMerge(&calls);
+        }
+    };
+
+    /// Every call site m<i> has a push to f with the same merge function
+    /// and is reached with the same weight, so the merges at the return
+    /// sites are all the same.
+    struct SharedCallSites
+    {
+        enum { num_sites = 5 };
+
+        Key p, acc, f, fx;
+        Key calls[num_sites], rets[num_sites];
+        EWPDS pds;
+        WFA query;
+
+        SharedCallSites(merge_fn_t mf)
+            : p(getKey("memo p"))
+            , acc(getKey("memo acc"))
+            , f(getKey("memo f"))
+            , fx(getKey("memo fx"))
+        {
+            query.addState(p, dist(0)->zero());
+            query.addState(acc, dist(0)->zero());
+            query.setInitialState(p);
+            query.addFinalState(acc);
+
+            for (int i = 0; i < num_sites; ++i) {
+                std::stringstream c, r;
+                c << "memo call " << i;
+                r << "memo ret " << i;
+                calls[i] = getKey(c.str());
+                rets[i] = getKey(r.str());
+                pds.add_rule(p, calls[i], p, f, rets[i], dist(0), mf);
+                query.addTrans(p, calls[i], acc, dist(0));
+            }
+            pds.add_rule(p, f, p, fx, dist(2));
+            pds.add_rule(p, fx, p, dist(0));
+        }
+
+        unsigned int
+        weightAtReturn(WFA const & out, int i) const
+        {
+            Trans t;
+            EXPECT_TRUE(out.find(p, rets[i], acc, t));
+            return distanceOf(t.weight());
+        }
+    };
+}
+
+
+TEST(wali$wpds$ewpds$MergeFnMemo, poststarReusesPureMerges)
+{
+    CountingFactory factory;
+    SharedCallSites sites(factory.getMergeFn("pure"));
+    ASSERT_TRUE(factory.getMergeFn("pure")->isPure());
+
+    WFA out;
+    sites.pds.poststar(sites.query, out);
+
+    merge_memo_t memo = sites.pds.mergeMemo();
+    EXPECT_EQ(1u, memo->misses());
+    EXPECT_EQ(1, factory.calls);
+    EXPECT_GE(memo->hits(), (size_t)SharedCallSites::num_sites - 1);
+    EXPECT_EQ(0u, memo->bypassed());
+
+    for (int i = 0; i < SharedCallSites::num_sites; ++i) {
+        EXPECT_EQ(2u, sites.weightAtReturn(out, i));
+    }
+
+    // Through the base class, as code that takes any WPDS would call it
+    std::stringstream ss;
+    wali::wpds::WPDS const & base = sites.pds;
+    base.printStatistics(ss);
+    EXPECT_NE(std::string::npos, ss.str().find("merge hits"));
+}
+
+
+TEST(wali$wpds$ewpds$MergeFnMemo, impureMergesAreNotMemoized)
+{
+    CountingFactory factory;
+    merge_fn_t mf = factory.getMergeFn("impure");
+    ASSERT_FALSE(mf->isPure());
+    SharedCallSites sites(mf);
+
+    WFA out;
+    sites.pds.poststar(sites.query, out);
+
+    merge_memo_t memo = sites.pds.mergeMemo();
+    EXPECT_EQ(0u, memo->hits());
+    EXPECT_EQ(0u, memo->size());
+    EXPECT_GE(factory.calls, (int)SharedCallSites::num_sites);
+    EXPECT_EQ((size_t)factory.calls, memo->bypassed());
+
+    for (int i = 0; i < SharedCallSites::num_sites; ++i) {
+        EXPECT_EQ(2u, sites.weightAtReturn(out, i));
+    }
+}
+
+
+TEST(wali$wpds$ewpds$MergeFnMemo, tableIsBounded)
+{
+    int calls = 0;
+    merge_fn_t mf = new CountingMerge(&calls);
+    mf->setPure(true);
+
+    MergeFnMemo memo(2);
+    memo.apply(mf, dist(1), dist(1));
+    memo.apply(mf, dist(1), dist(2));
+    EXPECT_EQ(2u, memo.size());
+    EXPECT_EQ(3u, distanceOf(memo.apply(mf, dist(1), dist(2))));
+    EXPECT_EQ(1u, memo.hits());
+
+    memo.apply(mf, dist(1), dist(3));
+    EXPECT_EQ(1u, memo.flushes());
+    EXPECT_EQ(1u, memo.size());
+    EXPECT_EQ(3, calls);
+
+    memo.setCapacity(0);
+    memo.apply(mf, dist(1), dist(3));
+    EXPECT_EQ(1u, memo.bypassed());
+    EXPECT_EQ(0u, memo.size());
+    EXPECT_EQ(4, calls);
+}
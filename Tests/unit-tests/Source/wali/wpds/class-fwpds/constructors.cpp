@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/Trans.hpp"
+#include "wali/wpds/fwpds/FWPDS.hpp"
+
+#include <cstring>
+#include <new>
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wfa;
+using namespace wali::wpds::fwpds;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// Runs poststar on "m0 --call f (1)--> m1 --(1)--> m2; f --(2)--> fx
+    /// --return" with an FWPDS built by FWPDS(bool) in memory that is
+    /// filled with garbage first, so that a member the constructor does
+    /// not initialize is not zero by luck. Returns the distance to m2.
+    unsigned int
+    distanceWithDirtyConstruction()
+    {
+        Key p = getKey("fwpds-ctor p");
+        Key acc = getKey("fwpds-ctor acc");
+        Key m0 = getKey("fwpds-ctor m0");
+        Key m1 = getKey("fwpds-ctor m1");
+        Key m2 = getKey("fwpds-ctor m2");
+        Key f = getKey("fwpds-ctor f");
+        Key fx = getKey("fwpds-ctor fx");
+
+        void * memory = ::operator new(sizeof(FWPDS));
+        std::memset(memory, 0xff, sizeof(FWPDS));
+        FWPDS * pds = new (memory) FWPDS(false);
+
+        pds->add_rule(p, m0, p, f, m1, dist(1));
+        pds->add_rule(p, f, p, fx, dist(2));
+        pds->add_rule(p, fx, p, dist(0));
+        pds->add_rule(p, m1, p, m2, dist(1));
+
+        WFA query;
+        query.addState(p, dist(0)->zero());
+        query.addState(acc, dist(0)->zero());
+        query.setInitialState(p);
+        query.addFinalState(acc);
+        query.addTrans(p, m0, acc, dist(0));
+
+        unsigned int distance = 0;
+        {
+            WFA out;
+            pds->poststar(query, out);
+
+            Trans t;
+            EXPECT_TRUE(out.find(p, m2, acc, t));
+            distance = distanceOf(t.weight());
+        }
+
+        pds->~FWPDS();
+        ::operator delete(memory);
+        return distance;
+    }
+
+}
+
+TEST(wali$wpds$fwpds$FWPDS$$FWPDS$bool, initializesTheSaturationState)
+{
+    EXPECT_EQ(4u, distanceWithDirtyConstruction());
+}
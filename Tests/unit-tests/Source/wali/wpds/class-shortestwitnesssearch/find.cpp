@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "wali/Reach.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/ShortestWitnessSearch.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+
+namespace {
+
+    typedef ShortestWitnessSearch::stack_t Stack;
+    typedef ShortestWitnessSearch::RuleSequence RuleSequence;
+
+    Key
+    sym(char const * prefix, int i)
+    {
+        std::stringstream ss;
+        ss << prefix << i;
+        return getKey(ss.str());
+    }
+
+    Stack
+    stack(Key top, Key below = WALI_EPSILON)
+    {
+        Stack s(1, top);
+        if (below != WALI_EPSILON) {
+            s.push_back(below);
+        }
+        return s;
+    }
+
+    WFA
+    query(Key p, Key symbol)
+    {
+        sem_elem_t one = Reach(true).one();
+        Key accept = getKey("accept");
+        WFA fa;
+        fa.addState(p, one->zero());
+        fa.addState(accept, one->zero());
+        fa.setInitialState(p);
+        fa.addFinalState(accept);
+        fa.addTrans(p, symbol, accept, one);
+        return fa;
+    }
+
+    /// Applies the rules of a witness to its start configuration
+    void
+    replay(RuleSequence const & witness, Key & state, Stack & s)
+    {
+        state = witness.start_state;
+        s = witness.start_stack;
+        for (size_t i = 0; i < witness.rules.size(); ++i) {
+            rule_t r = witness.rules[i];
+            ASSERT_EQ(r->from_state(), state);
+            ASSERT_FALSE(s.empty());
+            ASSERT_EQ(r->from_stack(), s.front());
+            s.erase(s.begin());
+            if (r->to_stack2() != WALI_EPSILON) {
+                s.insert(s.begin(), r->to_stack2());
+            }
+            if (r->to_stack1() != WALI_EPSILON) {
+                s.insert(s.begin(), r->to_stack1());
+            }
+            state = r->to_state();
+        }
+    }
+
+}
+
+
+TEST(wali$wpds$ShortestWitnessSearch$find, chainWithShortcut)
+{
+    Key p = getKey("p");
+    sem_elem_t one = Reach(true).one();
+    WPDS pds;
+    for (int i = 0; i < 8; ++i) {
+        pds.add_rule(p, sym("a", i), p, sym("a", i + 1), one);
+    }
+    pds.add_rule(p, sym("a", 0), p, sym("a", 8), one);
+    // Zero-weight rules cannot be part of a witness
+    pds.add_rule(p, sym("a", 0), p, sym("a", 7), one->zero());
+
+    ShortestWitnessSearch search(pds, query(p, sym("a", 0)));
+    EXPECT_EQ(1u, search.distance(p, stack(sym("a", 8))));
+    EXPECT_EQ(7u, search.distance(p, stack(sym("a", 7))));
+
+    std::vector<RuleSequence> found = search.find(p, stack(sym("a", 8)), 5);
+    ASSERT_EQ(2u, found.size());
+    EXPECT_EQ(1u, found[0].rules.size());
+    EXPECT_EQ(8u, found[1].rules.size());
+
+    for (size_t i = 0; i < found.size(); ++i) {
+        Key state;
+        Stack s;
+        replay(found[i], state, s);
+        EXPECT_EQ(p, state);
+        EXPECT_EQ(stack(sym("a", 8)), s);
+        EXPECT_EQ(stack(sym("a", 0)), found[i].start_stack);
+    }
+
+    // Only the shortest
+    EXPECT_EQ(1u, search.find(p, stack(sym("a", 8)), 1).size());
+    // Nothing within the length bound
+    EXPECT_TRUE(search.find(p, stack(sym("a", 8)), 5, 0).empty());
+}
+
+
+TEST(wali$wpds$ShortestWitnessSearch$find, throughACall)
+{
+    Key p = getKey("p"), q = getKey("q");
+    sem_elem_t one = Reach(true).one();
+    WPDS pds;
+    pds.add_rule(p, sym("m", 0), p, sym("f", 0), sym("m", 1), one);
+    pds.add_rule(p, sym("f", 0), p, sym("f", 1), one);
+    pds.add_rule(p, sym("f", 0), p, sym("f", 0), sym("f", 2), one);
+    pds.add_rule(p, sym("f", 1), q, one);
+    pds.add_rule(q, sym("f", 2), q, one);
+    pds.add_rule(q, sym("m", 1), p, sym("m", 2), one);
+
+    ShortestWitnessSearch search(pds, query(p, sym("m", 0)));
+
+    std::vector<RuleSequence> inside = search.find(p, stack(sym("f", 1), sym("m", 1)), 1);
+    ASSERT_EQ(1u, inside.size());
+    EXPECT_EQ(2u, inside[0].rules.size());
+
+    // Call, step, return, step; then the same through one recursive call
+    std::vector<RuleSequence> after = search.find(p, stack(sym("m", 2)), 2);
+    ASSERT_EQ(2u, after.size());
+    EXPECT_EQ(4u, after[0].rules.size());
+    EXPECT_EQ(6u, after[1].rules.size());
+    for (size_t i = 0; i < after.size(); ++i) {
+        Key state;
+        Stack s;
+        replay(after[i], state, s);
+        EXPECT_EQ(p, state);
+        EXPECT_EQ(stack(sym("m", 2)), s);
+    }
+}
+
+
+TEST(wali$wpds$ShortestWitnessSearch$find, unreachableTarget)
+{
+    Key p = getKey("p");
+    sem_elem_t one = Reach(true).one();
+    WPDS pds;
+    pds.add_rule(p, sym("a", 0), p, sym("a", 1), one);
+
+    ShortestWitnessSearch search(pds, query(p, sym("a", 0)));
+    EXPECT_EQ(ShortestWitnessSearch::UNREACHABLE, search.distance(p, stack(sym("a", 2))));
+    EXPECT_TRUE(search.find(p, stack(sym("a", 2)), 3).empty());
+
+    // The initial configuration is its own (empty) witness
+    std::vector<RuleSequence> start = search.find(p, stack(sym("a", 0)), 1);
+    ASSERT_EQ(1u, start.size());
+    EXPECT_TRUE(start[0].rules.empty());
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/Trans.hpp"
+#include "wali/wpds/fwpds/SWPDS.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wfa;
+using namespace wali::wpds::fwpds;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// main: m0 --call f (1)--> m1 --(1)--> m2
+    /// f:    f  --(2)--> fx --return (0)
+    struct CallOnce
+    {
+        Key p, acc, m0, m1, m2, f, fx;
+        SWPDS pds;
+
+        CallOnce()
+            : p(getKey("swpds p"))
+            , acc(getKey("swpds acc"))
+            , m0(getKey("swpds m0"))
+            , m1(getKey("swpds m1"))
+            , m2(getKey("swpds m2"))
+            , f(getKey("swpds f"))
+            , fx(getKey("swpds fx"))
+        {
+            pds.add_rule(p, m0, p, f, m1, dist(1));
+            pds.add_rule(p, f, p, fx, dist(2));
+            pds.add_rule(p, fx, p, dist(0));
+            pds.add_rule(p, m1, p, m2, dist(1));
+            pds.addEntryPoint(m0);
+        }
+
+        /// Runs poststar from the configuration <p,start> with weight w
+        /// and returns the weight of reaching <p,m2>
+        unsigned int
+        reachM2(Key start, unsigned int w)
+        {
+            WFA query;
+            query.addState(p, dist(0)->zero());
+            query.addState(acc, dist(0)->zero());
+            query.setInitialState(p);
+            query.addFinalState(acc);
+            query.addTrans(p, start, acc, dist(w));
+
+            WFA out;
+            pds.poststar(query, out);
+
+            Trans t;
+            EXPECT_TRUE(out.find(p, m2, acc, t));
+            return distanceOf(t.weight());
+        }
+    };
+}
+
+
+TEST(wali$wpds$fwpds$SWPDS, summariesAreSharedAcrossQueries)
+{
+    CallOnce prog;
+    EXPECT_FALSE(prog.pds.isPreprocessed());
+
+    EXPECT_EQ(4u, prog.reachM2(prog.m0, 0));
+    EXPECT_TRUE(prog.pds.isPreprocessed());
+    EXPECT_EQ(10u, prog.reachM2(prog.m0, 6));
+    EXPECT_EQ(6u, prog.reachM2(prog.m1, 5));
+
+    EXPECT_EQ(1u, prog.pds.numPreprocessed());
+}
+
+
+TEST(wali$wpds$fwpds$SWPDS, changingTheRulesRecomputesSummaries)
+{
+    CallOnce prog;
+    EXPECT_EQ(4u, prog.reachM2(prog.m0, 0));
+
+    // Re-adding a rule with its current weight keeps the summaries
+    prog.pds.add_rule(prog.p, prog.f, prog.p, prog.fx, dist(2));
+    EXPECT_TRUE(prog.pds.isPreprocessed());
+
+    // A cheaper path through f changes them
+    prog.pds.add_rule(prog.p, prog.f, prog.p, prog.fx, dist(0));
+    EXPECT_FALSE(prog.pds.isPreprocessed());
+    EXPECT_EQ(2u, prog.reachM2(prog.m0, 0));
+    EXPECT_EQ(2u, prog.pds.numPreprocessed());
+
+    EXPECT_TRUE(prog.pds.erase_rule(prog.p, prog.m1, prog.p, prog.m2, WALI_EPSILON));
+    EXPECT_FALSE(prog.pds.isPreprocessed());
+    prog.pds.add_rule(prog.p, prog.m1, prog.p, prog.m2, dist(3));
+    EXPECT_EQ(4u, prog.reachM2(prog.m0, 0));
+    EXPECT_EQ(3u, prog.pds.numPreprocessed());
+}
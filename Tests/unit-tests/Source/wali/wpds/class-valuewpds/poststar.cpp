@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include "wali/ValueSemiring.hpp"
+#include "wali/wpds/ValueWPDS.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+
+namespace {
+
+    bool
+    isGenerated(Key k)
+    {
+        return dynamic_cast<GenKeySource*>(getKeySource(k).get_ptr()) != NULL;
+    }
+
+    /// Checks each transition of a WPDS::poststar result between
+    /// non-generated states against a ValueWPDS::poststar result
+    template<typename Semiring>
+    struct Comparer : ConstTransFunctor
+    {
+        typename ValueWPDS<Semiring>::Automaton const & actual;
+        int num_compared;
+
+        Comparer(typename ValueWPDS<Semiring>::Automaton const & a)
+            : actual(a), num_compared(0)
+        {}
+
+        virtual void operator()(ITrans const * t) {
+            if (isGenerated(t->from()) || isGenerated(t->to())) {
+                return;
+            }
+            typename Semiring::value_type w;
+            ASSERT_TRUE(actual.find(t->from(), t->stack(), t->to(), w))
+                << key2str(t->from()) << " " << key2str(t->stack())
+                << " " << key2str(t->to());
+            EXPECT_TRUE(Semiring::equal(Semiring::from_sem_elem(t->weight()), w))
+                << key2str(t->from()) << " " << key2str(t->stack())
+                << " " << key2str(t->to());
+            ++num_compared;
+        }
+    };
+
+    template<typename Semiring>
+    int
+    countOriginal(typename ValueWPDS<Semiring>::Automaton const & a)
+    {
+        int n = 0;
+        for (typename ValueWPDS<Semiring>::Automaton::const_iterator it = a.begin();
+             it != a.end(); ++it)
+        {
+            if (!isGenerated(it->from) && !isGenerated(it->to)) {
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    Key
+    sym(char const * prefix, int i)
+    {
+        std::stringstream ss;
+        ss << prefix << i;
+        return getKey(ss.str());
+    }
+
+    /// Builds the same small recursive program in both a WPDS and a
+    /// ValueWPDS: main calls f, f either returns or calls itself, and each
+    /// procedure has a few weighted steps.
+    template<typename Semiring>
+    void
+    addProgram(WPDS & pds, ValueWPDS<Semiring> & vpds)
+    {
+        Key p = getKey("p"), q = getKey("q");
+        unsigned weights[] = { 1, 2, 3, 1, 4, 2, 5 };
+
+        // main: m0 -> m1 -> call f (returning to m2) -> m3
+        pds.add_rule(p, sym("m", 0), p, sym("m", 1), Semiring::to_sem_elem(weights[0]));
+        pds.add_rule(p, sym("m", 1), p, sym("f", 0), sym("m", 2),
+                     Semiring::to_sem_elem(weights[1]));
+        pds.add_rule(p, sym("m", 2), p, sym("m", 3), Semiring::to_sem_elem(weights[2]));
+
+        // f: f0 -> f1 | f0 -> call f (returning to f2); f1, f2 -> return
+        pds.add_rule(p, sym("f", 0), p, sym("f", 1), Semiring::to_sem_elem(weights[3]));
+        pds.add_rule(p, sym("f", 0), p, sym("f", 0), sym("f", 2),
+                     Semiring::to_sem_elem(weights[4]));
+        pds.add_rule(p, sym("f", 1), p, Semiring::to_sem_elem(weights[5]));
+        pds.add_rule(p, sym("f", 2), p, Semiring::to_sem_elem(weights[6]));
+
+        // A second control state, reached by a step that changes state
+        pds.add_rule(p, sym("m", 3), q, sym("m", 4), Semiring::to_sem_elem(weights[0]));
+        pds.add_rule(q, sym("m", 4), q, Semiring::to_sem_elem(weights[1]));
+
+        vpds.add_rules(pds);
+    }
+
+    WFA
+    query(sem_elem_t one)
+    {
+        Key p = getKey("p"), accept = getKey("accept");
+        WFA fa;
+        fa.addState(p, one->zero());
+        fa.addState(accept, one->zero());
+        fa.setInitialState(p);
+        fa.addFinalState(accept);
+        fa.addTrans(p, sym("m", 0), accept, one);
+        return fa;
+    }
+
+    template<typename Semiring>
+    void
+    checkAgreesWithWpds()
+    {
+        WPDS pds;
+        ValueWPDS<Semiring> vpds;
+        addProgram(pds, vpds);
+        EXPECT_EQ(pds.count_rules(), (int)vpds.count_rules());
+
+        WFA in = query(Semiring::to_sem_elem(Semiring::one()));
+        WFA expected = pds.poststar(in);
+        typename ValueWPDS<Semiring>::Automaton actual =
+            vpds.poststar(ValueWPDS<Semiring>::Automaton::fromWfa(in));
+
+        Comparer<Semiring> comparer(actual);
+        expected.for_each(comparer);
+        EXPECT_GT(comparer.num_compared, 0);
+        EXPECT_EQ(comparer.num_compared, countOriginal<Semiring>(actual));
+    }
+
+}
+
+
+TEST(wali$wpds$ValueWPDS$poststar, reachAgreesWithWpds)
+{
+    checkAgreesWithWpds<ReachValue>();
+}
+
+
+TEST(wali$wpds$ValueWPDS$poststar, shortestPathAgreesWithWpds)
+{
+    checkAgreesWithWpds<ShortestPathValue>();
+}
+
+
+TEST(wali$wpds$ValueWPDS$poststar, longestSaturatingPathAgreesWithWpds)
+{
+    checkAgreesWithWpds< LongestSaturatingPathValue<10> >();
+}
+
+
+TEST(wali$wpds$ValueWPDS$poststar, shortestPathWeights)
+{
+    ValueWPDS<ShortestPathValue> vpds;
+    Key p = getKey("p"), accept = getKey("accept");
+    vpds.add_rule(p, sym("a", 0), p, sym("a", 1), 1);
+    vpds.add_rule(p, sym("a", 1), p, sym("a", 2), 1);
+    vpds.add_rule(p, sym("a", 0), p, sym("a", 2), 5);
+
+    ValueWPDS<ShortestPathValue>::Automaton in;
+    in.addTrans(p, sym("a", 0), accept, ShortestPathValue::one());
+    ValueWPDS<ShortestPathValue>::Automaton out = vpds.poststar(in);
+
+    unsigned w;
+    ASSERT_TRUE(out.find(p, sym("a", 2), accept, w));
+    EXPECT_EQ(2u, w);
+    EXPECT_FALSE(out.find(accept, sym("a", 2), p, w));
+    EXPECT_EQ(3u, out.numTransitions());
+}
@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 
 #include "wali/Reach.hpp"
+#include "wali/KeySpace.hpp"
 #include "wali/wpds/WPDS.hpp"
 #include "wali/wfa/TransFunctor.hpp"
 
@@ -52,3 +53,30 @@ TEST(wali$wpds$WPDS$poststar, canTakePoststarOfEmptyWpds)
     EXPECT_EQ(2u, result.numStates());
     EXPECT_EQ(1u, counter.getNumTrans());
 }
+
+TEST(wali$wpds$WPDS$poststar, keyScopeReclaimsTheKeysOfAQuery)
+{
+    SimpleQuery outside;
+    size_t before = 0;
+    for (int round = 0; round < 3; ++round) {
+        KeyScope scope;
+        if (round == 0) {
+            before = scope.mark();
+        }
+        EXPECT_EQ(before, scope.mark());
+
+        WPDS pds;
+        Key p = getKey("scoped p");
+        pds.add_rule(outside.start, outside.symbol, p, getKey("scoped a"), getKey("scoped b"),
+                     outside.one);
+        pds.add_rule(p, getKey("scoped a"), p, outside.one);
+        WFA result = pds.poststar(outside.wfa);
+        EXPECT_GT(getKeySpace()->size(), before);
+
+        // Keys from before the scope are still usable
+        EXPECT_EQ("start", key2str(outside.start));
+        EXPECT_EQ(1u, result.match(p, getKey("scoped b")).size());
+    }
+    EXPECT_EQ(before, getKeySpace()->size());
+    EXPECT_EQ(outside.symbol, getKey("symbol"));
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/WtoWorklist.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+
+#include "fixtures/SimpleWeights.hpp"
+
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+using namespace testing::ShortestPathWeights;
+
+namespace {
+
+    /// main: m0 -> m1 -> m2 -> m3, with a loop m2 -> m1 around m1 ->
+    /// m2, an inner loop m2 -> m2, and a call to f at m3 returning to
+    /// m4. f: f0 -> f1 -> f0 and f1 returns.
+    struct Program
+    {
+        Key p, m0, m1, m2, m3, m4, f0, f1;
+        WPDS pds;
+
+        Program()
+            : p(getKey("wto p"))
+            , m0(getKey("wto m0"))
+            , m1(getKey("wto m1"))
+            , m2(getKey("wto m2"))
+            , m3(getKey("wto m3"))
+            , m4(getKey("wto m4"))
+            , f0(getKey("wto f0"))
+            , f1(getKey("wto f1"))
+        {
+            pds.add_rule(p, m0, p, m1, dist(1));
+            pds.add_rule(p, m1, p, m2, dist(2));
+            pds.add_rule(p, m2, p, m2, dist(1));
+            pds.add_rule(p, m2, p, m1, dist(3));
+            pds.add_rule(p, m2, p, m3, dist(1));
+            pds.add_rule(p, m3, p, f0, m4, dist(1));
+            pds.add_rule(p, f0, p, f1, dist(4));
+            pds.add_rule(p, f1, p, f0, dist(1));
+            pds.add_rule(p, f1, p, dist(0));
+        }
+
+        WFA
+        query() const
+        {
+            Key acc = getKey("wto acc");
+            WFA q;
+            q.addState(p, dist(0)->zero());
+            q.addState(acc, dist(0)->zero());
+            q.setInitialState(p);
+            q.addFinalState(acc);
+            q.addTrans(p, m0, acc, dist(0));
+            return q;
+        }
+    };
+}
+
+
+TEST(wali$wpds$WeakTopologicalOrder, nestsLoopsUnderTheirHeads)
+{
+    Program prog;
+    WeakTopologicalOrder wto(prog.pds);
+
+    std::stringstream ss;
+    wto.print(ss);
+    EXPECT_EQ("wto m0 (wto m1 (wto m2)) wto m3 (wto f0 wto f1) wto m4", ss.str());
+
+    EXPECT_EQ(7u, wto.size());
+    EXPECT_TRUE(wto.isWideningPoint(prog.m1));
+    EXPECT_TRUE(wto.isWideningPoint(prog.m2));
+    EXPECT_TRUE(wto.isWideningPoint(prog.f0));
+    EXPECT_FALSE(wto.isWideningPoint(prog.f1));
+    EXPECT_EQ(3u, wto.wideningPoints().size());
+    EXPECT_EQ(2, wto.depth(prog.m2));
+    EXPECT_EQ(0, wto.depth(prog.m3));
+    EXPECT_LT(wto.position(prog.m3), wto.position(prog.m4));
+    EXPECT_EQ(wto.size(), wto.position(getKey("wto unknown")));
+}
+
+
+TEST(wali$wpds$WtoWorklist, poststarAndPrestarAgreeWithDefaultWorklist)
+{
+    Program prog;
+    WFA query = prog.query();
+
+    WFA expected_post, expected_pre;
+    prog.pds.poststar(query, expected_post);
+    prog.pds.prestar(query, expected_pre);
+
+    prog.pds.setWorklist(new WtoWorklist(prog.pds));
+    WFA post;
+    prog.pds.poststar(query, post);
+    prog.pds.setWorklist(new WtoWorklist(prog.pds, true));
+    WFA pre;
+    prog.pds.prestar(query, pre);
+
+    SumDistances se, s, pe, p;
+    expected_post.for_each(se);
+    post.for_each(s);
+    expected_pre.for_each(pe);
+    pre.for_each(p);
+    EXPECT_GT(se.count, 0);
+    EXPECT_EQ(se.count, s.count);
+    EXPECT_EQ(se.total, s.total);
+    EXPECT_EQ(pe.count, p.count);
+    EXPECT_EQ(pe.total, p.total);
+}
@@ -0,0 +1,129 @@
+// Times poststar on a random program with the SemElem-based WPDS and with
+// ValueWPDS, both over shortest-path weights, and checks that they agree.
+//
+// usage: value_wpds_speed_test [seed [procedures [nodes-per-procedure]]]
+
+#include "wali/ValueSemiring.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/ValueWPDS.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/util/Timer.hpp"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+
+typedef ValueWPDS<ShortestPathValue> SpValueWPDS;
+
+namespace {
+
+  Key node(int proc, int n)
+  {
+    stringstream ss;
+    ss << "f" << proc << "_n" << n;
+    return getKey(ss.str());
+  }
+
+  /// Each procedure is a chain of nodes with some forward jumps; some
+  /// nodes call a random procedure, and the last node returns.
+  void buildProgram(WPDS & pds, int procs, int nodes)
+  {
+    Key p = getKey("p");
+    for (int f = 0; f < procs; ++f) {
+      for (int n = 0; n + 1 < nodes; ++n) {
+        sem_elem_t w = new ShortestPathSemiring(rand() % 10 + 1);
+        int r = rand() % 10;
+        if (r < 2) {
+          pds.add_rule(p, node(f, n), p, node(rand() % procs, 0), node(f, n + 1), w);
+        }
+        else {
+          pds.add_rule(p, node(f, n), p, node(f, n + 1), w);
+          if (r == 9 && n + 2 < nodes) {
+            int target = n + 2 + rand() % (nodes - n - 2);
+            pds.add_rule(p, node(f, n), p, node(f, target),
+                         new ShortestPathSemiring(rand() % 10 + 1));
+          }
+        }
+      }
+      pds.add_rule(p, node(f, nodes - 1), p, new ShortestPathSemiring(1));
+    }
+  }
+
+  struct Checker : ConstTransFunctor
+  {
+    SpValueWPDS::Automaton const & other;
+    int mismatches;
+
+    Checker(SpValueWPDS::Automaton const & o) : other(o), mismatches(0) {}
+
+    virtual void operator()(ITrans const * t) {
+      if (dynamic_cast<GenKeySource*>(getKeySource(t->from()).get_ptr())
+          || dynamic_cast<GenKeySource*>(getKeySource(t->to()).get_ptr()))
+      {
+        return;
+      }
+      unsigned w;
+      if (!other.find(t->from(), t->stack(), t->to(), w)
+          || w != ShortestPathValue::from_sem_elem(t->weight()))
+      {
+        ++mismatches;
+      }
+    }
+  };
+
+}
+
+int main(int argc, char ** argv)
+{
+  int seed = (argc > 1) ? atoi(argv[1]) : (int)time(NULL);
+  int procs = (argc > 2) ? atoi(argv[2]) : 200;
+  int nodes = (argc > 3) ? atoi(argv[3]) : 50;
+  srand(seed);
+
+  WPDS pds;
+  buildProgram(pds, procs, nodes);
+  SpValueWPDS vpds;
+  vpds.add_rules(pds);
+
+  Key p = getKey("p"), accept = getKey("accept");
+  sem_elem_t one = ShortestPathSemiring(0).one();
+  WFA query;
+  query.addState(p, one->zero());
+  query.addState(accept, one->zero());
+  query.setInitialState(p);
+  query.addFinalState(accept);
+  query.addTrans(p, node(0, 0), accept, one);
+
+  cout << "seed " << seed << ", " << pds.count_rules() << " rules\n";
+
+  WFA answer;
+  {
+    util::GoodTimer timer("WPDS poststar");
+    answer = pds.poststar(query);
+  }
+
+  SpValueWPDS::Automaton value_query = SpValueWPDS::Automaton::fromWfa(query);
+  SpValueWPDS::Automaton value_answer;
+  {
+    util::GoodTimer timer("ValueWPDS poststar");
+    vpds.poststar(value_query, value_answer);
+  }
+
+  Checker checker(value_answer);
+  answer.for_each(checker);
+  cout << value_answer.numTransitions() << " transitions, "
+       << checker.mismatches << " mismatches\n";
+  return checker.mismatches == 0 ? 0 : 1;
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End:
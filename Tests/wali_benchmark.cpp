@@ -0,0 +1,661 @@
+// Runs a fixed suite of WPDS and NWA operations on seeded random inputs
+// and reports, for each case and size, the time, the peak resident set
+// size and a few operation counts as JSON or CSV, so that runs of
+// different versions can be compared.
+//
+// PDSs come from RandomPdsGen (AddOns/RandomFWPDS) with BinRel weights,
+// the domain Newton's method is implemented for. NWAs follow the
+// density models of AddOns/RandomNwa (see randomNwa).
+// Every case runs in its own process so that its peak RSS is
+// not inherited from the cases before it. Inputs depend only on the
+// seed and the scale, so the PDS cases at a scale all see the same PDS.
+//
+// usage: wali_benchmark [key=value ...]
+//   seed=N        seed of the generators; must be non-zero (default 1)
+//   scales=1,2,4  size multipliers; every case runs at every scale
+//   procs=N       procedures at scale 1 (default 50)
+//   nodes=N       CFG nodes per procedure (default 4)
+//   calls=N       call sites per procedure (default 2)
+//   splits=N      branches per procedure (default 1)
+//   pcall=P       probability that a block is a call (default 0.45)
+//   psplit=P      probability that a block is a branch (default 0.45)
+//   vars=N        boolean and integer variables of the weights (default 2)
+//   bddnodes=N    initial BuDDy node table, which grows as needed; 0 uses
+//                 the library default, which dominates the RSS (100000)
+//   states=N      states of the NWAs to intersect at scale 1 (default 8)
+//   dstates=N     states of the NWA to determinize at scale 1; as the
+//                 result can be exponential, each scale step adds one
+//                 state instead of multiplying (default 4)
+//   symbols=N     NWA symbols (default 2)
+//   density=P     NWA transition density (default 0.5)
+//   repeat=N      runs of each case; the fastest is reported (default 1)
+//   cases=S       only run the cases whose name contains S
+//   format=F      json or csv (default json)
+//   out=FILE      write the results to FILE instead of stdout
+//   isolate=0     run the cases in this process, e.g. under a debugger;
+//                 peak RSS is then the largest so far, and the library
+//                 prints to stdout, so use out=FILE
+//
+// Progress goes to stderr, as does anything the library prints. The exit
+// status is non-zero if a case failed.
+
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/ewpds/EWPDS.hpp"
+#include "wali/wpds/fwpds/FWPDS.hpp"
+#include "wali/wpds/fwpds/SWPDS.hpp"
+#include "wali/wpds/RuleFunctor.hpp"
+#include "wali/wfa/WFA.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/DefaultWorklist.hpp"
+#include "wali/util/ParseArgv.hpp"
+#include "wali/util/Timer.hpp"
+#include "wali/domains/binrel/ProgramBddContext.hpp"
+#include "wali/domains/binrel/BinRel.hpp"
+#include "generateRandomFWPDS.hpp"
+
+#include "opennwa/Nwa.hpp"
+#include "opennwa/construct/intersect.hpp"
+#include "opennwa/construct/determinize.hpp"
+#include "opennwa/query/language.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  error "wali_benchmark needs fork, waitpid and getrusage (POSIX)"
+#endif
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+using namespace wali::domains::binrel;
+
+namespace {
+
+  struct Params
+  {
+    unsigned seed;
+    vector<int> scales;
+    int procs, nodes, calls, splits;
+    double pcall, psplit;
+    int vars;
+    int bddnodes;
+    int states, dstates, symbols;
+    double density;
+    int repeat;
+    string cases;
+    string format;
+    string out;
+    int isolate;
+  };
+
+  /// What a case measured; counts that do not apply are -1
+  struct Result
+  {
+    int ok;
+    double gen_s;
+    double time_s;
+    long peak_rss_kb;
+    long rules;
+    long in_trans;
+    long out_trans;
+    long out_states;
+    long worklist_gets;
+  };
+
+  enum Kind { PLAIN, EXTENDED, FUNCTIONAL, NEWTON, SUMMARY,
+              INTERSECT, DETERMINIZE, EMPTINESS };
+
+  struct Case
+  {
+    const char * name;
+    Kind kind;
+    bool post;
+  };
+
+  const Case all_cases[] = {
+    { "wpds-poststar", PLAIN, true },
+    { "wpds-prestar", PLAIN, false },
+    { "ewpds-poststar", EXTENDED, true },
+    { "ewpds-prestar", EXTENDED, false },
+    { "fwpds-poststar", FUNCTIONAL, true },
+    { "fwpds-prestar", FUNCTIONAL, false },
+    // InterGraph only has a Newton solver for poststar
+    { "fwpds-newton-poststar", NEWTON, true },
+    { "swpds-poststar", SUMMARY, true },
+    { "swpds-prestar", SUMMARY, false },
+    { "nwa-intersect", INTERSECT, false },
+    { "nwa-determinize", DETERMINIZE, false },
+    { "nwa-emptiness", EMPTINESS, false }
+  };
+
+  const size_t num_cases = sizeof(all_cases) / sizeof(all_cases[0]);
+
+  double seconds()
+  {
+    return util::details::to_sec(util::details::now());
+  }
+
+  long peakRssKb()
+  {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;  // kilobytes on Linux
+  }
+
+  class BinRelGen : public RandomPdsGen::WtGen
+  {
+    public:
+      BinRelGen(program_bdd_context_t c) : con(c) {}
+
+      // A seed of 0 keeps drawing from the sequence RandomPdsGen seeded
+      virtual sem_elem_t operator () ()
+      {
+        return new BinRel(con.get_ptr(), con->tGetRandomTransformer(false, 0));
+      }
+
+    private:
+      program_bdd_context_t con;
+  };
+
+  /// Counts the worklist items a saturation processes
+  class CountingWorklist : public Worklist<ITrans>
+  {
+    public:
+      CountingWorklist() : gets(0), wl(new DefaultWorklist<ITrans>()) {}
+
+      virtual bool put( ITrans * t ) { return wl->put(t); }
+
+      virtual ITrans * get() { ++gets; return wl->get(); }
+
+      virtual bool empty() const { return wl->empty(); }
+
+      virtual void clear() { wl->clear(); }
+
+      virtual size_t size() const { return wl->size(); }
+
+      long gets;
+
+    private:
+      ref_ptr< Worklist<ITrans> > wl;
+  };
+
+  struct CountRules : ConstRuleFunctor
+  {
+    long n;
+    CountRules() : n(0) {}
+    virtual void operator()( const rule_t & ) { ++n; }
+  };
+
+  /// Counts the transitions and asks for each weight, which makes
+  /// FWPDS evaluate the weights it left lazy
+  struct ForceTrans : ConstTransFunctor
+  {
+    long n;
+    ForceTrans() : n(0) {}
+    virtual void operator()( const ITrans * t ) { ++n; t->weight(); }
+  };
+
+  Result blankResult()
+  {
+    Result r = { 0, 0.0, 0.0, -1, -1, -1, -1, -1, -1 };
+    return r;
+  }
+
+  WPDS * makePds( Kind kind )
+  {
+    switch (kind) {
+      case PLAIN:
+        return new WPDS();
+      case EXTENDED:
+        return new ewpds::EWPDS();
+      case FUNCTIONAL:
+        return new fwpds::FWPDS(false);
+      case NEWTON:
+        return new fwpds::FWPDS(true);
+      case SUMMARY:
+        return new fwpds::SWPDS();
+      default:
+        assert(false);
+        return NULL;
+    }
+  }
+
+  Result runPds( Case const & c, Params const & p, int scale )
+  {
+    Result r = blankResult();
+    double start = seconds();
+
+    program_bdd_context_t con = new ProgramBddContext(p.bddnodes);
+    for (int i = 0; i < p.vars; ++i) {
+      stringstream b, n;
+      b << "bool_" << i;
+      n << "int_" << i;
+      con->addBoolVar(b.str());
+      con->addIntVar(n.str(), 4);
+    }
+    RandomPdsGen::wtgen_t wg = new BinRelGen(con);
+    int procs = p.procs * scale;
+    random_pdsgen_t gen = new RandomPdsGen(wg, procs, p.calls * procs,
+        p.nodes * procs, p.splits * procs, 0, p.pcall, p.psplit, p.seed);
+
+    WPDS * pds = makePds(c.kind);
+    ref_ptr<CountingWorklist> wl = new CountingWorklist();
+    pds->setWorklist(wl);
+    RandomPdsGen::Names names;
+    gen->get(*pds, names);
+
+    // post*: the entries of all procedures; pre*: their exits
+    WFA query;
+    Key accept = getKey("accept");
+    sem_elem_t one = (*wg)()->one();
+    RandomPdsGen::Names::KeyVector const & syms = c.post ? names.entries : names.exits;
+    for (size_t i = 0; i < syms.size(); ++i) {
+      query.addTrans(names.pdsState, syms[i], accept, one);
+    }
+    query.setInitialState(names.pdsState);
+    query.addFinalState(accept);
+    if (c.kind == SUMMARY) {
+      for (size_t i = 0; i < names.entries.size(); ++i) {
+        static_cast<fwpds::SWPDS*>(pds)->addEntryPoint(names.entries[i]);
+      }
+    }
+    CountRules rules;
+    pds->for_each(rules);
+    r.rules = rules.n;
+    r.in_trans = static_cast<long>(syms.size());
+    r.gen_s = seconds() - start;
+
+    start = seconds();
+    WFA answer;
+    if (c.post) {
+      pds->poststar(query, answer);
+    }
+    else {
+      pds->prestar(query, answer);
+    }
+    ForceTrans force;
+    answer.for_each(force);
+    r.time_s = seconds() - start;
+
+    r.out_trans = force.n;
+    r.out_states = static_cast<long>(answer.numStates());
+    r.worklist_gets = wl->gets;
+    r.ok = 1;
+    delete pds;
+    return r;
+  }
+
+  /// An NWA with one initial state. With probability density, each
+  /// state is final (at least one is) and has an epsilon jump, and for
+  /// each symbol an internal, a call and a return transition, each to a
+  /// random state; the return has a random call predecessor. This is
+  /// RandomNwa's deterministic density for internals and calls and its
+  /// single source, single predecessor density for returns.
+  opennwa::NwaRefPtr randomNwa( string const & prefix, int states, int symbols,
+                                double density )
+  {
+    using opennwa::State;
+    using opennwa::Symbol;
+    opennwa::NwaRefPtr nwa = new opennwa::Nwa();
+    vector<State> q;
+    vector<Symbol> s;
+    for (int i = 0; i < states; ++i) {
+      stringstream ss;
+      ss << prefix << i;
+      q.push_back(getKey(ss.str()));
+      nwa->addState(q.back());
+    }
+    for (int i = 0; i < symbols; ++i) {
+      stringstream ss;
+      ss << "a" << i;
+      s.push_back(getKey(ss.str()));
+      nwa->addSymbol(s.back());
+    }
+    nwa->addInitialState(q[0]);
+    int limit = static_cast<int>(density * RAND_MAX);
+    for (int a = 0; a < states; ++a) {
+      if (rand() < limit) {
+        nwa->addFinalState(q[a]);
+      }
+    }
+    if (nwa->sizeFinalStates() == 0) {
+      nwa->addFinalState(q[rand() % states]);
+    }
+    for (int a = 0; a < states; ++a) {
+      if (rand() < limit) {
+        nwa->addInternalTrans(q[a], opennwa::EPSILON, q[rand() % states]);
+      }
+      for (int x = 0; x < symbols; ++x) {
+        if (rand() < limit) {
+          nwa->addInternalTrans(q[a], s[x], q[rand() % states]);
+        }
+        if (rand() < limit) {
+          nwa->addCallTrans(q[a], s[x], q[rand() % states]);
+        }
+        if (rand() < limit) {
+          nwa->addReturnTrans(q[a], q[rand() % states], s[x], q[rand() % states]);
+        }
+      }
+    }
+    return nwa;
+  }
+
+  Result runNwa( Case const & c, Params const & p, int scale )
+  {
+    Result r = blankResult();
+    double start = seconds();
+
+    srand(p.seed);
+    int states = (c.kind == DETERMINIZE) ? p.dstates + scale - 1 : p.states * scale;
+    opennwa::NwaRefPtr a = randomNwa("q", states, p.symbols, p.density);
+    opennwa::NwaRefPtr b = randomNwa("r", states, p.symbols, p.density);
+    opennwa::NwaRefPtr product;
+    if (c.kind == EMPTINESS) {
+      product = opennwa::construct::intersect(*a, *b);
+    }
+    r.in_trans = static_cast<long>(a->sizeTrans());
+    if (c.kind == INTERSECT) {
+      r.in_trans += static_cast<long>(b->sizeTrans());
+    }
+    r.gen_s = seconds() - start;
+
+    start = seconds();
+    opennwa::NwaRefPtr result;
+    switch (c.kind) {
+      case INTERSECT:
+        result = opennwa::construct::intersect(*a, *b);
+        break;
+      case DETERMINIZE:
+        result = opennwa::construct::determinize(*a);
+        break;
+      case EMPTINESS:
+        r.in_trans = static_cast<long>(product->sizeTrans());
+        opennwa::query::languageIsEmpty(*product);
+        break;
+      default:
+        assert(false);
+    }
+    r.time_s = seconds() - start;
+
+    if (result != NULL) {
+      r.out_trans = static_cast<long>(result->sizeTrans());
+      r.out_states = static_cast<long>(result->sizeStates());
+    }
+    r.ok = 1;
+    return r;
+  }
+
+  Result runCase( Case const & c, Params const & p, int scale )
+  {
+    Result r = (c.kind >= INTERSECT) ? runNwa(c, p, scale) : runPds(c, p, scale);
+    r.peak_rss_kb = peakRssKb();
+    return r;
+  }
+
+  /// Runs the case in a child process and reads its Result back through
+  /// a pipe. @return false if the child failed
+  bool runIsolated( Case const & c, Params const & p, int scale, Result & r )
+  {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      return false;
+    }
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      close(fds[0]);
+      close(fds[1]);
+      return false;
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      // Keep what the library prints out of the results
+      dup2(2, 1);
+      Result res = runCase(c, p, scale);
+      cout.flush();
+      ssize_t n = write(fds[1], &res, sizeof(res));
+      _exit(n == static_cast<ssize_t>(sizeof(res)) ? 0 : 1);
+    }
+    close(fds[1]);
+    char * buf = reinterpret_cast<char*>(&r);
+    size_t got = 0;
+    while (got < sizeof(r)) {
+      ssize_t n = read(fds[0], buf + got, sizeof(r) - got);
+      if (n <= 0) {
+        break;
+      }
+      got += static_cast<size_t>(n);
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status)) {
+      cerr << c.name << ": killed by signal " << WTERMSIG(status) << "\n";
+    }
+    return got == sizeof(r) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  struct Row
+  {
+    const char * name;
+    int scale;
+    Result r;
+  };
+
+  void printCount( ostream & o, const char * key, long v, bool json )
+  {
+    if (json) {
+      if (v >= 0) {
+        o << ", \"" << key << "\": " << v;
+      }
+    }
+    else {
+      o << ",";
+      if (v >= 0) {
+        o << v;
+      }
+    }
+  }
+
+  void printJson( ostream & o, Params const & p, vector<Row> const & rows )
+  {
+    o << "{\n"
+      << "  \"benchmark\": \"wali_benchmark\",\n"
+      << "  \"params\": {\"seed\": " << p.seed
+      << ", \"procs\": " << p.procs << ", \"nodes\": " << p.nodes
+      << ", \"calls\": " << p.calls << ", \"splits\": " << p.splits
+      << ", \"pcall\": " << p.pcall << ", \"psplit\": " << p.psplit
+      << ", \"vars\": " << p.vars << ", \"bddnodes\": " << p.bddnodes
+      << ", \"states\": " << p.states << ", \"dstates\": " << p.dstates
+      << ", \"symbols\": " << p.symbols << ", \"density\": " << p.density
+      << ", \"repeat\": " << p.repeat << "},\n"
+      << "  \"results\": [";
+    for (size_t i = 0; i < rows.size(); ++i) {
+      Result const & r = rows[i].r;
+      o << (i == 0 ? "\n" : ",\n")
+        << "    {\"case\": \"" << rows[i].name << "\", \"scale\": " << rows[i].scale
+        << ", \"ok\": " << (r.ok ? "true" : "false");
+      if (r.ok) {
+        o << ", \"gen_s\": " << r.gen_s << ", \"time_s\": " << r.time_s;
+      }
+      printCount(o, "peak_rss_kb", r.peak_rss_kb, true);
+      printCount(o, "rules", r.rules, true);
+      printCount(o, "in_trans", r.in_trans, true);
+      printCount(o, "out_trans", r.out_trans, true);
+      printCount(o, "out_states", r.out_states, true);
+      printCount(o, "worklist_gets", r.worklist_gets, true);
+      o << "}";
+    }
+    o << "\n  ]\n}\n";
+  }
+
+  void printCsv( ostream & o, Params const & p, vector<Row> const & rows )
+  {
+    o << "case,scale,seed,ok,gen_s,time_s,peak_rss_kb,rules,in_trans,"
+      << "out_trans,out_states,worklist_gets\n";
+    for (size_t i = 0; i < rows.size(); ++i) {
+      Result const & r = rows[i].r;
+      o << rows[i].name << "," << rows[i].scale << "," << p.seed << ","
+        << (r.ok ? 1 : 0) << ",";
+      if (r.ok) {
+        o << r.gen_s << "," << r.time_s;
+      }
+      else {
+        o << ",";
+      }
+      printCount(o, "peak_rss_kb", r.peak_rss_kb, false);
+      printCount(o, "rules", r.rules, false);
+      printCount(o, "in_trans", r.in_trans, false);
+      printCount(o, "out_trans", r.out_trans, false);
+      printCount(o, "out_states", r.out_states, false);
+      printCount(o, "worklist_gets", r.worklist_gets, false);
+      o << "\n";
+    }
+  }
+
+  void getDouble( util::ParseArgv const & args, const char * key, double & d )
+  {
+    string s;
+    if (args.get(key, s)) {
+      d = atof(s.c_str());
+    }
+  }
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+  util::ParseArgv args(argc, argv);
+  Params p;
+  int seed = 1;
+  args.geti("seed", seed);
+  p.seed = static_cast<unsigned>(seed);
+  p.procs = 50;
+  p.nodes = 4;
+  p.calls = 2;
+  p.splits = 1;
+  p.pcall = 0.45;
+  p.psplit = 0.45;
+  p.vars = 2;
+  p.bddnodes = 100000;
+  p.states = 8;
+  p.dstates = 4;
+  p.symbols = 2;
+  p.density = 0.5;
+  p.repeat = 1;
+  p.format = "json";
+  p.isolate = 1;
+  args.geti("procs", p.procs);
+  args.geti("nodes", p.nodes);
+  args.geti("calls", p.calls);
+  args.geti("splits", p.splits);
+  getDouble(args, "pcall", p.pcall);
+  getDouble(args, "psplit", p.psplit);
+  args.geti("vars", p.vars);
+  args.geti("bddnodes", p.bddnodes);
+  args.geti("states", p.states);
+  args.geti("dstates", p.dstates);
+  args.geti("symbols", p.symbols);
+  getDouble(args, "density", p.density);
+  args.geti("repeat", p.repeat);
+  args.get("cases", p.cases);
+  args.get("format", p.format);
+  args.get("out", p.out);
+  args.geti("isolate", p.isolate);
+
+  string scales = "1,2,4";
+  args.get("scales", scales);
+  stringstream ss(scales);
+  string item;
+  while (getline(ss, item, ',')) {
+    int s = atoi(item.c_str());
+    if (s > 0) {
+      p.scales.push_back(s);
+    }
+  }
+
+  if (seed == 0 || p.scales.empty() || p.procs <= 0 || p.states <= 0 || p.dstates <= 0
+      || p.symbols <= 0 || p.repeat <= 0
+      || (p.format != "json" && p.format != "csv")) {
+    cerr << "usage: " << argv[0] << " [seed=N] [scales=1,2,4] [procs=N] [nodes=N]"
+         << " [calls=N] [splits=N] [pcall=P] [psplit=P] [vars=N] [bddnodes=N]"
+         << " [states=N] [dstates=N]"
+         << " [symbols=N] [density=P] [repeat=N] [cases=S] [format=json|csv]"
+         << " [out=FILE] [isolate=0|1]\n";
+    return 2;
+  }
+
+  // FWPDS would otherwise check every answer against EWPDS
+  set_verify_fwpds(false);
+
+  vector<Row> rows;
+  bool failed = false;
+  for (size_t s = 0; s < p.scales.size(); ++s) {
+    for (size_t i = 0; i < num_cases; ++i) {
+      Case const & c = all_cases[i];
+      if (string(c.name).find(p.cases) == string::npos) {
+        continue;
+      }
+      Row row;
+      row.name = c.name;
+      row.scale = p.scales[s];
+      row.r = blankResult();
+      for (int k = 0; k < p.repeat; ++k) {
+        Result r = blankResult();
+        if (!p.isolate) {
+          r = runCase(c, p, row.scale);
+        }
+        else if (!runIsolated(c, p, row.scale, r)) {
+          row.r = blankResult();
+          break;
+        }
+        if (!row.r.ok || r.time_s < row.r.time_s) {
+          long rss = (row.r.peak_rss_kb > r.peak_rss_kb) ? row.r.peak_rss_kb : r.peak_rss_kb;
+          row.r = r;
+          row.r.peak_rss_kb = rss;
+        }
+      }
+      failed = failed || !row.r.ok;
+      cerr << c.name << " scale " << row.scale << ": ";
+      if (row.r.ok) {
+        cerr << row.r.time_s << "s, " << row.r.peak_rss_kb << " KB\n";
+      }
+      else {
+        cerr << "FAILED\n";
+      }
+      rows.push_back(row);
+    }
+  }
+
+  ofstream file;
+  if (!p.out.empty()) {
+    file.open(p.out.c_str());
+    if (!file) {
+      cerr << "cannot write " << p.out << "\n";
+      return 2;
+    }
+  }
+  ostream & o = p.out.empty() ? cout : file;
+  if (p.format == "json") {
+    printJson(o, p, rows);
+  }
+  else {
+    printCsv(o, p, rows);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+// Times poststar on a random program over shortest-path weights with each
+// of the worklists that order transitions by distance, and with the
+// control-flow ordered WtoWorklist, and checks that they agree.
+//
+// usage: worklist_speed_test [seed [procedures [nodes-per-procedure]]]
+
+#include "wali/ShortestPathSemiring.hpp"
+#include "wali/ShortestPathWorklist.hpp"
+#include "wali/DefaultWorklist.hpp"
+#include "wali/wpds/WPDS.hpp"
+#include "wali/wpds/WtoWorklist.hpp"
+#include "wali/wfa/TransFunctor.hpp"
+#include "wali/util/Timer.hpp"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace wali;
+using namespace wali::wpds;
+using namespace wali::wfa;
+
+namespace {
+
+  Key node(int proc, int n)
+  {
+    stringstream ss;
+    ss << "f" << proc << "_n" << n;
+    return getKey(ss.str());
+  }
+
+  /// Each procedure is a chain of nodes with some forward jumps; some
+  /// nodes call a random procedure, and the last node returns.
+  void buildProgram(WPDS & pds, int procs, int nodes)
+  {
+    Key p = getKey("p");
+    for (int f = 0; f < procs; ++f) {
+      for (int n = 0; n + 1 < nodes; ++n) {
+        sem_elem_t w = new ShortestPathSemiring(rand() % 10 + 1);
+        int r = rand() % 10;
+        if (r < 2) {
+          pds.add_rule(p, node(f, n), p, node(rand() % procs, 0), node(f, n + 1), w);
+        }
+        else {
+          pds.add_rule(p, node(f, n), p, node(f, n + 1), w);
+          if (r == 9 && n + 2 < nodes) {
+            int target = n + 2 + rand() % (nodes - n - 2);
+            pds.add_rule(p, node(f, n), p, node(f, target),
+                         new ShortestPathSemiring(rand() % 10 + 1));
+          }
+        }
+      }
+      pds.add_rule(p, node(f, nodes - 1), p, new ShortestPathSemiring(1));
+    }
+  }
+
+  /// Sums the distances of the transitions
+  struct Sum : ConstTransFunctor
+  {
+    unsigned long total;
+
+    Sum() : total(0) {}
+
+    virtual void operator()(ITrans const * t) {
+      total += dynamic_cast<ShortestPathSemiring*>(t->weight().get_ptr())->getNum();
+    }
+  };
+
+  unsigned long run(WPDS & pds, WFA const & query,
+                    ref_ptr< Worklist<ITrans> > wl, char const * name)
+  {
+    pds.setWorklist(wl);
+    WFA answer;
+    {
+      util::GoodTimer timer(name);
+      pds.poststar(query, answer);
+    }
+    Sum sum;
+    answer.for_each(sum);
+    return sum.total;
+  }
+
+}
+
+int main(int argc, char ** argv)
+{
+  int seed = (argc > 1) ? atoi(argv[1]) : (int)time(NULL);
+  int procs = (argc > 2) ? atoi(argv[2]) : 200;
+  int nodes = (argc > 3) ? atoi(argv[3]) : 50;
+  srand(seed);
+
+  WPDS pds;
+  buildProgram(pds, procs, nodes);
+
+  Key p = getKey("p"), accept = getKey("accept");
+  sem_elem_t one = ShortestPathSemiring(0).one();
+  WFA query;
+  query.addState(p, one->zero());
+  query.addState(accept, one->zero());
+  query.setInitialState(p);
+  query.addFinalState(accept);
+  query.addTrans(p, node(0, 0), accept, one);
+
+  cout << "seed " << seed << ", " << pds.count_rules() << " rules\n";
+
+  unsigned long expected =
+    run(pds, query, new DefaultWorklist<ITrans>(), "DefaultWorklist");
+  unsigned long totals[] = {
+    run(pds, query, new ShortestPathWorklist(), "ShortestPathWorklist (multimap)"),
+    run(pds, query, new ShortestPathBucketWorklist(), "ShortestPathBucketWorklist"),
+    run(pds, query, new ShortestPathBucketWorklist(8), "ShortestPathBucketWorklist, width 8"),
+    run(pds, query, new ShortestPathRadixWorklist(), "ShortestPathRadixWorklist"),
+    run(pds, query, new WtoWorklist(pds), "WtoWorklist")
+  };
+
+  int mismatches = 0;
+  for (size_t i = 0; i < sizeof(totals) / sizeof(totals[0]); ++i) {
+    if (totals[i] != expected) {
+      ++mismatches;
+    }
+  }
+  cout << mismatches << " mismatches\n";
+  return mismatches == 0 ? 0 : 1;
+}
+
+// Yo, Emacs!
+// Local Variables:
+//   c-file-style: "ellemtel"
+//   c-basic-offset: 2
+// End: